@@ -0,0 +1,414 @@
+// SPDX-License-Identifier: MIT
+#include "check_jobs.h"
+#include "typecheck.h"
+#include "../compiler.h"
+#include "../parser/parser.h"
+#include "../platform/arch.h"
+#include "../utils/colors.h"
+#include <stdio.h>
+#include <string.h>
+
+#if ZC_OS_WINDOWS
+
+CheckJobs *check_jobs_start(TypeChecker *tc, ASTNode *root, int jobs)
+{
+    (void)tc;
+    (void)root;
+    (void)jobs;
+    return NULL;
+}
+
+int check_jobs_enter(TypeChecker *tc, ASTNode *fn)
+{
+    (void)tc;
+    (void)fn;
+    return 1;
+}
+
+void check_jobs_leave(TypeChecker *tc, ASTNode *fn)
+{
+    (void)tc;
+    (void)fn;
+}
+
+void check_jobs_finish(TypeChecker *tc)
+{
+    (void)tc;
+}
+
+#else
+
+#include <stdint.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// What a worker checked: one function body and the diagnostics it printed.
+typedef struct
+{
+    uint32_t unit;
+    int errors;
+    int warnings;
+    long start; // Offset of its first byte in the worker's stderr file
+    long end;
+} CheckRecord;
+
+typedef struct
+{
+    pid_t pid;
+    FILE *err;     // The worker's stderr
+    FILE *records; // Its CheckRecords, in the order it checked them
+    int state;     // 0 running, 1 done, -1 failed (the parent checks its bodies itself)
+    char *text;    // Contents of err once done
+} CheckWorker;
+
+typedef struct
+{
+    int owner; // 0 = the parent, k = worker k
+    int done;  // Parent: a CheckRecord for it has been loaded
+    CheckRecord record;
+} CheckUnit;
+
+struct CheckJobs
+{
+    int worker; // 0 in the parent, k in worker k
+    int count;  // Processes, parent included
+    CheckWorker *workers;
+
+    // Function bodies known when the workers were forked, in the order of a serial check.
+    CheckUnit *units;
+    uint32_t unit_count;
+
+    // Open-addressed node -> units index + 1, 0 = empty.
+    ASTNode **keys;
+    uint32_t *slots;
+    uint32_t cap; // Power of two
+
+    int depth;        // Bodies being checked in this process, nested inside each other
+    uint32_t current; // Unit of the outermost one
+    int current_errors;
+    int current_warnings;
+    long current_start;
+    int inst_count; // Length of ctx->instantiated_funcs at fork time
+};
+
+static uint32_t node_hash(ASTNode *node)
+{
+    uintptr_t p = (uintptr_t)node;
+    return (uint32_t)((p >> 4) * 2654435761u);
+}
+
+static uint32_t *unit_slot(CheckJobs *j, ASTNode *node)
+{
+    uint32_t i = node_hash(node) & (j->cap - 1);
+    while (j->slots[i] && j->keys[i] != node)
+    {
+        i = (i + 1) & (j->cap - 1);
+    }
+    j->keys[i] = node;
+    return &j->slots[i];
+}
+
+static void add_unit(CheckJobs *j, ASTNode *node)
+{
+    if (!node || node->type != NODE_FUNCTION || !node->func.body)
+    {
+        return;
+    }
+    if ((j->unit_count + 1) * 2 > j->cap)
+    {
+        uint32_t cap = j->cap ? j->cap * 2 : 256;
+        ASTNode **keys = xcalloc(cap, sizeof(ASTNode *));
+        uint32_t *slots = xcalloc(cap, sizeof(uint32_t));
+        ASTNode **old_keys = j->keys;
+        uint32_t *old_slots = j->slots;
+        uint32_t old_cap = j->cap;
+        j->keys = keys;
+        j->slots = slots;
+        j->cap = cap;
+        for (uint32_t i = 0; i < old_cap; i++)
+        {
+            if (old_slots[i])
+            {
+                *unit_slot(j, old_keys[i]) = old_slots[i];
+            }
+        }
+    }
+    uint32_t *slot = unit_slot(j, node);
+    if (*slot)
+    {
+        return;
+    }
+    *slot = ++j->unit_count;
+}
+
+static void add_methods(CheckJobs *j, ASTNode *method)
+{
+    for (; method; method = method->next)
+    {
+        add_unit(j, method);
+    }
+}
+
+// Same walk as check_node() takes to reach function bodies; see tc_check_impl().
+static void collect_units(CheckJobs *j, ASTNode *root, int depth)
+{
+    if (!root || root->type != NODE_ROOT || depth > 64)
+    {
+        return;
+    }
+    for (ASTNode *n = root->root.children; n; n = n->next)
+    {
+        switch (n->type)
+        {
+        case NODE_ROOT:
+            collect_units(j, n, depth + 1);
+            break;
+        case NODE_IMPORT:
+            collect_units(j, n->import_stmt.module_root, depth + 1);
+            break;
+        case NODE_FUNCTION:
+            add_unit(j, n);
+            break;
+        case NODE_TRAIT:
+            add_methods(j, n->trait.methods);
+            break;
+        case NODE_IMPL:
+            if (!n->impl.struct_name || !strchr(n->impl.struct_name, '<'))
+            {
+                add_methods(j, n->impl.methods);
+            }
+            break;
+        case NODE_IMPL_TRAIT:
+            if (!n->impl_trait.target_type || !strchr(n->impl_trait.target_type, '<'))
+            {
+                add_methods(j, n->impl_trait.methods);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static CheckUnit *find_unit(CheckJobs *j, ASTNode *node)
+{
+    uint32_t i = node_hash(node) & (j->cap - 1);
+    while (j->slots[i])
+    {
+        if (j->keys[i] == node)
+        {
+            return &j->units[j->slots[i] - 1];
+        }
+        i = (i + 1) & (j->cap - 1);
+    }
+    return NULL;
+}
+
+static int list_length(ASTNode *n)
+{
+    int count = 0;
+    for (; n; n = n->next)
+    {
+        count++;
+    }
+    return count;
+}
+
+CheckJobs *check_jobs_start(TypeChecker *tc, ASTNode *root, int jobs)
+{
+    ParserContext *ctx = tc->pctx;
+    CompilerConfig *cfg = ctx->config;
+    // The MISRA audits read is_used flags set while checking, JSON diagnostics are one
+    // document, and the LSP keeps the checked tree around.
+    if (jobs < 2 || !cfg->mode_check || cfg->misra_mode || cfg->json_output ||
+        ctx->is_fault_tolerant)
+    {
+        return NULL;
+    }
+
+    CheckJobs *j = xcalloc(1, sizeof(CheckJobs));
+    collect_units(j, root, 0);
+    for (ASTNode *n = ctx->instantiated_funcs; n; n = n->next)
+    {
+        if (!n->is_checked)
+        {
+            add_unit(j, n);
+        }
+    }
+    if (j->unit_count < (uint32_t)jobs * 2)
+    {
+        jobs = (int)(j->unit_count / 2);
+    }
+    if (jobs < 2)
+    {
+        return NULL;
+    }
+    j->count = jobs;
+    j->inst_count = list_length(ctx->instantiated_funcs);
+    j->units = xcalloc(j->unit_count, sizeof(CheckUnit));
+    j->workers = xcalloc((size_t)jobs, sizeof(CheckWorker));
+
+    // Consecutive runs of bodies, so the parent checks the first while the workers check the
+    // rest and their output is usually ready by the time the parent gets to it.
+    for (uint32_t i = 0; i < j->unit_count; i++)
+    {
+        j->units[i].owner = (int)((uint64_t)i * (uint64_t)jobs / j->unit_count);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    int stderr_tty = isatty(2);
+    for (int k = 1; k < jobs; k++)
+    {
+        CheckWorker *w = &j->workers[k];
+        w->err = tmpfile();
+        w->records = tmpfile();
+        w->pid = (w->err && w->records) ? fork() : -1;
+        if (w->pid == 0)
+        {
+            j->worker = k;
+            zcolors_assume_tty(2, stderr_tty);
+            dup2(fileno(w->err), 2);
+            tc->jobs = j;
+            return j;
+        }
+        if (w->pid < 0)
+        {
+            w->state = -1;
+        }
+    }
+    tc->jobs = j;
+    return j;
+}
+
+// Parent: wait for worker k and load what it printed.
+static void join_worker(CheckJobs *j, int k)
+{
+    CheckWorker *w = &j->workers[k];
+    if (w->state != 0)
+    {
+        return;
+    }
+    int status = 0;
+    w->state = -1;
+    if (waitpid(w->pid, &status, 0) != w->pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return;
+    }
+    fseek(w->err, 0, SEEK_END);
+    long size = ftell(w->err);
+    rewind(w->err);
+    w->text = xmalloc((size_t)size + 1);
+    if (size < 0 || fread(w->text, 1, (size_t)size, w->err) != (size_t)size)
+    {
+        return;
+    }
+    rewind(w->records);
+    CheckRecord r;
+    while (fread(&r, sizeof(r), 1, w->records) == 1)
+    {
+        if (r.unit >= j->unit_count || r.start < 0 || r.end < r.start || r.end > size)
+        {
+            return;
+        }
+        j->units[r.unit].record = r;
+        j->units[r.unit].done = 1;
+    }
+    w->state = 1;
+}
+
+int check_jobs_enter(TypeChecker *tc, ASTNode *fn)
+{
+    CheckJobs *j = tc->jobs;
+    if (!j)
+    {
+        return 1;
+    }
+    if (j->depth > 0)
+    {
+        j->depth++;
+        return 1;
+    }
+
+    CheckUnit *u = find_unit(j, fn);
+    if (j->worker)
+    {
+        if (!u || u->owner != j->worker)
+        {
+            return 0;
+        }
+        j->current = (uint32_t)(u - j->units);
+        j->current_errors = g_error_count;
+        j->current_warnings = g_warning_count;
+        j->current_start = lseek(2, 0, SEEK_CUR);
+        j->depth = 1;
+        return 1;
+    }
+
+    if (u && u->owner)
+    {
+        join_worker(j, u->owner);
+        if (j->workers[u->owner].state == 1 && u->done)
+        {
+            CheckRecord *r = &u->record;
+            fflush(stderr);
+            fwrite(j->workers[u->owner].text + r->start, 1, (size_t)(r->end - r->start), stderr);
+            g_error_count += r->errors;
+            g_warning_count += r->warnings;
+            return 0;
+        }
+    }
+    j->depth = 1;
+    return 1;
+}
+
+void check_jobs_leave(TypeChecker *tc, ASTNode *fn)
+{
+    (void)fn;
+    CheckJobs *j = tc->jobs;
+    if (!j || --j->depth > 0 || !j->worker)
+    {
+        return;
+    }
+    CheckRecord r = {0};
+    r.unit = j->current;
+    r.errors = g_error_count - j->current_errors;
+    r.warnings = g_warning_count - j->current_warnings;
+    r.start = j->current_start;
+    r.end = lseek(2, 0, SEEK_CUR);
+    fwrite(&r, sizeof(r), 1, j->workers[j->worker].records);
+}
+
+void check_jobs_finish(TypeChecker *tc)
+{
+    CheckJobs *j = tc->jobs;
+    if (!j)
+    {
+        return;
+    }
+    tc->jobs = NULL;
+    if (j->worker)
+    {
+        // Checking added instantiations a serial check would have checked too, but the parent
+        // never sees them: leave all of this worker's bodies to the parent.
+        int diverged = list_length(tc->pctx->instantiated_funcs) != j->inst_count;
+        fflush(stdout);
+        fflush(stderr);
+        int ok = fflush(j->workers[j->worker].records) == 0 && !diverged;
+        _exit(ok ? 0 : 2);
+    }
+    for (int k = 1; k < j->count; k++)
+    {
+        join_worker(j, k);
+        if (j->workers[k].err)
+        {
+            fclose(j->workers[k].err);
+        }
+        if (j->workers[k].records)
+        {
+            fclose(j->workers[k].records);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MIT
+#ifndef CHECK_JOBS_H
+#ifndef ZC_ALLOW_INTERNAL
+#error "analysis/check_jobs.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#define CHECK_JOBS_H
+
+#include "ast.h"
+
+typedef struct TypeChecker TypeChecker;
+
+/**
+ * @brief Function bodies of `zc check` split across worker processes (--check-jobs).
+ *
+ * After the prepass the checker forks one process per worker. Each worker walks the program
+ * like a serial check but only checks the function bodies assigned to it, with stderr going to a
+ * private file. The parent then does the walk itself, skipping those bodies and printing each
+ * one's diagnostics where a serial check would have, so the output does not depend on the
+ * number of workers. Forking gives every worker its own arena, intern table, scopes and types,
+ * none of which are safe to share between threads.
+ */
+typedef struct CheckJobs CheckJobs;
+
+/**
+ * @brief Fork @p jobs workers for the function bodies under @p root.
+ *
+ * Returns in the parent once every worker is done, and in each worker straight away; either way
+ * tc->jobs is set. NULL (and a serial check) when forking is unavailable or not worth it.
+ */
+CheckJobs *check_jobs_start(TypeChecker *tc, ASTNode *root, int jobs);
+
+/**
+ * @brief Whether the body of @p fn is checked in this process. When another process checked
+ * it, its diagnostics are printed instead. A 1 must be paired with check_jobs_leave().
+ */
+int check_jobs_enter(TypeChecker *tc, ASTNode *fn);
+void check_jobs_leave(TypeChecker *tc, ASTNode *fn);
+
+/**
+ * @brief End of the walk: a worker reports its diagnostics and exits, the parent cleans up.
+ */
+void check_jobs_finish(TypeChecker *tc);
+
+#endif // CHECK_JOBS_H
@@ -1,16 +1,29 @@
 // SPDX-License-Identifier: MIT
 #include "comptime_interpreter.h"
+#include "../constants.h"
 #include "../diagnostics/diagnostics.h"
-#include <string.h>
-#include <stdlib.h>
+#include "../utils/intern.h"
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-// Max comptime execution steps
-#define MAX_STEPS 1000000
+// Comptime code is lowered once to register bytecode and run by a dispatch loop. Every name a
+// block or @comptime fn declares owns one register for the whole body, which gives the flat
+// scoping of the language (a `let` stays visible after its block). Expression temporaries live
+// above the named registers.
+
+// Max comptime instructions executed per block
+#define MAX_STEPS 10000000
 // Max recursion depth for @comptime fn calls
 #define MAX_RECURSION 64
 // Max yield buffer
 #define MAX_YIELD (1024 * 1024)
+// Registers of one body (instruction operands are 16-bit)
+#define MAX_REGS 0xFFFF
+// Parameter without a name
+#define NO_REG 0xFFFF
 
 // Tagged value type
 typedef enum
@@ -18,112 +31,119 @@ typedef enum
     VAL_NULL,
     VAL_INT,
     VAL_BOOL,
-    VAL_STRING
+    VAL_STRING,
+    VAL_UNSET ///< Register of a name whose `let` has not run yet.
 } CValType;
 
+// Strings are immutable arena copies, shared freely between registers.
 typedef struct
 {
     CValType type;
+    uint32_t len; ///< Bytes of a VAL_STRING.
     union
     {
         int64_t i;
         int b;
-        char *s;
+        const char *s;
     } as;
 } CValue;
 
-static const CValue val_null = {VAL_NULL, {0}};
+static const CValue val_null = {VAL_NULL, 0, {0}};
 
-// Scope entry
-typedef struct CScope
+typedef enum
 {
-    char *name;
-    CValue value;
-    struct CScope *next;
-} CScope;
+    OP_CONST, // r[a] = K[b]
+    OP_MOVE,  // r[a] = r[b]
+    OP_CHECK, // fail unless r[a] is set; K[b] names it
+    OP_ADD,   // r[a] = r[b] + r[c], also string concatenation
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE,
+    OP_AND, // r[a] = r[b] && r[c], both already evaluated
+    OP_OR,
+    OP_BADOP,        // r[b] op r[c] for an operator comptime lacks
+    OP_NEG,          // r[a] = -r[b]
+    OP_NOT,          // r[a] = !r[b]
+    OP_INT,          // r[a] = r[b], which must be an integer
+    OP_JUMP,         // pc = b
+    OP_JUMP_FALSE,   // pc = b unless r[a] is truthy
+    OP_RANGE,        // pc = c unless r[a] < r[b]
+    OP_RANGE_INCL,   // pc = c unless r[a] <= r[b]
+    OP_INC,          // r[a].i++
+    OP_CALL,         // r[a] = calls[b](r[c], r[c + 1], ...)
+    OP_RETURN,       // return r[a] if b, else null
+    OP_YIELD,        // append r[a] to the output
+    OP_COMPILE_ERROR,
+    OP_COMPILE_WARN,
+    OP_ASSERT, // fail with K[b] unless r[a] is truthy
+    OP_FAIL    // report K[b] and stop
+} COp;
 
-// Interpreter state
 typedef struct
 {
-    ParserContext *pctx;
-    CScope *scope;
-    char *yield_buf;
-    size_t yield_cap;
-    size_t yield_len;
-    const char *source_file;
-    int step_count;
-    int rec_depth;
-    int error_happened;
-} CInterp;
-
-static CScope *scope_push(CScope *head, const char *name, CValue val)
-{
-    CScope *e = xmalloc(sizeof(CScope));
-    e->name = xstrdup(name);
-    e->value = val;
-    e->next = head;
-    return e;
-}
+    uint16_t op;
+    uint16_t a;
+    int32_t b;
+    int32_t c;
+} CInstr;
 
-static void scope_pop(CScope **head)
-{
-    if (!*head)
-    {
-        return;
-    }
-    CScope *tmp = *head;
-    *head = (*head)->next;
-    if (tmp->value.type == VAL_STRING)
-    {
-        zfree(tmp->value.as.s);
-    }
-    zfree(tmp->name);
-    zfree(tmp);
-}
+typedef struct CFunc CFunc;
 
-static void scope_pop_all(CScope **head)
+// Call site of a @comptime fn; the callee is lowered on its first call.
+typedef struct
 {
-    while (*head)
-    {
-        scope_pop(head);
-    }
-}
+    ASTNode *fn;
+    CFunc *code;
+    uint16_t argc;
+} CCall;
 
-static CValue *scope_find(CScope *head, const char *name)
+struct CFunc
 {
-    for (CScope *e = head; e; e = e->next)
-    {
-        if (strcmp(e->name, name) == 0)
-        {
-            return &e->value;
-        }
-    }
-    return NULL;
-}
+    CInstr *code;
+    ASTNode **at; ///< Source of each instruction, for diagnostics.
+    uint32_t count;
+    CValue *consts;
+    uint32_t const_count;
+    CCall *calls;
+    uint32_t call_count;
+    uint16_t *params; ///< Register of each parameter.
+    uint16_t param_count;
+    uint16_t regs;
+};
 
-static CValue val_string(const char *s)
+// Lowered @comptime fn, shared by every call site of one interpret_comptime() run.
+typedef struct CFuncEntry
 {
-    CValue v = {VAL_STRING, {0}};
-    v.as.s = xstrdup(s ? s : "");
-    return v;
-}
+    ASTNode *fn;
+    CFunc *code;
+    struct CFuncEntry *next;
+} CFuncEntry;
 
-static void val_free(CValue *v)
+// Interpreter state
+typedef struct
 {
-    if (v->type == VAL_STRING)
-    {
-        zfree(v->as.s);
-        v->as.s = NULL;
-    }
-}
+    ParserContext *pctx;
+    char *yield_buf;
+    size_t yield_cap;
+    size_t yield_len;
+    const char *source_file;
+    int64_t steps_left;
+    int rec_depth;
+    int error_happened;
+    CValue *stack; ///< Registers of every active call.
+    uint32_t stack_cap;
+    CFuncEntry *funcs;
+} CInterp;
 
-static void yield_append(CInterp *ci, const char *s)
+static void yield_append(CInterp *ci, const char *s, size_t len)
 {
-    if (!s)
-    {
-        return;
-    }
-    size_t len = strlen(s);
     if (ci->yield_len + len + 1 > ci->yield_cap)
     {
         size_t new_cap = ci->yield_cap ? ci->yield_cap * 2 : 4096;
@@ -140,339 +160,404 @@ static void yield_append(CInterp *ci, const char *s)
         ci->yield_buf = xrealloc(ci->yield_buf, new_cap);
         ci->yield_cap = new_cap;
     }
-    memcpy(ci->yield_buf + ci->yield_len, s, (size_t)(len));
+    memcpy(ci->yield_buf + ci->yield_len, s, len);
     ci->yield_len += len;
     ci->yield_buf[ci->yield_len] = 0;
 }
 
-// Forward declarations
-static CValue eval_expr(CInterp *ci, ASTNode *node);
-static void exec_stmt(CInterp *ci, ASTNode *node);
-static CValue call_builtin(CInterp *ci, const char *name, ASTNode *args);
-static CValue call_comptime_fn(CInterp *ci, ASTNode *fn_node, ASTNode *args);
+static CValue val_string(const char *s)
+{
+    CValue v = {VAL_STRING, 0, {0}};
+    v.as.s = s ? s : "";
+    v.len = (uint32_t)strlen(v.as.s);
+    return v;
+}
 
-static CValue eval_literal(CInterp *ci, ASTNode *node)
+static CValue val_int(int64_t i)
 {
-    (void)ci;
-    CValue v = {VAL_NULL, {0}};
-    switch (node->literal.type_kind)
-    {
-    case LITERAL_INT:
-        v.type = VAL_INT;
-        v.as.i = (int64_t)node->literal.int_val;
-        break;
-    case LITERAL_FLOAT:
-        v.type = VAL_INT;
-        v.as.i = (int64_t)node->literal.float_val;
-        break;
-    case LITERAL_STRING:
-    case LITERAL_RAW_STRING:
-        v = val_string(node->literal.string_val ? node->literal.string_val : "");
-        break;
-    case LITERAL_CHAR:
-        v.type = VAL_INT;
-        v.as.i = (int64_t)node->literal.int_val;
-        break;
-    default:
-        v = val_null;
-        break;
-    }
+    CValue v = {VAL_INT, 0, {.i = i}};
     return v;
 }
 
-static CValue eval_var(CInterp *ci, ASTNode *node)
+static CValue val_bool(int b)
 {
-    const char *name = node->var_ref.name;
-    if (!name)
-    {
-        return val_null;
-    }
+    CValue v = {VAL_BOOL, 0, {.b = b}};
+    return v;
+}
 
-    // Builtin variables
-    if (strcmp(name, "__COMPTIME_TARGET__") == 0)
-    {
-        return val_string(z_get_system_name());
-    }
-    if (strcmp(name, "__COMPTIME_FILE__") == 0)
-    {
-        return val_string(ci->source_file ? ci->source_file : "");
-    }
-    if (strcmp(name, "true") == 0)
-    {
-        CValue v = {VAL_BOOL, {.b = 1}};
-        return v;
-    }
-    if (strcmp(name, "false") == 0)
-    {
-        CValue v = {VAL_BOOL, {.b = 0}};
-        return v;
-    }
+static int val_truthy(const CValue *v)
+{
+    return (v->type == VAL_INT && v->as.i) || (v->type == VAL_BOOL && v->as.b);
+}
+
+// ** Lowering **
+
+// Jumps to patch once the end of a loop is known.
+typedef struct
+{
+    uint32_t *items;
+    uint32_t count;
+    uint32_t cap;
+} CPatchList;
 
-    CValue *found = scope_find(ci->scope, name);
-    if (!found)
+typedef struct CLoop
+{
+    CPatchList breaks;
+    CPatchList continues;
+    struct CLoop *outer;
+} CLoop;
+
+typedef struct
+{
+    CInterp *ci;
+    CFunc *f;
+    uint32_t code_cap;
+    uint32_t const_cap;
+    uint32_t call_cap;
+    const char **names; ///< Interned; register i holds names[i].
+    uint32_t name_count;
+    uint32_t name_cap;
+    uint8_t *known; ///< 1 = register of names[i] is set on every path to here
+    uint32_t top;   ///< First free temporary
+    uint32_t floor; ///< Temporaries below it belong to enclosing loops
+    int in_function;
+    ASTNode *at;
+    CLoop *loop;
+} Lower;
+
+// lower_expr() destinations other than a register: the result may be left in any register (a
+// variable's own, say), or only the side effects and errors of the expression matter.
+#define ANY_REG (-2)
+#define DISCARD (-1)
+
+static uint32_t emit(Lower *lw, COp op, uint32_t a, int32_t b, int32_t c)
+{
+    CFunc *f = lw->f;
+    if (f->count == lw->code_cap)
+    {
+        lw->code_cap = lw->code_cap ? lw->code_cap * 2 : 64;
+        f->code = xrealloc(f->code, lw->code_cap * sizeof(CInstr));
+        f->at = xrealloc(f->at, lw->code_cap * sizeof(ASTNode *));
+    }
+    CInstr *in = &f->code[f->count];
+    in->op = (uint16_t)op;
+    in->a = (uint16_t)a;
+    in->b = b;
+    in->c = c;
+    f->at[f->count] = lw->at;
+    return f->count++;
+}
+
+static int32_t add_const(Lower *lw, CValue v)
+{
+    CFunc *f = lw->f;
+    if (f->const_count == lw->const_cap)
     {
-        zerror_at(node->token, "comptime: undefined variable '%s'", name);
-        ci->error_happened = 1;
-        return val_null;
+        lw->const_cap = lw->const_cap ? lw->const_cap * 2 : 16;
+        f->consts = xrealloc(f->consts, lw->const_cap * sizeof(CValue));
     }
-    CValue v;
-    if (found->type == VAL_STRING)
+    f->consts[f->const_count] = v;
+    return (int32_t)f->const_count++;
+}
+
+static void patch_add(CPatchList *p, uint32_t pc)
+{
+    if (p->count == p->cap)
     {
-        v = val_string(found->as.s);
+        p->cap = p->cap ? p->cap * 2 : 8;
+        p->items = xrealloc(p->items, p->cap * sizeof(uint32_t));
     }
-    else
+    p->items[p->count++] = pc;
+}
+
+static void patch_to(Lower *lw, CPatchList *p, uint32_t target)
+{
+    for (uint32_t i = 0; i < p->count; i++)
     {
-        memcpy(&v, found, sizeof(CValue));
+        lw->f->code[p->items[i]].b = (int32_t)target;
     }
-    return v;
 }
 
-static int64_t eval_int(CInterp *ci, ASTNode *node)
+static uint32_t alloc_temp(Lower *lw)
 {
-    CValue v = eval_expr(ci, node);
-    if (ci->error_happened)
+    if (lw->top >= MAX_REGS)
     {
+        zerror_at(lw->at ? lw->at->token : TOKEN_UNKNOWN, "comptime: body too large");
+        lw->ci->error_happened = 1;
         return 0;
     }
-    if (v.type != VAL_INT)
+    uint32_t r = lw->top++;
+    if (lw->top > lw->f->regs)
     {
-        zerror_at(node->token, "comptime: expected integer expression");
-        ci->error_happened = 1;
-        val_free(&v);
-        return 0;
+        lw->f->regs = (uint16_t)lw->top;
     }
-    int64_t r = v.as.i;
-    val_free(&v);
     return r;
 }
 
-static CValue eval_binary(CInterp *ci, ASTNode *node)
+static int find_name(Lower *lw, const char *name)
 {
-    CValue left = eval_expr(ci, node->binary.left);
-    if (ci->error_happened)
+    const char *key = name ? intern_find(name) : NULL;
+    for (uint32_t i = 0; key && i < lw->name_count; i++)
     {
-        return val_null;
+        if (lw->names[i] == key)
+        {
+            return (int)i;
+        }
     }
+    return -1;
+}
 
-    const char *op = node->binary.op;
-    if (!op)
+static void declare_name(Lower *lw, const char *name)
+{
+    if (!name || find_name(lw, name) >= 0)
     {
-        val_free(&left);
-        return val_null;
+        return;
+    }
+    if (lw->name_count == lw->name_cap)
+    {
+        lw->name_cap = lw->name_cap ? lw->name_cap * 2 : 16;
+        lw->names = xrealloc((void *)lw->names, lw->name_cap * sizeof(const char *));
     }
+    lw->names[lw->name_count++] = intern(name);
+}
 
-    // Handle string concat with +
-    if (left.type == VAL_STRING && strcmp(op, "+") == 0)
+static ASTNode *branch_statements(ASTNode *s)
+{
+    return (s && s->type == NODE_BLOCK) ? s->block.statements : s;
+}
+
+static void declare_names(Lower *lw, ASTNode *s)
+{
+    for (; s; s = s->next)
     {
-        CValue right = eval_expr(ci, node->binary.right);
-        if (ci->error_happened)
-        {
-            val_free(&left);
-            val_free(&right);
-            return val_null;
-        }
-        if (right.type != VAL_STRING)
+        switch (s->type)
         {
-            zerror_at(node->token, "comptime: cannot concatenate string with non-string");
-            ci->error_happened = 1;
-            val_free(&left);
-            val_free(&right);
-            return val_null;
+        case NODE_VAR_DECL:
+            declare_name(lw, s->var_decl.name);
+            break;
+        case NODE_BLOCK:
+            declare_names(lw, s->block.statements);
+            break;
+        case NODE_IF:
+            declare_names(lw, branch_statements(s->if_stmt.then_body));
+            declare_names(lw, branch_statements(s->if_stmt.else_body));
+            break;
+        case NODE_FOR:
+            declare_names(lw, s->for_stmt.init);
+            declare_names(lw, s->for_stmt.body);
+            declare_names(lw, s->for_stmt.step);
+            break;
+        case NODE_FOR_RANGE:
+            declare_name(lw, s->for_range.var_name);
+            declare_names(lw, s->for_range.body);
+            break;
+        case NODE_WHILE:
+            declare_names(lw, s->while_stmt.body);
+            break;
+        case NODE_LOOP:
+            declare_names(lw, s->loop_stmt.body);
+            break;
+        case NODE_REPEAT:
+            declare_names(lw, s->repeat_stmt.body);
+            break;
+        default:
+            break;
         }
-        size_t sz = strlen(left.as.s) + strlen(right.as.s) + 1;
-        char *buf = xmalloc(sz);
-        snprintf(buf, sz, "%s%s", left.as.s, right.as.s);
-        val_free(&left);
-        val_free(&right);
-        CValue r = {VAL_STRING, {0}};
-        r.as.s = buf;
-        return r;
     }
+}
+
+static uint8_t *known_save(Lower *lw)
+{
+    uint8_t *saved = xmalloc(lw->name_count + 1);
+    memcpy(saved, lw->known, lw->name_count);
+    return saved;
+}
+
+static void known_restore(Lower *lw, uint8_t *saved)
+{
+    memcpy(lw->known, saved, lw->name_count);
+    zfree(saved);
+}
+
+static void fail(Lower *lw, ASTNode *at, const char *fmt, ...)
+{
+    char msg[MAX_ERROR_MSG_LEN];
+    va_list a;
+    va_start(a, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, a);
+    va_end(a);
+    ASTNode *saved = lw->at;
+    lw->at = at;
+    emit(lw, OP_FAIL, 0, add_const(lw, val_string(xstrdup(msg))), 0);
+    lw->at = saved;
+}
+
+static uint32_t lower_expr(Lower *lw, ASTNode *node, int dst);
+static void lower_stmts(Lower *lw, ASTNode *s);
+
+// Register for the result: @p dst, or a fresh temporary when the caller has none in mind.
+static uint32_t result_reg(Lower *lw, int dst)
+{
+    return dst >= 0 ? (uint32_t)dst : alloc_temp(lw);
+}
 
-    CValue right = eval_expr(ci, node->binary.right);
-    if (ci->error_happened)
+static uint32_t lower_const(Lower *lw, CValue v, int dst)
+{
+    if (dst == DISCARD)
     {
-        val_free(&left);
-        val_free(&right);
-        return val_null;
+        return 0;
     }
+    uint32_t r = result_reg(lw, dst);
+    emit(lw, OP_CONST, r, add_const(lw, v), 0);
+    return r;
+}
 
-    // Logical operators work on bools; arithmetic/comparison on ints
-    int is_logic = (strcmp(op, "&&") == 0 || strcmp(op, "||") == 0);
-    int is_compare = (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0 || strcmp(op, "<") == 0 ||
-                      strcmp(op, ">") == 0 || strcmp(op, "<=") == 0 || strcmp(op, ">=") == 0);
+static uint32_t lower_literal(Lower *lw, ASTNode *node, int dst)
+{
+    switch (node->literal.type_kind)
+    {
+    case LITERAL_INT:
+    case LITERAL_CHAR:
+        return lower_const(lw, val_int((int64_t)node->literal.int_val), dst);
+    case LITERAL_FLOAT:
+        return lower_const(lw, val_int((int64_t)node->literal.float_val), dst);
+    case LITERAL_STRING:
+    case LITERAL_RAW_STRING:
+        return lower_const(lw, val_string(node->literal.string_val), dst);
+    default:
+        return lower_const(lw, val_null, dst);
+    }
+}
 
-    if (is_logic)
+static uint32_t lower_var(Lower *lw, ASTNode *node, int dst)
+{
+    const char *name = node->var_ref.name;
+    if (!name)
     {
-        int a = 0, b = 0;
-        if (left.type == VAL_BOOL)
-        {
-            a = left.as.b;
-        }
-        else if (left.type == VAL_INT)
-        {
-            a = left.as.i != 0;
-        }
-        if (right.type == VAL_BOOL)
-        {
-            b = right.as.b;
-        }
-        else if (right.type == VAL_INT)
-        {
-            b = right.as.i != 0;
-        }
-        val_free(&left);
-        val_free(&right);
-        CValue r = {VAL_BOOL, {.b = (strcmp(op, "&&") == 0) ? (a && b) : (a || b)}};
-        return r;
+        return lower_const(lw, val_null, dst);
     }
 
-    if (left.type != VAL_INT)
+    // Builtin variables
+    if (strcmp(name, "__COMPTIME_TARGET__") == 0)
     {
-        zerror_at(node->token, "comptime: operator '%s' requires integer operands", op);
-        ci->error_happened = 1;
-        val_free(&left);
-        val_free(&right);
-        return val_null;
+        return lower_const(lw, val_string(z_get_system_name()), dst);
     }
-    if (right.type != VAL_INT)
+    if (strcmp(name, "__COMPTIME_FILE__") == 0)
     {
-        zerror_at(node->token, "comptime: operator '%s' requires integer operands", op);
-        ci->error_happened = 1;
-        val_free(&left);
-        val_free(&right);
-        return val_null;
+        return lower_const(lw, val_string(lw->ci->source_file), dst);
     }
-
-    int64_t a = left.as.i, b = right.as.i;
-    CValue r = {VAL_INT, {0}};
-
-    if (strcmp(op, "+") == 0)
+    if (strcmp(name, "true") == 0 || strcmp(name, "false") == 0)
     {
-        r.as.i = a + b;
+        return lower_const(lw, val_bool(name[0] == 't'), dst);
     }
-    else if (strcmp(op, "-") == 0)
+
+    int slot = find_name(lw, name);
+    if (slot < 0)
     {
-        r.as.i = a - b;
+        // Nothing in this body declares it, so it can never be set.
+        fail(lw, node, "comptime: undefined variable '%s'", name);
+        return dst >= 0 ? (uint32_t)dst : 0;
     }
-    else if (strcmp(op, "*") == 0)
+    if (!lw->known[slot])
     {
-        r.as.i = a * b;
+        emit(lw, OP_CHECK, (uint32_t)slot, add_const(lw, val_string(name)), 0);
+        lw->known[slot] = 1;
     }
-    else if (strcmp(op, "/") == 0)
+    if (dst < 0)
     {
-        if (b == 0)
-        {
-            zerror_at(node->token, "comptime: division by zero");
-            ci->error_happened = 1;
-            val_free(&left);
-            val_free(&right);
-            return val_null;
-        }
-        r.as.i = a / b;
+        return (uint32_t)slot;
     }
-    else if (strcmp(op, "%") == 0)
+    if ((uint32_t)dst != (uint32_t)slot)
     {
-        if (b == 0)
-        {
-            zerror_at(node->token, "comptime: modulo by zero");
-            ci->error_happened = 1;
-            val_free(&left);
-            val_free(&right);
-            return val_null;
-        }
-        r.as.i = a % b;
+        emit(lw, OP_MOVE, (uint32_t)dst, slot, 0);
     }
-    else if (is_compare)
+    return (uint32_t)dst;
+}
+
+static COp binary_op(const char *op)
+{
+    static const struct
     {
-        r.type = VAL_BOOL;
-        if (strcmp(op, "==") == 0)
-        {
-            r.as.b = (a == b);
-        }
-        else if (strcmp(op, "!=") == 0)
-        {
-            r.as.b = (a != b);
-        }
-        else if (strcmp(op, "<") == 0)
-        {
-            r.as.b = (a < b);
-        }
-        else if (strcmp(op, ">") == 0)
-        {
-            r.as.b = (a > b);
-        }
-        else if (strcmp(op, "<=") == 0)
-        {
-            r.as.b = (a <= b);
-        }
-        else if (strcmp(op, ">=") == 0)
+        const char *name;
+        COp op;
+    } ops[] = {{"+", OP_ADD}, {"-", OP_SUB}, {"*", OP_MUL}, {"/", OP_DIV}, {"%", OP_MOD},
+               {"==", OP_EQ}, {"!=", OP_NE}, {"<", OP_LT},  {">", OP_GT},  {"<=", OP_LE},
+               {">=", OP_GE}, {"&&", OP_AND}, {"||", OP_OR}};
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+    {
+        if (strcmp(op, ops[i].name) == 0)
         {
-            r.as.b = (a >= b);
+            return ops[i].op;
         }
     }
-    else if (strcmp(op, "&&") == 0)
+    return OP_BADOP;
+}
+
+static uint32_t lower_binary(Lower *lw, ASTNode *node, int dst)
+{
+    uint32_t mark = lw->top;
+    uint32_t left = lower_expr(lw, node->binary.left, ANY_REG);
+    if (!node->binary.op)
     {
-        r.type = VAL_BOOL;
-        r.as.b = (a && b);
+        lw->top = mark;
+        return lower_const(lw, val_null, dst);
     }
-    else if (strcmp(op, "||") == 0)
+    uint32_t right = lower_expr(lw, node->binary.right, ANY_REG);
+    lw->top = mark;
+    uint32_t r = dst >= 0 ? (uint32_t)dst : alloc_temp(lw);
+    emit(lw, binary_op(node->binary.op), r, (int32_t)left, (int32_t)right);
+    return r;
+}
+
+static uint32_t lower_unary(Lower *lw, ASTNode *node, int dst)
+{
+    const char *op = node->unary.op;
+    if (!op)
     {
-        r.type = VAL_BOOL;
-        r.as.b = (a || b);
+        return lower_const(lw, val_null, dst);
     }
-    else
+    if (strcmp(op, "-") != 0 && strcmp(op, "!") != 0)
     {
-        zerror_at(node->token, "comptime: unsupported binary operator '%s'", op);
-        ci->error_happened = 1;
+        fail(lw, node, "comptime: unsupported unary operator '%s'", op);
+        return dst >= 0 ? (uint32_t)dst : 0;
     }
-
-    val_free(&left);
-    val_free(&right);
+    uint32_t mark = lw->top;
+    uint32_t v = lower_expr(lw, node->unary.operand, ANY_REG);
+    lw->top = mark;
+    uint32_t r = dst >= 0 ? (uint32_t)dst : alloc_temp(lw);
+    emit(lw, op[0] == '-' ? OP_NEG : OP_NOT, r, (int32_t)v, 0);
     return r;
 }
 
-static CValue eval_unary(CInterp *ci, ASTNode *node)
+static uint32_t lower_builtin(Lower *lw, const char *name, ASTNode *args, int dst)
 {
-    if (!node->unary.op)
+    // For string-typed args, we need the compile-time value
+    if (args && args->type_info && args->type_info->kind == TYPE_STRING &&
+        args->type != NODE_EXPR_LITERAL && args->type != NODE_EXPR_VAR &&
+        args->type != NODE_EXPR_CALL &&
+        !(args->type == NODE_EXPR_BINARY && args->binary.op && strcmp(args->binary.op, "+") == 0))
     {
-        return val_null;
+        fail(lw, args, "comptime: argument to '%s' must be a compile-time constant", name);
+        return dst >= 0 ? (uint32_t)dst : 0;
     }
-    if (strcmp(node->unary.op, "-") == 0)
+
+    uint32_t mark = lw->top;
+    uint32_t arg = args ? lower_expr(lw, args, ANY_REG) : lower_const(lw, val_null, ANY_REG);
+    COp op = OP_YIELD;
+    if (strcmp(name, "compile_error") == 0)
     {
-        CValue v = eval_expr(ci, node->unary.operand);
-        if (ci->error_happened || v.type != VAL_INT)
-        {
-            val_free(&v);
-            return val_null;
-        }
-        v.as.i = -v.as.i;
-        return v;
+        op = OP_COMPILE_ERROR;
     }
-    if (strcmp(node->unary.op, "!") == 0)
+    else if (strcmp(name, "compile_warn") == 0)
     {
-        CValue v = eval_expr(ci, node->unary.operand);
-        if (ci->error_happened)
-        {
-            return val_null;
-        }
-        if (v.type == VAL_INT)
-        {
-            v.as.b = !v.as.i;
-            v.type = VAL_BOOL;
-        }
-        else if (v.type == VAL_BOOL)
-        {
-            v.as.b = !v.as.b;
-        }
-        return v;
+        op = OP_COMPILE_WARN;
     }
-    zerror_at(node->token, "comptime: unsupported unary operator '%s'", node->unary.op);
-    ci->error_happened = 1;
-    return val_null;
+    emit(lw, op, arg, 0, 0);
+    lw->top = mark;
+    return lower_const(lw, val_null, dst);
 }
 
-static CValue eval_call(CInterp *ci, ASTNode *node)
+static uint32_t lower_call(Lower *lw, ASTNode *node, int dst)
 {
     const char *name = NULL;
     if (node->call.callee && node->call.callee->type == NODE_EXPR_VAR)
@@ -481,486 +566,773 @@ static CValue eval_call(CInterp *ci, ASTNode *node)
     }
     if (!name)
     {
-        zerror_at(node->token, "comptime: cannot call indirect expressions");
-        ci->error_happened = 1;
-        return val_null;
+        fail(lw, node, "comptime: cannot call indirect expressions");
+        return dst >= 0 ? (uint32_t)dst : 0;
     }
 
     // Try builtins first
     if (strcmp(name, "yield") == 0 || strcmp(name, "code") == 0 ||
         strcmp(name, "compile_error") == 0 || strcmp(name, "compile_warn") == 0)
     {
-        return call_builtin(ci, name, node->call.args);
+        return lower_builtin(lw, name, node->call.args, dst);
     }
 
     // Look for @comptime function
-    for (StructRef *r = ci->pctx->parsed_funcs_list; r; r = r->next)
+    ASTNode *fn = NULL;
+    for (StructRef *r = lw->ci->pctx->parsed_funcs_list; r && !fn; r = r->next)
     {
         if (r->node && r->node->type == NODE_FUNCTION && r->node->func.is_comptime &&
             strcmp(r->node->func.name, name) == 0)
         {
-            return call_comptime_fn(ci, r->node, node->call.args);
+            fn = r->node;
         }
     }
+    if (!fn)
+    {
+        fail(lw, node, "comptime: undefined function '%s'", name);
+        return dst >= 0 ? (uint32_t)dst : 0;
+    }
 
-    zerror_at(node->token, "comptime: undefined function '%s'", name);
-    ci->error_happened = 1;
-    return val_null;
+    // Arguments go to consecutive temporaries.
+    uint32_t mark = lw->top;
+    uint32_t base = lw->top;
+    uint16_t argc = 0;
+    ASTNode *arg = node->call.args;
+    for (int i = 0; i < fn->func.arg_count && arg; i++, arg = arg->next)
+    {
+        uint32_t t = alloc_temp(lw);
+        lower_expr(lw, arg, (int)t);
+        lw->top = t + 1;
+        argc++;
+    }
+
+    CFunc *f = lw->f;
+    if (f->call_count == lw->call_cap)
+    {
+        lw->call_cap = lw->call_cap ? lw->call_cap * 2 : 8;
+        f->calls = xrealloc(f->calls, lw->call_cap * sizeof(CCall));
+    }
+    CCall *call = &f->calls[f->call_count];
+    call->fn = fn;
+    call->code = NULL;
+    call->argc = argc;
+
+    lw->top = mark;
+    uint32_t r = dst >= 0 ? (uint32_t)dst : alloc_temp(lw);
+    ASTNode *saved = lw->at;
+    lw->at = node;
+    emit(lw, OP_CALL, r, (int32_t)f->call_count++, (int32_t)base);
+    lw->at = saved;
+    return r;
 }
 
-static CValue call_builtin(CInterp *ci, const char *name, ASTNode *args)
+// Lower @p node into register @p dst (or ANY_REG / DISCARD) and return the result register.
+static uint32_t lower_expr(Lower *lw, ASTNode *node, int dst)
 {
-    // Evaluate first argument
-    CValue arg = {VAL_NULL, {0}};
-    if (args && args->type_info && args->type_info->kind == TYPE_STRING)
+    if (!node)
     {
-        // For string-typed args, we need the compile-time value
-        if (args->type == NODE_EXPR_LITERAL || args->type == NODE_EXPR_VAR)
-        {
-            arg = eval_expr(ci, args);
-        }
-        else if (args->type == NODE_EXPR_BINARY && strcmp(args->binary.op, "+") == 0)
-        {
-            arg = eval_expr(ci, args); // string concat
-        }
-        else if (args->type == NODE_EXPR_CALL)
-        {
-            arg = eval_expr(ci, args); // function return value
-        }
-        else
-        {
-            zerror_at(args->token, "comptime: argument to '%s' must be a compile-time constant",
-                      name);
-            ci->error_happened = 1;
-            return val_null;
-        }
+        return lower_const(lw, val_null, dst);
     }
-    else if (args)
+    ASTNode *saved = lw->at;
+    lw->at = node;
+    uint32_t r = 0;
+    switch (node->type)
     {
-        arg = eval_expr(ci, args);
+    case NODE_EXPR_LITERAL:
+        r = lower_literal(lw, node, dst);
+        break;
+    case NODE_EXPR_VAR:
+        r = lower_var(lw, node, dst);
+        break;
+    case NODE_EXPR_BINARY:
+        r = lower_binary(lw, node, dst);
+        break;
+    case NODE_EXPR_UNARY:
+        r = lower_unary(lw, node, dst);
+        break;
+    case NODE_EXPR_CALL:
+        r = lower_call(lw, node, dst);
+        break;
+    case NODE_EXPR_MEMBER:
+        // Simple member access not supported yet
+        fail(lw, node, "comptime: member access not supported yet");
+        break;
+    default:
+        fail(lw, node, "comptime: unsupported expression type %d", (int)node->type);
+        break;
     }
+    lw->at = saved;
+    return r;
+}
 
-    if (ci->error_happened)
+// Condition in a register; the jump over the guarded code is patched by the caller.
+static uint32_t lower_jump_false(Lower *lw, ASTNode *cond)
+{
+    uint32_t mark = lw->top;
+    uint32_t c = lower_expr(lw, cond, ANY_REG);
+    lw->top = mark;
+    return emit(lw, OP_JUMP_FALSE, c, 0, 0);
+}
+
+static void lower_assign(Lower *lw, ASTNode *node)
+{
+    if (!node->binary.left || node->binary.left->type != NODE_EXPR_VAR)
     {
-        val_free(&arg);
-        return val_null;
+        fail(lw, node, "comptime: assignment target must be a variable");
+        return;
     }
-
-    if (strcmp(name, "yield") == 0 || strcmp(name, "code") == 0)
+    const char *name = node->binary.left->var_ref.name;
+    int slot = find_name(lw, name);
+    if (slot < 0)
     {
-        char int_buf[32];
-        const char *s = "";
-        if (arg.type == VAL_STRING)
-        {
-            s = arg.as.s ? arg.as.s : "";
-        }
-        else if (arg.type == VAL_INT)
-        {
-            snprintf(int_buf, sizeof(int_buf), "%lld", (long long)arg.as.i);
-            s = int_buf;
-        }
-        yield_append(ci, s);
-        val_free(&arg);
-        return val_null;
+        fail(lw, node, "comptime: undefined variable '%s'", name);
+        return;
     }
-
-    if (strcmp(name, "compile_error") == 0)
+    if (!lw->known[slot])
     {
-        const char *msg = (arg.type == VAL_STRING && arg.as.s) ? arg.as.s : "comptime error";
-        zerror_at(TOKEN_UNKNOWN, "comptime error: %s", msg);
-        ci->error_happened = 1;
-        val_free(&arg);
-        return val_null;
+        emit(lw, OP_CHECK, (uint32_t)slot, add_const(lw, val_string(name)), 0);
+        lw->known[slot] = 1;
     }
+    lower_expr(lw, node->binary.right, slot);
+}
+
+// Body of a loop; `break` and `continue` jumps are collected in @p loop.
+static void lower_loop_body(Lower *lw, CLoop *loop, ASTNode *body)
+{
+    loop->outer = lw->loop;
+    lw->loop = loop;
+    uint8_t *known = known_save(lw);
+    lower_stmts(lw, body);
+    known_restore(lw, known);
+    lw->loop = loop->outer;
+}
 
-    if (strcmp(name, "compile_warn") == 0)
+// Integer bound of a for-range loop into @p dst; a missing one is 0.
+static void lower_bound(Lower *lw, ASTNode *bound, uint32_t dst)
+{
+    uint32_t mark = lw->top;
+    if (!bound)
     {
-        const char *msg = (arg.type == VAL_STRING && arg.as.s) ? arg.as.s : "comptime warning";
-        fprintf(stderr, "comptime warning: %s\n", msg);
-        val_free(&arg);
-        return val_null;
+        lower_const(lw, val_int(0), (int)dst);
+        return;
     }
-
-    val_free(&arg);
-    return val_null;
+    uint32_t v = lower_expr(lw, bound, ANY_REG);
+    lw->at = bound;
+    emit(lw, OP_INT, dst, (int32_t)v, 0);
+    lw->top = mark;
 }
 
-static CValue call_comptime_fn(CInterp *ci, ASTNode *fn_node, ASTNode *args)
+static void lower_for_range(Lower *lw, ASTNode *node)
 {
-    if (ci->rec_depth >= MAX_RECURSION)
+    uint32_t floor = lw->floor;
+    uint32_t cur = alloc_temp(lw);
+    uint32_t end = alloc_temp(lw);
+    lower_bound(lw, node->for_range.start, cur);
+    lower_bound(lw, node->for_range.end, end);
+    lw->at = node;
+
+    // The loop variable shadows an outer one of the same name until the loop ends.
+    int slot = find_name(lw, node->for_range.var_name);
+    uint32_t saved = 0;
+    if (slot >= 0)
     {
-        zerror_at(fn_node->token, "comptime: recursion depth limit exceeded");
-        ci->error_happened = 1;
-        return val_null;
+        saved = alloc_temp(lw);
+        emit(lw, OP_MOVE, saved, slot, 0);
     }
+    lw->floor = lw->top;
 
-    // Save scope
-    CScope *saved_scope = ci->scope;
-    ci->scope = NULL;
-    ci->rec_depth++;
+    uint32_t top = emit(lw, node->for_range.is_inclusive ? OP_RANGE_INCL : OP_RANGE, cur,
+                        (int32_t)end, 0);
+    uint8_t *known = known_save(lw);
+    if (slot >= 0)
+    {
+        emit(lw, OP_MOVE, (uint32_t)slot, (int32_t)cur, 0);
+        lw->known[slot] = 1;
+    }
+    CLoop loop = {0};
+    lower_loop_body(lw, &loop, node->for_range.body);
+    known_restore(lw, known);
+    lw->at = node;
+    patch_to(lw, &loop.continues, lw->f->count);
+    emit(lw, OP_INC, cur, 0, 0);
+    emit(lw, OP_JUMP, 0, (int32_t)top, 0);
+    lw->f->code[top].c = (int32_t)lw->f->count;
+    patch_to(lw, &loop.breaks, lw->f->count);
+    if (slot >= 0)
+    {
+        emit(lw, OP_MOVE, (uint32_t)slot, (int32_t)saved, 0);
+    }
+    lw->floor = floor;
+    lw->top = floor;
+}
 
-    // Bind args to params
-    ASTNode *arg = args;
-    for (int i = 0; i < fn_node->func.arg_count && arg; i++, arg = arg->next)
+static void lower_stmt(Lower *lw, ASTNode *node)
+{
+    lw->at = node;
+    lw->top = lw->floor;
+    switch (node->type)
     {
-        CValue val = eval_expr(ci, arg);
-        if (ci->error_happened)
+    case NODE_ASSERT:
+    case NODE_EXPECT:
+    {
+        uint32_t c = lower_expr(lw, node->assert_stmt.condition, ANY_REG);
+        lw->at = node;
+        const char *msg = node->assert_stmt.message ? node->assert_stmt.message
+                                                    : "comptime assertion failed";
+        emit(lw, OP_ASSERT, c, add_const(lw, val_string(msg)), 0);
+        break;
+    }
+    case NODE_VAR_DECL:
+    {
+        int slot = find_name(lw, node->var_decl.name);
+        if (slot >= 0)
         {
-            break;
+            lower_expr(lw, node->var_decl.init_expr, slot);
+            lw->known[slot] = 1;
         }
-        if (fn_node->func.param_names && fn_node->func.param_names[i])
+        break;
+    }
+    case NODE_EXPR_BINARY:
+        if (node->binary.op && strcmp(node->binary.op, "=") == 0)
         {
-            ci->scope = scope_push(ci->scope, fn_node->func.param_names[i], val);
+            lower_assign(lw, node);
         }
         else
         {
-            val_free(&val);
+            lower_expr(lw, node, DISCARD);
         }
+        break;
+    case NODE_EXPR_CALL:
+    case NODE_EXPR_VAR:
+    case NODE_EXPR_LITERAL:
+    case NODE_EXPR_UNARY:
+        lower_expr(lw, node, DISCARD);
+        break;
+    case NODE_IF:
+    {
+        uint32_t jump = lower_jump_false(lw, node->if_stmt.condition);
+        uint8_t *known = known_save(lw);
+        lower_stmts(lw, branch_statements(node->if_stmt.then_body));
+        known_restore(lw, known);
+        if (node->if_stmt.else_body)
+        {
+            lw->at = node;
+            uint32_t skip = emit(lw, OP_JUMP, 0, 0, 0);
+            lw->f->code[jump].b = (int32_t)lw->f->count;
+            known = known_save(lw);
+            lower_stmts(lw, branch_statements(node->if_stmt.else_body));
+            known_restore(lw, known);
+            jump = skip;
+        }
+        lw->f->code[jump].b = (int32_t)lw->f->count;
+        break;
     }
-
-    // Execute body
-    if (!ci->error_happened && fn_node->func.body)
+    case NODE_BLOCK:
+    {
+        uint8_t *known = known_save(lw);
+        lower_stmts(lw, node->block.statements);
+        known_restore(lw, known);
+        break;
+    }
+    case NODE_FOR:
     {
-        ASTNode *stmt = fn_node->func.body->block.statements;
-        while (stmt && !ci->error_happened)
+        // for (init; cond; step) body
+        if (node->for_stmt.init)
         {
-            // Check for return
-            if (stmt->type == NODE_RETURN)
-            {
-                CValue ret = val_null;
-                if (stmt->ret.value)
-                {
-                    ret = eval_expr(ci, stmt->ret.value);
-                }
-                scope_pop_all(&ci->scope);
-                ci->scope = saved_scope;
-                ci->rec_depth--;
-                return ret;
-            }
-            exec_stmt(ci, stmt);
-            if (ci->error_happened)
-            {
-                break;
-            }
-            stmt = stmt->next;
+            lower_stmt(lw, node->for_stmt.init);
+            lw->at = node;
+        }
+        uint32_t top = lw->f->count;
+        uint32_t exit = 0;
+        int has_cond = node->for_stmt.condition != NULL;
+        if (has_cond)
+        {
+            exit = lower_jump_false(lw, node->for_stmt.condition);
         }
+        CLoop loop = {0};
+        lower_loop_body(lw, &loop, node->for_stmt.body);
+        patch_to(lw, &loop.continues, lw->f->count);
+        if (node->for_stmt.step)
+        {
+            uint8_t *known = known_save(lw);
+            lower_stmt(lw, node->for_stmt.step);
+            known_restore(lw, known);
+        }
+        lw->at = node;
+        emit(lw, OP_JUMP, 0, (int32_t)top, 0);
+        if (has_cond)
+        {
+            lw->f->code[exit].b = (int32_t)lw->f->count;
+        }
+        patch_to(lw, &loop.breaks, lw->f->count);
+        break;
     }
-
-    scope_pop_all(&ci->scope);
-    ci->scope = saved_scope;
-    ci->rec_depth--;
-    return val_null;
-}
-
-static CValue eval_expr(CInterp *ci, ASTNode *node)
-{
-    if (ci->step_count++ > MAX_STEPS)
+    case NODE_FOR_RANGE:
+        lower_for_range(lw, node);
+        break;
+    case NODE_WHILE:
     {
-        zerror_at(node ? node->token : TOKEN_UNKNOWN,
-                  "comptime: step limit exceeded (possible infinite loop)");
-        ci->error_happened = 1;
-        return val_null;
+        uint32_t top = lw->f->count;
+        uint32_t exit = lower_jump_false(lw, node->while_stmt.condition);
+        CLoop loop = {0};
+        lower_loop_body(lw, &loop, node->while_stmt.body);
+        lw->at = node;
+        emit(lw, OP_JUMP, 0, (int32_t)top, 0);
+        lw->f->code[exit].b = (int32_t)lw->f->count;
+        patch_to(lw, &loop.continues, top);
+        patch_to(lw, &loop.breaks, lw->f->count);
+        break;
     }
-    if (!node || ci->error_happened)
+    case NODE_LOOP:
     {
-        return val_null;
+        uint32_t top = lw->f->count;
+        CLoop loop = {0};
+        lower_loop_body(lw, &loop, node->loop_stmt.body);
+        lw->at = node;
+        emit(lw, OP_JUMP, 0, (int32_t)top, 0);
+        patch_to(lw, &loop.continues, top);
+        patch_to(lw, &loop.breaks, lw->f->count);
+        break;
     }
-
-    switch (node->type)
+    case NODE_REPEAT:
     {
-    case NODE_EXPR_LITERAL:
-        return eval_literal(ci, node);
-    case NODE_EXPR_VAR:
-        return eval_var(ci, node);
-    case NODE_EXPR_BINARY:
-        return eval_binary(ci, node);
-    case NODE_EXPR_UNARY:
-        return eval_unary(ci, node);
-    case NODE_EXPR_CALL:
-        return eval_call(ci, node);
-    case NODE_EXPR_MEMBER:
-        // Simple member access not supported yet
-        zerror_at(node->token, "comptime: member access not supported yet");
-        ci->error_happened = 1;
-        return val_null;
+        int64_t n = node->repeat_stmt.count ? atoll(node->repeat_stmt.count) : 0;
+        uint32_t floor = lw->floor;
+        uint32_t cur = lower_const(lw, val_int(0), (int)alloc_temp(lw));
+        uint32_t end = lower_const(lw, val_int(n), (int)alloc_temp(lw));
+        lw->floor = lw->top;
+        uint32_t top = emit(lw, OP_RANGE, cur, (int32_t)end, 0);
+        CLoop loop = {0};
+        lower_loop_body(lw, &loop, node->repeat_stmt.body);
+        lw->at = node;
+        patch_to(lw, &loop.continues, lw->f->count);
+        emit(lw, OP_INC, cur, 0, 0);
+        emit(lw, OP_JUMP, 0, (int32_t)top, 0);
+        lw->f->code[top].c = (int32_t)lw->f->count;
+        patch_to(lw, &loop.breaks, lw->f->count);
+        lw->floor = floor;
+        break;
+    }
+    case NODE_BREAK:
+    case NODE_CONTINUE:
+        if (lw->loop)
+        {
+            CPatchList *list =
+                node->type == NODE_BREAK ? &lw->loop->breaks : &lw->loop->continues;
+            patch_add(list, emit(lw, OP_JUMP, 0, 0, 0));
+        }
+        break;
+    case NODE_RETURN:
+        // Blocks have nothing to return to.
+        if (lw->in_function)
+        {
+            uint32_t r = node->ret.value ? lower_expr(lw, node->ret.value, ANY_REG) : 0;
+            lw->at = node;
+            emit(lw, OP_RETURN, r, node->ret.value != NULL, 0);
+        }
+        break;
     default:
-        zerror_at(node->token, "comptime: unsupported expression type %d", (int)node->type);
-        ci->error_happened = 1;
-        return val_null;
+        // Skip unsupported statement types silently (they may be comptime-only constructs)
+        break;
     }
+    lw->top = lw->floor;
 }
 
-static void exec_let(CInterp *ci, ASTNode *node)
+static void lower_stmts(Lower *lw, ASTNode *s)
 {
-    const char *name = node->var_decl.name;
-    if (!name)
+    for (; s && !lw->ci->error_happened; s = s->next)
     {
-        return;
-    }
-    CValue val = val_null;
-    if (node->var_decl.init_expr)
-    {
-        val = eval_expr(ci, node->var_decl.init_expr);
-        if (ci->error_happened)
-        {
-            return;
-        }
+        lower_stmt(lw, s);
     }
-    ci->scope = scope_push(ci->scope, name, val);
 }
 
-static void exec_assign(CInterp *ci, ASTNode *node)
+// Lower a comptime block (@p fn NULL) or the body of @comptime fn @p fn.
+static CFunc *lower_body(CInterp *ci, ASTNode *fn, ASTNode *stmts)
 {
-    if (!node->binary.left || node->binary.left->type != NODE_EXPR_VAR)
+    Lower lw = {0};
+    lw.ci = ci;
+    lw.f = xcalloc(1, sizeof(CFunc));
+    lw.in_function = fn != NULL;
+    lw.at = fn ? fn : stmts;
+
+    if (fn)
     {
-        zerror_at(node->token, "comptime: assignment target must be a variable");
-        ci->error_happened = 1;
-        return;
+        for (int i = 0; i < fn->func.arg_count; i++)
+        {
+            declare_name(&lw, fn->func.param_names ? fn->func.param_names[i] : NULL);
+        }
     }
-    const char *name = node->binary.left->var_ref.name;
-    CValue *existing = scope_find(ci->scope, name);
-    if (!existing)
+    declare_names(&lw, stmts);
+    if (lw.name_count >= MAX_REGS)
     {
-        zerror_at(node->token, "comptime: undefined variable '%s'", name);
+        zerror_at(lw.at ? lw.at->token : TOKEN_UNKNOWN, "comptime: body too large");
         ci->error_happened = 1;
-        return;
+        return lw.f;
     }
-    CValue new_val = eval_expr(ci, node->binary.right);
-    if (ci->error_happened)
+    lw.known = xcalloc(lw.name_count + 1, 1);
+    lw.top = lw.floor = lw.name_count;
+    lw.f->regs = (uint16_t)lw.name_count;
+
+    if (fn)
     {
-        return;
+        lw.f->param_count = (uint16_t)fn->func.arg_count;
+        lw.f->params = xcalloc((size_t)fn->func.arg_count + 1, sizeof(uint16_t));
+        for (int i = 0; i < fn->func.arg_count; i++)
+        {
+            int slot = find_name(&lw, fn->func.param_names ? fn->func.param_names[i] : NULL);
+            lw.f->params[i] = slot >= 0 ? (uint16_t)slot : NO_REG;
+            if (slot >= 0)
+            {
+                lw.known[slot] = 1;
+            }
+        }
     }
-    val_free(existing);
-    *existing = new_val;
+
+    lower_stmts(&lw, stmts);
+    lw.at = fn ? fn : stmts;
+    emit(&lw, OP_RETURN, 0, 0, 0);
+    return lw.f;
 }
 
-static void exec_if(CInterp *ci, ASTNode *node)
+static CFunc *function_code(CInterp *ci, ASTNode *fn)
 {
-    CValue cond = eval_expr(ci, node->if_stmt.condition);
-    if (ci->error_happened)
-    {
-        val_free(&cond);
-        return;
-    }
-    int truthy = (cond.type == VAL_INT && cond.as.i) || (cond.type == VAL_BOOL && cond.as.b);
-    val_free(&cond);
-    if (truthy)
+    for (CFuncEntry *e = ci->funcs; e; e = e->next)
     {
-        ASTNode *s = node->if_stmt.then_body;
-        if (s && s->type == NODE_BLOCK)
+        if (e->fn == fn)
         {
-            s = s->block.statements;
-        }
-        while (s && !ci->error_happened)
-        {
-            exec_stmt(ci, s);
-            s = s->next;
+            return e->code;
         }
     }
-    else if (node->if_stmt.else_body)
+    CFuncEntry *e = xmalloc(sizeof(CFuncEntry));
+    e->fn = fn;
+    e->code = lower_body(ci, fn, fn->func.body ? fn->func.body->block.statements : NULL);
+    e->next = ci->funcs;
+    ci->funcs = e;
+    return e->code;
+}
+
+// ** Execution **
+
+static void reserve_stack(CInterp *ci, uint32_t size)
+{
+    if (size <= ci->stack_cap)
     {
-        ASTNode *s = node->if_stmt.else_body;
-        if (s && s->type == NODE_BLOCK)
-        {
-            s = s->block.statements;
-        }
-        while (s && !ci->error_happened)
-        {
-            exec_stmt(ci, s);
-            s = s->next;
-        }
+        return;
+    }
+    uint32_t cap = ci->stack_cap ? ci->stack_cap : 256;
+    while (cap < size)
+    {
+        cap *= 2;
     }
+    ci->stack = xrealloc(ci->stack, cap * sizeof(CValue));
+    ci->stack_cap = cap;
 }
 
-static void exec_block(CInterp *ci, ASTNode *node)
+static int int_operands(CInterp *ci, ASTNode *at, const CValue *l, const CValue *r)
 {
-    ASTNode *s = node->block.statements;
-    while (s && !ci->error_happened)
+    if (l->type == VAL_INT && r->type == VAL_INT)
     {
-        exec_stmt(ci, s);
-        s = s->next;
+        return 1;
     }
+    zerror_at(at->token, "comptime: operator '%s' requires integer operands", at->binary.op);
+    ci->error_happened = 1;
+    return 0;
 }
 
-static void exec_stmt(CInterp *ci, ASTNode *node)
+static void vm_yield(CInterp *ci, const CValue *v)
 {
-    if (!node || ci->error_happened)
+    if (v->type == VAL_STRING)
     {
-        return;
+        yield_append(ci, v->as.s, v->len);
     }
-    if (ci->step_count++ > MAX_STEPS)
+    else if (v->type == VAL_INT)
     {
-        zerror_at(node->token, "comptime: step limit exceeded (possible infinite loop)");
-        ci->error_happened = 1;
-        return;
+        char int_buf[32];
+        int n = snprintf(int_buf, sizeof(int_buf), "%lld", (long long)v->as.i);
+        yield_append(ci, int_buf, (size_t)n);
     }
-    switch (node->type)
+}
+
+static CValue vm_run(CInterp *ci, CFunc *f, uint32_t base);
+
+static CValue vm_call(CInterp *ci, CCall *call, uint32_t base, uint32_t args)
+{
+    ASTNode *fn = call->fn;
+    if (ci->rec_depth >= MAX_RECURSION)
     {
-    case NODE_ASSERT:
-    case NODE_EXPECT:
+        zerror_at(fn->token, "comptime: recursion depth limit exceeded");
+        ci->error_happened = 1;
+        return val_null;
+    }
+    if (!call->code)
     {
-        CValue cv = eval_expr(ci, node->assert_stmt.condition);
-        int truthy = (cv.type == VAL_INT && cv.as.i) || (cv.type == VAL_BOOL && cv.as.b);
-        val_free(&cv);
-        if (!truthy)
+        call->code = function_code(ci, fn);
+        if (ci->error_happened)
         {
-            const char *msg =
-                node->assert_stmt.message ? node->assert_stmt.message : "comptime assertion failed";
-            zerror_at(node->token, "comptime: %s", msg);
-            ci->error_happened = 1;
+            return val_null;
         }
-        break;
     }
-    case NODE_VAR_DECL:
-        exec_let(ci, node);
-        break;
-    case NODE_EXPR_BINARY:
-        if (node->binary.op && strcmp(node->binary.op, "=") == 0)
-        {
-            exec_assign(ci, node);
-        }
-        else
+    CFunc *callee = call->code;
+    reserve_stack(ci, base + callee->regs);
+    CValue *regs = ci->stack + base;
+    for (uint32_t i = 0; i < callee->regs; i++)
+    {
+        regs[i].type = VAL_UNSET;
+    }
+    for (uint32_t i = 0; i < call->argc; i++)
+    {
+        if (callee->params[i] != NO_REG)
         {
-            eval_expr(ci, node);
+            regs[callee->params[i]] = ci->stack[args + i];
         }
-        break;
-    case NODE_EXPR_CALL:
-    case NODE_EXPR_VAR:
-    case NODE_EXPR_LITERAL:
-    case NODE_EXPR_UNARY:
-        eval_expr(ci, node);
-        break;
-    case NODE_IF:
-        exec_if(ci, node);
-        break;
-    case NODE_BLOCK:
-        exec_block(ci, node);
-        break;
-    case NODE_FOR:
+    }
+    ci->rec_depth++;
+    CValue ret = vm_run(ci, callee, base);
+    ci->rec_depth--;
+    return ret;
+}
+
+static CValue vm_run(CInterp *ci, CFunc *f, uint32_t base)
+{
+    CValue *regs = ci->stack + base;
+    const CInstr *code = f->code;
+    uint32_t pc = 0;
+    for (;;)
     {
-        // for (init; cond; step) body
-        if (node->for_stmt.init)
+        if (--ci->steps_left < 0)
         {
-            exec_stmt(ci, node->for_stmt.init);
+            zerror_at(f->at[pc] ? f->at[pc]->token : TOKEN_UNKNOWN,
+                      "comptime: step limit exceeded (possible infinite loop)");
+            ci->error_happened = 1;
+            return val_null;
         }
-        while (!ci->error_happened)
+        const CInstr *in = &code[pc];
+        CValue *a = &regs[in->a];
+        switch ((COp)in->op)
+        {
+        case OP_CONST:
+            *a = f->consts[in->b];
+            break;
+        case OP_MOVE:
+            *a = regs[in->b];
+            break;
+        case OP_CHECK:
+            if (a->type == VAL_UNSET)
+            {
+                zerror_at(f->at[pc]->token, "comptime: undefined variable '%s'",
+                          f->consts[in->b].as.s);
+                ci->error_happened = 1;
+                return val_null;
+            }
+            break;
+        case OP_ADD:
         {
-            CValue cv = val_null;
-            if (node->for_stmt.condition)
+            const CValue *l = &regs[in->b];
+            const CValue *r = &regs[in->c];
+            if (l->type == VAL_STRING)
             {
-                cv = eval_expr(ci, node->for_stmt.condition);
-                int truthy = (cv.type == VAL_INT && cv.as.i) || (cv.type == VAL_BOOL && cv.as.b);
-                val_free(&cv);
-                if (!truthy)
+                if (r->type != VAL_STRING)
                 {
-                    break;
+                    zerror_at(f->at[pc]->token,
+                              "comptime: cannot concatenate string with non-string");
+                    ci->error_happened = 1;
+                    return val_null;
                 }
+                uint32_t len = l->len + r->len;
+                char *buf = xmalloc((size_t)len + 1);
+                memcpy(buf, l->as.s, l->len);
+                memcpy(buf + l->len, r->as.s, r->len);
+                buf[len] = 0;
+                a->type = VAL_STRING;
+                a->len = len;
+                a->as.s = buf;
+                break;
             }
-            if (node->for_stmt.body)
+            if (!int_operands(ci, f->at[pc], l, r))
             {
-                exec_stmt(ci, node->for_stmt.body);
+                return val_null;
             }
-            if (ci->error_happened)
+            *a = val_int(l->as.i + r->as.i);
+            break;
+        }
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_EQ:
+        case OP_NE:
+        case OP_LT:
+        case OP_GT:
+        case OP_LE:
+        case OP_GE:
+        case OP_BADOP:
+        {
+            const CValue *l = &regs[in->b];
+            const CValue *r = &regs[in->c];
+            if (!int_operands(ci, f->at[pc], l, r))
             {
-                break;
+                return val_null;
             }
-            if (node->for_stmt.step)
+            int64_t x = l->as.i, y = r->as.i;
+            switch ((COp)in->op)
             {
-                exec_stmt(ci, node->for_stmt.step);
+            case OP_SUB:
+                *a = val_int(x - y);
+                break;
+            case OP_MUL:
+                *a = val_int(x * y);
+                break;
+            case OP_DIV:
+            case OP_MOD:
+                if (y == 0)
+                {
+                    zerror_at(f->at[pc]->token, in->op == OP_DIV ? "comptime: division by zero"
+                                                                 : "comptime: modulo by zero");
+                    ci->error_happened = 1;
+                    return val_null;
+                }
+                *a = val_int(in->op == OP_DIV ? x / y : x % y);
+                break;
+            case OP_EQ:
+                *a = val_bool(x == y);
+                break;
+            case OP_NE:
+                *a = val_bool(x != y);
+                break;
+            case OP_LT:
+                *a = val_bool(x < y);
+                break;
+            case OP_GT:
+                *a = val_bool(x > y);
+                break;
+            case OP_LE:
+                *a = val_bool(x <= y);
+                break;
+            case OP_GE:
+                *a = val_bool(x >= y);
+                break;
+            default:
+                zerror_at(f->at[pc]->token, "comptime: unsupported binary operator '%s'",
+                          f->at[pc]->binary.op);
+                ci->error_happened = 1;
+                return val_null;
             }
+            break;
         }
-        break;
-    }
-    case NODE_FOR_RANGE:
-    {
-        int64_t start = node->for_range.start ? eval_int(ci, node->for_range.start) : 0;
-        int64_t end = node->for_range.end ? eval_int(ci, node->for_range.end) : 0;
-        if (ci->error_happened)
+        case OP_AND:
+        case OP_OR:
         {
+            // Logical operators work on bools and ints; anything else is false.
+            const CValue *l = &regs[in->b];
+            const CValue *r = &regs[in->c];
+            int x = l->type == VAL_BOOL ? l->as.b : (l->type == VAL_INT && l->as.i != 0);
+            int y = r->type == VAL_BOOL ? r->as.b : (r->type == VAL_INT && r->as.i != 0);
+            *a = val_bool(in->op == OP_AND ? (x && y) : (x || y));
             break;
         }
-        int inclusive = node->for_range.is_inclusive;
-        for (int64_t i = start; inclusive ? i <= end : i < end; i++)
+        case OP_NEG:
         {
-            if (ci->step_count++ > MAX_STEPS)
-            {
-                zerror_at(node->token, "comptime: step limit exceeded in for-range loop");
-                ci->error_happened = 1;
-                break;
-            }
-            // Bind loop variable
-            if (node->for_range.var_name)
+            const CValue *v = &regs[in->b];
+            *a = v->type == VAL_INT ? val_int(-v->as.i) : val_null;
+            break;
+        }
+        case OP_NOT:
+        {
+            CValue v = regs[in->b];
+            if (v.type == VAL_INT)
             {
-                CValue iv = {VAL_INT, {.i = i}};
-                ci->scope = scope_push(ci->scope, node->for_range.var_name, iv);
+                v = val_bool(!v.as.i);
             }
-            if (node->for_range.body)
+            else if (v.type == VAL_BOOL)
             {
-                exec_stmt(ci, node->for_range.body);
+                v.as.b = !v.as.b;
             }
-            if (node->for_range.var_name)
+            *a = v;
+            break;
+        }
+        case OP_INT:
+            if (regs[in->b].type != VAL_INT)
             {
-                scope_pop(&ci->scope);
+                zerror_at(f->at[pc]->token, "comptime: expected integer expression");
+                ci->error_happened = 1;
+                return val_null;
             }
-            if (ci->error_happened)
+            *a = regs[in->b];
+            break;
+        case OP_JUMP:
+            pc = (uint32_t)in->b;
+            continue;
+        case OP_JUMP_FALSE:
+            if (!val_truthy(a))
             {
-                break;
+                pc = (uint32_t)in->b;
+                continue;
             }
-        }
-        break;
-    }
-    case NODE_WHILE:
-    {
-        while (!ci->error_happened)
+            break;
+        case OP_RANGE:
+        case OP_RANGE_INCL:
         {
-            CValue cv = eval_expr(ci, node->while_stmt.condition);
-            int truthy = (cv.type == VAL_INT && cv.as.i) || (cv.type == VAL_BOOL && cv.as.b);
-            val_free(&cv);
-            if (!truthy)
+            int64_t end = regs[in->b].as.i;
+            if (in->op == OP_RANGE ? a->as.i >= end : a->as.i > end)
             {
-                break;
-            }
-            if (node->while_stmt.body)
-            {
-                exec_stmt(ci, node->while_stmt.body);
+                pc = (uint32_t)in->c;
+                continue;
             }
+            break;
         }
-        break;
-    }
-    case NODE_LOOP:
-    {
-        while (!ci->error_happened)
+        case OP_INC:
+            a->as.i++;
+            break;
+        case OP_CALL:
         {
-            if (ci->step_count++ > MAX_STEPS)
+            CValue ret = vm_call(ci, &f->calls[in->b], base + f->regs, base + (uint32_t)in->c);
+            if (ci->error_happened)
             {
-                break;
+                return val_null;
             }
-            if (node->loop_stmt.body)
+            // The call may have moved the stack.
+            regs = ci->stack + base;
+            regs[in->a] = ret;
+            break;
+        }
+        case OP_RETURN:
+            return in->b ? *a : val_null;
+        case OP_YIELD:
+            vm_yield(ci, a);
+            if (ci->error_happened)
             {
-                exec_stmt(ci, node->loop_stmt.body);
+                return val_null;
             }
+            break;
+        case OP_COMPILE_ERROR:
+        {
+            const char *msg = (a->type == VAL_STRING) ? a->as.s : "comptime error";
+            zerror_at(TOKEN_UNKNOWN, "comptime error: %s", msg);
+            ci->error_happened = 1;
+            return val_null;
         }
-        break;
-    }
-    case NODE_REPEAT:
-    {
-        int64_t n = node->repeat_stmt.count ? atoll(node->repeat_stmt.count) : 0;
-        for (int64_t i = 0; i < n && !ci->error_happened; i++)
+        case OP_COMPILE_WARN:
         {
-            if (node->repeat_stmt.body)
+            const char *msg = (a->type == VAL_STRING) ? a->as.s : "comptime warning";
+            fprintf(stderr, "comptime warning: %s\n", msg);
+            break;
+        }
+        case OP_ASSERT:
+            if (!val_truthy(a))
             {
-                exec_stmt(ci, node->repeat_stmt.body);
+                zerror_at(f->at[pc]->token, "comptime: %s", f->consts[in->b].as.s);
+                ci->error_happened = 1;
+                return val_null;
             }
+            break;
+        case OP_FAIL:
+            zerror_at(f->at[pc] ? f->at[pc]->token : TOKEN_UNKNOWN, "%s", f->consts[in->b].as.s);
+            ci->error_happened = 1;
+            return val_null;
+        default:
+            break;
         }
-        break;
-    }
-    case NODE_BREAK:
-    case NODE_CONTINUE:
-        // Not directly supported in comptime loops; ignore
-        break;
-    default:
-        // Skip unsupported statement types silently (they may be comptime-only constructs)
-        break;
+        pc++;
     }
 }
 
@@ -969,34 +1341,222 @@ char *interpret_comptime(ParserContext *ctx, ASTNode *body, const char *source_f
     CInterp ci;
     memset(&ci, 0, sizeof(ci));
     ci.pctx = ctx;
-    ci.source_file = source_file;
-    ci.yield_buf = NULL;
-    ci.yield_cap = 0;
-    ci.yield_len = 0;
+    ci.source_file = source_file ? source_file : "";
+    ci.steps_left = MAX_STEPS;
 
-    // Execute body statements
-    ASTNode *stmt = body;
-    while (stmt && !ci.error_happened)
+    CFunc *code = lower_body(&ci, NULL, body);
+    if (!ci.error_happened)
     {
-        exec_stmt(&ci, stmt);
-        stmt = stmt->next;
+        reserve_stack(&ci, code->regs);
+        for (uint32_t i = 0; i < code->regs; i++)
+        {
+            ci.stack[i].type = VAL_UNSET;
+        }
+        vm_run(&ci, code, 0);
+    }
+
+    if (ci.error_happened)
+    {
+        zfree(ci.yield_buf);
+        return NULL;
     }
 
     // Finalize yield buffer
-    char *result = ci.yield_buf ? ci.yield_buf : xstrdup("");
+    return ci.yield_buf ? ci.yield_buf : xstrdup("");
+}
 
-    // Cleanup
-    scope_pop_all(&ci.scope);
+// ** Cache key **
 
-    if (ci.error_happened)
+// 64-bit FNV-1a over the same fields lowering reads, so two bodies with equal keys lower to
+// the same code.
+typedef struct
+{
+    ParserContext *pctx;
+    uint64_t h;
+    ASTNode **fns; ///< @comptime fns reached so far, hashed after the block.
+    int fn_count;
+    int fn_cap;
+    int prints; ///< Calls compile_warn(), whose output a cached result would lose.
+} CKey;
+
+static void key_bytes(CKey *k, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++)
     {
-        if (result != ci.yield_buf)
+        k->h ^= p[i];
+        k->h *= 1099511628211ull;
+    }
+}
+
+static void key_int(CKey *k, int64_t v)
+{
+    key_bytes(k, &v, sizeof(v));
+}
+
+// With the terminator, so that ("ab","c") and ("a","bc") differ; NULL differs from "".
+static void key_str(CKey *k, const char *s)
+{
+    key_int(k, s != NULL);
+    if (s)
+    {
+        key_bytes(k, s, strlen(s) + 1);
+    }
+}
+
+static int key_function(CKey *k, const char *name)
+{
+    ASTNode *fn = NULL;
+    for (StructRef *r = k->pctx->parsed_funcs_list; r && !fn; r = r->next)
+    {
+        if (r->node && r->node->type == NODE_FUNCTION && r->node->func.is_comptime &&
+            strcmp(r->node->func.name, name) == 0)
         {
-            zfree(result);
+            fn = r->node;
         }
-        zfree(ci.yield_buf);
-        return NULL;
     }
+    if (!fn)
+    {
+        return -1;
+    }
+    for (int i = 0; i < k->fn_count; i++)
+    {
+        if (k->fns[i] == fn)
+        {
+            return i;
+        }
+    }
+    if (k->fn_count == k->fn_cap)
+    {
+        k->fn_cap = k->fn_cap ? k->fn_cap * 2 : 8;
+        k->fns = xrealloc(k->fns, (size_t)k->fn_cap * sizeof(ASTNode *));
+    }
+    k->fns[k->fn_count] = fn;
+    return k->fn_count++;
+}
+
+static void key_list(CKey *k, ASTNode *s);
+
+static void key_node(CKey *k, ASTNode *n)
+{
+    if (!n)
+    {
+        key_int(k, -1);
+        return;
+    }
+    key_int(k, n->type);
+    switch (n->type)
+    {
+    case NODE_EXPR_LITERAL:
+        key_int(k, n->literal.type_kind);
+        key_int(k, (int64_t)n->literal.int_val);
+        key_int(k, (int64_t)n->literal.float_val);
+        key_str(k, n->literal.string_val);
+        break;
+    case NODE_EXPR_VAR:
+        key_str(k, n->var_ref.name);
+        break;
+    case NODE_EXPR_BINARY:
+        key_str(k, n->binary.op);
+        key_node(k, n->binary.left);
+        key_node(k, n->binary.right);
+        break;
+    case NODE_EXPR_UNARY:
+        key_str(k, n->unary.op);
+        key_node(k, n->unary.operand);
+        break;
+    case NODE_EXPR_CALL:
+        key_node(k, n->call.callee);
+        key_list(k, n->call.args);
+        if (n->call.callee && n->call.callee->type == NODE_EXPR_VAR &&
+            n->call.callee->var_ref.name)
+        {
+            const char *name = n->call.callee->var_ref.name;
+            k->prints |= strcmp(name, "compile_warn") == 0;
+            key_int(k, key_function(k, name));
+        }
+        break;
+    case NODE_ASSERT:
+    case NODE_EXPECT:
+        key_node(k, n->assert_stmt.condition);
+        key_str(k, n->assert_stmt.message);
+        break;
+    case NODE_VAR_DECL:
+        key_str(k, n->var_decl.name);
+        key_node(k, n->var_decl.init_expr);
+        break;
+    case NODE_IF:
+        key_node(k, n->if_stmt.condition);
+        key_list(k, branch_statements(n->if_stmt.then_body));
+        key_int(k, n->if_stmt.else_body != NULL);
+        key_list(k, branch_statements(n->if_stmt.else_body));
+        break;
+    case NODE_BLOCK:
+        key_list(k, n->block.statements);
+        break;
+    case NODE_FOR:
+        key_list(k, n->for_stmt.init);
+        key_node(k, n->for_stmt.condition);
+        key_list(k, n->for_stmt.step);
+        key_list(k, n->for_stmt.body);
+        break;
+    case NODE_FOR_RANGE:
+        key_str(k, n->for_range.var_name);
+        key_node(k, n->for_range.start);
+        key_node(k, n->for_range.end);
+        key_int(k, n->for_range.is_inclusive);
+        key_list(k, n->for_range.body);
+        break;
+    case NODE_WHILE:
+        key_node(k, n->while_stmt.condition);
+        key_list(k, n->while_stmt.body);
+        break;
+    case NODE_LOOP:
+        key_list(k, n->loop_stmt.body);
+        break;
+    case NODE_REPEAT:
+        key_str(k, n->repeat_stmt.count);
+        key_list(k, n->repeat_stmt.body);
+        break;
+    case NODE_RETURN:
+        key_node(k, n->ret.value);
+        break;
+    default:
+        // Anything else is skipped or rejected by lowering; its type says enough.
+        break;
+    }
+}
+
+static void key_list(CKey *k, ASTNode *s)
+{
+    for (; s; s = s->next)
+    {
+        key_node(k, s);
+    }
+    key_int(k, -2);
+}
 
-    return result;
+uint64_t comptime_key(ParserContext *ctx, ASTNode *body, const char *source_file)
+{
+    CKey k = {0};
+    k.pctx = ctx;
+    k.h = 14695981039346656037ull;
+    key_str(&k, source_file ? source_file : "");
+    key_str(&k, z_get_system_name());
+    key_list(&k, body);
+
+    // Callees may call further @comptime fns; the list grows while it is walked.
+    for (int i = 0; i < k.fn_count; i++)
+    {
+        ASTNode *fn = k.fns[i];
+        key_str(&k, fn->func.name);
+        key_int(&k, fn->func.arg_count);
+        for (int p = 0; p < fn->func.arg_count; p++)
+        {
+            key_str(&k, fn->func.param_names ? fn->func.param_names[p] : NULL);
+        }
+        key_list(&k, fn->func.body ? fn->func.body->block.statements : NULL);
+    }
+    zfree(k.fns);
+    return (k.prints || k.h == 0) ? 0 : k.h;
 }
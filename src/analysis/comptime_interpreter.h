@@ -11,4 +11,11 @@
 
 char *interpret_comptime(ParserContext *ctx, ASTNode *body, const char *source_file);
 
+/**
+ * @brief Hash of everything interpret_comptime() output depends on: the block body, every
+ * @comptime fn it reaches, @p source_file and the target system. 0 when the block may print a
+ * compile_warn(), which replaying its output would not repeat.
+ */
+uint64_t comptime_key(ParserContext *ctx, ASTNode *body, const char *source_file);
+
 #endif
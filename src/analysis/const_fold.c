@@ -3,6 +3,10 @@
 #include "analysis/const_fold.h"
 #include "../parser/parser.h"
 #include "../ast/symbols.h"
+#include "../compiler.h"
+#include "../utils/colors.h"
+#include <ctype.h>
+#include <math.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -190,3 +194,1667 @@ int eval_const_int_expr(ASTNode *node, ParserContext *ctx, long long *out_val)
     }
     return 0; // For warning.
 }
+
+// ** Constant propagation and dead-branch elimination **
+
+// Folded integers stay within this range, where an unsuffixed C literal (or its negation) is an
+// int, so the generated C keeps the types it had before folding.
+#define FOLD_INT_MAX 2147483647LL
+
+typedef enum
+{
+    FOLD_NONE,
+    FOLD_INT,
+    FOLD_FLOAT,
+    FOLD_BOOL,
+    FOLD_CHAR,
+    FOLD_STRING
+} FoldKind;
+
+typedef struct
+{
+    FoldKind kind;
+    long long i;   // FOLD_INT, FOLD_BOOL, FOLD_CHAR
+    double f;      // FOLD_FLOAT
+    const char *s; // FOLD_STRING, as escaped C source
+} FoldValue;
+
+typedef struct
+{
+    const char *name;
+    FoldValue value; // FOLD_NONE: bound to something that is not a constant
+} FoldBinding;
+
+typedef struct
+{
+    ParserContext *ctx;
+    FoldBinding *binds; // Innermost last; the top-level defs come first
+    int bind_count;
+    int bind_cap;
+    int cfg_known; // The @cfg conditions can be decided here (see fold_cfg())
+    int strings_only; // --no-fold: join string literal sums, which C cannot add, and nothing else
+    ASTNode **seen; // Module roots already walked
+    int seen_count;
+    int seen_cap;
+
+    // The body being folded, from fold_scan()
+    const char **written; // Names assigned, incremented, address-taken or used by raw C
+    int written_count;
+    int written_cap;
+    int opaque;    // It holds nodes this pass does not model: fold literals only
+    int has_label; // It holds a label: keep every branch
+
+    int folded;
+    int pruned;
+    int dropped;
+} Folder;
+
+static int fold_seen(Folder *f, ASTNode *root)
+{
+    for (int i = 0; i < f->seen_count; i++)
+    {
+        if (f->seen[i] == root)
+        {
+            return 1;
+        }
+    }
+    if (f->seen_count == f->seen_cap)
+    {
+        f->seen_cap = f->seen_cap ? f->seen_cap * 2 : 16;
+        f->seen = xrealloc(f->seen, (size_t)f->seen_cap * sizeof(ASTNode *));
+    }
+    f->seen[f->seen_count++] = root;
+    return 0;
+}
+
+static void fold_bind(Folder *f, const char *name, const FoldValue *value)
+{
+    if (f->bind_count == f->bind_cap)
+    {
+        f->bind_cap = f->bind_cap ? f->bind_cap * 2 : 64;
+        f->binds = xrealloc(f->binds, (size_t)f->bind_cap * sizeof(FoldBinding));
+    }
+    FoldBinding *b = &f->binds[f->bind_count++];
+    b->name = name;
+    memset(&b->value, 0, sizeof(b->value));
+    if (value)
+    {
+        b->value = *value;
+    }
+}
+
+static const FoldValue *fold_lookup(Folder *f, const char *name)
+{
+    if (f->opaque)
+    {
+        return NULL;
+    }
+    for (int i = f->bind_count - 1; i >= 0; i--)
+    {
+        if (strcmp(f->binds[i].name, name) == 0)
+        {
+            return f->binds[i].value.kind == FOLD_NONE ? NULL : &f->binds[i].value;
+        }
+    }
+    return NULL;
+}
+
+static void fold_mark_written(Folder *f, const char *name, size_t len)
+{
+    if (f->written_count == f->written_cap)
+    {
+        f->written_cap = f->written_cap ? f->written_cap * 2 : 16;
+        f->written = xrealloc(f->written, (size_t)f->written_cap * sizeof(char *));
+    }
+    char *copy = xmalloc(len + 1);
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    f->written[f->written_count++] = copy;
+}
+
+static int fold_is_written(Folder *f, const char *name)
+{
+    for (int i = 0; i < f->written_count; i++)
+    {
+        if (strcmp(f->written[i], name) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Every identifier in a piece of C (raw blocks, interpolated strings, asm) may be written to.
+static void fold_mark_text(Folder *f, const char *s)
+{
+    while (s && *s)
+    {
+        if (isalpha((unsigned char)*s) || *s == '_')
+        {
+            const char *start = s;
+            while (isalnum((unsigned char)*s) || *s == '_')
+            {
+                s++;
+            }
+            fold_mark_written(f, start, (size_t)(s - start));
+        }
+        else
+        {
+            s++;
+        }
+    }
+}
+
+// The variable an lvalue expression writes through, if any.
+static void fold_mark_lvalue(Folder *f, ASTNode *n)
+{
+    while (n)
+    {
+        switch (n->type)
+        {
+        case NODE_EXPR_VAR:
+            fold_mark_written(f, n->var_ref.name, strlen(n->var_ref.name));
+            return;
+        case NODE_EXPR_MEMBER:
+            n = n->member.target;
+            break;
+        case NODE_EXPR_INDEX:
+            n = n->index.array;
+            break;
+        case NODE_EXPR_SLICE:
+            n = n->slice.array;
+            break;
+        case NODE_EXPR_CAST:
+            n = n->cast.expr;
+            break;
+        case NODE_EXPR_UNARY:
+            n = n->unary.operand;
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+static int fold_is_assign_op(const char *op)
+{
+    size_t len = strlen(op);
+    return len > 0 && op[len - 1] == '=' && strcmp(op, "==") != 0 && strcmp(op, "!=") != 0 &&
+           strcmp(op, "<=") != 0 && strcmp(op, ">=") != 0;
+}
+
+// Unary operators that only read their operand; the rest (&, ++, --) take it as an lvalue.
+static int fold_is_value_op(const char *op)
+{
+    return strcmp(op, "-") == 0 || strcmp(op, "+") == 0 || strcmp(op, "!") == 0 ||
+           strcmp(op, "~") == 0 || strcmp(op, "*") == 0;
+}
+
+static void fold_scan(Folder *f, ASTNode *n);
+
+static void fold_scan_list(Folder *f, ASTNode *n)
+{
+    for (; n; n = n->next)
+    {
+        fold_scan(f, n);
+    }
+}
+
+// Collects what fold_lookup() and the pruning need to know about a whole body up front.
+static void fold_scan(Folder *f, ASTNode *n)
+{
+    if (!n)
+    {
+        return;
+    }
+    switch (n->type)
+    {
+    case NODE_EXPR_LITERAL:
+    case NODE_EXPR_VAR:
+    case NODE_EXPR_SIZEOF:
+    case NODE_TYPEOF:
+    case NODE_BREAK:
+    case NODE_CONTINUE:
+    case NODE_AST_COMMENT:
+        break;
+    case NODE_LABEL:
+        f->has_label = 1;
+        break;
+    case NODE_GOTO:
+        fold_scan(f, n->goto_stmt.goto_expr);
+        break;
+    case NODE_BLOCK:
+        fold_scan_list(f, n->block.statements);
+        break;
+    case NODE_VAR_DECL:
+    case NODE_CONST:
+        fold_scan(f, n->var_decl.init_expr);
+        break;
+    case NODE_DESTRUCT_VAR:
+        fold_scan(f, n->destruct.init_expr);
+        fold_scan(f, n->destruct.else_block);
+        break;
+    case NODE_RETURN:
+        fold_scan(f, n->ret.value);
+        break;
+    case NODE_IF:
+        fold_scan(f, n->if_stmt.condition);
+        fold_scan(f, n->if_stmt.then_body);
+        fold_scan(f, n->if_stmt.else_body);
+        break;
+    case NODE_WHILE:
+        fold_scan(f, n->while_stmt.condition);
+        fold_scan(f, n->while_stmt.body);
+        break;
+    case NODE_DO_WHILE:
+        fold_scan(f, n->do_while_stmt.condition);
+        fold_scan(f, n->do_while_stmt.body);
+        break;
+    case NODE_FOR:
+        fold_scan(f, n->for_stmt.init);
+        fold_scan(f, n->for_stmt.condition);
+        fold_scan(f, n->for_stmt.step);
+        fold_scan(f, n->for_stmt.body);
+        break;
+    case NODE_FOR_RANGE:
+        fold_scan(f, n->for_range.start);
+        fold_scan(f, n->for_range.end);
+        fold_scan(f, n->for_range.body);
+        break;
+    case NODE_LOOP:
+        fold_scan(f, n->loop_stmt.body);
+        break;
+    case NODE_REPEAT:
+        fold_scan(f, n->repeat_stmt.body);
+        break;
+    case NODE_UNLESS:
+        fold_scan(f, n->unless_stmt.condition);
+        fold_scan(f, n->unless_stmt.body);
+        break;
+    case NODE_GUARD:
+        fold_scan(f, n->guard_stmt.condition);
+        fold_scan(f, n->guard_stmt.body);
+        break;
+    case NODE_MATCH:
+        fold_scan(f, n->match_stmt.expr);
+        fold_scan_list(f, n->match_stmt.cases);
+        break;
+    case NODE_MATCH_CASE:
+        fold_scan(f, n->match_case.guard);
+        fold_scan(f, n->match_case.body);
+        break;
+    case NODE_ASSERT:
+    case NODE_EXPECT:
+        fold_scan(f, n->assert_stmt.condition);
+        break;
+    case NODE_DEFER:
+        fold_scan(f, n->defer_stmt.stmt);
+        break;
+    case NODE_EXPR_BINARY:
+        if (fold_is_assign_op(n->binary.op))
+        {
+            fold_mark_lvalue(f, n->binary.left);
+        }
+        fold_scan(f, n->binary.left);
+        fold_scan(f, n->binary.right);
+        break;
+    case NODE_EXPR_UNARY:
+        if (!fold_is_value_op(n->unary.op))
+        {
+            fold_mark_lvalue(f, n->unary.operand);
+        }
+        fold_scan(f, n->unary.operand);
+        break;
+    case NODE_AWAIT:
+        fold_scan(f, n->unary.operand);
+        break;
+    case NODE_EXPR_CALL:
+        fold_scan(f, n->call.callee);
+        fold_scan_list(f, n->call.args);
+        break;
+    case NODE_EXPR_MEMBER:
+        // Methods take self by pointer.
+        fold_mark_lvalue(f, n->member.target);
+        fold_scan(f, n->member.target);
+        break;
+    case NODE_EXPR_INDEX:
+        fold_mark_lvalue(f, n->index.array);
+        fold_scan(f, n->index.array);
+        fold_scan(f, n->index.index);
+        fold_scan_list(f, n->index.extra_indices);
+        break;
+    case NODE_EXPR_SLICE:
+        fold_mark_lvalue(f, n->slice.array);
+        fold_scan(f, n->slice.array);
+        fold_scan(f, n->slice.start);
+        fold_scan(f, n->slice.end);
+        break;
+    case NODE_EXPR_CAST:
+        fold_scan(f, n->cast.expr);
+        break;
+    case NODE_EXPR_STRUCT_INIT:
+        fold_scan_list(f, n->struct_init.fields);
+        break;
+    case NODE_EXPR_ARRAY_LITERAL:
+        fold_scan_list(f, n->array_literal.elements);
+        break;
+    case NODE_EXPR_TUPLE_LITERAL:
+        fold_scan_list(f, n->tuple_literal.elements);
+        break;
+    case NODE_TERNARY:
+        fold_scan(f, n->ternary.cond);
+        fold_scan(f, n->ternary.true_expr);
+        fold_scan(f, n->ternary.false_expr);
+        break;
+    case NODE_TRY:
+        fold_scan(f, n->try_stmt.expr);
+        break;
+    case NODE_REPL_PRINT:
+        fold_scan(f, n->repl_print.expr);
+        break;
+    case NODE_LAMBDA:
+        fold_scan(f, n->lambda.body);
+        break;
+    case NODE_RAW_STMT:
+        fold_mark_text(f, n->raw_stmt.content);
+        break;
+    case NODE_ASM:
+        fold_mark_text(f, n->asm_stmt.code);
+        for (int i = 0; i < n->asm_stmt.num_outputs; i++)
+        {
+            fold_mark_text(f, n->asm_stmt.outputs[i]);
+        }
+        for (int i = 0; i < n->asm_stmt.num_inputs; i++)
+        {
+            fold_mark_text(f, n->asm_stmt.inputs[i]);
+        }
+        break;
+    default:
+        f->opaque = 1;
+        break;
+    }
+}
+
+static int fold_value(Folder *f, ASTNode *n, FoldValue *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!n)
+    {
+        return 0;
+    }
+    if (f->strings_only &&
+        (n->type != NODE_EXPR_LITERAL || n->literal.type_kind != LITERAL_STRING))
+    {
+        return 0;
+    }
+    switch (n->type)
+    {
+    case NODE_EXPR_LITERAL:
+        switch (n->literal.type_kind)
+        {
+        case LITERAL_INT:
+            if (!n->type_info || n->type_info->kind != TYPE_INT ||
+                n->literal.int_val > (unsigned long long)FOLD_INT_MAX)
+            {
+                return 0;
+            }
+            out->kind = FOLD_INT;
+            out->i = (long long)n->literal.int_val;
+            return 1;
+        case LITERAL_FLOAT:
+            if (!n->type_info || n->type_info->kind != TYPE_F64)
+            {
+                return 0;
+            }
+            out->kind = FOLD_FLOAT;
+            out->f = n->literal.float_val;
+            return 1;
+        case LITERAL_CHAR:
+            if (!n->type_info || n->type_info->kind != TYPE_CHAR)
+            {
+                return 0;
+            }
+            out->kind = FOLD_CHAR;
+            out->i = (long long)n->literal.int_val;
+            return 1;
+        case LITERAL_STRING:
+            if (!n->literal.string_val)
+            {
+                return 0;
+            }
+            out->kind = FOLD_STRING;
+            out->s = n->literal.string_val;
+            return 1;
+        default:
+            return 0;
+        }
+    case NODE_EXPR_VAR:
+    {
+        if (strcmp(n->var_ref.name, "true") == 0 || strcmp(n->var_ref.name, "false") == 0)
+        {
+            out->kind = FOLD_BOOL;
+            out->i = n->var_ref.name[0] == 't';
+            return 1;
+        }
+        const FoldValue *v = fold_lookup(f, n->var_ref.name);
+        if (v)
+        {
+            *out = *v;
+            return 1;
+        }
+        return 0;
+    }
+    case NODE_EXPR_UNARY:
+        // Negative numbers are a minus applied to a literal.
+        if (strcmp(n->unary.op, "-") == 0 && n->unary.operand &&
+            n->unary.operand->type == NODE_EXPR_LITERAL && fold_value(f, n->unary.operand, out))
+        {
+            if (out->kind == FOLD_INT)
+            {
+                out->i = -out->i;
+                return 1;
+            }
+            if (out->kind == FOLD_FLOAT)
+            {
+                out->f = -out->f;
+                return 1;
+            }
+        }
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+// Rewrites @p n in place into the literal for @p v, keeping its token and its place in any list.
+static void fold_set(Folder *f, ASTNode *n, const FoldValue *v)
+{
+    if (v->kind == FOLD_BOOL)
+    {
+        n->type = NODE_EXPR_VAR;
+        memset(&n->var_ref, 0, sizeof(n->var_ref));
+        n->var_ref.name = xstrdup(v->i ? "true" : "false");
+        n->type_info = type_new(TYPE_BOOL);
+        n->resolved_type = NULL;
+        f->folded++;
+        return;
+    }
+    if (v->kind != FOLD_INT && v->kind != FOLD_FLOAT && v->kind != FOLD_STRING)
+    {
+        return;
+    }
+
+    int negative = (v->kind == FOLD_INT && v->i < 0) || (v->kind == FOLD_FLOAT && signbit(v->f));
+    ASTNode *lit = n;
+    if (negative)
+    {
+        lit = ast_create(NODE_EXPR_LITERAL);
+        lit->token = n->token;
+        lit->line = n->line;
+        n->type = NODE_EXPR_UNARY;
+        memset(&n->unary, 0, sizeof(n->unary));
+        n->unary.op = xstrdup("-");
+        n->unary.operand = lit;
+    }
+    else
+    {
+        n->type = NODE_EXPR_LITERAL;
+    }
+
+    memset(&lit->literal, 0, sizeof(lit->literal));
+    if (v->kind == FOLD_INT)
+    {
+        lit->literal.type_kind = LITERAL_INT;
+        lit->literal.int_val = (unsigned long long)(negative ? -v->i : v->i);
+        lit->type_info = type_new(TYPE_INT);
+    }
+    else if (v->kind == FOLD_FLOAT)
+    {
+        lit->literal.type_kind = LITERAL_FLOAT;
+        lit->literal.float_val = negative ? -v->f : v->f;
+        lit->type_info = type_new(TYPE_F64);
+    }
+    else
+    {
+        lit->literal.type_kind = LITERAL_STRING;
+        lit->literal.string_val = (char *)v->s;
+        lit->type_info = type_new(TYPE_STRING);
+    }
+    n->type_info = lit->type_info;
+    n->resolved_type = NULL;
+    lit->resolved_type = NULL;
+    f->folded++;
+}
+
+static int fold_compare(const char *op, int cmp, long long *out)
+{
+    if (strcmp(op, "==") == 0)
+    {
+        *out = cmp == 0;
+    }
+    else if (strcmp(op, "!=") == 0)
+    {
+        *out = cmp != 0;
+    }
+    else if (strcmp(op, "<") == 0)
+    {
+        *out = cmp < 0;
+    }
+    else if (strcmp(op, ">") == 0)
+    {
+        *out = cmp > 0;
+    }
+    else if (strcmp(op, "<=") == 0)
+    {
+        *out = cmp <= 0;
+    }
+    else if (strcmp(op, ">=") == 0)
+    {
+        *out = cmp >= 0;
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+static int fold_int_op(const char *op, long long a, long long b, FoldValue *out)
+{
+    long long v;
+    if (fold_compare(op, (a > b) - (a < b), &out->i))
+    {
+        out->kind = FOLD_BOOL;
+        return 1;
+    }
+    if (strcmp(op, "&&") == 0)
+    {
+        v = a && b;
+    }
+    else if (strcmp(op, "||") == 0)
+    {
+        v = a || b;
+    }
+    else if (strcmp(op, "+") == 0)
+    {
+        v = a + b;
+    }
+    else if (strcmp(op, "-") == 0)
+    {
+        v = a - b;
+    }
+    else if (strcmp(op, "*") == 0)
+    {
+        v = a * b;
+    }
+    else if (strcmp(op, "/") == 0 || strcmp(op, "%") == 0)
+    {
+        if (b == 0)
+        {
+            return 0;
+        }
+        v = op[0] == '/' ? a / b : a % b;
+    }
+    else if (strcmp(op, "<<") == 0)
+    {
+        if (a < 0 || b < 0 || b > 30)
+        {
+            return 0;
+        }
+        v = a << b;
+    }
+    else if (strcmp(op, ">>") == 0)
+    {
+        if (a < 0 || b < 0 || b > 31)
+        {
+            return 0;
+        }
+        v = a >> b;
+    }
+    else if (strcmp(op, "&") == 0)
+    {
+        v = a & b;
+    }
+    else if (strcmp(op, "|") == 0)
+    {
+        v = a | b;
+    }
+    else if (strcmp(op, "^") == 0)
+    {
+        v = a ^ b;
+    }
+    else
+    {
+        return 0;
+    }
+    if (v > FOLD_INT_MAX || v < -FOLD_INT_MAX)
+    {
+        return 0;
+    }
+    out->kind = FOLD_INT;
+    out->i = v;
+    return 1;
+}
+
+static int fold_float_op(const char *op, double a, double b, FoldValue *out)
+{
+    double v;
+    if (fold_compare(op, (a > b) - (a < b), &out->i))
+    {
+        out->kind = FOLD_BOOL;
+        return 1;
+    }
+    if (strcmp(op, "+") == 0)
+    {
+        v = a + b;
+    }
+    else if (strcmp(op, "-") == 0)
+    {
+        v = a - b;
+    }
+    else if (strcmp(op, "*") == 0)
+    {
+        v = a * b;
+    }
+    else if (strcmp(op, "/") == 0)
+    {
+        if (!(b < 0 || b > 0))
+        {
+            return 0;
+        }
+        v = a / b;
+    }
+    else
+    {
+        return 0;
+    }
+    if (!isfinite(v))
+    {
+        return 0;
+    }
+    out->kind = FOLD_FLOAT;
+    out->f = v;
+    return 1;
+}
+
+// A trailing \x or short octal escape in @p s would swallow the leading digits of @p next.
+static int fold_escape_runs_on(const char *s, const char *next)
+{
+    int hex = 0;
+    int octal = 0;
+    for (size_t i = 0; s[i]; i++)
+    {
+        hex = 0;
+        octal = 0;
+        if (s[i] != '\\' || !s[i + 1])
+        {
+            continue;
+        }
+        i++;
+        if (s[i] == 'x')
+        {
+            while (isxdigit((unsigned char)s[i + 1]))
+            {
+                i++;
+            }
+            hex = 1;
+        }
+        else if (s[i] >= '0' && s[i] <= '7')
+        {
+            int digits = 1;
+            while (digits < 3 && s[i + 1] >= '0' && s[i + 1] <= '7')
+            {
+                i++;
+                digits++;
+            }
+            octal = digits < 3;
+        }
+    }
+    return (hex && isxdigit((unsigned char)next[0])) || (octal && next[0] >= '0' && next[0] <= '7');
+}
+
+static int fold_string_op(const char *op, const char *a, const char *b, FoldValue *out)
+{
+    if (strcmp(op, "+") != 0)
+    {
+        return 0;
+    }
+    // Split the literal ("a" "b") where joining the text would change an escape.
+    const char *glue = fold_escape_runs_on(a, b) ? "\"\"" : "";
+    size_t len = strlen(a) + strlen(glue) + strlen(b);
+    char *s = xmalloc(len + 1);
+    snprintf(s, len + 1, "%s%s%s", a, glue, b);
+    out->kind = FOLD_STRING;
+    out->s = s;
+    return 1;
+}
+
+static int fold_binary_value(const char *op, const FoldValue *l, const FoldValue *r,
+                             FoldValue *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (l->kind != r->kind)
+    {
+        // A bool def used in a condition is inlined by the parser as 0 or 1.
+        int logical = strcmp(op, "&&") == 0 || strcmp(op, "||") == 0;
+        if (!logical || (l->kind != FOLD_INT && l->kind != FOLD_BOOL) ||
+            (r->kind != FOLD_INT && r->kind != FOLD_BOOL))
+        {
+            return 0;
+        }
+        return fold_int_op(op, l->i, r->i, out);
+    }
+    switch (l->kind)
+    {
+    case FOLD_INT:
+        return fold_int_op(op, l->i, r->i, out);
+    case FOLD_FLOAT:
+        return fold_float_op(op, l->f, r->f, out);
+    case FOLD_CHAR:
+        out->kind = FOLD_BOOL;
+        return fold_compare(op, (l->i > r->i) - (l->i < r->i), &out->i);
+    case FOLD_BOOL:
+        out->kind = FOLD_BOOL;
+        if (strcmp(op, "&&") == 0)
+        {
+            out->i = l->i && r->i;
+            return 1;
+        }
+        if (strcmp(op, "||") == 0)
+        {
+            out->i = l->i || r->i;
+            return 1;
+        }
+        return (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) &&
+               fold_compare(op, (int)(l->i != r->i), &out->i);
+    case FOLD_STRING:
+        return fold_string_op(op, l->s, r->s, out);
+    case FOLD_NONE:
+    default:
+        return 0;
+    }
+}
+
+static void fold_expr(Folder *f, ASTNode *n);
+static ASTNode *fold_stmt(Folder *f, ASTNode *n, int prune);
+
+// Folds the parts of an lvalue that are read, leaving the variable written to alone.
+static void fold_lvalue(Folder *f, ASTNode *n)
+{
+    if (!n)
+    {
+        return;
+    }
+    switch (n->type)
+    {
+    case NODE_EXPR_VAR:
+        break;
+    case NODE_EXPR_MEMBER:
+        fold_lvalue(f, n->member.target);
+        break;
+    case NODE_EXPR_INDEX:
+        fold_lvalue(f, n->index.array);
+        fold_expr(f, n->index.index);
+        for (ASTNode *i = n->index.extra_indices; i; i = i->next)
+        {
+            fold_expr(f, i);
+        }
+        break;
+    case NODE_EXPR_SLICE:
+        fold_lvalue(f, n->slice.array);
+        fold_expr(f, n->slice.start);
+        fold_expr(f, n->slice.end);
+        break;
+    default:
+        fold_expr(f, n);
+        break;
+    }
+}
+
+static void fold_binary(Folder *f, ASTNode *n)
+{
+    const char *op = n->binary.op;
+    if (fold_is_assign_op(op))
+    {
+        fold_lvalue(f, n->binary.left);
+        fold_expr(f, n->binary.right);
+        return;
+    }
+    fold_expr(f, n->binary.left);
+    fold_expr(f, n->binary.right);
+
+    FoldValue l, r, v;
+    int has_l = fold_value(f, n->binary.left, &l);
+    if (has_l && (l.kind == FOLD_BOOL || l.kind == FOLD_INT) &&
+        ((strcmp(op, "&&") == 0 && !l.i) || (strcmp(op, "||") == 0 && l.i)))
+    {
+        // The right operand is never evaluated.
+        l.i = l.i != 0;
+        fold_set(f, n, &l);
+        return;
+    }
+    if (has_l && fold_value(f, n->binary.right, &r) && fold_binary_value(op, &l, &r, &v))
+    {
+        fold_set(f, n, &v);
+    }
+}
+
+static void fold_unary(Folder *f, ASTNode *n)
+{
+    const char *op = n->unary.op;
+    if (!fold_is_value_op(op))
+    {
+        fold_lvalue(f, n->unary.operand);
+        return;
+    }
+    fold_expr(f, n->unary.operand);
+
+    FoldValue v;
+    if (!fold_value(f, n->unary.operand, &v))
+    {
+        return;
+    }
+    if (strcmp(op, "!") == 0 && (v.kind == FOLD_BOOL || v.kind == FOLD_INT))
+    {
+        v.i = !v.i;
+        fold_set(f, n, &v);
+    }
+    else if (strcmp(op, "~") == 0 && v.kind == FOLD_INT)
+    {
+        v.i = ~v.i;
+        fold_set(f, n, &v);
+    }
+    else if (strcmp(op, "-") == 0 && n->unary.operand->type != NODE_EXPR_LITERAL)
+    {
+        // A minus on a plain literal is how negative numbers are spelled already.
+        if (v.kind == FOLD_INT)
+        {
+            v.i = -v.i;
+            fold_set(f, n, &v);
+        }
+        else if (v.kind == FOLD_FLOAT)
+        {
+            v.f = -v.f;
+            fold_set(f, n, &v);
+        }
+    }
+}
+
+static void fold_expr(Folder *f, ASTNode *n)
+{
+    if (!n)
+    {
+        return;
+    }
+    switch (n->type)
+    {
+    case NODE_EXPR_VAR:
+    {
+        // bool and char constants keep their name: `true` and 'c' are ints in C.
+        FoldValue v;
+        if (fold_lookup(f, n->var_ref.name) && fold_value(f, n, &v) &&
+            (v.kind == FOLD_INT || v.kind == FOLD_FLOAT))
+        {
+            fold_set(f, n, &v);
+        }
+        break;
+    }
+    case NODE_EXPR_BINARY:
+        fold_binary(f, n);
+        break;
+    case NODE_EXPR_UNARY:
+        fold_unary(f, n);
+        break;
+    case NODE_AWAIT:
+        fold_expr(f, n->unary.operand);
+        break;
+    case NODE_EXPR_CALL:
+        for (ASTNode *a = n->call.args; a; a = a->next)
+        {
+            fold_expr(f, a);
+        }
+        break;
+    case NODE_EXPR_MEMBER:
+    case NODE_EXPR_INDEX:
+    case NODE_EXPR_SLICE:
+        fold_lvalue(f, n);
+        break;
+    case NODE_EXPR_CAST:
+        fold_expr(f, n->cast.expr);
+        break;
+    case NODE_EXPR_STRUCT_INIT:
+        for (ASTNode *field = n->struct_init.fields; field; field = field->next)
+        {
+            if (field->type == NODE_VAR_DECL)
+            {
+                fold_expr(f, field->var_decl.init_expr);
+            }
+        }
+        break;
+    case NODE_EXPR_ARRAY_LITERAL:
+        for (ASTNode *e = n->array_literal.elements; e; e = e->next)
+        {
+            fold_expr(f, e);
+        }
+        break;
+    case NODE_EXPR_TUPLE_LITERAL:
+        for (ASTNode *e = n->tuple_literal.elements; e; e = e->next)
+        {
+            fold_expr(f, e);
+        }
+        break;
+    case NODE_TERNARY:
+        fold_expr(f, n->ternary.cond);
+        fold_expr(f, n->ternary.true_expr);
+        fold_expr(f, n->ternary.false_expr);
+        break;
+    case NODE_TRY:
+        fold_expr(f, n->try_stmt.expr);
+        break;
+    case NODE_REPL_PRINT:
+        fold_expr(f, n->repl_print.expr);
+        break;
+    case NODE_IF:
+    case NODE_MATCH:
+    case NODE_BLOCK:
+        // Used for their value: the last statement of each block is the result.
+        fold_stmt(f, n, 0);
+        break;
+    default:
+        break;
+    }
+}
+
+// Folds the statement in *slot, which must keep holding one.
+static void fold_body(Folder *f, ASTNode **slot, int prune)
+{
+    if (!*slot)
+    {
+        return;
+    }
+    ASTNode *r = fold_stmt(f, *slot, prune);
+    *slot = r ? r : ast_create(NODE_BLOCK);
+}
+
+static void fold_list(Folder *f, ASTNode **link, int prune)
+{
+    while (*link)
+    {
+        ASTNode *n = *link;
+        ASTNode *next = n->next;
+        ASTNode *r = fold_stmt(f, n, prune);
+        if (!r)
+        {
+            *link = next;
+            continue;
+        }
+        if (r != n)
+        {
+            r->next = next;
+            *link = r;
+        }
+        link = &r->next;
+    }
+}
+
+static int fold_cond(Folder *f, ASTNode *cond, int prune, int *value)
+{
+    FoldValue v;
+    if (!prune || f->has_label || !fold_value(f, cond, &v) ||
+        (v.kind != FOLD_BOOL && v.kind != FOLD_INT))
+    {
+        return 0;
+    }
+    *value = v.i != 0;
+    f->pruned++;
+    return 1;
+}
+
+// Whether a constant def or never-written let of @p type can stand in for its name.
+static int fold_type_matches(const FoldValue *v, TypeKind type)
+{
+    switch (v->kind)
+    {
+    case FOLD_INT:
+        return type == TYPE_INT;
+    case FOLD_FLOAT:
+        return type == TYPE_F64;
+    case FOLD_BOOL:
+        return type == TYPE_BOOL;
+    case FOLD_CHAR:
+        return type == TYPE_CHAR;
+    case FOLD_STRING:
+    case FOLD_NONE:
+    default:
+        return 0;
+    }
+}
+
+static int fold_def_value(Folder *f, ASTNode *n, FoldValue *v)
+{
+    if (!fold_value(f, n->var_decl.init_expr, v) || v->kind == FOLD_STRING)
+    {
+        return 0;
+    }
+    const char *t = n->var_decl.type_str;
+    if (!t)
+    {
+        return 1;
+    }
+    static const struct
+    {
+        const char *name;
+        TypeKind kind;
+    } names[] = {{"int", TYPE_INT}, {"f64", TYPE_F64},   {"double", TYPE_F64},
+                 {"bool", TYPE_BOOL}, {"char", TYPE_CHAR}};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (strcmp(t, names[i].name) == 0)
+        {
+            return fold_type_matches(v, names[i].kind);
+        }
+    }
+    return 0;
+}
+
+// One alternative of a match pattern: an integer, character or bool literal.
+static int fold_pattern_atom(const char *s, const char *end, FoldValue *out)
+{
+    while (s < end && isspace((unsigned char)*s))
+    {
+        s++;
+    }
+    while (end > s && isspace((unsigned char)end[-1]))
+    {
+        end--;
+    }
+    size_t len = (size_t)(end - s);
+    memset(out, 0, sizeof(*out));
+    if ((len == 4 && strncmp(s, "true", 4) == 0) || (len == 5 && strncmp(s, "false", 5) == 0))
+    {
+        out->kind = FOLD_BOOL;
+        out->i = s[0] == 't';
+        return 1;
+    }
+    if (len == 3 && s[0] == '\'' && s[2] == '\'' && s[1] != '\\' && s[1] != '\'')
+    {
+        out->kind = FOLD_CHAR;
+        out->i = (unsigned char)s[1];
+        return 1;
+    }
+    int negative = s < end && *s == '-';
+    if (negative)
+    {
+        s++;
+    }
+    // Leading zeros would make C read the pattern as octal.
+    if (s == end || (*s == '0' && end - s > 1))
+    {
+        return 0;
+    }
+    long long v = 0;
+    for (; s < end; s++)
+    {
+        if (!isdigit((unsigned char)*s))
+        {
+            return 0;
+        }
+        v = v * 10 + (*s - '0');
+        if (v > FOLD_INT_MAX)
+        {
+            return 0;
+        }
+    }
+    out->kind = FOLD_INT;
+    out->i = negative ? -v : v;
+    return 1;
+}
+
+static int fold_is_number(const FoldValue *v)
+{
+    return v->kind == FOLD_INT || v->kind == FOLD_CHAR;
+}
+
+// Decides whether @p v matches @p pattern. Returns 0 when the pattern is not made of literals.
+static int fold_pattern_matches(const char *pattern, const FoldValue *v, int *matched)
+{
+    *matched = 0;
+    const char *part = pattern;
+    while (*part)
+    {
+        const char *end = strchr(part, '|');
+        if (!end)
+        {
+            end = part + strlen(part);
+        }
+        const char *dots = strstr(part, "..");
+        FoldValue lo, hi;
+        if (dots && dots < end)
+        {
+            int inclusive = dots[2] == '=';
+            if (!fold_pattern_atom(part, dots, &lo) ||
+                !fold_pattern_atom(dots + (inclusive ? 3 : 2), end, &hi) || !fold_is_number(&lo) ||
+                !fold_is_number(&hi) || !fold_is_number(v))
+            {
+                return 0;
+            }
+            if (v->i >= lo.i && (inclusive ? v->i <= hi.i : v->i < hi.i))
+            {
+                *matched = 1;
+            }
+        }
+        else
+        {
+            if (!fold_pattern_atom(part, end, &lo) ||
+                fold_is_number(&lo) != fold_is_number(v))
+            {
+                return 0;
+            }
+            if (lo.i == v->i)
+            {
+                *matched = 1;
+            }
+        }
+        part = *end ? end + 1 : end;
+    }
+    return 1;
+}
+
+static ASTNode *fold_match(Folder *f, ASTNode *n, int prune)
+{
+    fold_expr(f, n->match_stmt.expr);
+    for (ASTNode *c = n->match_stmt.cases; c; c = c->next)
+    {
+        if (c->type != NODE_MATCH_CASE)
+        {
+            continue;
+        }
+        int mark = f->bind_count;
+        for (int i = 0; i < c->match_case.binding_count; i++)
+        {
+            if (c->match_case.binding_names[i])
+            {
+                fold_bind(f, c->match_case.binding_names[i], NULL);
+            }
+        }
+        fold_expr(f, c->match_case.guard);
+        fold_body(f, &c->match_case.body, prune);
+        f->bind_count = mark;
+    }
+
+    FoldValue v;
+    if (!prune || f->has_label || !fold_value(f, n->match_stmt.expr, &v) ||
+        (v.kind != FOLD_INT && v.kind != FOLD_CHAR && v.kind != FOLD_BOOL))
+    {
+        return n;
+    }
+    ASTNode *hit = NULL;
+    for (ASTNode *c = n->match_stmt.cases; c && !hit; c = c->next)
+    {
+        if (c->type != NODE_MATCH_CASE || !c->match_case.pattern || c->match_case.guard ||
+            c->match_case.binding_count > 0 || c->match_case.is_destructuring)
+        {
+            return n;
+        }
+        int matched = c->match_case.is_default || strcmp(c->match_case.pattern, "_") == 0;
+        if (!matched && !fold_pattern_matches(c->match_case.pattern, &v, &matched))
+        {
+            return n;
+        }
+        if (matched)
+        {
+            hit = c;
+        }
+    }
+    if (!hit)
+    {
+        f->pruned++;
+        return NULL;
+    }
+    ASTNode *body = hit->match_case.body;
+    if (body->type == NODE_EXPR_LITERAL && body->literal.type_kind == LITERAL_STRING)
+    {
+        return n; // An arm that is a string prints it
+    }
+    f->pruned++;
+    if (body->type == NODE_BLOCK)
+    {
+        return body;
+    }
+    ASTNode *block = ast_create(NODE_BLOCK);
+    block->token = body->token;
+    block->line = body->line;
+    block->block.statements = body;
+    body->next = NULL;
+    return block;
+}
+
+// Folds one statement. With @p prune set it sits in a statement list (not the value of a
+// block), and comes back as what replaces it: the arm that is always taken, or NULL.
+static ASTNode *fold_stmt(Folder *f, ASTNode *n, int prune)
+{
+    int mark = f->bind_count;
+    int cond;
+    switch (n->type)
+    {
+    case NODE_BLOCK:
+        fold_list(f, &n->block.statements, prune);
+        f->bind_count = mark;
+        return n;
+    case NODE_VAR_DECL:
+    {
+        fold_expr(f, n->var_decl.init_expr);
+        FoldValue v;
+        int constant = !n->var_decl.is_static && n->var_decl.type_info &&
+                       !fold_is_written(f, n->var_decl.name) &&
+                       fold_value(f, n->var_decl.init_expr, &v) &&
+                       fold_type_matches(&v, n->var_decl.type_info->kind);
+        fold_bind(f, n->var_decl.name, constant ? &v : NULL);
+        return n;
+    }
+    case NODE_CONST:
+    {
+        fold_expr(f, n->var_decl.init_expr);
+        FoldValue v;
+        fold_bind(f, n->var_decl.name, fold_def_value(f, n, &v) ? &v : NULL);
+        return n;
+    }
+    case NODE_DESTRUCT_VAR:
+        fold_expr(f, n->destruct.init_expr);
+        fold_body(f, &n->destruct.else_block, prune);
+        for (int i = 0; i < n->destruct.count; i++)
+        {
+            fold_bind(f, n->destruct.names[i], NULL);
+        }
+        return n;
+    case NODE_RETURN:
+        fold_expr(f, n->ret.value);
+        return n;
+    case NODE_IF:
+        fold_expr(f, n->if_stmt.condition);
+        fold_body(f, &n->if_stmt.then_body, prune);
+        if (n->if_stmt.else_body)
+        {
+            n->if_stmt.else_body = fold_stmt(f, n->if_stmt.else_body, prune);
+        }
+        if (fold_cond(f, n->if_stmt.condition, prune, &cond))
+        {
+            return cond ? n->if_stmt.then_body : n->if_stmt.else_body;
+        }
+        return n;
+    case NODE_UNLESS:
+        fold_expr(f, n->unless_stmt.condition);
+        fold_body(f, &n->unless_stmt.body, prune);
+        if (fold_cond(f, n->unless_stmt.condition, prune, &cond))
+        {
+            return cond ? NULL : n->unless_stmt.body;
+        }
+        return n;
+    case NODE_GUARD:
+        fold_expr(f, n->guard_stmt.condition);
+        fold_body(f, &n->guard_stmt.body, prune);
+        if (fold_cond(f, n->guard_stmt.condition, prune, &cond))
+        {
+            return cond ? NULL : n->guard_stmt.body;
+        }
+        return n;
+    case NODE_WHILE:
+        fold_expr(f, n->while_stmt.condition);
+        fold_body(f, &n->while_stmt.body, prune);
+        if (!n->while_stmt.loop_label && fold_cond(f, n->while_stmt.condition, prune, &cond))
+        {
+            if (!cond)
+            {
+                return NULL;
+            }
+            f->pruned--; // `while true` stays a loop
+        }
+        return n;
+    case NODE_DO_WHILE:
+        fold_expr(f, n->do_while_stmt.condition);
+        fold_body(f, &n->do_while_stmt.body, prune);
+        return n;
+    case NODE_FOR:
+        if (n->for_stmt.init)
+        {
+            n->for_stmt.init = fold_stmt(f, n->for_stmt.init, 0);
+        }
+        fold_expr(f, n->for_stmt.condition);
+        fold_expr(f, n->for_stmt.step);
+        fold_body(f, &n->for_stmt.body, prune);
+        f->bind_count = mark;
+        return n;
+    case NODE_FOR_RANGE:
+        fold_expr(f, n->for_range.start);
+        fold_expr(f, n->for_range.end);
+        fold_bind(f, n->for_range.var_name, NULL);
+        fold_body(f, &n->for_range.body, prune);
+        f->bind_count = mark;
+        return n;
+    case NODE_LOOP:
+        fold_body(f, &n->loop_stmt.body, prune);
+        return n;
+    case NODE_REPEAT:
+        fold_body(f, &n->repeat_stmt.body, prune);
+        return n;
+    case NODE_MATCH:
+        return fold_match(f, n, prune);
+    case NODE_ASSERT:
+    case NODE_EXPECT:
+        fold_expr(f, n->assert_stmt.condition);
+        return n;
+    case NODE_DEFER:
+        fold_body(f, &n->defer_stmt.stmt, prune);
+        return n;
+    default:
+        fold_expr(f, n);
+        return n;
+    }
+}
+
+// Folds a function or test body, which must be a block for arms to be dropped from it.
+static void fold_body_of(Folder *f, ASTNode **body, char **params, int param_count)
+{
+    f->written_count = 0;
+    f->opaque = 0;
+    f->has_label = 0;
+    fold_scan(f, *body);
+
+    int mark = f->bind_count;
+    for (int i = 0; i < param_count; i++)
+    {
+        if (!params || !params[i])
+        {
+            f->opaque = 1;
+            break;
+        }
+        fold_bind(f, params[i], NULL);
+    }
+    fold_body(f, body, (*body)->type == NODE_BLOCK);
+    f->bind_count = mark;
+}
+
+static void fold_function(Folder *f, ASTNode *fn)
+{
+    if (fn && fn->type == NODE_FUNCTION && fn->func.body && !fn->func.generic_params)
+    {
+        fold_body_of(f, &fn->func.body, fn->func.param_names, fn->func.arg_count);
+    }
+}
+
+// ** @cfg conditions **
+
+// The cfg_condition strings built by the attribute parser: defined(ZC_CFG_NAME) terms
+// combined with !, &&, || and parentheses.
+typedef struct
+{
+    const char *p;
+    const zvec_Str *defines;
+    int ok;
+} CfgCursor;
+
+static int cfg_or(CfgCursor *c);
+
+static void cfg_space(CfgCursor *c)
+{
+    while (*c->p == ' ')
+    {
+        c->p++;
+    }
+}
+
+static int cfg_term(CfgCursor *c)
+{
+    cfg_space(c);
+    if (*c->p == '!')
+    {
+        c->p++;
+        return !cfg_term(c);
+    }
+    if (*c->p == '(')
+    {
+        c->p++;
+        int v = cfg_or(c);
+        cfg_space(c);
+        if (*c->p != ')')
+        {
+            c->ok = 0;
+            return 0;
+        }
+        c->p++;
+        return v;
+    }
+    if (strncmp(c->p, "defined(ZC_CFG_", 15) == 0)
+    {
+        const char *name = c->p + 15;
+        const char *end = strchr(name, ')');
+        if (!end)
+        {
+            c->ok = 0;
+            return 0;
+        }
+        c->p = end + 1;
+        size_t len = (size_t)(end - name);
+        for (size_t i = 0; i < c->defines->length; i++)
+        {
+            const char *d = c->defines->data[i];
+            if (strlen(d) == len && strncmp(d, name, len) == 0)
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+    c->ok = 0;
+    return 0;
+}
+
+static int cfg_and(CfgCursor *c)
+{
+    int v = cfg_term(c);
+    for (;;)
+    {
+        cfg_space(c);
+        if (strncmp(c->p, "&&", 2) != 0)
+        {
+            return v;
+        }
+        c->p += 2;
+        int r = cfg_term(c);
+        v = v && r;
+    }
+}
+
+static int cfg_or(CfgCursor *c)
+{
+    int v = cfg_and(c);
+    for (;;)
+    {
+        cfg_space(c);
+        if (strncmp(c->p, "||", 2) != 0)
+        {
+            return v;
+        }
+        c->p += 2;
+        int r = cfg_and(c);
+        v = v || r;
+    }
+}
+
+// 1 if an item with this @cfg condition is compiled in, 0 if it never is, -1 if unknown.
+static int fold_cfg(Folder *f, const char *condition)
+{
+    if (!condition)
+    {
+        return 1;
+    }
+    if (!f->cfg_known)
+    {
+        return -1;
+    }
+    CfgCursor c = {condition, &f->ctx->config->cfg_defines, 1};
+    int v = cfg_or(&c);
+    cfg_space(&c);
+    return c.ok && !*c.p ? v : -1;
+}
+
+// Binds the top-level defs; one defined twice (in two modules, or under @cfg) is left alone.
+static void fold_collect_defs(Folder *f, ASTNode *root, int depth)
+{
+    if (!root || root->type != NODE_ROOT || depth > 64 || fold_seen(f, root))
+    {
+        return;
+    }
+    for (ASTNode *n = root->root.children; n; n = n->next)
+    {
+        switch (n->type)
+        {
+        case NODE_ROOT:
+            fold_collect_defs(f, n, depth + 1);
+            break;
+        case NODE_IMPORT:
+            fold_collect_defs(f, n->import_stmt.module_root, depth + 1);
+            break;
+        case NODE_RAW_STMT:
+        case NODE_PREPROC_DIRECTIVE:
+            if (n->raw_stmt.content && strstr(n->raw_stmt.content, "ZC_CFG_"))
+            {
+                f->cfg_known = 0;
+            }
+            break;
+        case NODE_CONST:
+        {
+            fold_expr(f, n->var_decl.init_expr);
+            FoldValue v;
+            int constant = !n->cfg_condition && fold_def_value(f, n, &v);
+            int known = 0;
+            for (int i = 0; i < f->bind_count; i++)
+            {
+                if (strcmp(f->binds[i].name, n->var_decl.name) == 0)
+                {
+                    f->binds[i].value.kind = FOLD_NONE;
+                    known = 1;
+                }
+            }
+            if (!known)
+            {
+                fold_bind(f, n->var_decl.name, constant ? &v : NULL);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+// Drops the functions in *link whose @cfg condition is false and folds the rest.
+static void fold_functions(Folder *f, ASTNode **link)
+{
+    while (*link)
+    {
+        ASTNode *n = *link;
+        if (n->type == NODE_FUNCTION && fold_cfg(f, n->cfg_condition) == 0)
+        {
+            *link = n->next;
+            f->dropped++;
+            continue;
+        }
+        fold_function(f, n);
+        link = &n->next;
+    }
+}
+
+static void fold_root(Folder *f, ASTNode *root, int depth)
+{
+    if (!root || root->type != NODE_ROOT || depth > 64 || fold_seen(f, root))
+    {
+        return;
+    }
+    ASTNode **link = &root->root.children;
+    while (*link)
+    {
+        ASTNode *n = *link;
+        switch (n->type)
+        {
+        case NODE_ROOT:
+            fold_root(f, n, depth + 1);
+            break;
+        case NODE_IMPORT:
+            fold_root(f, n->import_stmt.module_root, depth + 1);
+            break;
+        case NODE_FUNCTION:
+            if (fold_cfg(f, n->cfg_condition) == 0)
+            {
+                *link = n->next;
+                f->dropped++;
+                continue;
+            }
+            fold_function(f, n);
+            break;
+        case NODE_TEST:
+            if (n->test_stmt.body)
+            {
+                fold_body_of(f, &n->test_stmt.body, NULL, 0);
+            }
+            break;
+        case NODE_IMPL:
+            // Impls of generic structs are templates.
+            if (!n->impl.struct_name || !strchr(n->impl.struct_name, '<'))
+            {
+                fold_functions(f, &n->impl.methods);
+            }
+            break;
+        case NODE_IMPL_TRAIT:
+            // Trait methods are all referenced from the vtable, so none is dropped.
+            if (!n->impl_trait.target_type || !strchr(n->impl_trait.target_type, '<'))
+            {
+                for (ASTNode *m = n->impl_trait.methods; m; m = m->next)
+                {
+                    fold_function(f, m);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+        link = &n->next;
+    }
+}
+
+void fold_program(ParserContext *ctx, ASTNode *root)
+{
+    CompilerConfig *cfg = ctx->config;
+    Folder f = {0};
+    f.ctx = ctx;
+    // When zc does not run the cc itself the C may be built with other defines, and
+    // ZC_CFG_* can be set by hand on the cc command line.
+    f.cfg_known = !cfg->mode_transpile && !cfg->emit_c && !(cfg->mode_run && cfg->use_jit) &&
+                  !strstr(cfg->gcc_flags, "ZC_CFG_") && !strstr(g_cflags, "ZC_CFG_");
+    // Defs are still walked for their string sums; their bindings are never read then.
+    f.strings_only = !cfg->use_fold;
+    f.cfg_known = f.cfg_known && !f.strings_only;
+
+    fold_collect_defs(&f, root, 0);
+    f.seen_count = 0;
+    fold_root(&f, root, 0);
+    for (ASTNode *n = ctx->instantiated_funcs; n; n = n->next)
+    {
+        fold_function(&f, n);
+    }
+
+    if (cfg->verbose && f.strings_only)
+    {
+        printf(COLOR_BOLD COLOR_CYAN "        Fold" COLOR_RESET " off, %d string sum%s joined\n",
+               f.folded, f.folded == 1 ? "" : "s");
+        fflush(stdout);
+    }
+    else if (cfg->verbose)
+    {
+        printf(COLOR_BOLD COLOR_CYAN "        Fold" COLOR_RESET
+                                     " %d expression%s, %d branch%s, %d @cfg item%s dropped\n",
+               f.folded, f.folded == 1 ? "" : "s", f.pruned, f.pruned == 1 ? "" : "es", f.dropped,
+               f.dropped == 1 ? "" : "s");
+        fflush(stdout);
+    }
+}
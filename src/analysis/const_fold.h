@@ -15,4 +15,9 @@ typedef struct ParserContext ParserContext;
 // Returns 0 if the expression is not a compile-time constant.
 int eval_const_int_expr(ASTNode *node, ParserContext *ctx, long long *out_val);
 
+// Folds constant expressions in function bodies, substitutes the values of defs and
+// never-assigned lets, and drops the branches (and @cfg functions) that can never run.
+// With --no-fold it only joins sums of string literals, which the type checker leaves to it.
+void fold_program(ParserContext *ctx, ASTNode *root);
+
 #endif
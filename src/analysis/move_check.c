@@ -10,11 +10,102 @@
 
 #include "zprep.h"
 
-MoveState *move_state_create(MoveState *parent)
+// Paths of one function body, numbered in order of first move.
+struct MovePlaces
 {
-    MoveState *s = xmalloc(sizeof(MoveState));
-    s->entries = NULL;
-    s->parent = parent;
+    const char **keys; // Open-addressed interned paths, NULL = empty
+    uint32_t *index;   // Place number of keys[i]
+    uint32_t cap;      // Power of two
+    uint32_t count;
+};
+
+// Slot holding @p key, or the empty slot where it belongs.
+static uint32_t place_slot(MovePlaces *p, const char *key)
+{
+    uint32_t i = intern_hash(key) & (p->cap - 1);
+    while (p->keys[i] && p->keys[i] != key)
+    {
+        i = (i + 1) & (p->cap - 1);
+    }
+    return i;
+}
+
+// Number of the place at @p path, or -1 if nothing ever moved it (and @p add is 0).
+static int64_t place_of(MovePlaces *p, const char *path, int add)
+{
+    const char *key = add ? intern(path) : intern_find(path);
+    if (!key)
+    {
+        return -1;
+    }
+    if (p->cap)
+    {
+        uint32_t i = place_slot(p, key);
+        if (p->keys[i])
+        {
+            return p->index[i];
+        }
+    }
+    if (!add)
+    {
+        return -1;
+    }
+    if ((p->count + 1) * 2 > p->cap)
+    {
+        MovePlaces grown = {0};
+        grown.cap = p->cap ? p->cap * 2 : 64;
+        grown.keys = xcalloc(grown.cap, sizeof(const char *));
+        grown.index = xcalloc(grown.cap, sizeof(uint32_t));
+        for (uint32_t i = 0; i < p->cap; i++)
+        {
+            if (p->keys[i])
+            {
+                uint32_t j = place_slot(&grown, p->keys[i]);
+                grown.keys[j] = p->keys[i];
+                grown.index[j] = p->index[i];
+            }
+        }
+        grown.count = p->count;
+        zfree(p->keys);
+        zfree(p->index);
+        *p = grown;
+    }
+    uint32_t i = place_slot(p, key);
+    p->keys[i] = key;
+    p->index[i] = p->count++;
+    return p->index[i];
+}
+
+static void state_reserve(MoveState *s, uint32_t words)
+{
+    if (words <= s->words)
+    {
+        return;
+    }
+    uint64_t *moved = xcalloc(words, sizeof(uint64_t));
+    if (s->words)
+    {
+        memcpy(moved, s->moved, s->words * sizeof(uint64_t));
+    }
+    zfree(s->moved);
+    s->moved = moved;
+    s->words = words;
+}
+
+// target |= src
+static void state_union(MoveState *target, MoveState *src)
+{
+    state_reserve(target, src->words);
+    for (uint32_t i = 0; i < src->words; i++)
+    {
+        target->moved[i] |= src->moved[i];
+    }
+}
+
+MoveState *move_state_create(void)
+{
+    MoveState *s = xcalloc(1, sizeof(MoveState));
+    s->places = xcalloc(1, sizeof(MovePlaces));
     return s;
 }
 
@@ -24,20 +115,14 @@ MoveState *move_state_clone(MoveState *src)
     {
         return NULL;
     }
-    MoveState *new_state = move_state_create(src->parent);
-
-    MoveEntry *curr = src->entries;
-    MoveEntry **tail = &new_state->entries;
-    while (curr)
+    MoveState *new_state = xmalloc(sizeof(MoveState));
+    new_state->places = src->places;
+    new_state->words = src->words;
+    new_state->moved = NULL;
+    if (src->words)
     {
-        MoveEntry *new_entry = xmalloc(sizeof(MoveEntry));
-        new_entry->symbol_name = xstrdup(curr->symbol_name);
-        new_entry->status = curr->status;
-        new_entry->moved_at = curr->moved_at;
-        new_entry->next = NULL;
-        *tail = new_entry;
-        tail = &new_entry->next;
-        curr = curr->next;
+        new_state->moved = xmalloc(src->words * sizeof(uint64_t));
+        memcpy(new_state->moved, src->moved, src->words * sizeof(uint64_t));
     }
     return new_state;
 }
@@ -48,14 +133,7 @@ void move_state_free(MoveState *state)
     {
         return;
     }
-    MoveEntry *e = state->entries;
-    while (e)
-    {
-        MoveEntry *next = e->next;
-        zfree(e->symbol_name);
-        zfree(e);
-        e = next;
-    }
+    zfree(state->moved);
     zfree(state);
 }
 
@@ -89,54 +167,29 @@ char *get_node_path(ASTNode *node, int depth, ParserContext *ctx)
     return path;
 }
 
-static void mark_moved_in_state(MoveState *state, const char *path, Token t)
+static void mark_moved_in_state(MoveState *state, const char *path)
 {
     if (!state || !path)
     {
         return;
     }
-
-    MoveEntry *e = state->entries;
-    while (e)
-    {
-        if (strcmp(e->symbol_name, path) == 0)
-        {
-            e->status = MOVE_STATE_MOVED;
-            e->moved_at = t;
-            return;
-        }
-        e = e->next;
-    }
-
-    MoveEntry *new_entry = xmalloc(sizeof(MoveEntry));
-    new_entry->symbol_name = xstrdup(path);
-    new_entry->status = MOVE_STATE_MOVED;
-    new_entry->moved_at = t;
-    new_entry->next = state->entries;
-    state->entries = new_entry;
+    uint32_t place = (uint32_t)place_of(state->places, path, 1);
+    state_reserve(state, place / 64 + 1);
+    state->moved[place / 64] |= (uint64_t)1 << (place % 64);
 }
 
 MoveStatus get_move_status(MoveState *state, const char *path)
 {
-    if (!path)
+    if (!state || !path)
     {
         return MOVE_STATE_VALID;
     }
-    MoveState *s = state;
-    while (s)
+    int64_t place = place_of(state->places, path, 0);
+    if (place < 0 || (uint64_t)place / 64 >= state->words)
     {
-        MoveEntry *e = s->entries;
-        while (e)
-        {
-            if (strcmp(e->symbol_name, path) == 0)
-            {
-                return e->status;
-            }
-            e = e->next;
-        }
-        s = s->parent;
+        return MOVE_STATE_VALID;
     }
-    return MOVE_STATE_VALID;
+    return (state->moved[place / 64] >> (place % 64)) & 1 ? MOVE_STATE_MOVED : MOVE_STATE_VALID;
 }
 
 void move_state_merge(MoveState *target, MoveState *a, MoveState *b)
@@ -145,37 +198,13 @@ void move_state_merge(MoveState *target, MoveState *a, MoveState *b)
     {
         return;
     }
-
     if (a)
     {
-        MoveEntry *e = a->entries;
-        while (e)
-        {
-            MoveStatus status_a = e->status;
-            MoveStatus status_b = b ? get_move_status(b, e->symbol_name) : MOVE_STATE_VALID;
-
-            if (status_a == MOVE_STATE_MOVED || status_b == MOVE_STATE_MOVED)
-            {
-                mark_moved_in_state(target, e->symbol_name, e->moved_at);
-            }
-            e = e->next;
-        }
+        state_union(target, a);
     }
-
     if (b)
     {
-        MoveEntry *e = b->entries;
-        while (e)
-        {
-            MoveStatus status_b = e->status;
-            MoveStatus status_a = a ? get_move_status(a, e->symbol_name) : MOVE_STATE_VALID;
-
-            if (status_b == MOVE_STATE_MOVED || status_a == MOVE_STATE_MOVED)
-            {
-                mark_moved_in_state(target, e->symbol_name, e->moved_at);
-            }
-            e = e->next;
-        }
+        state_union(target, b);
     }
 }
 
@@ -191,16 +220,20 @@ void move_state_merge_into(MoveState **target, MoveState *src)
         *target = move_state_clone(src);
         return;
     }
+    state_union(*target, src);
+}
 
-    MoveEntry *e = src->entries;
-    while (e)
+int move_state_covers(MoveState *a, MoveState *b)
+{
+    for (uint32_t i = 0; i < b->words; i++)
     {
-        if (e->status == MOVE_STATE_MOVED)
+        uint64_t in_a = i < a->words ? a->moved[i] : 0;
+        if (b->moved[i] & ~in_a)
         {
-            mark_moved_in_state(*target, e->symbol_name, e->moved_at);
+            return 0;
         }
-        e = e->next;
     }
+    return 1;
 }
 
 int is_type_copy(ParserContext *ctx, Type *t)
@@ -388,38 +421,24 @@ void mark_symbol_moved(ParserContext *ctx, ZenSymbol *sym, ASTNode *context_node
 
             if (path)
             {
-                mark_moved_in_state(ctx->move_state, path, context_node->token);
+                mark_moved_in_state(ctx->move_state, path);
                 zfree(path);
             }
         }
     }
 }
 
-static void mark_valid_in_state(MoveState *state, const char *path, Token t)
+static void mark_valid_in_state(MoveState *state, const char *path)
 {
     if (!state || !path)
     {
         return;
     }
-
-    MoveEntry *e = state->entries;
-    while (e)
+    int64_t place = place_of(state->places, path, 0);
+    if (place >= 0 && (uint64_t)place / 64 < state->words)
     {
-        if (strcmp(e->symbol_name, path) == 0)
-        {
-            e->status = MOVE_STATE_VALID;
-            e->moved_at = t;
-            return;
-        }
-        e = e->next;
+        state->moved[place / 64] &= ~((uint64_t)1 << (place % 64));
     }
-
-    MoveEntry *new_entry = xmalloc(sizeof(MoveEntry));
-    new_entry->symbol_name = xstrdup(path);
-    new_entry->status = MOVE_STATE_VALID;
-    new_entry->moved_at = t;
-    new_entry->next = state->entries;
-    state->entries = new_entry;
 }
 
 void mark_symbol_valid(ParserContext *ctx, ZenSymbol *sym, ASTNode *context_node)
@@ -439,9 +458,7 @@ void mark_symbol_valid(ParserContext *ctx, ZenSymbol *sym, ASTNode *context_node
 
         if (path)
         {
-            mark_valid_in_state(ctx->move_state, path,
-                                context_node ? context_node->token
-                                             : (sym ? sym->decl_token : TOKEN_UNKNOWN));
+            mark_valid_in_state(ctx->move_state, path);
             zfree(path);
         }
     }
@@ -9,6 +9,7 @@
 #include "ast/ast.h"
 #include "ast/symbols.h"
 #include "token.h"
+#include <stdint.h>
 
 typedef struct ParserContext ParserContext;
 typedef struct TypeChecker TypeChecker;
@@ -23,43 +24,41 @@ typedef enum
     MOVE_STATE_MAYBE_MOVED // Used when merging diverging paths (e.g., if/else)
 } MoveStatus;
 
-/**
- * @brief Linked list of tracked moved symbols in the current state.
- */
-typedef struct MoveEntry
-{
-    char *symbol_name;
-    MoveStatus status;
-    Token moved_at; // For error reporting
-    struct MoveEntry *next;
-} MoveEntry;
+typedef struct MovePlaces MovePlaces;
 
 /**
  * @brief Represents the state of moves at a specific point in control flow.
+ *
+ * Each path a function tracks ("v", "v.field") is numbered once, in the MovePlaces table shared
+ * by every state of that function; a state is the bitset of the places moved at that point.
  */
 typedef struct MoveState
 {
-    struct MoveEntry *entries; // List of tracked symbols
-    struct MoveState *parent;  // Parent state (for scoping/forking)
+    MovePlaces *places; // Path numbering of the function
+    uint64_t *moved;    // Bit n set: place n is moved
+    uint32_t words;     // Length of moved; places past it are valid
 } MoveState;
 
+enum
+{
+    MOVE_LOOP_MAX_PASSES = 8 // Most re-checks of a loop body while its entry state still grows
+};
+
 /**
- * @brief Creates a new move state, optionally inheriting from a parent.
+ * @brief Creates an empty move state with its own place numbering (one per function body).
  */
-MoveState *move_state_create(MoveState *parent);
+MoveState *move_state_create(void);
 
 /**
- * @brief Deep clones a move state (for branching).
+ * @brief Clones a move state (for branching); the clone shares its place numbering.
  */
 MoveState *move_state_clone(MoveState *src);
 
 /**
  * @brief Merges two branches into a target state.
  *
- * Logic:
- * - Valid + Valid -> Valid
- * - Moved + Moved -> Moved
- * - Moved + Valid -> Maybe Moved (Error on use)
+ * A place moved on either branch stays moved (maybe moved is an error on use as well), so
+ * this is target |= a | b. NULL branches are unreachable.
  */
 void move_state_merge(MoveState *target, MoveState *a, MoveState *b);
 
@@ -69,13 +68,18 @@ void move_state_merge(MoveState *target, MoveState *a, MoveState *b);
  */
 void move_state_merge_into(MoveState **target, MoveState *src);
 
+/**
+ * @brief Whether every place moved in @p b is moved in @p a as well.
+ */
+int move_state_covers(MoveState *a, MoveState *b);
+
 /**
  * @brief Frees a move state.
  */
 void move_state_free(MoveState *state);
 
 /**
- * @brief Check if a symbol or path is moved in the given state (or parents).
+ * @brief Check if a symbol or path is moved in the given state.
  */
 MoveStatus get_move_status(MoveState *state, const char *path);
 
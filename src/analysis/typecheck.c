@@ -4,8 +4,10 @@
 #include "../constants.h"
 
 #include "typecheck.h"
+#include "check_jobs.h"
 #include "comptime_interpreter.h"
 #include "diagnostics/diagnostics.h"
+#include "driver/build_cache.h"
 #include "move_check.h"
 #include "platform/misra.h"
 #include <ctype.h>
@@ -48,7 +50,11 @@ void check_node(TypeChecker *tc, ASTNode *node, int depth)
         check_var_decl(tc, node, depth + 1);
         break;
     case NODE_FUNCTION:
-        check_function(tc, node, depth + 1);
+        if (check_jobs_enter(tc, node))
+        {
+            check_function(tc, node, depth + 1);
+            check_jobs_leave(tc, node);
+        }
         break;
     case NODE_TRAIT:
         tc_check_trait(tc, node, depth + 1);
@@ -604,7 +610,7 @@ void check_node(TypeChecker *tc, ASTNode *node, int depth)
     case NODE_TEST:
     {
         MoveState *prev_move_state = tc->pctx->move_state;
-        tc->pctx->move_state = move_state_create(NULL);
+        tc->pctx->move_state = move_state_create();
 
         check_node(tc, node->test_stmt.body, depth + 1);
 
@@ -913,9 +919,34 @@ void check_node(TypeChecker *tc, ASTNode *node, int depth)
             stmt = stmt->next;
         }
 
-        // Interpret the comptime body
-        char *output =
-            interpret_comptime(tc->pctx, node->comptime.body, tc->pctx->current_filename);
+        // Interpret the comptime body, unless an earlier compile already did
+        char *output = NULL;
+        uint64_t key = 0;
+        if (tc->pctx->config->comptime_cache)
+        {
+            key = comptime_key(tc->pctx, node->comptime.body, tc->pctx->current_filename);
+            output = key ? build_cache_comptime_lookup(tc->pctx, key) : NULL;
+            if (output)
+            {
+                tc->comptime_hits++;
+            }
+            else
+            {
+                tc->comptime_misses++;
+            }
+        }
+        if (!output)
+        {
+            int errors = g_error_count;
+            int warnings = g_warning_count;
+            output =
+                interpret_comptime(tc->pctx, node->comptime.body, tc->pctx->current_filename);
+            // Diagnostics are not replayed from the cache, so such a run is not stored.
+            if (output && key && g_error_count == errors && g_warning_count == warnings)
+            {
+                build_cache_comptime_store(tc->pctx, key, output);
+            }
+        }
         if (!output)
         {
             break;
@@ -1088,6 +1119,17 @@ static void check_program_prepass(TypeChecker *tc, ASTNode *root, int depth)
 
 // ** Entry Point **
 
+static void report_comptime_cache(TypeChecker *tc)
+{
+    if (tc->pctx->config->verbose && (tc->comptime_hits || tc->comptime_misses))
+    {
+        printf(COLOR_BOLD COLOR_CYAN "       Cache" COLOR_RESET " comptime %d hit%s, %d miss%s\n",
+               tc->comptime_hits, tc->comptime_hits == 1 ? "" : "s", tc->comptime_misses,
+               tc->comptime_misses == 1 ? "" : "es");
+        fflush(stdout);
+    }
+}
+
 int check_program(ParserContext *ctx, ASTNode *root)
 {
     TypeChecker tc = {0};
@@ -1096,10 +1138,11 @@ int check_program(ParserContext *ctx, ASTNode *root)
 
     if (!ctx->move_state)
     {
-        ctx->move_state = move_state_create(NULL);
+        ctx->move_state = move_state_create();
     }
 
     check_program_prepass(&tc, root, 0);
+    check_jobs_start(&tc, root, ctx->config->check_jobs);
 
     check_node(&tc, root, 0);
     root->is_checked = 1;
@@ -1123,6 +1166,8 @@ int check_program(ParserContext *ctx, ASTNode *root)
             inst_func = inst_func->next;
         }
     }
+    check_jobs_finish(&tc);
+    report_comptime_cache(&tc);
 
     if (ctx->move_state)
     {
@@ -1158,10 +1203,11 @@ int check_moves_only(ParserContext *ctx, ASTNode *root)
 
     if (!ctx->move_state)
     {
-        ctx->move_state = move_state_create(NULL);
+        ctx->move_state = move_state_create();
     }
 
     check_node(&tc, root, 0);
+    report_comptime_cache(&tc);
 
     if (ctx->move_state)
     {
@@ -10,6 +10,7 @@
 #include "parser.h"
 
 struct MoveState; // Forward declaration
+struct CheckJobs;
 
 // Type Checker Context
 // Holds the state during the semantic analysis pass.
@@ -44,6 +45,10 @@ typedef struct TypeChecker
     int loop_break_count;  ///< Count of breaks for Rule 15.4
     int func_return_count; ///< Count of returns for Rule 15.5
     int current_depth;     ///< Current nesting level for escape analysis (0=global).
+
+    struct CheckJobs *jobs; ///< Worker processes sharing the function bodies (--check-jobs).
+    int comptime_hits;      ///< Comptime blocks whose output came from the comptime cache.
+    int comptime_misses;    ///< Comptime blocks run because the cache had no output for them.
 } TypeChecker;
 
 /**
@@ -205,6 +205,20 @@ void check_expr_unary(TypeChecker *tc, ASTNode *node, int depth)
     }
 }
 
+// A string literal, or string literals joined with +. Such a sum is typed as a string and
+// left for fold_program() to join: C would take it as pointer arithmetic. That join also
+// runs under --no-fold, so codegen never sees the sum.
+static int is_string_literal_sum(ASTNode *node)
+{
+    if (node && node->type == NODE_EXPR_BINARY && strcmp(node->binary.op, "+") == 0)
+    {
+        return is_string_literal_sum(node->binary.left) &&
+               is_string_literal_sum(node->binary.right);
+    }
+    return node && node->type == NODE_EXPR_LITERAL && node->literal.type_kind == LITERAL_STRING &&
+           node->literal.string_val;
+}
+
 void check_expr_binary(TypeChecker *tc, ASTNode *node, int depth)
 {
     const char *op = node->binary.op;
@@ -459,6 +473,14 @@ void check_expr_binary(TypeChecker *tc, ASTNode *node, int depth)
             Type *lhs_resolved = resolve_alias(left_type);
             Type *rhs_resolved = resolve_alias(right_type);
 
+            // "a" + "b": joined into one literal by fold_program()
+            if (strcmp(op, "+") == 0 && is_string_literal_sum(node->binary.left) &&
+                is_string_literal_sum(node->binary.right))
+            {
+                node->type_info = type_new(TYPE_STRING);
+                return;
+            }
+
             // Pointer Arithmetic
             if (lhs_resolved->kind == TYPE_POINTER || lhs_resolved->kind == TYPE_STRING)
             {
@@ -1333,7 +1355,7 @@ void check_expr_lambda(TypeChecker *tc, ASTNode *node, int depth)
     }
 
     MoveState *prev_move_state = tc->pctx->move_state;
-    tc->pctx->move_state = move_state_create(NULL);
+    tc->pctx->move_state = move_state_create();
 
     int prev_unreachable = tc->is_unreachable;
     tc->is_unreachable = 0;
@@ -299,7 +299,7 @@ void check_function(TypeChecker *tc, ASTNode *node, int depth)
     tc->func_return_count = 0;
 
     MoveState *prev_move_state = tc->pctx->move_state;
-    tc->pctx->move_state = move_state_create(NULL);
+    tc->pctx->move_state = move_state_create();
 
     for (int i = 0; i < node->func.arg_count; i++)
     {
@@ -659,8 +659,9 @@ void check_loop_passes(TypeChecker *tc, ASTNode *node, int depth)
         move_state_merge_into(&next_iter_state, tc->loop_continue_state);
     }
 
-    // Pass 2: Re-run with next_iter_state to catch use-after-move across iterations
-    if (next_iter_state)
+    // Pass 2: Re-run with next_iter_state to catch use-after-move across iterations, until the
+    // state at the top of the loop stops growing.
+    for (int pass = 0; next_iter_state && pass < MOVE_LOOP_MAX_PASSES; pass++)
     {
         int prev_move_checks_only = tc->move_checks_only;
         tc->move_checks_only = 1; // suppress type errors
@@ -669,6 +670,9 @@ void check_loop_passes(TypeChecker *tc, ASTNode *node, int depth)
         tc->pctx->move_state = move_state_clone(next_iter_state);
         tc->is_unreachable = 0;
 
+        // Only the breaks of the last pass reach the exit.
+        move_state_free(tc->loop_break_state);
+        move_state_free(tc->loop_continue_state);
         tc->loop_break_state = NULL;
         tc->loop_continue_state = NULL;
 
@@ -702,20 +706,30 @@ void check_loop_passes(TypeChecker *tc, ASTNode *node, int depth)
             break;
         }
 
-        if (tc->pctx->move_state)
+        MoveState *again = NULL;
+        if (!tc->is_unreachable && tc->pctx->move_state)
         {
-            move_state_free(tc->pctx->move_state);
+            move_state_merge_into(&again, tc->pctx->move_state);
         }
-        if (tc->loop_break_state)
+        if (tc->loop_continue_state)
         {
-            move_state_free(tc->loop_break_state);
+            move_state_merge_into(&again, tc->loop_continue_state);
         }
-        if (tc->loop_continue_state)
+        int stable = !again || move_state_covers(next_iter_state, again);
+        if (!stable)
         {
-            move_state_free(tc->loop_continue_state);
+            move_state_merge_into(&next_iter_state, again);
         }
 
+        move_state_free(again);
+        move_state_free(tc->pctx->move_state);
+        tc->pctx->move_state = NULL;
+
         tc->move_checks_only = prev_move_checks_only;
+        if (stable)
+        {
+            break;
+        }
     }
 
     // Compute final move state exiting the loop
@@ -735,15 +749,8 @@ void check_loop_passes(TypeChecker *tc, ASTNode *node, int depth)
         move_state_merge_into(&final_state, tc->loop_break_state);
     }
 
-    // Cleanup Pass 1 states
-    if (tc->loop_break_state)
-    {
-        move_state_free(tc->loop_break_state);
-    }
-    if (tc->loop_continue_state)
-    {
-        move_state_free(tc->loop_continue_state);
-    }
+    move_state_free(tc->loop_break_state);
+    move_state_free(tc->loop_continue_state);
 
     tc->loop_break_count = outer_break_count;
     if (next_iter_state)
@@ -775,7 +782,7 @@ void check_loop_passes(TypeChecker *tc, ASTNode *node, int depth)
         tc->is_unreachable = initial_unreachable;
     }
 
-    if (tc->pctx->move_state)
+    if (tc->pctx->move_state && tc->pctx->move_state != initial_state)
     {
         move_state_free(tc->pctx->move_state);
     }
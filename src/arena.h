@@ -14,12 +14,28 @@
 // Need to pull in the zarena type definition
 #include "utils/zalloc.h"
 
+#include "utils/mem_stats.h"
+
 // Allocation functions declared in zprep.h:
 void *xmalloc(size_t size) __attribute__((returns_nonnull));
 void *xrealloc(void *ptr, size_t new_size) __attribute__((returns_nonnull));
 void *xcalloc(size_t n, size_t size) __attribute__((returns_nonnull));
 char *xstrdup(const char *s) __attribute__((returns_nonnull));
 
+/// Call-site variants behind the macros below; `file` may be NULL. The site is
+/// only recorded while --mem-report is collecting allocation sites.
+void *xmalloc_at(size_t size, const char *file, int line) __attribute__((returns_nonnull));
+void *xrealloc_at(void *ptr, size_t new_size, const char *file, int line)
+    __attribute__((returns_nonnull));
+void *xcalloc_at(size_t n, size_t size, const char *file, int line)
+    __attribute__((returns_nonnull));
+char *xstrdup_at(const char *s, const char *file, int line) __attribute__((returns_nonnull));
+
+#define xmalloc(sz) xmalloc_at(sz, __FILE__, __LINE__)
+#define xrealloc(p, s) xrealloc_at(p, s, __FILE__, __LINE__)
+#define xcalloc(n, s) xcalloc_at(n, s, __FILE__, __LINE__)
+#define xstrdup(s) xstrdup_at(s, __FILE__, __LINE__)
+
 /// Arena allocator: allocations via malloc/realloc/calloc go to the arena
 /// and are reclaimed all at once (never individually freed). Use zfree()
 /// to document no-op frees on arena memory. Use libc_free/libc_malloc etc.
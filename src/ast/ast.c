@@ -5,6 +5,8 @@
 #include "../arena.h"
 #include "../utils/colors.h"
 #include "../utils/utils.h"
+#include "../utils/pass_timer.h"
+#include "../utils/mem_report.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -84,9 +86,12 @@ int is_trait_ptr(const char *name)
 
 ASTNode *ast_create(NodeType type)
 {
+    ZcMemCategory prev = mem_enter(ZC_MEM_AST);
     ASTNode *node = xmalloc(sizeof(ASTNode));
+    mem_leave(prev);
     memset(node, 0, sizeof(ASTNode));
     node->type = type;
+    g_ast_node_count++;
     return node;
 }
 
@@ -104,7 +109,9 @@ void ast_free(ASTNode *node)
 
 Type *type_new(TypeKind kind)
 {
+    ZcMemCategory prev = mem_enter(ZC_MEM_TYPES);
     Type *t = xmalloc(sizeof(Type));
+    mem_leave(prev);
     memset(t, 0, sizeof(Type));
     t->kind = kind;
     if (kind == TYPE_FUNCTION)
@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: MIT
 #include "../arena.h"
+#include "../utils/intern.h"
+#include "../utils/mem_report.h"
 #include "symbols.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,6 +9,7 @@
 
 Scope *symbol_scope_create(Scope *parent, const char *name)
 {
+    ZcMemCategory prev = mem_enter(ZC_MEM_SYMBOLS);
     Scope *s = xmalloc(sizeof(Scope));
     memset(s, 0, sizeof(Scope));
     s->parent = parent;
@@ -14,6 +17,7 @@ Scope *symbol_scope_create(Scope *parent, const char *name)
     {
         s->name = xstrdup(name);
     }
+    mem_leave(prev);
     return s;
 }
 
@@ -28,10 +32,6 @@ void symbol_scope_free(Scope *s)
     while (sym)
     {
         ZenSymbol *next = sym->next;
-        if (sym->name)
-        {
-            zfree(sym->name);
-        }
         if (sym->cfg_condition)
         {
             zfree(sym->cfg_condition);
@@ -74,6 +74,74 @@ void symbol_scope_free(Scope *s)
     zfree(s);
 }
 
+// Slot of @p key, which is interned, in the index of @p s: its newest symbol or an empty slot.
+static ZenSymbol **table_slot(Scope *s, const char *key)
+{
+    uint32_t mask = (uint32_t)s->table_cap - 1;
+    uint32_t i = intern_hash(key) & mask;
+    while (s->table[i] && s->table[i]->name != key)
+    {
+        i = (i + 1) & mask;
+    }
+    return &s->table[i];
+}
+
+// Index every symbol of @p s in a table of @p cap slots. The list is newest first, so a name
+// seen again is older than the one already indexed and joins the end of its chain.
+static void table_fill(Scope *s, int cap)
+{
+    s->table = xcalloc((size_t)cap, sizeof(ZenSymbol *));
+    s->table_cap = cap;
+    s->table_used = 0;
+    for (ZenSymbol *sym = s->symbols; sym; sym = sym->next)
+    {
+        ZenSymbol **slot = table_slot(s, sym->name);
+        sym->same_name = NULL;
+        if (!*slot)
+        {
+            *slot = sym;
+            s->table_used++;
+            continue;
+        }
+        ZenSymbol *last = *slot;
+        while (last->same_name)
+        {
+            last = last->same_name;
+        }
+        last->same_name = sym;
+    }
+}
+
+static void table_build(Scope *s)
+{
+    int cap = SCOPE_HASH_MIN * 4;
+    while (cap < s->count * 2)
+    {
+        cap *= 2;
+    }
+    table_fill(s, cap);
+}
+
+// Index @p sym, the newest symbol of @p s; it shadows any older one of the same name.
+static void table_insert(Scope *s, ZenSymbol *sym)
+{
+    ZenSymbol **slot = table_slot(s, sym->name);
+    if (*slot)
+    {
+        sym->same_name = *slot;
+        *slot = sym;
+        return;
+    }
+    if ((s->table_used + 1) * 2 > s->table_cap)
+    {
+        // The arena does not free; the old table is simply dropped.
+        table_fill(s, s->table_cap * 2);
+        return;
+    }
+    *slot = sym;
+    s->table_used++;
+}
+
 ZenSymbol *symbol_add(Scope *s, const char *name, SymbolKind kind)
 {
     if (!s || !name)
@@ -81,39 +149,85 @@ ZenSymbol *symbol_add(Scope *s, const char *name, SymbolKind kind)
         return NULL;
     }
 
+    ZcMemCategory prev = mem_enter(ZC_MEM_SYMBOLS);
     ZenSymbol *sym = xmalloc(sizeof(ZenSymbol));
     memset(sym, 0, sizeof(ZenSymbol));
-    sym->name = xstrdup(name);
+    sym->name = (char *)intern(name);
     sym->kind = kind;
 
     sym->next = s->symbols;
     s->symbols = sym;
+    s->count++;
+    if (s->table)
+    {
+        table_insert(s, sym);
+    }
+    else if (s->count >= SCOPE_HASH_MIN)
+    {
+        table_build(s);
+    }
+    mem_leave(prev);
 
     return sym;
 }
 
-ZenSymbol *symbol_lookup_local(Scope *s, const char *name)
+// Newest symbol named @p key, which is interned, in @p s itself.
+static ZenSymbol *scope_find(Scope *s, const char *key)
 {
-    if (!s || !name)
+    if (s->table)
     {
-        return NULL;
+        return *table_slot(s, key);
     }
-
-    ZenSymbol *curr = s->symbols;
-    while (curr)
+    for (ZenSymbol *curr = s->symbols; curr; curr = curr->next)
     {
-        if (curr->name && strcmp(curr->name, name) == 0)
+        if (curr->name == key)
         {
             return curr;
         }
-        curr = curr->next;
     }
     return NULL;
 }
 
+// Newest symbol named @p key of @p kind in @p s itself. Hashed scopes only visit symbols of
+// that name, however many symbols of other kinds the scope holds.
+static ZenSymbol *scope_find_kind(Scope *s, const char *key, SymbolKind kind)
+{
+    if (s->table)
+    {
+        for (ZenSymbol *sym = *table_slot(s, key); sym; sym = sym->same_name)
+        {
+            if (sym->kind == kind)
+            {
+                return sym;
+            }
+        }
+        return NULL;
+    }
+    for (ZenSymbol *sym = s->symbols; sym; sym = sym->next)
+    {
+        if (sym->kind == kind && sym->name == key)
+        {
+            return sym;
+        }
+    }
+    return NULL;
+}
+
+ZenSymbol *symbol_lookup_local(Scope *s, const char *name)
+{
+    if (!s || !name)
+    {
+        return NULL;
+    }
+
+    const char *key = intern_find(name);
+    return key ? scope_find(s, key) : NULL;
+}
+
 ZenSymbol *symbol_lookup(Scope *s, const char *name)
 {
-    if (!name)
+    const char *key = intern_find(name);
+    if (!key)
     {
         return NULL;
     }
@@ -121,7 +235,7 @@ ZenSymbol *symbol_lookup(Scope *s, const char *name)
     Scope *curr_scope = s;
     while (curr_scope)
     {
-        ZenSymbol *sym = symbol_lookup_local(curr_scope, name);
+        ZenSymbol *sym = scope_find(curr_scope, key);
         if (sym)
         {
             return sym;
@@ -133,7 +247,8 @@ ZenSymbol *symbol_lookup(Scope *s, const char *name)
 
 ZenSymbol *symbol_lookup_kind(Scope *s, const char *name, SymbolKind kind)
 {
-    if (!name)
+    const char *key = intern_find(name);
+    if (!key)
     {
         return NULL;
     }
@@ -141,14 +256,10 @@ ZenSymbol *symbol_lookup_kind(Scope *s, const char *name, SymbolKind kind)
     Scope *curr_scope = s;
     while (curr_scope)
     {
-        ZenSymbol *sym = curr_scope->symbols;
-        while (sym)
+        ZenSymbol *sym = scope_find_kind(curr_scope, key, kind);
+        if (sym)
         {
-            if (sym->kind == kind && sym->name && strcmp(sym->name, name) == 0)
-            {
-                return sym;
-            }
-            sym = sym->next;
+            return sym;
         }
         curr_scope = curr_scope->parent;
     }
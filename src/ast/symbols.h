@@ -39,7 +39,7 @@ typedef enum
  */
 typedef struct ZenSymbol
 {
-    char *name; ///< Symbol name.
+    char *name; ///< Symbol name, interned (see intern.h): compare by pointer, never modify.
 
     // --- MISRA tracking ---
     struct ZenSymbol *original; ///< Pointer to the original symbol (for clones).
@@ -88,7 +88,8 @@ typedef struct ZenSymbol
         } module;
     } data;
 
-    struct ZenSymbol *next; ///< Next symbol in the same scope.
+    struct ZenSymbol *next;      ///< Next symbol in the same scope.
+    struct ZenSymbol *same_name; ///< Older symbol of this name in a hashed scope, or NULL.
 } ZenSymbol;
 
 /**
@@ -96,12 +97,22 @@ typedef struct ZenSymbol
  */
 typedef struct Scope
 {
-    ZenSymbol *symbols;   ///< Linked list of symbols in this scope.
+    ZenSymbol *symbols;   ///< Linked list of symbols in this scope, newest first.
     struct Scope *parent; ///< Pointer to the parent scope (NULL for global).
     char *name;           ///< Optional name for the scope (e.g. "Module::Func").
     int is_loop;          ///< 1 if this is a loop scope (for break/continue).
+    int count;            ///< Symbols in the list.
+
+    /// Open-addressed index by name, built once the scope holds SCOPE_HASH_MIN symbols (NULL
+    /// before). Each slot is the newest symbol of a name; older ones hang off same_name.
+    ZenSymbol **table;
+    int table_cap; ///< Power of two.
+    int table_used;
 } Scope;
 
+/** @brief Scopes with fewer symbols are searched linearly. */
+#define SCOPE_HASH_MIN 16
+
 // ** Symbol Table Utilities **
 
 /**
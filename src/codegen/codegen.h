@@ -36,6 +36,27 @@ void codegen_node(ParserContext *ctx, ASTNode *node);
  */
 void codegen_c_program(ParserContext *ctx, ASTNode *node);
 
+/**
+ * @brief Role of the translation unit emitted by codegen_c_program() (ctx->cg.split_role).
+ *
+ * A split build emits one header with every type, prototype and extern declaration, one
+ * primary unit that owns all data definitions (globals, vtables, lambdas, tests), and further
+ * units holding nothing but function bodies. Bodies are assigned to units by source module.
+ */
+typedef enum
+{
+    CODEGEN_UNIT_SINGLE = 0, ///< Whole program in one file (default).
+    CODEGEN_UNIT_PRIMARY,    ///< Full preamble and definitions plus the bodies of unit 0.
+    CODEGEN_UNIT_HEADER,     ///< Declarations only, included by every CODEGEN_UNIT_BODIES unit.
+    CODEGEN_UNIT_BODIES      ///< `#include` of the header plus the bodies of ctx->cg.split_unit.
+} CodegenUnitRole;
+
+/**
+ * @brief Tell whether the program can be emitted as several translation units.
+ * @return NULL when splitting is safe, otherwise a short human-readable reason.
+ */
+const char *codegen_split_blocker(ParserContext *ctx, ASTNode *root);
+
 /**
  * @brief Generates code for a single AST node (non-recursive for siblings).
  */
@@ -84,6 +105,13 @@ void handle_node_await_internal(ParserContext *ctx, ASTNode *node);
 typedef struct VisitedModules VisitedModules;
 
 void emit_preamble(ParserContext *ctx);
+
+/**
+ * @brief Emits the body of the shared C runtime header: the hosted preamble behind an include
+ * guard. When ctx->cg.runtime_header names such a file, emit_preamble() includes it instead.
+ */
+void emit_runtime_header(ParserContext *ctx);
+
 void emit_includes_and_aliases(ParserContext *ctx, ASTNode *node, VisitedModules **visited);
 void emit_type_aliases(ParserContext *ctx, ASTNode *node, VisitedModules **visited);
 void emit_global_aliases(ParserContext *ctx);
@@ -96,6 +124,54 @@ void emit_lambda_defs(ParserContext *ctx);
 void emit_protos(ParserContext *ctx, ASTNode *node, VisitedModules **visited);
 void emit_impl_vtables(ParserContext *ctx);
 
+// Lazy emission of generic impl methods and function instantiations (codegen_lazy.c).
+/**
+ * @brief Where lazy_methods_end() splices the methods that turned out to be referenced.
+ */
+typedef enum
+{
+    LAZY_AT_PROTOS = 0, ///< After the last function prototype.
+    LAZY_AT_BODIES,     ///< After the last function body.
+    LAZY_AT_COUNT
+} LazySlot;
+
+/**
+ * @brief Start capturing a single-unit program so that methods of impl blocks on generic
+ * instantiations (Vec__int32_t, ...) and instantiations of generic functions are emitted only
+ * when something else names them.
+ * @return 1 if capturing, 0 when lazy methods are off (config, split builds, REPL).
+ */
+int lazy_methods_begin(ParserContext *ctx);
+
+/**
+ * @brief Whether @p node, an impl block or a function, is deferred rather than emitted in place.
+ */
+int lazy_methods_wanted(ParserContext *ctx, ASTNode *node);
+
+/**
+ * @brief Redirect output to a side buffer for the prototype of one deferred method; finished
+ * by lazy_methods_defer_proto(), which files it under the method's C name @p name.
+ */
+void lazy_methods_capture(ParserContext *ctx);
+void lazy_methods_defer_proto(ParserContext *ctx, ASTNode *method, const char *name);
+
+/**
+ * @brief Render the bodies of @p node into side buffers if it is deferred.
+ * @return 1 if deferred, 0 if the caller emits @p node itself.
+ */
+int lazy_methods_defer_bodies(ParserContext *ctx, ASTNode *node);
+
+/**
+ * @brief Remember the current output position as @p slot.
+ */
+void lazy_methods_mark(ParserContext *ctx, LazySlot slot);
+
+/**
+ * @brief Stop capturing and write the program with the prototypes and bodies of every
+ * deferred method reachable from the rest of it.
+ */
+void lazy_methods_end(ParserContext *ctx);
+
 /**
  * @brief Emits test runner and test cases if testing is enabled.
  */
@@ -49,7 +49,8 @@ void emit_source_mapping(ParserContext *ctx, ASTNode *node)
         }
     }
 
-    if (!node->token.start || !node->token.file)
+    const char *file = token_file(node->token);
+    if (!node->token.start || !file)
     {
         zwarn_at(node->token,
                  "Encountered source mapping issue for node type %i, please report this issue.",
@@ -62,7 +63,7 @@ void emit_source_mapping(ParserContext *ctx, ASTNode *node)
 
     if (!ctx->config->misra_mode)
     {
-        char *safe_file = sanitize_path_for_c_string(node->token.file);
+        char *safe_file = sanitize_path_for_c_string(file);
         EMIT(ctx, "\n#line %i \"%s\"\n", node->token.line, safe_file);
     }
 }
\ No newline at end of file
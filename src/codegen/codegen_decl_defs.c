@@ -342,35 +342,47 @@ void emit_lambda_defs(ParserContext *ctx)
             emitter_dedent(&ctx->cg.emitter);
             EMIT(ctx, "};\n\n");
 
-            // Generate Drop function for the closure context
-            EMIT(ctx, "static void _lambda_%d_drop(void* _ctx) {\n", node->lambda.lambda_id);
-            emitter_indent(&ctx->cg.emitter);
-            EMIT(ctx, "struct Lambda_%d_Ctx* ctx = (struct Lambda_%d_Ctx*)_ctx;\n",
-                 node->lambda.lambda_id, node->lambda.lambda_id);
-
-            for (int i = 0; i < node->lambda.num_captures; i++)
+            // Generate Drop function for the closure context. Split builds call it from
+            // other units, so it only stays static in a single-unit build.
+            EMIT(ctx, "%svoid _lambda_%d_drop(void* _ctx)",
+                 ctx->cg.split_role == CODEGEN_UNIT_SINGLE ? "static " : "",
+                 node->lambda.lambda_id);
+            if (ctx->cg.split_role == CODEGEN_UNIT_HEADER)
+            {
+                EMIT(ctx, ";\n\n");
+            }
+            else
             {
-                if (node->lambda.capture_modes && node->lambda.capture_modes[i] == 0)
+                EMIT(ctx, " {\n");
+                emitter_indent(&ctx->cg.emitter);
+                EMIT(ctx, "struct Lambda_%d_Ctx* ctx = (struct Lambda_%d_Ctx*)_ctx;\n",
+                     node->lambda.lambda_id, node->lambda.lambda_id);
+
+                for (int i = 0; i < node->lambda.num_captures; i++)
                 {
-                    char *tname = node->lambda.captured_types[i];
-                    const char *clean = tname;
-                    if (strncmp(clean, "struct ", 7) == 0)
+                    if (node->lambda.capture_modes && node->lambda.capture_modes[i] == 0)
                     {
-                        clean += 7;
-                    }
+                        char *tname = node->lambda.captured_types[i];
+                        const char *clean = tname;
+                        if (strncmp(clean, "struct ", 7) == 0)
+                        {
+                            clean += 7;
+                        }
 
-                    ASTNode *fdef = find_struct_def(ctx, clean);
-                    if (fdef && fdef->type_info && fdef->type_info->traits.has_drop)
-                    {
-                        EMIT(ctx, "if (ctx->__z_drop_flag_%s) %s__Drop__glue(&ctx->%s);\n",
-                             node->lambda.captured_vars[i], clean, node->lambda.captured_vars[i]);
+                        ASTNode *fdef = find_struct_def(ctx, clean);
+                        if (fdef && fdef->type_info && fdef->type_info->traits.has_drop)
+                        {
+                            EMIT(ctx, "if (ctx->__z_drop_flag_%s) %s__Drop__glue(&ctx->%s);\n",
+                                 node->lambda.captured_vars[i], clean,
+                                 node->lambda.captured_vars[i]);
+                        }
                     }
                 }
-            }
 
-            EMIT(ctx, "free(_ctx);\n");
-            emitter_dedent(&ctx->cg.emitter);
-            EMIT(ctx, "}\n\n");
+                EMIT(ctx, "free(_ctx);\n");
+                emitter_dedent(&ctx->cg.emitter);
+                EMIT(ctx, "}\n\n");
+            }
         }
 
         char *ret_type_str = node->lambda.return_type;
@@ -428,6 +440,13 @@ void emit_lambda_defs(ParserContext *ctx)
                 zfree(param_type_str);
             }
         }
+        if (ctx->cg.split_role == CODEGEN_UNIT_HEADER)
+        {
+            EMIT(ctx, ");\n\n");
+            ctx->cg.defer_count = saved_defer;
+            cur = cur->next;
+            continue;
+        }
         EMIT(ctx, ") {\n");
         emitter_indent(&ctx->cg.emitter);
 
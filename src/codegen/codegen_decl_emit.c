@@ -33,7 +33,18 @@ static void emit_globals_internal(ParserContext *ctx, ASTNode *node, VisitedModu
         }
         if (node->type == NODE_VAR_DECL || node->type == NODE_CONST)
         {
-            EMIT(ctx, "ZC_GLOBAL ");
+            // The header of a split build declares variables defined by the primary unit.
+            // Constants keep their initializer as a static copy so they stay usable in every unit.
+            int decl_only = ctx->cg.split_role == CODEGEN_UNIT_HEADER;
+            int is_extern = decl_only && node->type == NODE_VAR_DECL;
+            if (!decl_only)
+            {
+                EMIT(ctx, "ZC_GLOBAL ");
+            }
+            else
+            {
+                EMIT(ctx, is_extern ? "extern " : "static ");
+            }
             if (node->cfg_condition)
             {
                 EMIT(ctx, "#if %s\n", node->cfg_condition);
@@ -58,6 +69,12 @@ static void emit_globals_internal(ParserContext *ctx, ASTNode *node, VisitedModu
                 {
                     emit_var_decl_type(ctx, inferred, node->var_decl.name);
                 }
+                else if (is_extern && node->var_decl.init_expr)
+                {
+                    EMIT(ctx, "__typeof__(");
+                    codegen_expression(ctx, node->var_decl.init_expr);
+                    EMIT(ctx, ") %s", node->var_decl.name);
+                }
                 else
                 {
                     emit_auto_type(ctx, node->var_decl.init_expr, node->token);
@@ -68,7 +85,7 @@ static void emit_globals_internal(ParserContext *ctx, ASTNode *node, VisitedModu
                     zfree(inferred);
                 }
             }
-            if (node->var_decl.init_expr)
+            if (node->var_decl.init_expr && !is_extern)
             {
                 EMIT(ctx, " = ");
                 char *tname =
@@ -202,6 +219,11 @@ static void emit_protos_internal(ParserContext *ctx, ASTNode *node, VisitedModul
                 }
             }
 
+            int lazy = lazy_methods_wanted(ctx, f);
+            if (lazy)
+            {
+                lazy_methods_capture(ctx);
+            }
             if (f->cfg_condition)
             {
                 EMIT(ctx, "#if %s\n", f->cfg_condition);
@@ -301,6 +323,10 @@ static void emit_protos_internal(ParserContext *ctx, ASTNode *node, VisitedModul
             {
                 EMIT(ctx, "#endif\n");
             }
+            if (lazy)
+            {
+                lazy_methods_defer_proto(ctx, f, f->link_name ? f->link_name : f->func.name);
+            }
         }
         else if (f->type == NODE_IMPL)
         {
@@ -360,7 +386,9 @@ static void emit_protos_internal(ParserContext *ctx, ASTNode *node, VisitedModul
                 continue;
             }
 
-            if (f->cfg_condition)
+            // Deferred methods carry the impl's @cfg guard in their own prototype.
+            int lazy = lazy_methods_wanted(ctx, f);
+            if (f->cfg_condition && !lazy)
             {
                 EMIT(ctx, "#if %s\n", f->cfg_condition);
             }
@@ -372,6 +400,14 @@ static void emit_protos_internal(ParserContext *ctx, ASTNode *node, VisitedModul
                     m = m->next;
                     continue;
                 }
+                if (lazy)
+                {
+                    lazy_methods_capture(ctx);
+                    if (f->cfg_condition)
+                    {
+                        EMIT(ctx, "#if %s\n", f->cfg_condition);
+                    }
+                }
                 if (m->cfg_condition)
                 {
                     EMIT(ctx, "#if %s\n", m->cfg_condition);
@@ -401,11 +437,19 @@ static void emit_protos_internal(ParserContext *ctx, ASTNode *node, VisitedModul
                 {
                     EMIT(ctx, "#endif\n");
                 }
+                if (lazy)
+                {
+                    if (f->cfg_condition)
+                    {
+                        EMIT(ctx, "#endif\n");
+                    }
+                    lazy_methods_defer_proto(ctx, m, m->link_name ? m->link_name : proto);
+                }
 
                 zfree(proto);
                 m = m->next;
             }
-            if (f->cfg_condition)
+            if (f->cfg_condition && !lazy)
             {
                 EMIT(ctx, "#endif\n");
             }
@@ -621,6 +665,13 @@ void emit_impl_vtables(ParserContext *ctx)
                 continue;
             }
 
+            if (ctx->cg.split_role == CODEGEN_UNIT_HEADER)
+            {
+                EMIT(ctx, "extern %s_VTable %s__%s__VTable;\n", trait, strct, trait);
+                ref = ref->next;
+                continue;
+            }
+
             EMIT(ctx, "%s_VTable %s__%s__VTable = {", trait, strct, trait);
 
             ASTNode *m = node->impl_trait.methods;
@@ -270,7 +270,9 @@ static void emit_struct_defs_internal(ParserContext *ctx, ASTNode *node, Visited
                 }
                 EMIT(ctx, "} data; };\n\n");
 
-                v = node->enm.variants;
+                // Constructors are defined once by the primary unit; the header relies on the
+                // prototypes from emit_enum_protos().
+                v = ctx->cg.split_role == CODEGEN_UNIT_HEADER ? NULL : node->enm.variants;
                 while (v)
                 {
                     if (v->variant.payload)
@@ -563,6 +565,13 @@ static void emit_trait_wrappers_internal(ParserContext *ctx, ASTNode *node,
                     }
                     zfree(sa);
                 }
+                if (ctx->cg.split_role == CODEGEN_UNIT_HEADER)
+                {
+                    EMIT(ctx, ");\n");
+                    zfree(ret_sub);
+                    m = m->next;
+                    continue;
+                }
                 EMIT(ctx, ") {\n");
                 emitter_indent(&ctx->cg.emitter);
 
@@ -0,0 +1,785 @@
+// SPDX-License-Identifier: MIT
+
+#include "../ast/ast.h"
+#include "../parser/parser.h"
+#include "../zprep.h"
+#include "codegen.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every concrete use of a generic type instantiates all methods of its impl blocks, and most
+// programs call a handful of them. The whole single-unit program is captured; those methods,
+// and instantiations of generic functions, are rendered into side buffers, and only the ones
+// whose C name occurs in the rest of the output (or in another deferred body that does) are
+// spliced back in. Trait impls stay eager: their methods are reached through vtables and drop
+// glue, which name them anyway.
+//
+// This only decides what reaches the C compiler. instantiate_methods() still copies every
+// method when a type is instantiated, and the type checker still checks each copy: method
+// references resolve in the parser, the checker, operator lowering and drop glue, and there is
+// no single point to defer them to. Reachability costs one pass over the identifiers of the
+// output and of each kept body.
+//
+// With --share-generics, instantiations whose arguments differ only in the struct a pointer
+// argument points to (Vec<A*>, Vec<B*>) share bodies: when two bodies are the same text up to
+// those names, and every function they call differently shares a body in turn, the later one
+// becomes a wrapper that casts and calls the first.
+
+struct LazyMethod
+{
+    const char *name; ///< Interned C name.
+    char *proto;      ///< Prototype text (libc heap), NULL if none was emitted.
+    char *body;       ///< Definition text (libc heap), NULL if none was emitted.
+    int used;
+    ASTNode *method;     ///< Function node while its body may be shared, otherwise NULL.
+    Instantiation *inst; ///< Instantiation of the method's impl, or of the function itself.
+    LazyMethod *canon;   ///< Method whose body this one forwards to (--share-generics).
+    LazyMethod *next;    ///< Emission order.
+    LazyMethod *work;    ///< Next method whose body still has to be scanned.
+};
+
+struct LazyMethods
+{
+    zmap_LazyMap by_name;
+    LazyMethod *head;
+    LazyMethod *tail;
+    size_t at[LAZY_AT_COUNT]; ///< Splice offsets into the captured output.
+};
+
+// Methods that are reachable from outside the program or under a name nobody spells out.
+static int is_root(ASTNode *m, const char *name)
+{
+    return m->link_name || m->func.is_export || m->func.constructor || m->func.destructor ||
+           m->func.weak || m->func.section || m->func.is_async || m->func.cuda_global ||
+           m->func.attributes || !strstr(name, "__");
+}
+
+static LazyMethod *lazy_method(struct LazyMethods *lz, ASTNode *method, const char *name)
+{
+    const char *key = intern(name);
+    LazyMethod **found = zmap_get(&lz->by_name, key);
+    if (found)
+    {
+        return *found;
+    }
+    LazyMethod *lm = xcalloc(1, sizeof(LazyMethod));
+    lm->name = key;
+    lm->used = is_root(method, key);
+    zmap_put(&lz->by_name, key, lm);
+    if (lz->tail)
+    {
+        lz->tail->next = lm;
+    }
+    else
+    {
+        lz->head = lm;
+    }
+    lz->tail = lm;
+    return lm;
+}
+
+// Append @p text to *@p dst, taking ownership of it. @cfg variants share a C name.
+static void append_text(char **dst, char *text)
+{
+    if (!text)
+    {
+        return;
+    }
+    if (!*dst)
+    {
+        *dst = text;
+        return;
+    }
+    size_t a = strlen(*dst);
+    size_t b = strlen(text);
+    char *joined = libc_realloc(*dst, a + b + 1);
+    if (!joined)
+    {
+        zfatal("lazy methods: out of memory");
+    }
+    memcpy(joined + a, text, b + 1);
+    libc_free(text);
+    *dst = joined;
+}
+
+// Mark every deferred method named in the @p len bytes at @p text, queueing newly marked ones.
+static void scan_names(struct LazyMethods *lz, const char *text, size_t len, LazyMethod **work)
+{
+    size_t i = 0;
+    while (i < len)
+    {
+        unsigned char c = (unsigned char)text[i];
+        if (!isalnum(c) && c != '_')
+        {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        int has_sep = 0;
+        while (i < len && (isalnum((unsigned char)text[i]) || text[i] == '_'))
+        {
+            if (text[i] == '_' && i > start && text[i - 1] == '_')
+            {
+                has_sep = 1;
+            }
+            i++;
+        }
+        // Method names are "<type>__<method>"; numbers and plain words cannot be one.
+        if (!has_sep || isdigit(c))
+        {
+            continue;
+        }
+        const char *key = intern_find_n(text + start, i - start);
+        LazyMethod **found = key ? zmap_get(&lz->by_name, key) : NULL;
+        if (found && !(*found)->used)
+        {
+            (*found)->used = 1;
+            (*found)->work = *work;
+            *work = *found;
+        }
+    }
+}
+
+// Sharing bodies (--share-generics).
+
+enum
+{
+    SHARE_MAX_ARGS = 8
+};
+
+// Type arguments of one instantiation, as far as sharing is concerned.
+typedef struct
+{
+    int count;
+    const char *base[SHARE_MAX_ARGS]; ///< Pointee of a struct pointer argument, else NULL.
+    char *piece[SHARE_MAX_ARGS];      ///< Argument as it appears in mangled names ("APtr").
+    ASTNode *def[SHARE_MAX_ARGS];     ///< Pointee struct, NULL for void*.
+} ShareArgs;
+
+static char *ret_c_type(ASTNode *m)
+{
+    if (m->func.ret_type_info)
+    {
+        return type_to_c_string(m->func.ret_type_info);
+    }
+    return xstrdup(m->func.ret_type ? m->func.ret_type : "void");
+}
+
+static char *param_c_type(ASTNode *m, int i)
+{
+    if (m->func.c_type_overrides && m->func.c_type_overrides[i])
+    {
+        return xstrdup(m->func.c_type_overrides[i]);
+    }
+    if (m->func.arg_types && m->func.arg_types[i])
+    {
+        return type_to_c_string(m->func.arg_types[i]);
+    }
+    return xstrdup("void*");
+}
+
+static int is_pointer_type(const char *t)
+{
+    size_t len = strlen(t);
+    return len > 0 && t[len - 1] == '*';
+}
+
+// Functions whose wrapper can be written from the signature alone. @p owner is the impl of a
+// method, or the function itself.
+static int may_share(ParserContext *ctx, ASTNode *owner, ASTNode *m)
+{
+    if (!ctx->config->share_generics || owner->cfg_condition || m->cfg_condition ||
+        !m->func.body || m->func.generic_params || m->func.is_async || m->func.is_varargs ||
+        m->link_name)
+    {
+        return 0;
+    }
+    for (int i = 0; i < m->func.arg_count; i++)
+    {
+        if (!m->func.param_names || !m->func.param_names[i])
+        {
+            return 0;
+        }
+    }
+    return !strstr(ret_c_type(m), "(*");
+}
+
+// The pointer behind a typedef like "APtr", which generic functions are instantiated with. It is
+// emitted for every type instantiation with that argument (emit_mangled_pointer_typedefs()).
+static const char *pointer_typedef(ParserContext *ctx, const char *arg)
+{
+    for (Instantiation *i = ctx->instantiations; i; i = i->next)
+    {
+        if (i->concrete_arg && i->unmangled_arg && strcmp(i->concrete_arg, arg) == 0 &&
+            strchr(i->unmangled_arg, '*'))
+        {
+            return i->unmangled_arg;
+        }
+    }
+    return arg;
+}
+
+// Split the arguments of @p inst and check they spell its mangled name.
+static int share_args(ParserContext *ctx, Instantiation *inst, ShareArgs *a)
+{
+    memset(a, 0, sizeof(*a));
+    size_t tlen = strlen(inst->template_name);
+    if (strncmp(inst->name, inst->template_name, tlen) != 0)
+    {
+        return 0;
+    }
+    const char *mangled = inst->name + tlen;
+    int pointers = 0;
+    const char *p = inst->unmangled_arg;
+    while (*p)
+    {
+        if (a->count == SHARE_MAX_ARGS)
+        {
+            return 0;
+        }
+        int depth = 0;
+        const char *end = p;
+        while (*end && (depth > 0 || *end != ','))
+        {
+            depth += (*end == '<' || *end == '(') - (*end == '>' || *end == ')');
+            end++;
+        }
+        char *arg = xmalloc((size_t)(end - p) + 1);
+        memcpy(arg, p, (size_t)(end - p));
+        arg[end - p] = '\0';
+        p = *end ? end + 1 : end;
+
+        char *piece = sanitize_mangled_name(arg);
+        size_t plen = strlen(piece);
+        if (strncmp(mangled, "__", 2) != 0 || strncmp(mangled + 2, piece, plen) != 0)
+        {
+            return 0;
+        }
+        mangled += 2 + plen;
+
+        int k = a->count++;
+        a->piece[k] = piece;
+        const char *base = strchr(arg, '*') ? arg : pointer_typedef(ctx, arg);
+        while (*base == ' ')
+        {
+            base++;
+        }
+        if (strncmp(base, "struct ", 7) == 0)
+        {
+            base += 7;
+        }
+        size_t blen = strcspn(base, " *");
+        if (blen == 0 || strspn(base + blen, " ") + blen + 1 != strlen(base) ||
+            base[strlen(base) - 1] != '*')
+        {
+            continue; // Not a single-level pointer: only shared with itself.
+        }
+        char *name = xmalloc(blen + 1);
+        memcpy(name, base, blen);
+        name[blen] = '\0';
+        ASTNode *def = strcmp(name, "void") == 0 ? NULL : find_struct_def(ctx, name);
+        if (strcmp(name, "void") != 0 &&
+            (!def || def->type != NODE_STRUCT || def->strct.is_template))
+        {
+            continue;
+        }
+        a->base[k] = name;
+        a->def[k] = def;
+        pointers++;
+    }
+    return pointers > 0 && *mangled == '\0';
+}
+
+static int is_pointee_field(const ShareArgs *a, const char *tok, size_t len)
+{
+    for (int k = 0; k < a->count; k++)
+    {
+        for (ASTNode *f = a->def[k] ? a->def[k]->strct.fields : NULL; f; f = f->next)
+        {
+            if (f->type == NODE_FIELD && f->field.name && strlen(f->field.name) == len &&
+                strncmp(f->field.name, tok, len) == 0)
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// The body of @p lm with the pointee of each pointer argument and its mangled spelling replaced
+// by placeholders. NULL when the body uses a pointee other than through a pointer: by value,
+// or by touching one of its fields.
+static char *shared_key(ParserContext *ctx, LazyMethod *lm)
+{
+    ShareArgs a;
+    if (!lm->inst || !share_args(ctx, lm->inst, &a))
+    {
+        return NULL;
+    }
+    const char *s = lm->body;
+    size_t n = strlen(s);
+    char *out = xmalloc(2 * n + 1); // A placeholder is two bytes; nothing it replaces is shorter.
+    char *o = out;
+    size_t i = 0;
+    while (i < n)
+    {
+        unsigned char c = (unsigned char)s[i];
+        if (!isalnum(c) && c != '_')
+        {
+            *o++ = s[i++];
+            continue;
+        }
+        size_t start = i;
+        while (i < n && (isalnum((unsigned char)s[i]) || s[i] == '_'))
+        {
+            i++;
+        }
+        const char *tok = s + start;
+        size_t len = i - start;
+        if (isdigit(c))
+        {
+            memcpy(o, tok, len);
+            o += len;
+            continue;
+        }
+        int member = (start >= 1 && s[start - 1] == '.') ||
+                     (start >= 2 && s[start - 2] == '-' && s[start - 1] == '>');
+        if (member && is_pointee_field(&a, tok, len))
+        {
+            return NULL;
+        }
+        int k = 0;
+        while (k < a.count && !(a.base[k] && strlen(a.base[k]) == len &&
+                                strncmp(a.base[k], tok, len) == 0))
+        {
+            k++;
+        }
+        if (k < a.count)
+        {
+            size_t j = i;
+            while (j < n && s[j] == ' ')
+            {
+                j++;
+            }
+            if (j == n || s[j] != '*')
+            {
+                return NULL;
+            }
+            *o++ = '\x01';
+            *o++ = (char)('0' + k);
+            continue;
+        }
+        // Mangled names: "Vec__APtr__push", "Option__APtr", and the typedef "APtr" itself.
+        size_t p = 0;
+        while (p < len)
+        {
+            int replaced = 0;
+            if (p == 0 || (p >= 2 && tok[p - 1] == '_' && tok[p - 2] == '_'))
+            {
+                for (k = 0; k < a.count; k++)
+                {
+                    size_t plen = strlen(a.piece[k]);
+                    if (a.base[k] && p + plen <= len && strncmp(tok + p, a.piece[k], plen) == 0 &&
+                        (p + plen == len || strncmp(tok + p + plen, "__", 2) == 0))
+                    {
+                        *o++ = '\x02';
+                        *o++ = (char)('0' + k);
+                        p += plen;
+                        replaced = 1;
+                        break;
+                    }
+                }
+            }
+            if (!replaced)
+            {
+                *o++ = tok[p++];
+            }
+        }
+    }
+    *o = '\0';
+    return out;
+}
+
+static LazyMethod *find_method(struct LazyMethods *lz, const char *tok, size_t len)
+{
+    const char *key = intern_find_n(tok, len);
+    LazyMethod **found = key ? zmap_get(&lz->by_name, key) : NULL;
+    return found ? *found : NULL;
+}
+
+// Index of the pointer argument spelled @p tok in mangled form ("APtr"), or -1.
+static int pointer_piece(const ShareArgs *a, const char *tok, size_t len)
+{
+    for (int k = 0; k < a->count; k++)
+    {
+        if (a->base[k] && strlen(a->piece[k]) == len && strncmp(a->piece[k], tok, len) == 0)
+        {
+            return k;
+        }
+    }
+    return -1;
+}
+
+// Whether the names where the bodies of @p a and @p b differ are interchangeable: types of the
+// same layout, or deferred functions that share a body themselves. Anything else could depend on
+// the pointee, so it cannot be.
+static int same_callees(ParserContext *ctx, struct LazyMethods *lz, LazyMethod *a, LazyMethod *b)
+{
+    ShareArgs sa;
+    ShareArgs sb;
+    if (!share_args(ctx, a->inst, &sa) || !share_args(ctx, b->inst, &sb))
+    {
+        return 0;
+    }
+    const char *s = a->body;
+    const char *t = b->body;
+    while (*s && *t)
+    {
+        if (!isalnum((unsigned char)*s) && *s != '_')
+        {
+            s++;
+            t++;
+            continue;
+        }
+        size_t ls = 0;
+        size_t lt = 0;
+        while (isalnum((unsigned char)s[ls]) || s[ls] == '_')
+        {
+            ls++;
+        }
+        while (isalnum((unsigned char)t[lt]) || t[lt] == '_')
+        {
+            lt++;
+        }
+        if (ls != lt || strncmp(s, t, ls) != 0)
+        {
+            LazyMethod *ma = find_method(lz, s, ls);
+            LazyMethod *mb = find_method(lz, t, lt);
+            if (ma || mb)
+            {
+                if (!ma || !mb || (ma->canon ? ma->canon : ma) != (mb->canon ? mb->canon : mb))
+                {
+                    return 0;
+                }
+            }
+            else if (pointer_piece(&sa, s, ls) < 0 ||
+                     pointer_piece(&sa, s, ls) != pointer_piece(&sb, t, lt))
+            {
+                char *na = xmalloc(ls + 1);
+                char *nb = xmalloc(lt + 1);
+                memcpy(na, s, ls);
+                memcpy(nb, t, lt);
+                na[ls] = '\0';
+                nb[lt] = '\0';
+                if (!find_struct_def(ctx, na) || !find_struct_def(ctx, nb))
+                {
+                    return 0;
+                }
+            }
+        }
+        s += ls;
+        t += lt;
+    }
+    return 1;
+}
+
+// Point each method at the first one whose body is the same up to the pointer arguments.
+static void share_bodies(ParserContext *ctx, struct LazyMethods *lz)
+{
+    zmap_LazyMap groups = zmap_init(LazyMap, zmap_hash_cstr, zmap_cmp_cstr);
+    for (LazyMethod *lm = lz->head; lm; lm = lm->next)
+    {
+        char *key = lm->method && lm->body ? shared_key(ctx, lm) : NULL;
+        if (!key)
+        {
+            continue;
+        }
+        LazyMethod **canon = zmap_get(&groups, key);
+        if (canon)
+        {
+            lm->canon = *canon;
+        }
+        else
+        {
+            zmap_put(&groups, key, lm);
+        }
+    }
+    zmap_free(&groups);
+
+    // Unsharing one method can break the premise of another, so repeat until nothing changes.
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (LazyMethod *lm = lz->head; lm; lm = lm->next)
+        {
+            if (lm->canon && !same_callees(ctx, lz, lm, lm->canon))
+            {
+                lm->canon = NULL;
+                changed = 1;
+            }
+        }
+    }
+}
+
+// Body of a shared method: convert the arguments to the types of lm->canon, call it and convert
+// the result back. Pointers are cast; structs of the two instantiations have the same layout.
+static void emit_wrapper(ParserContext *ctx, LazyMethod *lm)
+{
+    ASTNode *m = lm->method;
+    ASTNode *c = lm->canon->method;
+    char *ret = ret_c_type(m);
+    char *cret = ret_c_type(c);
+    int pun_ret = 0;
+
+    emit_func_signature(ctx, m, NULL);
+    EMIT(ctx, "\n{\n    ");
+    if (strcmp(ret, cret) == 0)
+    {
+        EMIT(ctx, "%s", strcmp(ret, "void") == 0 ? "" : "return ");
+    }
+    else if (is_pointer_type(ret))
+    {
+        EMIT(ctx, "return (%s)", ret);
+    }
+    else
+    {
+        EMIT(ctx, "%s _z_shared = ", cret);
+        pun_ret = 1;
+    }
+    EMIT(ctx, "%s(", lm->canon->name);
+    for (int i = 0; i < m->func.arg_count; i++)
+    {
+        char *t = param_c_type(m, i);
+        char *ct = param_c_type(c, i);
+        const char *name = m->func.param_names[i];
+        if (i > 0)
+        {
+            EMIT(ctx, ", ");
+        }
+        if (strcmp(t, ct) == 0)
+        {
+            EMIT(ctx, "%s", name);
+        }
+        else if (is_pointer_type(t))
+        {
+            EMIT(ctx, "(%s)%s", ct, name);
+        }
+        else
+        {
+            EMIT(ctx, "*(%s *)&%s", ct, name);
+        }
+    }
+    EMIT(ctx, ");\n");
+    if (pun_ret)
+    {
+        EMIT(ctx, "    return *(%s *)&_z_shared;\n", ret);
+    }
+    EMIT(ctx, "}\n\n");
+}
+
+int lazy_methods_begin(ParserContext *ctx)
+{
+    if (!ctx->config || !ctx->config->use_lazy_methods ||
+        ctx->cg.split_role != CODEGEN_UNIT_SINGLE || ctx->cg.is_repl)
+    {
+        return 0;
+    }
+    if (!emitter_push_buffer(&ctx->cg.emitter))
+    {
+        return 0;
+    }
+    struct LazyMethods *lz = xcalloc(1, sizeof(struct LazyMethods));
+    lz->by_name = zmap_init(LazyMap, zmap_hash_name, zmap_cmp_name);
+    ctx->cg.lazy = lz;
+    return 1;
+}
+
+int lazy_methods_wanted(ParserContext *ctx, ASTNode *node)
+{
+    if (!ctx->cg.lazy)
+    {
+        return 0;
+    }
+    if (node->type == NODE_IMPL)
+    {
+        return node->impl.struct_name && find_instantiation(ctx, node->impl.struct_name);
+    }
+    // Async functions also emit their future struct with the prototype.
+    return node->type == NODE_FUNCTION && node->func.name && node->func.body &&
+           !node->func.is_async && find_function_instantiation(ctx, node->func.name);
+}
+
+void lazy_methods_capture(ParserContext *ctx)
+{
+    emitter_push_buffer(&ctx->cg.emitter);
+}
+
+void lazy_methods_defer_proto(ParserContext *ctx, ASTNode *method, const char *name)
+{
+    char *text = emitter_pop_buffer(&ctx->cg.emitter);
+    append_text(&lazy_method(ctx->cg.lazy, method, name)->proto, text);
+}
+
+// Render @p fn, an instantiation of a generic function.
+static void defer_function(ParserContext *ctx, ASTNode *fn)
+{
+    lazy_methods_capture(ctx);
+    if (fn->cfg_condition)
+    {
+        EMIT(ctx, "#if %s\n", fn->cfg_condition);
+    }
+    codegen_node_single(ctx, fn);
+    if (fn->cfg_condition)
+    {
+        EMIT(ctx, "#endif\n");
+    }
+    char *text = emitter_pop_buffer(&ctx->cg.emitter);
+
+    const char *name = fn->link_name ? fn->link_name : fn->func.name;
+    LazyMethod *lm = lazy_method(ctx->cg.lazy, fn, name);
+    int first = !lm->body && !lm->method;
+    lm->method = first && may_share(ctx, fn, fn) ? fn : NULL;
+    lm->inst = lm->method ? find_function_instantiation(ctx, fn->func.name) : NULL;
+    append_text(&lm->body, text);
+}
+
+// Render the methods of @p impl one by one.
+static void defer_impl(ParserContext *ctx, ASTNode *impl)
+{
+    // Emit the impl once per method, so handle_node_impl() still sets up the impl context.
+    ASTNode *methods = impl->impl.methods;
+    for (ASTNode *m = methods; m; m = m->next)
+    {
+        ASTNode *next = m->next;
+        m->next = NULL;
+        impl->impl.methods = m;
+
+        lazy_methods_capture(ctx);
+        if (impl->cfg_condition)
+        {
+            EMIT(ctx, "#if %s\n", impl->cfg_condition);
+        }
+        codegen_node_single(ctx, impl);
+        if (impl->cfg_condition)
+        {
+            EMIT(ctx, "#endif\n");
+        }
+        char *text = emitter_pop_buffer(&ctx->cg.emitter);
+
+        m->next = next;
+        const char *name = m->link_name ? m->link_name : m->func.name;
+        LazyMethod *lm = lazy_method(ctx->cg.lazy, m, name);
+        // A name emitted twice (@cfg variants) keeps both bodies verbatim.
+        int first = !lm->body && !lm->method;
+        lm->method = first && may_share(ctx, impl, m) ? m : NULL;
+        lm->inst = lm->method ? find_instantiation(ctx, impl->impl.struct_name) : NULL;
+        append_text(&lm->body, text);
+    }
+    impl->impl.methods = methods;
+}
+
+int lazy_methods_defer_bodies(ParserContext *ctx, ASTNode *node)
+{
+    if (!lazy_methods_wanted(ctx, node))
+    {
+        return 0;
+    }
+    if (node->type == NODE_FUNCTION)
+    {
+        defer_function(ctx, node);
+    }
+    else
+    {
+        defer_impl(ctx, node);
+    }
+    return 1;
+}
+
+void lazy_methods_mark(ParserContext *ctx, LazySlot slot)
+{
+    if (ctx->cg.lazy)
+    {
+        ctx->cg.lazy->at[slot] = ctx->cg.emitter.buffer.len;
+    }
+}
+
+void lazy_methods_end(ParserContext *ctx)
+{
+    struct LazyMethods *lz = ctx->cg.lazy;
+    if (!lz)
+    {
+        return;
+    }
+    ctx->cg.lazy = NULL;
+
+    Emitter *e = &ctx->cg.emitter;
+    size_t len = e->buffer.len;
+    char *text = emitter_pop_buffer(e);
+    const char *out = text ? text : "";
+
+    if (ctx->config->share_generics)
+    {
+        share_bodies(ctx, lz);
+    }
+
+    LazyMethod *work = NULL;
+    for (LazyMethod *lm = lz->head; lm; lm = lm->next)
+    {
+        if (lm->used)
+        {
+            lm->work = work;
+            work = lm;
+        }
+    }
+    scan_names(lz, out, len, &work);
+    while (work)
+    {
+        LazyMethod *lm = work;
+        work = lm->work;
+        if (lm->canon)
+        {
+            // The wrapper names nothing but the method it forwards to.
+            if (!lm->canon->used)
+            {
+                lm->canon->used = 1;
+                lm->canon->work = work;
+                work = lm->canon;
+            }
+        }
+        else if (lm->body)
+        {
+            scan_names(lz, lm->body, strlen(lm->body), &work);
+        }
+    }
+
+    size_t from = 0;
+    for (int slot = 0; slot < LAZY_AT_COUNT; slot++)
+    {
+        size_t at = lz->at[slot] < len ? lz->at[slot] : len;
+        emitter_write(e, out + from, at - from);
+        for (LazyMethod *lm = lz->head; lm; lm = lm->next)
+        {
+            const char *part = slot == LAZY_AT_PROTOS ? lm->proto : lm->body;
+            if (lm->used && lm->canon && slot == LAZY_AT_BODIES)
+            {
+                emit_wrapper(ctx, lm);
+            }
+            else if (lm->used && part)
+            {
+                emitter_write(e, part, strlen(part));
+            }
+        }
+        from = at;
+    }
+    emitter_write(e, out + from, len - from);
+
+    libc_free(text);
+    for (LazyMethod *lm = lz->head; lm; lm = lm->next)
+    {
+        libc_free(lm->proto);
+        libc_free(lm->body);
+    }
+    zmap_free(&lz->by_name);
+}
@@ -493,6 +493,16 @@ static void emit_auto_drop_glues(ParserContext *ctx, ASTNode *structs)
             }
 
             char *sname = s->strct.name;
+            if (ctx->cg.split_role == CODEGEN_UNIT_HEADER)
+            {
+                EMIT(ctx, "void %s__Drop__glue(%s *self);\n", sname, sname);
+                if (s->cfg_condition)
+                {
+                    EMIT(ctx, "#endif\n");
+                }
+                s = s->next;
+                continue;
+            }
             EMIT(ctx, "// Auto-Generated RAII Glue for %s\n", sname);
             EMIT(ctx, "void %s__Drop__glue(%s *self) {\n", sname, sname);
 
@@ -775,6 +785,392 @@ static void flatten_comptime_nodes(ASTNode *parent)
 }
 
 // Main entry point for code generation.
+// Functions emitted by one entry of the function list, used to balance split units.
+static int func_weight(ASTNode *n)
+{
+    ASTNode *m = NULL;
+    if (n->type == NODE_IMPL)
+    {
+        m = n->impl.methods;
+    }
+    else if (n->type == NODE_IMPL_TRAIT)
+    {
+        m = n->impl_trait.methods;
+    }
+    else
+    {
+        return 1;
+    }
+    int w = 0;
+    for (; m; m = m->next)
+    {
+        w++;
+    }
+    return w > 0 ? w : 1;
+}
+
+// Map every entry of `funcs` to a split unit, or return NULL when the build is not split.
+// Entries are grouped by source module so a module's bodies land in one unit; a module larger
+// than an even share is cut into several groups. Groups are then placed heaviest first on the
+// least loaded unit. Depends only on list order, so every unit of one build agrees on it.
+static int *assign_units(ParserContext *ctx, ASTNode *funcs)
+{
+    int units = ctx->cg.split_units;
+    if (units <= 1)
+    {
+        return NULL;
+    }
+
+    int count = 0;
+    int total = 0;
+    for (ASTNode *f = funcs; f; f = f->next)
+    {
+        count++;
+        total += func_weight(f);
+    }
+    if (count == 0)
+    {
+        return NULL;
+    }
+
+    int share = (total + units - 1) / units;
+    int *group_of = xmalloc(sizeof(int) * (size_t)count);
+    int *group_weight = xmalloc(sizeof(int) * (size_t)count);
+    const char **group_file = xmalloc(sizeof(char *) * (size_t)count);
+    int groups = 0;
+
+    int i = 0;
+    for (ASTNode *f = funcs; f; f = f->next, i++)
+    {
+        const char *file = token_file(f->token) ? token_file(f->token) : "";
+        int g = -1;
+        for (int k = groups - 1; k >= 0; k--)
+        {
+            if (strcmp(group_file[k], file) == 0)
+            {
+                g = k;
+                break;
+            }
+        }
+        if (g < 0 || group_weight[g] >= share)
+        {
+            g = groups++;
+            group_file[g] = file;
+            group_weight[g] = 0;
+        }
+        group_weight[g] += func_weight(f);
+        group_of[i] = g;
+    }
+
+    int *order = xmalloc(sizeof(int) * (size_t)groups);
+    for (int g = 0; g < groups; g++)
+    {
+        int j = g;
+        while (j > 0 && group_weight[order[j - 1]] < group_weight[g])
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = g;
+    }
+
+    int *load = xmalloc(sizeof(int) * (size_t)units);
+    memset(load, 0, sizeof(int) * (size_t)units);
+    int *unit_of_group = xmalloc(sizeof(int) * (size_t)groups);
+    for (int k = 0; k < groups; k++)
+    {
+        int best = 0;
+        for (int u = 1; u < units; u++)
+        {
+            if (load[u] < load[best])
+            {
+                best = u;
+            }
+        }
+        unit_of_group[order[k]] = best;
+        load[best] += group_weight[order[k]];
+    }
+
+    int *unit_of = xmalloc(sizeof(int) * (size_t)count);
+    for (i = 0; i < count; i++)
+    {
+        unit_of[i] = unit_of_group[group_of[i]];
+    }
+
+    zfree(group_of);
+    zfree(group_weight);
+    zfree(group_file);
+    zfree(order);
+    zfree(load);
+    zfree(unit_of_group);
+    return unit_of;
+}
+
+static int has_raw_code(ASTNode *node, VisitedModules **visited, int depth)
+{
+    if (depth > 1024)
+    {
+        return 0;
+    }
+    for (; node; node = node->next)
+    {
+        if (node->type == NODE_IMPORT)
+        {
+            if (!is_module_visited(*visited, node->import_stmt.path))
+            {
+                mark_module_visited(visited, node->import_stmt.path);
+                if (has_raw_code(node->import_stmt.module_root, visited, depth + 1))
+                {
+                    return 1;
+                }
+            }
+        }
+        else if (node->type == NODE_ROOT)
+        {
+            if (has_raw_code(node->root.children, visited, depth + 1))
+            {
+                return 1;
+            }
+        }
+        else if (node->type == NODE_RAW_STMT && node->raw_stmt.content)
+        {
+            const char *content = node->raw_stmt.content;
+            while (*content == ' ' || *content == '\t' || *content == '\n')
+            {
+                content++;
+            }
+            if (*content && *content != '#')
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+const char *codegen_split_blocker(ParserContext *ctx, ASTNode *root)
+{
+    if (ctx->config->use_cpp || ctx->config->use_cuda || ctx->config->use_objc)
+    {
+        return "only plain C output is split";
+    }
+    if (ctx->cg.has_async)
+    {
+        return "async functions emit their future types next to the body";
+    }
+    if (ctx->cg.hoist_out && ftell(ctx->cg.hoist_out) > 0)
+    {
+        return "plugins hoisted code to file scope";
+    }
+
+    // Top-level raw C is copied verbatim; a static variable in it would silently become one
+    // copy per unit, so such programs stay in a single unit.
+    flatten_comptime_nodes(root);
+    VisitedModules *visited = NULL;
+    int raw = has_raw_code(root, &visited, 0);
+    free_visited_modules(visited);
+    if (raw)
+    {
+        return "top-level raw blocks";
+    }
+    return NULL;
+}
+
+// Instantiated generics, then parsed functions, then impl blocks: the order bodies are emitted.
+static ASTNode *collect_funcs(ParserContext *ctx)
+{
+    ASTNode *merged_funcs = NULL;
+    ASTNode *merged_funcs_tail = NULL;
+
+    if (ctx->instantiated_funcs)
+    {
+        ASTNode *fn_node = ctx->instantiated_funcs;
+        while (fn_node)
+        {
+            ASTNode *copy = xmalloc(sizeof(ASTNode));
+            *copy = *fn_node;
+            copy->next = NULL;
+            if (!merged_funcs)
+            {
+                merged_funcs = copy;
+                merged_funcs_tail = copy;
+            }
+            else
+            {
+                merged_funcs_tail->next = copy;
+                merged_funcs_tail = copy;
+            }
+            fn_node = fn_node->next;
+        }
+    }
+
+    if (ctx->parsed_funcs_list)
+    {
+        StructRef *fn_ref = ctx->parsed_funcs_list;
+        while (fn_ref)
+        {
+            ASTNode *copy = xmalloc(sizeof(ASTNode));
+            *copy = *fn_ref->node;
+            copy->next = NULL;
+            if (!merged_funcs)
+            {
+                merged_funcs = copy;
+                merged_funcs_tail = copy;
+            }
+            else
+            {
+                merged_funcs_tail->next = copy;
+                merged_funcs_tail = copy;
+            }
+            fn_ref = fn_ref->next;
+        }
+    }
+
+    if (ctx->parsed_impls_list)
+    {
+        StructRef *impl_ref = ctx->parsed_impls_list;
+        while (impl_ref)
+        {
+            ASTNode *copy = xmalloc(sizeof(ASTNode));
+            *copy = *impl_ref->node;
+            copy->next = NULL;
+            if (!merged_funcs)
+            {
+                merged_funcs = copy;
+                merged_funcs_tail = copy;
+            }
+            else
+            {
+                merged_funcs_tail->next = copy;
+                merged_funcs_tail = copy;
+            }
+            impl_ref = impl_ref->next;
+        }
+    }
+
+    return merged_funcs;
+}
+
+static void emit_function_bodies(ParserContext *ctx, ASTNode *funcs)
+{
+    int *unit_of = assign_units(ctx, funcs);
+    int idx = 0;
+    for (ASTNode *iter = funcs; iter; iter = iter->next, idx++)
+    {
+        if (unit_of && unit_of[idx] != ctx->cg.split_unit)
+        {
+            continue;
+        }
+        if (iter->type == NODE_IMPL)
+        {
+            char *sname = iter->impl.struct_name;
+            if (!sname)
+            {
+                continue;
+            }
+
+            // Resolve opaque alias
+            const char *resolved = find_type_alias(ctx, sname);
+
+            char *mangled = replace_string_type(sname);
+            ASTNode *def = find_struct_def(ctx, mangled);
+            if (!def && resolved)
+            {
+                zfree(mangled);
+                mangled = replace_string_type(resolved);
+                def = find_struct_def(ctx, mangled);
+            }
+            int skip = 0;
+            if (def)
+            {
+                if (def->type == NODE_STRUCT && def->strct.is_template)
+                {
+                    skip = 1;
+                }
+                else if (def->type == NODE_ENUM && def->enm.is_template)
+                {
+                    skip = 1;
+                }
+            }
+            else
+            {
+                char *buf = strip_template_suffix(sname);
+                if (buf)
+                {
+                    def = find_struct_def(ctx, buf);
+                    if (def && def->strct.is_template)
+                    {
+                        skip = 1;
+                    }
+                    zfree(buf);
+                }
+            }
+            if (mangled)
+            {
+                zfree(mangled);
+            }
+            if (skip)
+            {
+                continue;
+            }
+        }
+        if (iter->type == NODE_IMPL_TRAIT)
+        {
+            char *sname = iter->impl_trait.target_type;
+            if (!sname)
+            {
+                continue;
+            }
+
+            char *mangled = replace_string_type(sname);
+            ASTNode *def = find_struct_def(ctx, mangled);
+            int skip = 0;
+            if (def)
+            {
+                if (def->strct.is_template)
+                {
+                    skip = 1;
+                }
+            }
+            else
+            {
+                char *buf = strip_template_suffix(sname);
+                if (buf)
+                {
+                    def = find_struct_def(ctx, buf);
+                    if (def && def->strct.is_template)
+                    {
+                        skip = 1;
+                    }
+                    zfree(buf);
+                }
+            }
+            if (mangled)
+            {
+                zfree(mangled);
+            }
+            if (skip)
+            {
+                continue;
+            }
+        }
+        if (lazy_methods_defer_bodies(ctx, iter))
+        {
+            continue;
+        }
+        if (iter->cfg_condition)
+        {
+            EMIT(ctx, "#if %s\n", iter->cfg_condition);
+        }
+        codegen_node_single(ctx, iter);
+        if (iter->cfg_condition)
+        {
+            EMIT(ctx, "#endif\n");
+        }
+    }
+    zfree(unit_of);
+}
+
 void codegen_c_program(ParserContext *ctx, ASTNode *node)
 {
     // Flatten any NODE_COMPTIME blocks into their generated AST nodes
@@ -801,6 +1197,15 @@ void codegen_c_program(ParserContext *ctx, ASTNode *node)
         ctx->cg.global_user_structs = kids;
         VisitedModules *visited = NULL;
 
+        if (ctx->cg.split_role == CODEGEN_UNIT_BODIES)
+        {
+            EMIT(ctx, "#include \"%s\"\n", ctx->cg.split_header);
+            emit_function_bodies(ctx, collect_funcs(ctx));
+            return;
+        }
+
+        lazy_methods_begin(ctx);
+
         if (!ctx->cg.skip_preamble)
         {
             emit_preamble(ctx);
@@ -1016,80 +1421,14 @@ void codegen_c_program(ParserContext *ctx, ASTNode *node)
             }
         }
 
-        ASTNode *merged_funcs = NULL;
-        ASTNode *merged_funcs_tail = NULL;
-
-        if (ctx->instantiated_funcs)
-        {
-            ASTNode *fn_node = ctx->instantiated_funcs;
-            while (fn_node)
-            {
-                ASTNode *copy = xmalloc(sizeof(ASTNode));
-                *copy = *fn_node;
-                copy->next = NULL;
-                if (!merged_funcs)
-                {
-                    merged_funcs = copy;
-                    merged_funcs_tail = copy;
-                }
-                else
-                {
-                    merged_funcs_tail->next = copy;
-                    merged_funcs_tail = copy;
-                }
-                fn_node = fn_node->next;
-            }
-        }
-
-        if (ctx->parsed_funcs_list)
-        {
-            StructRef *fn_ref = ctx->parsed_funcs_list;
-            while (fn_ref)
-            {
-                ASTNode *copy = xmalloc(sizeof(ASTNode));
-                *copy = *fn_ref->node;
-                copy->next = NULL;
-                if (!merged_funcs)
-                {
-                    merged_funcs = copy;
-                    merged_funcs_tail = copy;
-                }
-                else
-                {
-                    merged_funcs_tail->next = copy;
-                    merged_funcs_tail = copy;
-                }
-                fn_ref = fn_ref->next;
-            }
-        }
-
-        if (ctx->parsed_impls_list)
-        {
-            StructRef *impl_ref = ctx->parsed_impls_list;
-            while (impl_ref)
-            {
-                ASTNode *copy = xmalloc(sizeof(ASTNode));
-                *copy = *impl_ref->node;
-                copy->next = NULL;
-                if (!merged_funcs)
-                {
-                    merged_funcs = copy;
-                    merged_funcs_tail = copy;
-                }
-                else
-                {
-                    merged_funcs_tail->next = copy;
-                    merged_funcs_tail = copy;
-                }
-                impl_ref = impl_ref->next;
-            }
-        }
+        ASTNode *merged_funcs = collect_funcs(ctx);
 
         visited = NULL;
         emit_trait_wrappers(ctx, kids, &visited);
 
         visited = NULL;
         emit_protos(ctx, merged_funcs, &visited);
+        lazy_methods_mark(ctx, LAZY_AT_PROTOS);
 
         visited = NULL;
         emit_globals(ctx, merged_globals, &visited);
@@ -1100,119 +1439,15 @@ void codegen_c_program(ParserContext *ctx, ASTNode *node)
 
         emit_lambda_defs(ctx);
 
-        int test_count = emit_tests_and_runner(ctx, kids);
+        // Tests and their runner are data of the primary unit, like globals and vtables.
+        int test_count =
+            ctx->cg.split_role == CODEGEN_UNIT_HEADER ? 0 : emit_tests_and_runner(ctx, kids);
 
-        ASTNode *iter = merged_funcs;
-        while (iter)
+        if (ctx->cg.split_role != CODEGEN_UNIT_HEADER)
         {
-            if (iter->type == NODE_IMPL)
-            {
-                char *sname = iter->impl.struct_name;
-                if (!sname)
-                {
-                    iter = iter->next;
-                    continue;
-                }
-
-                // Resolve opaque alias
-                const char *resolved = find_type_alias(ctx, sname);
-
-                char *mangled = replace_string_type(sname);
-                ASTNode *def = find_struct_def(ctx, mangled);
-                if (!def && resolved)
-                {
-                    zfree(mangled);
-                    mangled = replace_string_type(resolved);
-                    def = find_struct_def(ctx, mangled);
-                }
-                int skip = 0;
-                if (def)
-                {
-                    if (def->type == NODE_STRUCT && def->strct.is_template)
-                    {
-                        skip = 1;
-                    }
-                    else if (def->type == NODE_ENUM && def->enm.is_template)
-                    {
-                        skip = 1;
-                    }
-                }
-                else
-                {
-                    char *buf = strip_template_suffix(sname);
-                    if (buf)
-                    {
-                        def = find_struct_def(ctx, buf);
-                        if (def && def->strct.is_template)
-                        {
-                            skip = 1;
-                        }
-                        zfree(buf);
-                    }
-                }
-                if (mangled)
-                {
-                    zfree(mangled);
-                }
-                if (skip)
-                {
-                    iter = iter->next;
-                    continue;
-                }
-            }
-            if (iter->type == NODE_IMPL_TRAIT)
-            {
-                char *sname = iter->impl_trait.target_type;
-                if (!sname)
-                {
-                    iter = iter->next;
-                    continue;
-                }
-
-                char *mangled = replace_string_type(sname);
-                ASTNode *def = find_struct_def(ctx, mangled);
-                int skip = 0;
-                if (def)
-                {
-                    if (def->strct.is_template)
-                    {
-                        skip = 1;
-                    }
-                }
-                else
-                {
-                    char *buf = strip_template_suffix(sname);
-                    if (buf)
-                    {
-                        def = find_struct_def(ctx, buf);
-                        if (def && def->strct.is_template)
-                        {
-                            skip = 1;
-                        }
-                        zfree(buf);
-                    }
-                }
-                if (mangled)
-                {
-                    zfree(mangled);
-                }
-                if (skip)
-                {
-                    iter = iter->next;
-                    continue;
-                }
-            }
-            if (iter->cfg_condition)
-            {
-                EMIT(ctx, "#if %s\n", iter->cfg_condition);
-            }
-            codegen_node_single(ctx, iter);
-            if (iter->cfg_condition)
-            {
-                EMIT(ctx, "#endif\n");
-            }
-            iter = iter->next;
+            emit_function_bodies(ctx, merged_funcs);
         }
+        lazy_methods_mark(ctx, LAZY_AT_BODIES);
 
         int has_user_main = 0;
         ASTNode *chk = merged_funcs;
@@ -1235,6 +1470,7 @@ void codegen_c_program(ParserContext *ctx, ASTNode *node)
         {
             EMIT(ctx, "\n#ifdef __cplusplus\n}\n#endif\n");
         }
+        lazy_methods_end(ctx);
 
         // Clean up emitted content tracking list
         free_emitted_list(emitted_raw);
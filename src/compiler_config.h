@@ -57,6 +57,17 @@ typedef struct CompilerConfig
     int no_suppress_warnings;
     int warn_pedantic;
     int misra_mode;
+    int use_build_cache;  ///< Reuse binaries from the content-addressed build cache.
+    int jobs;             ///< Concurrent cc jobs for a split build (-j N); 0/1 keeps one unit.
+    int check_jobs;       ///< Processes type-checking function bodies in zc check (--check-jobs N).
+    int use_runtime_pch;  ///< Include a cached, precompiled runtime header (--no-pch clears it).
+    int comptime_cache;   ///< Reuse output of unchanged comptime blocks (--no-comptime-cache).
+    int use_lazy_methods; ///< Emit generic impl methods only when named (--no-lazy-methods clears).
+    int share_generics;   ///< Pointer instantiations share method bodies (--share-generics).
+    int use_fold;         ///< Fold constants and drop dead branches before codegen (--no-fold).
+    int use_jit;          ///< zc run: execute the program in memory through libtcc (--jit).
+    int time_passes;      ///< Print the per-phase timing table (--time-passes).
+    int mem_report;       ///< Print arena bytes per subsystem and top sites (--mem-report).
     uint64_t diag_mask;
 
     int keep_comments;
@@ -73,6 +84,9 @@ typedef struct CompilerConfig
 
     char *root_path;
     char *input_dir;
+    char *runtime_pch; ///< PCH passed to clang via -include-pch; gcc finds its .gch by itself.
+    char *trace_out;   ///< Chrome trace-event JSON written by --trace-out, or NULL.
+    char *deps_out;    ///< Make-style list of the files the build read (--emit-deps), or NULL.
     int std_locked;
     char std_root[MAX_PATH_SIZE];
     const char *backend_name;
@@ -4,6 +4,7 @@
 #include "constants.h"
 #include "parser.h"
 #include "lsp/cJSON.h"
+#include "utils/source_manager.h"
 #include <stdio.h>
 #include <stddef.h>
 
@@ -26,9 +27,10 @@ static CompilerConfig *diag_cfg(void)
 
 static const char *diag_filename(Token t)
 {
-    if (t.file)
+    const char *file = token_file(t);
+    if (file)
     {
-        return t.file;
+        return file;
     }
     return d_ctx.parser_ctx ? d_ctx.parser_ctx->current_filename : "unknown";
 }
@@ -52,7 +54,16 @@ static void diag_print_context(FILE *f, Token t, const char *caret_color)
     {
         return;
     }
+    // Tokens into a loaded file are placed by its line table; others (interpolated strings,
+    // generated code) only have their own line/col to go by.
     const char *line_start = t.start - (t.col - 1);
+    int line = t.line;
+    const SourceFile *sf = source_find(t.start);
+    if (sf)
+    {
+        line = source_line_of(sf, t.start, &line_start);
+    }
+    int col = (int)(t.start - line_start) + 1;
     const char *line_end = t.start;
     while (*line_end && *line_end != '\n')
     {
@@ -60,9 +71,9 @@ static void diag_print_context(FILE *f, Token t, const char *caret_color)
     }
     ptrdiff_t line_len = line_end - line_start;
     fprintf(f, COLOR_BLUE "   |\n" COLOR_RESET);
-    fprintf(f, COLOR_BLUE "%-3d| " COLOR_RESET "%.*s\n", t.line, (int)line_len, line_start);
+    fprintf(f, COLOR_BLUE "%-3d| " COLOR_RESET "%.*s\n", line, (int)line_len, line_start);
     fprintf(f, COLOR_BLUE "   | " COLOR_RESET);
-    for (int i = 0; i < t.col - 1; i++)
+    for (int i = 0; i < col - 1; i++)
     {
         fprintf(f, " ");
     }
@@ -0,0 +1,1318 @@
+// SPDX-License-Identifier: MIT
+#include "build_cache.h"
+#include "../parser/parser.h"
+#include "../constants.h"
+#include "../codegen/codegen.h"
+#include "../utils/utils.h"
+#include "../utils/cmd.h"
+#include "../utils/colors.h"
+#include "../platform/os.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#if !ZC_OS_WINDOWS
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#define BUILD_CACHE_MAGIC "zc-build-cache 3"
+
+// ----------------------------------------------------------------------------
+// Hashing
+// ----------------------------------------------------------------------------
+
+// 64-bit FNV-1a, the same family zmap uses for its 32-bit string hash.
+#define FNV64_OFFSET 14695981039346656037ull
+#define FNV64_PRIME 1099511628211ull
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= p[i];
+        h *= FNV64_PRIME;
+    }
+    return h;
+}
+
+// Strings are hashed with their terminator so that ("ab","c") and ("a","bc") differ.
+static uint64_t hash_str(uint64_t h, const char *s)
+{
+    if (!s)
+    {
+        s = "";
+    }
+    return hash_bytes(h, s, strlen(s) + 1);
+}
+
+static uint64_t hash_int(uint64_t h, int v)
+{
+    return hash_bytes(h, &v, sizeof(v));
+}
+
+static uint64_t hash_str_vec(uint64_t h, const zvec_Str *v)
+{
+    h = hash_int(h, (int)v->length);
+    for (size_t i = 0; i < v->length; i++)
+    {
+        h = hash_str(h, v->data[i]);
+    }
+    return h;
+}
+
+// Identifies the cc executable itself, not just its name: the size and mtime of the binary
+// the name resolves to on PATH. An upgraded compiler must not reuse binaries built by the old
+// one, and a PCH is only valid for the compiler that wrote it (clang rejects a foreign one).
+static uint64_t hash_tool(uint64_t h, const char *cc)
+{
+    char name[MAX_PATH_SIZE];
+    size_t n = strcspn(cc, " \t");
+    if (n == 0 || n >= sizeof(name))
+    {
+        return h;
+    }
+    memcpy(name, cc, n);
+    name[n] = '\0';
+
+    struct stat st;
+    int found = 0;
+    if (strchr(name, '/') || strchr(name, '\\'))
+    {
+        found = stat(name, &st) == 0;
+    }
+    else
+    {
+        const char *sep = z_is_windows() ? ";" : ":";
+        const char *dirs = getenv("PATH");
+        while (!found && dirs && *dirs)
+        {
+            size_t len = strcspn(dirs, sep);
+            char path[MAX_PATH_SIZE * 2];
+            snprintf(path, sizeof(path), "%.*s/%s%s", (int)len, dirs, name,
+                     z_is_windows() && !z_path_has_extension(name, ".exe") ? ".exe" : "");
+            found = len > 0 && stat(path, &st) == 0;
+            dirs += len + (dirs[len] != '\0');
+        }
+    }
+    if (found)
+    {
+        h = hash_bytes(h, &st.st_size, sizeof(st.st_size));
+        h = hash_bytes(h, &st.st_mtime, sizeof(st.st_mtime));
+    }
+    return h;
+}
+
+// `//>` directives may expand ${VAR}; the expansion is not visible in the file bytes,
+// so mix the current value of every referenced variable into the file hash.
+static uint64_t hash_directive_env(uint64_t h, const char *src, size_t len)
+{
+    const char *p = src;
+    const char *end = src + len;
+    while (p < end)
+    {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol)
+        {
+            eol = end;
+        }
+        if (eol - p >= 3 && p[0] == '/' && p[1] == '/' && p[2] == '>')
+        {
+            for (const char *q = p + 3; q + 1 < eol; q++)
+            {
+                if (q[0] != '$' || q[1] != '{')
+                {
+                    continue;
+                }
+                const char *close = memchr(q + 2, '}', (size_t)(eol - q - 2));
+                if (!close)
+                {
+                    break;
+                }
+                char name[MAX_VAR_NAME_LEN];
+                size_t n = (size_t)(close - (q + 2));
+                if (n < sizeof(name))
+                {
+                    memcpy(name, q + 2, n);
+                    name[n] = '\0';
+                    h = hash_str(h, name);
+                    h = hash_str(h, getenv(name));
+                }
+                q = close;
+            }
+        }
+        p = eol + 1;
+    }
+    return h;
+}
+
+// Returns 0 and leaves *out untouched if the file cannot be read.
+static int hash_file(const char *path, uint64_t *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    long l = ftell(f);
+    if (l < 0)
+    {
+        fclose(f);
+        return 0;
+    }
+    rewind(f);
+    char *buf = libc_malloc((size_t)l + 1);
+    if (!buf)
+    {
+        fclose(f);
+        return 0;
+    }
+    size_t got = fread(buf, 1, (size_t)l, f);
+    fclose(f);
+    if (got != (size_t)l)
+    {
+        libc_free(buf);
+        return 0;
+    }
+
+    uint64_t h = hash_bytes(FNV64_OFFSET, buf, got);
+    h = hash_directive_env(h, buf, got);
+    libc_free(buf);
+    *out = h;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+// Filesystem helpers
+// ----------------------------------------------------------------------------
+
+static int make_dir(const char *path)
+{
+#if ZC_OS_WINDOWS
+    return _mkdir(path);
+#else
+    return mkdir(path, 0755);
+#endif
+}
+
+static int ensure_dir(const char *path)
+{
+    char tmp[MAX_PATH_SIZE];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++)
+    {
+        if (*p == '/' || *p == '\\')
+        {
+            char saved = *p;
+            *p = '\0';
+            make_dir(tmp);
+            *p = saved;
+        }
+    }
+    int made = make_dir(tmp) == 0 || errno == EEXIST;
+    int err = errno;
+
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        return 1;
+    }
+    errno = made ? ENOTDIR : err;
+    return 0;
+}
+
+static int copy_file(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "rb");
+    if (!in)
+    {
+        return 0;
+    }
+    FILE *out = fopen(to, "wb");
+    if (!out)
+    {
+        fclose(in);
+        return 0;
+    }
+
+    char buf[65536];
+    size_t n;
+    int ok = 1;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+        if (fwrite(buf, 1, n, out) != n)
+        {
+            ok = 0;
+            break;
+        }
+    }
+    fclose(in);
+    if (fclose(out) != 0)
+    {
+        ok = 0;
+    }
+
+#if !ZC_OS_WINDOWS
+    struct stat st;
+    if (ok && stat(from, &st) == 0)
+    {
+        chmod(to, st.st_mode & 0777);
+    }
+#endif
+    return ok;
+}
+
+// Binaries live in <root>/build, runtime headers in <root>/runtime, output of comptime blocks
+// in <root>/comptime.
+static void resolve_cache_dir(char *out, size_t size, const char *sub)
+{
+    const char *env = getenv("ZC_CACHE_DIR");
+    if (env && env[0])
+    {
+        snprintf(out, size, "%s/%s", env, sub);
+        return;
+    }
+
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && xdg[0])
+    {
+        snprintf(out, size, "%s/zenc/%s", xdg, sub);
+        return;
+    }
+
+    const char *home = getenv("HOME");
+#if ZC_OS_WINDOWS
+    if (!home)
+    {
+        home = getenv("LOCALAPPDATA");
+    }
+#endif
+    if (home && home[0])
+    {
+        snprintf(out, size, "%s/.cache/zenc/%s", home, sub);
+        return;
+    }
+
+    snprintf(out, size, "%s/zenc-cache/%s", z_get_temp_dir(), sub);
+}
+
+// ----------------------------------------------------------------------------
+// Lookup / store
+// ----------------------------------------------------------------------------
+
+void build_cache_init(BuildCache *cache, ZenCompiler *compiler)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->saved_stderr = -1;
+    CompilerConfig *cfg = &compiler->config;
+
+    if (!cfg->use_build_cache || cfg->mode_check || cfg->mode_doc || cfg->mode_transpile ||
+        cfg->emit_c)
+    {
+        return;
+    }
+    const CodegenBackend *backend = codegen_get_backend(cfg->backend_name);
+    if (backend && !backend->needs_cc)
+    {
+        return;
+    }
+
+    char abs_input[MAX_PATH_LEN];
+    z_get_absolute_path(cfg->input_file, abs_input, sizeof(abs_input));
+
+    uint64_t h = hash_str(FNV64_OFFSET, BUILD_CACHE_MAGIC);
+    h = hash_str(h, ZEN_VERSION);
+    h = hash_str(h, abs_input);
+    h = hash_str(h, cfg->cc);
+    h = hash_tool(h, cfg->cc);
+    h = hash_str(h, cfg->gcc_flags);
+    h = hash_str(h, compiler->cflags);
+    h = hash_str(h, compiler->link_flags);
+    h = hash_str(h, cfg->backend_name ? cfg->backend_name : "c");
+    h = hash_str_vec(h, &cfg->backend_opts);
+    h = hash_str_vec(h, &cfg->cfg_defines);
+    h = hash_str_vec(h, &cfg->include_paths);
+    h = hash_str_vec(h, &cfg->extra_files);
+    h = hash_str(h, cfg->root_path);
+    h = hash_int(h, cfg->mode_debug);
+    h = hash_int(h, cfg->use_cpp);
+    h = hash_int(h, cfg->use_cuda);
+    h = hash_int(h, cfg->use_objc);
+    h = hash_int(h, cfg->is_freestanding);
+    h = hash_int(h, cfg->misra_mode);
+    h = hash_int(h, cfg->use_typecheck);
+    h = hash_int(h, cfg->no_suppress_warnings);
+    h = hash_int(h, cfg->use_lazy_methods);
+    h = hash_int(h, cfg->share_generics);
+    h = hash_int(h, cfg->use_fold);
+
+    cache->key = h;
+    resolve_cache_dir(cache->dir, sizeof(cache->dir), "build");
+    snprintf(cache->bin_path, sizeof(cache->bin_path), "%s/%016llx.bin", cache->dir,
+             (unsigned long long)h);
+    snprintf(cache->manifest_path, sizeof(cache->manifest_path), "%s/%016llx.manifest",
+             cache->dir, (unsigned long long)h);
+    snprintf(cache->log_path, sizeof(cache->log_path), "%s/%016llx.log", cache->dir,
+             (unsigned long long)h);
+    cache->enabled = 1;
+}
+
+static void report(const ZenCompiler *compiler, const BuildCache *cache, const char *what,
+                   const char *why)
+{
+    if (!compiler->config.verbose)
+    {
+        return;
+    }
+    printf(COLOR_BOLD COLOR_CYAN "       Cache" COLOR_RESET " %s %016llx", what,
+           (unsigned long long)cache->key);
+    if (why)
+    {
+        printf(" (%s)", why);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int build_cache_lookup(BuildCache *cache, ZenCompiler *compiler, const char *outfile)
+{
+    if (!cache->enabled)
+    {
+        return 0;
+    }
+
+    FILE *mf = fopen(cache->manifest_path, "r");
+    if (!mf)
+    {
+        report(compiler, cache, "miss", "no entry");
+        return 0;
+    }
+
+    char line[MAX_PATH_LEN + 64];
+    int valid = fgets(line, sizeof(line), mf) && strncmp(line, BUILD_CACHE_MAGIC, 16) == 0;
+    const char *why = valid ? NULL : "bad manifest";
+    int deps = 0;
+    int warnings = 0;
+
+    while (valid && fgets(line, sizeof(line), mf))
+    {
+        size_t n = strlen(line);
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+        {
+            line[--n] = '\0';
+        }
+        unsigned long long recorded = 0;
+        int path_off = 0;
+        if (sscanf(line, "warnings %d", &warnings) == 1)
+        {
+            continue;
+        }
+        if ((sscanf(line, "dep %16llx %n", &recorded, &path_off) != 1 &&
+             sscanf(line, "header %16llx %n", &recorded, &path_off) != 1) ||
+            path_off == 0)
+        {
+            continue;
+        }
+
+        uint64_t now = 0;
+        if (!hash_file(line + path_off, &now) || now != recorded)
+        {
+            valid = 0;
+            why = "source changed";
+            if (compiler->config.verbose)
+            {
+                printf(COLOR_BOLD COLOR_CYAN "       Cache" COLOR_RESET " changed: %s\n",
+                       line + path_off);
+            }
+        }
+        deps++;
+    }
+    fclose(mf);
+
+    if (valid && deps == 0)
+    {
+        valid = 0;
+        why = "empty manifest";
+    }
+    if (valid && !copy_file(cache->bin_path, outfile))
+    {
+        valid = 0;
+        why = "missing binary";
+    }
+
+    report(compiler, cache, valid ? "hit" : "miss", why);
+    if (valid)
+    {
+        // Print what the stored build printed, as a build without the cache would.
+        FILE *log = fopen(cache->log_path, "rb");
+        if (log)
+        {
+            char buf[4096];
+            size_t n;
+            fflush(stdout);
+            while ((n = fread(buf, 1, sizeof(buf) - 1, log)) > 0)
+            {
+                buf[n] = '\0';
+                fprintf(stderr, "%s", buf);
+            }
+            fclose(log);
+        }
+        compiler->warning_count += warnings;
+    }
+    return valid;
+}
+
+// ----------------------------------------------------------------------------
+// Diagnostics of the stored build
+// ----------------------------------------------------------------------------
+
+#if !ZC_OS_WINDOWS
+
+// The capture in progress, given back at exit if the build stops early (errors, zpanic).
+static BuildCache *g_capturing;
+
+static void end_capture_at_exit(void)
+{
+    if (g_capturing)
+    {
+        build_cache_capture_end(g_capturing);
+    }
+}
+
+void build_cache_capture(BuildCache *cache)
+{
+    static int registered;
+    if (!cache->enabled || cache->log || g_capturing)
+    {
+        return;
+    }
+    fflush(stderr);
+    cache->log = tmpfile();
+    cache->saved_stderr = cache->log ? dup(2) : -1;
+    if (cache->saved_stderr < 0 || dup2(fileno(cache->log), 2) < 0)
+    {
+        if (cache->saved_stderr >= 0)
+        {
+            close(cache->saved_stderr);
+        }
+        if (cache->log)
+        {
+            fclose(cache->log);
+        }
+        cache->log = NULL;
+        cache->saved_stderr = -1;
+        return;
+    }
+    // Keep the colors the real stderr gets; the log is replayed through fprintf, which strips
+    // them again when a later build prints to something that is not a terminal.
+    zcolors_assume_tty(2, zcolors_is_tty(cache->saved_stderr));
+    cache->log_echoed = 0;
+    cache->log_warnings = g_warning_count;
+    g_capturing = cache;
+    if (!registered)
+    {
+        registered = 1;
+        atexit(end_capture_at_exit);
+    }
+}
+
+void build_cache_capture_echo(BuildCache *cache)
+{
+    if (!cache->log || cache->saved_stderr < 0)
+    {
+        return;
+    }
+    fflush(stderr);
+    long end = lseek(2, 0, SEEK_CUR);
+    char buf[4096];
+    while (cache->log_echoed < end)
+    {
+        size_t want = (size_t)(end - cache->log_echoed);
+        ssize_t n = pread(fileno(cache->log), buf, want < sizeof(buf) ? want : sizeof(buf),
+                          cache->log_echoed);
+        if (n <= 0 || write(cache->saved_stderr, buf, (size_t)n) != n)
+        {
+            break;
+        }
+        cache->log_echoed += n;
+    }
+}
+
+void build_cache_capture_end(BuildCache *cache)
+{
+    if (!cache->log || cache->saved_stderr < 0)
+    {
+        return;
+    }
+    build_cache_capture_echo(cache);
+    dup2(cache->saved_stderr, 2);
+    close(cache->saved_stderr);
+    cache->saved_stderr = -1;
+    zcolors_assume_tty(2, -1);
+    cache->log_warnings = g_warning_count - cache->log_warnings;
+    g_capturing = NULL;
+}
+
+#else
+
+void build_cache_capture(BuildCache *cache)
+{
+    (void)cache;
+}
+
+void build_cache_capture_echo(BuildCache *cache)
+{
+    (void)cache;
+}
+
+void build_cache_capture_end(BuildCache *cache)
+{
+    (void)cache;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Headers read by cc
+// ----------------------------------------------------------------------------
+
+// Headers reached through other headers or `raw { #include }` blocks never pass through the
+// parser; cc lists them in a make-style rule, as ccache has it do.
+
+// The entry whose rule files are on disk, removed at exit if the build stops before the store.
+static BuildCache *g_dep_owner;
+
+static void remove_dep_files(BuildCache *cache)
+{
+    for (int i = 0; i < cache->dep_file_count; i++)
+    {
+        remove(cache->dep_files[i]);
+        zfree(cache->dep_files[i]);
+    }
+    zfree(cache->dep_files);
+    cache->dep_files = NULL;
+    cache->dep_file_count = 0;
+    if (g_dep_owner == cache)
+    {
+        g_dep_owner = NULL;
+    }
+}
+
+static void remove_dep_files_at_exit(void)
+{
+    if (g_dep_owner)
+    {
+        remove_dep_files(g_dep_owner);
+    }
+}
+
+static void print_cc_command(const ArgList *args)
+{
+    printf(COLOR_BOLD COLOR_BLUE "     Command" COLOR_RESET);
+    for (size_t i = 0; i < args->count; i++)
+    {
+        printf(" %s", args->args[i]);
+    }
+    printf("\n");
+}
+
+// Name for one more rule file, or NULL (and the headers unknown) if it has nowhere to go.
+static const char *new_dep_file(BuildCache *cache)
+{
+    static int registered;
+    if (!ensure_dir(cache->dir))
+    {
+        cache->deps_unknown = 1;
+        return NULL;
+    }
+    char path[MAX_PATH_SIZE + 64];
+    snprintf(path, sizeof(path), "%s/%016llx.%d.%d.d", cache->dir, (unsigned long long)cache->key,
+             z_get_pid(), cache->dep_file_count);
+    // A file left by a crashed process with the same pid must not pass for this build's.
+    remove(path);
+
+    cache->dep_files =
+        xrealloc(cache->dep_files, sizeof(char *) * (size_t)(cache->dep_file_count + 1));
+    cache->dep_files[cache->dep_file_count] = xstrdup(path);
+    g_dep_owner = cache;
+    if (!registered)
+    {
+        registered = 1;
+        atexit(remove_dep_files_at_exit);
+    }
+    return cache->dep_files[cache->dep_file_count++];
+}
+
+void build_cache_dep_flags(BuildCache *cache, ArgList *args)
+{
+    if (!cache->enabled)
+    {
+        return;
+    }
+    const char *path = new_dep_file(cache);
+    if (path)
+    {
+        arg_list_add(args, "-MD");
+        arg_list_add(args, "-MF");
+        arg_list_add(args, path);
+    }
+}
+
+void build_cache_scan_deps(BuildCache *cache, ZenCompiler *compiler, const char *source)
+{
+    if (!cache->enabled || cache->deps_unknown)
+    {
+        return;
+    }
+    // tcc only writes the rule as a side effect of compiling (-MD).
+    if (z_path_match_compiler(compiler->config.cc, "tcc"))
+    {
+        cache->deps_unknown = 1;
+        return;
+    }
+    const char *path = new_dep_file(cache);
+    if (!path)
+    {
+        return;
+    }
+
+    ArgList args;
+    arg_list_init(&args);
+    build_deps_arg_list(&args, path, source, &compiler->config);
+    if (compiler->config.verbose)
+    {
+        print_cc_command(&args);
+    }
+    if (arg_run(&args) != 0)
+    {
+        cache->deps_unknown = 1;
+    }
+    arg_list_free(&args);
+}
+
+// Next word of a make rule, with `\ `, `\#` and `$$` unescaped and `\`-newline taken as a
+// space. Returns 0 at the end of the file.
+static int read_dep_word(FILE *f, char *out, size_t size)
+{
+    int c;
+    do
+    {
+        c = fgetc(f);
+        if (c == '\\')
+        {
+            int next = fgetc(f);
+            if (next == '\n' || next == '\r')
+            {
+                c = ' ';
+                continue;
+            }
+            ungetc(next, f);
+            break;
+        }
+    } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+
+    size_t n = 0;
+    while (c != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r')
+    {
+        if (c == '\\')
+        {
+            int next = fgetc(f);
+            if (next == ' ' || next == '#' || next == '\\')
+            {
+                c = next;
+            }
+            else if (next == '\n' || next == '\r' || next == EOF)
+            {
+                break;
+            }
+            else
+            {
+                ungetc(next, f);
+            }
+        }
+        else if (c == '$')
+        {
+            int next = fgetc(f);
+            if (next != '$')
+            {
+                ungetc(next, f);
+            }
+        }
+        if (n + 1 < size)
+        {
+            out[n++] = (char)c;
+        }
+        c = fgetc(f);
+    }
+    out[n] = '\0';
+    return n > 0;
+}
+
+void build_cache_for_each_dep(const BuildCache *cache, void (*fn)(const char *path, void *arg),
+                              void *arg)
+{
+    FILE *mf = fopen(cache->manifest_path, "r");
+    if (!mf)
+    {
+        return;
+    }
+    char line[MAX_PATH_LEN + 64];
+    while (fgets(line, sizeof(line), mf))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        unsigned long long recorded = 0;
+        int path_off = 0;
+        if (sscanf(line, "dep %16llx %n", &recorded, &path_off) == 1 && path_off > 0)
+        {
+            fn(line + path_off, arg);
+        }
+    }
+    fclose(mf);
+}
+
+// `dep` lines name files the build read itself, `header` lines the headers only cc read; both
+// are re-hashed on lookup, but --emit-deps after a hit only lists the former, as the build does.
+static void manifest_add(FILE *mf, zmap_FileSet *seen, const char *kind, const char *path,
+                         ZenCompiler *compiler)
+{
+    char abs_path[MAX_PATH_LEN];
+    z_get_absolute_path(path, abs_path, sizeof(abs_path));
+    if (zmap_get(seen, abs_path))
+    {
+        return;
+    }
+    char *key = xstrdup(abs_path);
+    zmap_put(seen, key, key);
+    uint64_t h = 0;
+    if (!hash_file(abs_path, &h))
+    {
+        // A dependency we cannot read back would make every later lookup miss anyway.
+        if (compiler->config.verbose)
+        {
+            printf(COLOR_BOLD COLOR_CYAN "       Cache" COLOR_RESET " cannot hash %s\n", path);
+        }
+        return;
+    }
+    fprintf(mf, "%s %016llx %s\n", kind, (unsigned long long)h, abs_path);
+}
+
+// Adds what the rule in @p dep_file lists. Returns 0 if cc did not write it.
+static int manifest_add_rule(FILE *mf, zmap_FileSet *seen, const char *dep_file,
+                             ZenCompiler *compiler)
+{
+    FILE *f = fopen(dep_file, "r");
+    if (!f)
+    {
+        return 0;
+    }
+    char word[MAX_PATH_LEN];
+    while (read_dep_word(f, word, sizeof(word)))
+    {
+        size_t n = strlen(word);
+        struct stat st;
+        // Targets end in ':'; generated sources and split headers are already gone.
+        if (word[n - 1] == ':' || stat(word, &st) != 0)
+        {
+            continue;
+        }
+        manifest_add(mf, seen, "header", word, compiler);
+    }
+    fclose(f);
+    return 1;
+}
+
+static void store_entry(BuildCache *cache, ParserContext *ctx, const char *outfile)
+{
+    ZenCompiler *compiler = ctx->compiler;
+    if (!ensure_dir(cache->dir))
+    {
+        report(compiler, cache, "store skipped", "cannot create cache directory");
+        return;
+    }
+    // The user's C files still exist; their headers are listed now.
+    for (size_t i = 0; i < compiler->config.c_files.length; i++)
+    {
+        build_cache_scan_deps(cache, compiler, compiler->config.c_files.data[i]);
+    }
+    if (cache->deps_unknown)
+    {
+        report(compiler, cache, "store skipped", "cc cannot list the headers it read");
+        return;
+    }
+
+    // Write under a pid-unique name and rename, so concurrent CI jobs sharing a cache
+    // directory never observe a half-written entry.
+    char tmp_bin[MAX_PATH_SIZE + 64];
+    char tmp_manifest[MAX_PATH_SIZE + 64];
+    snprintf(tmp_bin, sizeof(tmp_bin), "%s.%d.tmp", cache->bin_path, z_get_pid());
+    snprintf(tmp_manifest, sizeof(tmp_manifest), "%s.%d.tmp", cache->manifest_path,
+             z_get_pid());
+
+    if (!copy_file(outfile, tmp_bin))
+    {
+        remove(tmp_bin);
+        report(compiler, cache, "store skipped", "cannot copy output");
+        return;
+    }
+
+    // The log goes in place before the binary and manifest; a stale one left by a failed store
+    // is overwritten by the next successful one.
+    char tmp_log[MAX_PATH_SIZE + 64];
+    snprintf(tmp_log, sizeof(tmp_log), "%s.%d.tmp", cache->log_path, z_get_pid());
+    FILE *lf = fopen(tmp_log, "wb");
+    int log_ok = lf != NULL;
+    if (lf && cache->log)
+    {
+        char buf[4096];
+        size_t n;
+        rewind(cache->log);
+        while ((n = fread(buf, 1, sizeof(buf), cache->log)) > 0)
+        {
+            log_ok = log_ok && fwrite(buf, 1, n, lf) == n;
+        }
+    }
+    if (lf)
+    {
+        log_ok = fclose(lf) == 0 && log_ok;
+    }
+    if (!log_ok || rename(tmp_log, cache->log_path) != 0)
+    {
+        remove(tmp_log);
+        remove(tmp_bin);
+        report(compiler, cache, "store skipped", "cannot write diagnostics");
+        return;
+    }
+
+    FILE *mf = fopen(tmp_manifest, "w");
+    if (!mf)
+    {
+        remove(tmp_bin);
+        return;
+    }
+    fprintf(mf, "%s\n", BUILD_CACHE_MAGIC);
+    fprintf(mf, "warnings %d\n", cache->log ? cache->log_warnings : 0);
+    zmap_FileSet seen = zmap_init(FileSet, zmap_hash_cstr, zmap_cmp_cstr);
+    manifest_add(mf, &seen, "dep", compiler->config.input_file, compiler);
+
+    zmap_iter_FileSet it = zmap_iter_init(FileSet, &ctx->imports.imported_files);
+    const char *key;
+    const char *val;
+    while (zmap_iter_next(&it, &key, &val))
+    {
+        if (key)
+        {
+            manifest_add(mf, &seen, "dep", key, compiler);
+        }
+    }
+    for (size_t i = 0; i < compiler->config.c_files.length; i++)
+    {
+        manifest_add(mf, &seen, "dep", compiler->config.c_files.data[i], compiler);
+    }
+    int rules_ok = 1;
+    for (int i = 0; i < cache->dep_file_count; i++)
+    {
+        rules_ok = manifest_add_rule(mf, &seen, cache->dep_files[i], compiler) && rules_ok;
+    }
+    zmap_free(&seen);
+    fclose(mf);
+    if (!rules_ok)
+    {
+        remove(tmp_bin);
+        remove(tmp_manifest);
+        report(compiler, cache, "store skipped", "cc did not list the headers it read");
+        return;
+    }
+
+    // The binary must land before the manifest that vouches for it.
+    if (rename(tmp_bin, cache->bin_path) != 0 || rename(tmp_manifest, cache->manifest_path) != 0)
+    {
+        remove(tmp_bin);
+        remove(tmp_manifest);
+        report(compiler, cache, "store skipped", "rename failed");
+        return;
+    }
+    report(compiler, cache, "stored", NULL);
+}
+
+void build_cache_store(BuildCache *cache, ParserContext *ctx, const char *outfile)
+{
+    if (!cache->enabled)
+    {
+        return;
+    }
+    build_cache_capture_end(cache);
+    store_entry(cache, ctx, outfile);
+    remove_dep_files(cache);
+}
+
+// ----------------------------------------------------------------------------
+// Precompiled runtime header
+// ----------------------------------------------------------------------------
+
+#define RUNTIME_HEADER_MAGIC "zc-runtime-header 1"
+
+// The header is only ever created, never rewritten: clang refuses a PCH whose header changed
+// after it was built, even to identical content. Sets errno on failure.
+static int write_runtime_header(const char *path, const char *text)
+{
+    if (access(path, F_OK) == 0)
+    {
+        return 1;
+    }
+    char tmp[MAX_PATH_SIZE + 128];
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, z_get_pid());
+    FILE *f = fopen(tmp, "w");
+    if (!f)
+    {
+        return 0;
+    }
+    int ok = fputs(text, f) >= 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || (access(path, F_OK) != 0 && rename(tmp, path) != 0))
+    {
+        int err = errno;
+        remove(tmp);
+        if (access(path, F_OK) == 0)
+        {
+            return 1;
+        }
+        errno = err;
+        return 0;
+    }
+    remove(tmp);
+    return 1;
+}
+
+// 1 on success, 0 if cc failed, -1 with errno set if the result could not be renamed into place.
+static int precompile_runtime_header(ZenCompiler *compiler, const char *header, const char *pch)
+{
+    char tmp[MAX_PATH_SIZE + 128];
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", pch, z_get_pid());
+
+    ArgList args;
+    arg_list_init(&args);
+    build_pch_arg_list(&args, tmp, header, &compiler->config);
+    if (compiler->config.verbose)
+    {
+        print_cc_command(&args);
+    }
+    int ret = arg_run(&args);
+    arg_list_free(&args);
+
+    if (ret != 0)
+    {
+        remove(tmp);
+        return 0;
+    }
+    if (rename(tmp, pch) != 0)
+    {
+        int err = errno;
+        remove(tmp);
+        errno = err;
+        return -1;
+    }
+    return 1;
+}
+
+int build_cache_runtime_header(ParserContext *ctx, char *out, size_t size)
+{
+    ZenCompiler *compiler = ctx->compiler;
+    CompilerConfig *cfg = &compiler->config;
+    cfg->runtime_pch = NULL;
+
+    if (!cfg->use_runtime_pch || cfg->mode_transpile || cfg->emit_c || cfg->use_cpp ||
+        cfg->use_cuda || cfg->use_objc || cfg->is_freestanding || cfg->misra_mode)
+    {
+        return 0;
+    }
+    const CodegenBackend *backend = codegen_get_backend(cfg->backend_name);
+    if (!backend || strcmp(backend->name, "c") != 0)
+    {
+        return 0;
+    }
+
+    // gcc looks for <header>.gch next to an #included header by itself; clang only uses a PCH
+    // passed with -include-pch. Other compilers keep the inline preamble.
+    int is_clang = z_path_match_compiler(cfg->cc, "clang");
+    if (!is_clang && !z_path_match_compiler(cfg->cc, "gcc"))
+    {
+        return 0;
+    }
+
+    Emitter saved = ctx->cg.emitter;
+    emitter_init_buffer(&ctx->cg.emitter);
+    emit_runtime_header(ctx);
+    char *text = emitter_take_string(&ctx->cg.emitter);
+    ctx->cg.emitter = saved;
+    if (!text)
+    {
+        return 0;
+    }
+
+    // Hash the precompile command with placeholder paths so the key does not depend on where
+    // the cache lives.
+    ArgList probe;
+    arg_list_init(&probe);
+    build_pch_arg_list(&probe, "zc_runtime.pch", "zc_runtime.h", cfg);
+    uint64_t h = hash_str(FNV64_OFFSET, RUNTIME_HEADER_MAGIC);
+    h = hash_str(h, ZEN_VERSION);
+    h = hash_str(h, text);
+    for (size_t i = 0; i < probe.count; i++)
+    {
+        h = hash_str(h, probe.args[i]);
+    }
+    arg_list_free(&probe);
+    h = hash_tool(h, cfg->cc);
+
+    char dir[MAX_PATH_SIZE];
+    resolve_cache_dir(dir, sizeof(dir), "runtime");
+    char header[MAX_PATH_SIZE + 32];
+    char pch[MAX_PATH_SIZE + 48];
+    char stamp[MAX_PATH_SIZE + 48];
+    snprintf(header, sizeof(header), "%s/zc_runtime-%016llx.h", dir, (unsigned long long)h);
+    snprintf(pch, sizeof(pch), "%s%s", header, is_clang ? ".pch" : ".gch");
+    snprintf(stamp, sizeof(stamp), "%s.failed", header);
+
+    // A stamp records that this cc/flags combination cannot precompile the header, so later
+    // builds do not pay for a second failing cc run. Failing to write the cache directory says
+    // nothing about cc and leaves no stamp.
+    const char *state = "reused";
+    const char *failed_path = NULL;
+    int err = 0;
+    int ok = access(stamp, F_OK) != 0;
+    if (!ok)
+    {
+        state = "skipped, cc could not precompile it before";
+    }
+    else if (access(pch, F_OK) != 0)
+    {
+        state = "precompiled";
+        int ret = 0;
+        if (!ensure_dir(dir))
+        {
+            failed_path = dir;
+        }
+        else if (!write_runtime_header(header, text))
+        {
+            failed_path = header;
+        }
+        else if ((ret = precompile_runtime_header(compiler, header, pch)) < 0)
+        {
+            failed_path = pch;
+        }
+        err = errno;
+        ok = ret > 0;
+        if (!ok && !failed_path)
+        {
+            FILE *f = fopen(stamp, "w");
+            if (f)
+            {
+                fclose(f);
+            }
+            state = "skipped, cc could not precompile it";
+        }
+    }
+    zfree(text);
+
+    if (cfg->verbose)
+    {
+        char why[MAX_PATH_SIZE + 256];
+        if (failed_path)
+        {
+            snprintf(why, sizeof(why), "skipped, cannot write %s: %s", failed_path, strerror(err));
+            state = why;
+        }
+        printf(COLOR_BOLD COLOR_CYAN "       Cache" COLOR_RESET " runtime header %016llx (%s)\n",
+               (unsigned long long)h, state);
+        fflush(stdout);
+    }
+    if (!ok)
+    {
+        return 0;
+    }
+    snprintf(out, size, "%s", header);
+    if (is_clang)
+    {
+        cfg->runtime_pch = xstrdup(pch);
+    }
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+// Comptime block output
+// ----------------------------------------------------------------------------
+
+#define COMPTIME_OUTPUT_MAGIC 0x5443435au // "ZCCT"
+
+// On-disk layout: this header, then `len` bytes of yielded source.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t len;
+    uint64_t key; ///< Same key as the file name, checked against truncated writes.
+} ComptimeOutputHeader;
+
+// The interpreter's key of a block, mixed with the zc version since lowering may change.
+static uint64_t comptime_output_file(uint64_t block_key, char *dir, size_t dir_size, char *file,
+                                     size_t file_size)
+{
+    uint64_t h = hash_str(FNV64_OFFSET, "zc-comptime-output");
+    h = hash_str(h, ZEN_VERSION);
+    h = hash_bytes(h, &block_key, sizeof(block_key));
+    resolve_cache_dir(dir, dir_size, "comptime");
+    snprintf(file, file_size, "%s/%016llx.ct", dir, (unsigned long long)h);
+    return h;
+}
+
+char *build_cache_comptime_lookup(ParserContext *ctx, uint64_t block_key)
+{
+    if (!ctx->config->comptime_cache)
+    {
+        return NULL;
+    }
+    char dir[MAX_PATH_SIZE];
+    char file[MAX_PATH_SIZE + 32];
+    uint64_t key = comptime_output_file(block_key, dir, sizeof(dir), file, sizeof(file));
+
+    FILE *f = fopen(file, "rb");
+    if (!f)
+    {
+        return NULL;
+    }
+    ComptimeOutputHeader hdr;
+    char *out = NULL;
+    if (fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == COMPTIME_OUTPUT_MAGIC &&
+        hdr.key == key)
+    {
+        out = xmalloc((size_t)hdr.len + 1);
+        // One byte more than recorded must hit end of file.
+        if (fread(out, 1, (size_t)hdr.len + 1, f) != hdr.len)
+        {
+            zfree(out);
+            out = NULL;
+        }
+        else
+        {
+            out[hdr.len] = '\0';
+        }
+    }
+    fclose(f);
+    return out;
+}
+
+void build_cache_comptime_store(ParserContext *ctx, uint64_t block_key, const char *output)
+{
+    size_t len = strlen(output);
+    if (!ctx->config->comptime_cache || len >= UINT32_MAX)
+    {
+        return;
+    }
+    char dir[MAX_PATH_SIZE];
+    char file[MAX_PATH_SIZE + 32];
+    uint64_t key = comptime_output_file(block_key, dir, sizeof(dir), file, sizeof(file));
+    if (!ensure_dir(dir))
+    {
+        return;
+    }
+    char tmp[MAX_PATH_SIZE + 64];
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", file, z_get_pid());
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
+    {
+        return;
+    }
+    ComptimeOutputHeader hdr = {COMPTIME_OUTPUT_MAGIC, (uint32_t)len, key};
+    int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 && fwrite(output, 1, len, f) == len;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, file) != 0)
+    {
+        remove(tmp);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// `zc cache` subcommand
+// ----------------------------------------------------------------------------
+
+static int is_cache_entry(const char *name)
+{
+    return z_path_has_extension(name, ".bin") || z_path_has_extension(name, ".manifest") ||
+           z_path_has_extension(name, ".tmp") || z_path_has_extension(name, ".h") ||
+           z_path_has_extension(name, ".gch") || z_path_has_extension(name, ".pch") ||
+           z_path_has_extension(name, ".failed") || z_path_has_extension(name, ".ct") ||
+           z_path_has_extension(name, ".log") || z_path_has_extension(name, ".d");
+}
+
+static int clean_dir(const char *dir)
+{
+    int removed = 0;
+    char path[MAX_PATH_SIZE + 256];
+#if ZC_OS_WINDOWS
+    char pattern[MAX_PATH_SIZE + 8];
+    snprintf(pattern, sizeof(pattern), "%s/*", dir);
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(pattern, &fd);
+    if (h == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+    do
+    {
+        if (is_cache_entry(fd.cFileName))
+        {
+            snprintf(path, sizeof(path), "%s/%s", dir, fd.cFileName);
+            removed += remove(path) == 0;
+        }
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        return 0;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL)
+    {
+        if (is_cache_entry(ent->d_name))
+        {
+            snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+            removed += remove(path) == 0;
+        }
+    }
+    closedir(d);
+#endif
+    return removed;
+}
+
+int build_cache_command(int argc, char **argv)
+{
+    char dir[MAX_PATH_SIZE];
+    resolve_cache_dir(dir, sizeof(dir), "build");
+
+    if (argc < 1 || strcmp(argv[0], "dir") == 0)
+    {
+        printf("%s\n", dir);
+        return 0;
+    }
+    if (strcmp(argv[0], "clean") == 0)
+    {
+        char runtime_dir[MAX_PATH_SIZE];
+        char comptime_dir[MAX_PATH_SIZE];
+        resolve_cache_dir(runtime_dir, sizeof(runtime_dir), "runtime");
+        resolve_cache_dir(comptime_dir, sizeof(comptime_dir), "comptime");
+        int removed = clean_dir(dir) + clean_dir(runtime_dir) + clean_dir(comptime_dir);
+        printf(COLOR_BOLD COLOR_GREEN "     Removed" COLOR_RESET
+                                      " %d cache files from %s, %s and %s\n",
+               removed, dir, runtime_dir, comptime_dir);
+        return 0;
+    }
+
+    fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET ": unknown cache command '%s'\n",
+            argv[0]);
+    print_command_help("cache");
+    return 1;
+}
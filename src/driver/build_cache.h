@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef ZC_ALLOW_INTERNAL
+#error "driver/build_cache.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#ifndef BUILD_CACHE_H
+#define BUILD_CACHE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "../compiler.h"
+#include "../utils/cmd.h"
+
+struct ParserContext;
+
+/**
+ * @brief Content-addressed cache of finished binaries.
+ *
+ * The key is computed before parsing from everything known up front (input path,
+ * cc, flags, backend, defines, zc version). The set of transitively imported files
+ * is only known after parsing, so it is recorded in a manifest next to the stored
+ * binary and re-hashed on lookup, together with every header cc reported reading.
+ */
+typedef struct BuildCache
+{
+    int enabled;                            ///< 1 if this invocation may read/write the cache.
+    uint64_t key;                           ///< Hash of the configuration-level inputs.
+    char dir[MAX_PATH_SIZE];                ///< Cache directory (created on first store).
+    char bin_path[MAX_PATH_SIZE + 32];      ///< Stored binary for this key.
+    char manifest_path[MAX_PATH_SIZE + 32]; ///< Dependency manifest for this key.
+    char log_path[MAX_PATH_SIZE + 32];      ///< Diagnostics printed by the stored build.
+    FILE *log;        ///< stderr of the build being captured (see build_cache_capture()).
+    int saved_stderr; ///< The real stderr while capturing, else -1.
+    long log_echoed;  ///< Bytes of log already copied to the real stderr.
+    int log_warnings; ///< Warnings counted while capturing.
+    char **dep_files;   ///< Make-style rules cc writes the headers it read to.
+    int dep_file_count; ///< Entries in dep_files.
+    int deps_unknown;   ///< 1 if some cc command could not list its headers.
+} BuildCache;
+
+/**
+ * @brief Resolve the cache directory and compute the configuration key.
+ *
+ * Leaves `cache->enabled` at 0 for modes whose output is not a cc-built artifact
+ * (check, doc, transpile, --emit-c, non-C backends).
+ */
+void build_cache_init(BuildCache *cache, ZenCompiler *compiler);
+
+/**
+ * @brief Look up a stored binary whose recorded dependencies are all unchanged.
+ *
+ * On a hit the binary is copied to @p outfile, and the diagnostics the stored build printed are
+ * printed again and added to the warning count.
+ * @return 1 on hit, 0 on miss.
+ */
+int build_cache_lookup(BuildCache *cache, ZenCompiler *compiler, const char *outfile);
+
+/**
+ * @brief Call @p fn with each absolute path in the manifest of the entry for @p cache.
+ *
+ * After a hit this is the file set the stored binary was built from, without the headers only
+ * cc read.
+ */
+void build_cache_for_each_dep(const BuildCache *cache, void (*fn)(const char *path, void *arg),
+                              void *arg);
+
+/**
+ * @brief Record what the build after a miss prints on stderr, for build_cache_store().
+ *
+ * Output still reaches the terminal: it is copied over by build_cache_capture_echo() and when
+ * the capture ends. Does nothing when the cache is disabled, and on Windows.
+ */
+void build_cache_capture(BuildCache *cache);
+
+/**
+ * @brief Copy what was captured since the last call to the real stderr.
+ */
+void build_cache_capture_echo(BuildCache *cache);
+
+/**
+ * @brief Give stderr back. Call before running the program that was built.
+ */
+void build_cache_capture_end(BuildCache *cache);
+
+/**
+ * @brief Have the cc command in @p args, which compiles one source, list the headers it
+ * reads for the manifest (`-MD -MF`).
+ */
+void build_cache_dep_flags(BuildCache *cache, ArgList *args);
+
+/**
+ * @brief List the headers @p source includes with a separate `cc -M` run, for cc commands that
+ * compile several sources at once.
+ */
+void build_cache_scan_deps(BuildCache *cache, ZenCompiler *compiler, const char *source);
+
+/**
+ * @brief Store @p outfile, the dependency manifest and the captured diagnostics of a
+ * successful build. Ends the capture.
+ */
+void build_cache_store(BuildCache *cache, struct ParserContext *ctx, const char *outfile);
+
+/**
+ * @brief Provide the shared runtime header that replaces the inline hosted preamble.
+ *
+ * The header is written under the cache directory once per zc version, cc binary and cc flags,
+ * and precompiled next to it (.gch for gcc, .pch for clang; the latter is recorded in
+ * `config.runtime_pch`). Leaves everything untouched for compilers without PCH support, C++ and
+ * freestanding modes, and when the generated C is itself the output.
+ * @return 1 and the header path in @p out if the generated C should include it.
+ */
+int build_cache_runtime_header(struct ParserContext *ctx, char *out, size_t size);
+
+/**
+ * @brief Source yielded by an earlier run of a comptime block, from the comptime cache.
+ *
+ * @p block_key is comptime_key() of the block. Returns NULL on a miss and when the cache is
+ * disabled (--no-comptime-cache, ZC_COMPTIME_CACHE=0).
+ */
+char *build_cache_comptime_lookup(struct ParserContext *ctx, uint64_t block_key);
+
+/**
+ * @brief Record @p output as what the block with key @p block_key yields.
+ */
+void build_cache_comptime_store(struct ParserContext *ctx, uint64_t block_key,
+                                const char *output);
+
+/**
+ * @brief Entry point for `zc cache <subcommand>`.
+ * @return Process exit code.
+ */
+int build_cache_command(int argc, char **argv);
+
+#endif // BUILD_CACHE_H
@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: MIT
 #include "driver.h"
+#include "build_cache.h"
+#include "serve.h"
 #include "../parser/parser.h"
 #include "../codegen/codegen.h"
 #include "../codegen/compat.h"
@@ -8,6 +10,9 @@
 #include "../analysis/const_fold.h"
 #include "../utils/cmd.h"
 #include "../utils/utils.h"
+#include "../constants.h"
+#include "../utils/pass_timer.h"
+#include "../utils/mem_report.h"
 #if ZC_HAS_ZEN
 #include "../zen/zen_facts.h"
 #include "../zen/zen_doc.h"
@@ -15,19 +20,34 @@
 #if ZC_HAS_PLUGINS
 #include "../plugins/plugin_manager.h"
 #endif
+#if ZC_HAS_REPL
+#include "../repl/repl_jit.h"
+#endif
 #include "../utils/colors.h"
 #include "../platform/os.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #if !ZC_OS_WINDOWS
 #include <sys/wait.h>
 #endif
 
 // Forward declarations (most are in headers — only keep what's not in headers)
 
+// Upper bound on translation units for -j; past this, extra units mostly re-parse the header.
+enum
+{
+    MAX_SPLIT_UNITS = 64
+};
+
 int driver_run(ZenCompiler *compiler)
 {
+    if (compiler->config.mem_report)
+    {
+        mem_report_init();
+    }
+
     // Backend detection for @cfg purposes
     if (z_path_match_compiler(compiler->config.cc, "tcc"))
     {
@@ -60,6 +80,8 @@ int driver_run(ZenCompiler *compiler)
     load_all_configs(&compiler->config);
 
     int result = driver_compile(compiler);
+    pass_timer_report();
+    mem_report_print();
 
 #if ZC_HAS_PLUGINS
 #ifndef ZC_NO_PLUGINS
@@ -84,6 +106,308 @@ int driver_run(ZenCompiler *compiler)
     return result;
 }
 
+// Execute a freshly built (or cache-restored) binary for `zc run`, then remove it.
+static int run_output(ZenCompiler *compiler, const char *outfile)
+{
+    pass_timer_report();
+    mem_report_print();
+    ArgList run_args;
+    arg_list_init(&run_args);
+    char exe_path[1024];
+    if (z_is_windows())
+    {
+        snprintf(exe_path, sizeof(exe_path), "%s", outfile);
+        if (access(exe_path, F_OK) != 0)
+        {
+            snprintf(exe_path, sizeof(exe_path), "%s.exe", outfile);
+        }
+    }
+    else
+    {
+        if (outfile[0] == '/')
+        {
+            snprintf(exe_path, sizeof(exe_path), "%s", outfile);
+        }
+        else
+        {
+            snprintf(exe_path, sizeof(exe_path), "./%s", outfile);
+        }
+    }
+
+    arg_list_add(&run_args, exe_path);
+    if (!compiler->config.quiet)
+    {
+        printf(COLOR_BOLD COLOR_GREEN "     Running" COLOR_RESET " %s\n", exe_path);
+    }
+
+    int run_ret = arg_run(&run_args);
+    arg_list_free(&run_args);
+    remove(exe_path);
+
+#if defined(WIFEXITED) && defined(WEXITSTATUS)
+    return WIFEXITED(run_ret) ? WEXITSTATUS(run_ret) : run_ret;
+#else
+    return run_ret;
+#endif
+}
+
+static int finish_build(ZenCompiler *compiler, const char *note)
+{
+    pass_timer_report();
+    mem_report_print();
+    double end_time = z_get_monotonic_time();
+    if (!compiler->config.quiet)
+    {
+        printf(COLOR_BOLD COLOR_GREEN "    Finished" COLOR_RESET
+                                      " build in %.2fs with %d errors and %d warnings%s\n",
+               end_time - compiler->start_time, compiler->error_count, compiler->warning_count,
+               note);
+    }
+    return 0;
+}
+
+static void write_dep(const char *path, void *arg)
+{
+    FILE *f = arg;
+    fputs(" \\\n  ", f);
+    for (const char *p = path; *p; p++)
+    {
+        if (*p == ' ' || *p == '\\' || *p == '#')
+        {
+            fputc('\\', f);
+        }
+        fputc(*p, f);
+    }
+}
+
+// Make-style rule naming every file the build read: the input, its imports, linked C files and
+// files named by `//> link:`. After a cache hit the file set comes from the manifest instead of
+// the parser (ctx is NULL).
+static void write_deps(ZenCompiler *compiler, ParserContext *ctx, const BuildCache *cache,
+                       const char *outfile)
+{
+    FILE *f = fopen(compiler->config.deps_out, "w");
+    if (!f)
+    {
+        zwarn_at(TOKEN_UNKNOWN, "could not write dependency file '%s'", compiler->config.deps_out);
+        return;
+    }
+    fprintf(f, "%s:", outfile);
+
+    if (ctx)
+    {
+        char abs_input[MAX_PATH_LEN];
+        z_get_absolute_path(compiler->config.input_file, abs_input, sizeof(abs_input));
+        write_dep(abs_input, f);
+        zmap_iter_FileSet it = zmap_iter_init(FileSet, &ctx->imports.imported_files);
+        const char *key;
+        const char *val;
+        while (zmap_iter_next(&it, &key, &val))
+        {
+            if (key && strcmp(key, abs_input) != 0)
+            {
+                write_dep(key, f);
+            }
+        }
+        for (size_t i = 0; i < compiler->config.c_files.length; i++)
+        {
+            char abs_path[MAX_PATH_LEN];
+            z_get_absolute_path(compiler->config.c_files.data[i], abs_path, sizeof(abs_path));
+            write_dep(abs_path, f);
+        }
+    }
+    else
+    {
+        build_cache_for_each_dep(cache, write_dep, f);
+    }
+
+    char words[sizeof(compiler->link_flags)];
+    snprintf(words, sizeof(words), "%s", compiler->link_flags);
+    for (char *w = strtok(words, " \t"); w; w = strtok(NULL, " \t"))
+    {
+        struct stat st;
+        if (w[0] != '-' && stat(w, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            char abs_path[MAX_PATH_LEN];
+            z_get_absolute_path(w, abs_path, sizeof(abs_path));
+            write_dep(abs_path, f);
+        }
+    }
+    fputc('\n', f);
+    fclose(f);
+}
+
+static void print_command(ArgList *args)
+{
+    printf(COLOR_BOLD COLOR_BLUE "     Command" COLOR_RESET);
+    for (size_t k = 0; k < args->count; k++)
+    {
+        printf(" %s", args->args[k]);
+    }
+    printf("\n");
+}
+
+static int emit_unit(ParserContext *ctx, ASTNode *root, const char *path, CodegenUnitRole role,
+                     int unit)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror("fopen split unit");
+        return 1;
+    }
+    ctx->cg.split_role = role;
+    ctx->cg.split_unit = unit;
+    emitter_init_file(&ctx->cg.emitter, f);
+    PASS_BEGIN(PASS_CODEGEN, path);
+    codegen_node(ctx, root);
+    PASS_END();
+    fclose(f);
+    return 0;
+}
+
+// Emit the program as a shared header plus `units` translation units, compile them with up to
+// config.jobs concurrent cc processes and link the objects into `outfile`. Intermediate files
+// are named after `stem` and removed afterwards.
+static int compile_split(ZenCompiler *compiler, ParserContext *ctx, BuildCache *cache,
+                         ASTNode *root, const char *stem, const char *outfile, int units)
+{
+    size_t path_len = strlen(stem) + 32;
+    char *header = xmalloc(path_len);
+    snprintf(header, path_len, "%s.h", stem);
+    char *header_name = z_basename(header);
+
+    char **sources = xmalloc(sizeof(char *) * (size_t)units);
+    char **objects = xmalloc(sizeof(char *) * (size_t)units);
+    for (int u = 0; u < units; u++)
+    {
+        sources[u] = xmalloc(path_len);
+        objects[u] = xmalloc(path_len);
+        snprintf(sources[u], path_len, "%s.%d.c", stem, u);
+        snprintf(objects[u], path_len, "%s.%d.o", stem, u);
+    }
+
+    ctx->cg.split_units = units;
+    ctx->cg.split_header = header_name;
+    int ret = emit_unit(ctx, root, header, CODEGEN_UNIT_HEADER, 0);
+    for (int u = 0; u < units && ret == 0; u++)
+    {
+        ret = emit_unit(ctx, root, sources[u], u == 0 ? CODEGEN_UNIT_PRIMARY : CODEGEN_UNIT_BODIES,
+                        u);
+    }
+    ctx->cg.split_role = CODEGEN_UNIT_SINGLE;
+    ctx->cg.split_units = 0;
+
+    if (ret == 0)
+    {
+        ArgList *jobs = xmalloc(sizeof(ArgList) * (size_t)units);
+        for (int u = 0; u < units; u++)
+        {
+            arg_list_init(&jobs[u]);
+            build_object_arg_list(&jobs[u], objects[u], sources[u], &compiler->config);
+            build_cache_dep_flags(cache, &jobs[u]);
+            if (compiler->config.verbose)
+            {
+                print_command(&jobs[u]);
+            }
+        }
+        PASS_BEGIN(PASS_CC, "compile units");
+        ret = arg_run_parallel(jobs, (size_t)units, compiler->config.jobs);
+        PASS_END();
+        for (int u = 0; u < units; u++)
+        {
+            arg_list_free(&jobs[u]);
+        }
+        zfree(jobs);
+    }
+
+    if (ret == 0)
+    {
+        ArgList link_args;
+        arg_list_init(&link_args);
+        build_link_arg_list(&link_args, outfile, objects, (size_t)units, &compiler->config);
+        if (compiler->config.verbose)
+        {
+            print_command(&link_args);
+        }
+        PASS_BEGIN(PASS_CC, "link");
+        ret = arg_run(&link_args);
+        PASS_END();
+        arg_list_free(&link_args);
+    }
+
+    remove(header);
+    for (int u = 0; u < units; u++)
+    {
+        remove(sources[u]);
+        remove(objects[u]);
+    }
+    return ret;
+}
+
+// zc run --jit: emit the program for TCC and run main() in memory. Returns 1 once the program
+// has run (its status in *exit_code), or 0 with *reason set when it has to be built with cc.
+static int jit_run(ZenCompiler *compiler, ParserContext *ctx, ASTNode *root, int *exit_code,
+                   char *reason, size_t reason_size)
+{
+    CompilerConfig *cfg = &compiler->config;
+    const CodegenBackend *backend = codegen_get_backend(cfg->backend_name);
+    if (!backend || strcmp(backend->name, "c") != 0 || cfg->use_cpp || cfg->use_cuda ||
+        cfg->use_objc)
+    {
+        snprintf(reason, reason_size, "the %s backend needs an external compiler",
+                 backend ? backend->name : cfg->backend_name);
+        return 0;
+    }
+    if (cfg->is_freestanding || cfg->misra_mode)
+    {
+        snprintf(reason, reason_size, "%s builds need an external compiler",
+                 cfg->is_freestanding ? "freestanding" : "MISRA");
+        return 0;
+    }
+#if ZC_HAS_REPL
+    // Codegen spells inferred declarations with __typeof__ rather than __auto_type when the
+    // target is tcc, so emit as if it were the configured compiler.
+    char saved_cc[sizeof(cfg->cc)];
+    memcpy(saved_cc, cfg->cc, sizeof(saved_cc));
+    snprintf(cfg->cc, sizeof(cfg->cc), "tcc");
+    emitter_init_buffer(&ctx->cg.emitter);
+    PASS_BEGIN(PASS_CODEGEN, "jit");
+    codegen_node(ctx, root);
+    PASS_END();
+    char *c_code = emitter_take_string(&ctx->cg.emitter);
+    ArgList flags;
+    arg_list_init(&flags);
+    build_jit_arg_list(&flags, cfg);
+    memcpy(cfg->cc, saved_cc, sizeof(saved_cc));
+
+    PASS_BEGIN(PASS_CC, "tcc");
+    ZJitProgram *prog =
+        c_code ? repl_jit_compile_program(c_code, &flags, cfg, reason, reason_size) : NULL;
+    PASS_END();
+    arg_list_free(&flags);
+    zfree(c_code);
+    if (!prog)
+    {
+        return 0;
+    }
+
+    if (!cfg->quiet)
+    {
+        printf(COLOR_BOLD COLOR_GREEN "     Running" COLOR_RESET " %s (jit)\n", cfg->input_file);
+    }
+    char *argv[] = {cfg->input_file, NULL};
+    *exit_code = repl_jit_run_program(prog, 1, argv);
+    return 1;
+#else
+    (void)ctx;
+    (void)root;
+    (void)exit_code;
+    snprintf(reason, reason_size, "zc was built without the REPL/JIT module");
+    return 0;
+#endif
+}
+
 int driver_compile(ZenCompiler *compiler)
 {
     ParserContext ctx;
@@ -140,8 +464,13 @@ int driver_compile(ZenCompiler *compiler)
         perror("tmpfile for hoisting");
         return 1;
     }
+    serve_arm_snapshot(&ctx, &l);
 
     compiler->start_time = z_get_monotonic_time();
+    if (compiler->config.time_passes || compiler->config.trace_out)
+    {
+        pass_timer_init(compiler->config.time_passes, compiler->config.trace_out);
+    }
 
     if (!compiler->config.quiet)
     {
@@ -150,7 +479,52 @@ int driver_compile(ZenCompiler *compiler)
         fflush(stdout);
     }
 
+    // Determine output file extension from backend
+    const CodegenBackend *backend = codegen_get_backend(compiler->config.backend_name);
+    const char *ext_p = backend ? backend->extension : ".c";
+
+    if (!compiler->config.output_file)
+    {
+        char *base = z_basename(compiler->config.input_file);
+        char *stripped = z_strip_ext(base);
+        zfree(base);
+        if (compiler->config.mode_transpile)
+        {
+            char *with_ext = xmalloc(strlen(stripped) + strlen(ext_p) + 1);
+            sprintf(with_ext, "%s%s", stripped, ext_p); /* safe */
+            compiler->config.output_file = with_ext;
+        }
+        else
+        {
+            compiler->config.output_file = stripped;
+        }
+    }
+
+    const char *outfile = compiler->config.output_file ? compiler->config.output_file
+                                                       : (z_is_windows() ? "a.exe" : "a.out");
+
+    // Directives of the primary file are already scanned, so their expanded flags are
+    // part of the key; imported files are validated through the manifest.
+    BuildCache cache;
+    build_cache_init(&cache, compiler);
+    if (build_cache_lookup(&cache, compiler, outfile))
+    {
+        if (compiler->config.deps_out)
+        {
+            write_deps(compiler, NULL, &cache, outfile);
+        }
+        if (compiler->config.mode_run)
+        {
+            return run_output(compiler, outfile);
+        }
+        return finish_build(compiler, " (cached)");
+    }
+    build_cache_capture(&cache);
+
+    lexer_buffer_tokens(&l);
+    PASS_BEGIN(PASS_PARSE, compiler->config.input_file);
     ASTNode *root = parse_program(&ctx, &l);
+    PASS_END();
     if (!root)
     {
         return 1;
@@ -162,7 +536,7 @@ int driver_compile(ZenCompiler *compiler)
         char *primary_real = realpath(compiler->config.input_file, NULL);
         if (primary_real)
         {
-            mark_file_imported(&ctx, primary_real);
+            mark_file_imported(&ctx, xstrdup(primary_real));
             free(primary_real);
         }
 
@@ -191,7 +565,7 @@ int driver_compile(ZenCompiler *compiler)
                 }
                 continue;
             }
-            mark_file_imported(&ctx, path);
+            mark_file_imported(&ctx, xstrdup(path));
 
             char *extra_src = load_file(path, ctx.current_filename);
             if (!extra_src)
@@ -213,7 +587,10 @@ int driver_compile(ZenCompiler *compiler)
             scan_build_directives(&ctx, extra_src);
             Lexer extra_l;
             lexer_init(&extra_l, extra_src, ctx.config, ctx.current_filename);
+            lexer_buffer_tokens(&extra_l);
+            PASS_BEGIN(PASS_PARSE, extra_path);
             ASTNode *extra_root = parse_program_nodes(&ctx, &extra_l);
+            PASS_END();
 
             if (extra_root)
             {
@@ -238,24 +615,34 @@ int driver_compile(ZenCompiler *compiler)
         }
     }
 
+    if (compiler->config.deps_out)
+    {
+        write_deps(compiler, &ctx, NULL, outfile);
+    }
+
     // Process @link directives
     // (Handled during parsing phase — NODE_LINK is collected there)
 
     // Semantic Analysis & Validation
     if (!compiler->config.mode_doc || compiler->config.use_typecheck)
     {
+        PASS_BEGIN(PASS_SEMA, NULL);
         propagate_vector_inner_types(&ctx);
         propagate_drop_traits(&ctx);
         fix_type_refs_has_drop(&ctx);
-
-        if (!validate_types(&ctx))
+        int types_ok = validate_types(&ctx);
+        PASS_END();
+        if (!types_ok)
         {
             return 1;
         }
 
         if (!compiler->config.use_typecheck && !compiler->config.mode_check)
         {
-            if (check_moves_only(&ctx, root) != 0)
+            PASS_BEGIN(PASS_MOVE_CHECK, NULL);
+            int moves = check_moves_only(&ctx, root);
+            PASS_END();
+            if (moves != 0)
             {
                 return 1;
             }
@@ -271,7 +658,9 @@ int driver_compile(ZenCompiler *compiler)
                    compiler->config.input_file);
             fflush(stdout);
         }
+        PASS_BEGIN(PASS_TYPECHECK, NULL);
         tc_result = check_program(&ctx, root);
+        PASS_END();
         if (tc_result != 0 && !compiler->config.mode_check)
         {
             return 1;
@@ -298,28 +687,33 @@ int driver_compile(ZenCompiler *compiler)
         return 0;
     }
 
-    // Determine output file extension from backend
-    const CodegenBackend *backend = codegen_get_backend(compiler->config.backend_name);
-    const char *ext_p = backend ? backend->extension : ".c";
-    char temp_source_buf[1024];
+    // Only for C that is compiled: the other backends print the tree as written.
+    if (!backend || backend->needs_cc)
+    {
+        PASS_BEGIN(PASS_FOLD, NULL);
+        fold_program(&ctx, root);
+        PASS_END();
+    }
 
-    if (!compiler->config.output_file)
+    if (compiler->config.mode_run && compiler->config.use_jit)
     {
-        char *base = z_basename(compiler->config.input_file);
-        char *stripped = z_strip_ext(base);
-        zfree(base);
-        if (compiler->config.mode_transpile)
+        // Nothing is stored for a JIT run, and the program's own stderr is not part of the build.
+        build_cache_capture_end(&cache);
+        int exit_code = 0;
+        char reason[512];
+        if (jit_run(compiler, &ctx, root, &exit_code, reason, sizeof(reason)))
         {
-            char *with_ext = xmalloc(strlen(stripped) + strlen(ext_p) + 1);
-            sprintf(with_ext, "%s%s", stripped, ext_p); /* safe */
-            compiler->config.output_file = with_ext;
+            return exit_code;
         }
-        else
+        if (!compiler->config.quiet)
         {
-            compiler->config.output_file = stripped;
+            printf(COLOR_BOLD COLOR_YELLOW "    Fallback" COLOR_RESET " to %s: %s\n",
+                   compiler->config.cc, reason);
+            fflush(stdout);
         }
     }
 
+    char temp_source_buf[1024];
     if (compiler->config.output_file)
     {
         size_t out_len = strlen(compiler->config.output_file);
@@ -341,6 +735,62 @@ int driver_compile(ZenCompiler *compiler)
         snprintf(temp_source_buf, sizeof(temp_source_buf), "out%s", ext_p);
     }
 
+    // -j N: several translation units compiled concurrently. Kept to a single unit when the
+    // output is the C source itself or the program cannot be split safely.
+    int units = 0;
+    if (compiler->config.jobs > 1 && backend && strcmp(backend->name, "c") == 0 &&
+        !compiler->config.mode_transpile && !compiler->config.emit_c)
+    {
+        const char *blocker = codegen_split_blocker(&ctx, root);
+        if (blocker)
+        {
+            if (compiler->config.verbose)
+            {
+                printf(COLOR_BOLD COLOR_GREEN "       Split" COLOR_RESET
+                                              " skipped, using one translation unit (%s)\n",
+                       blocker);
+            }
+        }
+        else
+        {
+            units = compiler->config.jobs < MAX_SPLIT_UNITS ? compiler->config.jobs
+                                                            : MAX_SPLIT_UNITS;
+        }
+    }
+
+    // The hosted preamble is the same for every program; include it from a header the cc has
+    // already precompiled rather than reparsing it on every build.
+    char runtime_header[MAX_PATH_SIZE + 32];
+    build_cache_capture_echo(&cache);
+    PASS_BEGIN(PASS_CC, "runtime header");
+    if (build_cache_runtime_header(&ctx, runtime_header, sizeof(runtime_header)))
+    {
+        ctx.cg.runtime_header = runtime_header;
+    }
+    PASS_END();
+
+    if (units > 1)
+    {
+        char stem[sizeof(temp_source_buf)];
+        snprintf(stem, sizeof(stem), "%s", temp_source_buf);
+        size_t stem_len = strlen(stem);
+        size_t ext_len = strlen(ext_p);
+        if (stem_len > ext_len && strcmp(stem + stem_len - ext_len, ext_p) == 0)
+        {
+            stem[stem_len - ext_len] = '\0';
+        }
+        if (compile_split(compiler, &ctx, &cache, root, stem, outfile, units) != 0)
+        {
+            return 1;
+        }
+        build_cache_store(&cache, &ctx, outfile);
+        if (compiler->config.mode_run)
+        {
+            return run_output(compiler, outfile);
+        }
+        return finish_build(compiler, "");
+    }
+
     FILE *out_f = fopen(temp_source_buf, "w");
     if (!out_f)
     {
@@ -348,7 +798,9 @@ int driver_compile(ZenCompiler *compiler)
         return 1;
     }
     emitter_init_file(&ctx.cg.emitter, out_f);
+    PASS_BEGIN(PASS_CODEGEN, temp_source_buf);
     codegen_node(&ctx, root);
+    PASS_END();
     fclose(out_f);
 
     if (compiler->config.mode_transpile)
@@ -377,23 +829,27 @@ int driver_compile(ZenCompiler *compiler)
     }
 
     // Compile C
-    const char *outfile = compiler->config.output_file ? compiler->config.output_file
-                                                       : (z_is_windows() ? "a.exe" : "a.out");
     ArgList compile_args;
     arg_list_init(&compile_args);
     build_compile_arg_list(&compile_args, outfile, temp_source_buf, &compiler->config);
+    if (compiler->config.c_files.length == 0)
+    {
+        build_cache_dep_flags(&cache, &compile_args);
+    }
+    else
+    {
+        // One -MF rule would only describe the last of several inputs.
+        build_cache_scan_deps(&cache, compiler, temp_source_buf);
+    }
 
     if (compiler->config.verbose)
     {
-        printf(COLOR_BOLD COLOR_BLUE "     Command" COLOR_RESET);
-        for (size_t k = 0; k < compile_args.count; k++)
-        {
-            printf(" %s", compile_args.args[k]);
-        }
-        printf("\n");
+        print_command(&compile_args);
     }
 
+    PASS_BEGIN(PASS_CC, compiler->config.cc);
     int ret = arg_run(&compile_args);
+    PASS_END();
     arg_list_free(&compile_args);
 
     if (!compiler->config.emit_c)
@@ -405,56 +861,11 @@ int driver_compile(ZenCompiler *compiler)
         return 1;
     }
 
-    // Run if needed
-    if (compiler->config.mode_run)
-    {
-        ArgList run_args;
-        arg_list_init(&run_args);
-        char exe_path[1024];
-        if (z_is_windows())
-        {
-            snprintf(exe_path, sizeof(exe_path), "%s", outfile);
-            if (access(exe_path, F_OK) != 0)
-            {
-                snprintf(exe_path, sizeof(exe_path), "%s.exe", outfile);
-            }
-        }
-        else
-        {
-            if (outfile[0] == '/')
-            {
-                snprintf(exe_path, sizeof(exe_path), "%s", outfile);
-            }
-            else
-            {
-                snprintf(exe_path, sizeof(exe_path), "./%s", outfile);
-            }
-        }
-
-        arg_list_add(&run_args, exe_path);
-        if (!compiler->config.quiet)
-        {
-            printf(COLOR_BOLD COLOR_GREEN "     Running" COLOR_RESET " %s\n", exe_path);
-        }
-
-        int run_ret = arg_run(&run_args);
-        arg_list_free(&run_args);
-        remove(exe_path);
+    build_cache_store(&cache, &ctx, outfile);
 
-#if defined(WIFEXITED) && defined(WEXITSTATUS)
-        return WIFEXITED(run_ret) ? WEXITSTATUS(run_ret) : run_ret;
-#else
-        return run_ret;
-#endif
-    }
-
-    double end_time = z_get_monotonic_time();
-    if (!compiler->config.quiet)
+    if (compiler->config.mode_run)
     {
-        printf(COLOR_BOLD COLOR_GREEN "    Finished" COLOR_RESET
-                                      " build in %.2fs with %d errors and %d warnings\n",
-               end_time - compiler->start_time, compiler->error_count, compiler->warning_count);
+        return run_output(compiler, outfile);
     }
-
-    return 0;
+    return finish_build(compiler, "");
 }
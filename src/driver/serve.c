@@ -0,0 +1,1443 @@
+// SPDX-License-Identifier: MIT
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // struct ucred
+#endif
+#include "serve.h"
+#include "../parser/parser.h"
+#include "../utils/utils.h"
+#include "../utils/colors.h"
+#include "../utils/cmd.h"
+#include "../utils/source_manager.h"
+#include "../platform/os.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ZC_OS_WINDOWS
+
+int serve_main(int argc, char **argv, ServeCompileFn compile)
+{
+    (void)argc;
+    (void)argv;
+    (void)compile;
+    fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET
+                                         ": zc serve needs Unix domain sockets and fork()\n");
+    return 1;
+}
+
+int serve_client(int argc, char **argv, int *status)
+{
+    (void)argc;
+    (void)argv;
+    (void)status;
+    return 0;
+}
+
+int serve_arm_snapshot(ParserContext *ctx, Lexer *l)
+{
+    (void)ctx;
+    (void)l;
+    return 0;
+}
+
+int serve_private_dir(char *buf, size_t size, int create)
+{
+    (void)buf;
+    (void)size;
+    (void)create;
+    return 0;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if !defined(_GNU_SOURCE)
+extern char **environ;
+#endif
+
+#define SERVE_MAGIC 0x5a435331u // "ZCS1"
+
+enum
+{
+    SERVE_MAX_SNAPSHOTS = 16,        ///< Live snapshot processes; the least recently used goes.
+    SERVE_MAX_REQUEST = 1 << 20,     ///< Upper bound on cwd + argv + environment.
+    SERVE_REPLY_TIMEOUT_MS = 120000, ///< How long a snapshot may take to answer (its first
+                                     ///< compile may still be parsing imports).
+    SERVE_REQUEST_TIMEOUT_MS = 5000, ///< How long a client may take to send its request.
+    SERVE_REQUEST_FDS = 3,           ///< Client stdin, stdout, stderr.
+};
+
+/// Wire header of a request; followed by `size` bytes of NUL-terminated strings: the working
+/// directory, `argc` arguments and `envc` environment entries.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t argc;
+    uint32_t envc;
+} ServeHeader;
+
+/// A file the snapshot parsed, with the stat data it had at that point.
+typedef struct
+{
+    char *path;
+    long long mtime_ns;
+    off_t size;
+} ServeDep;
+
+// Edits within the same second are common when a tool writes a file and recompiles at once.
+static long long stat_mtime_ns(const struct stat *st)
+{
+#if defined(__APPLE__)
+    return (long long)st->st_mtimespec.tv_sec * 1000000000LL + st->st_mtimespec.tv_nsec;
+#else
+    return (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+#endif
+}
+
+/// Server-side record of a snapshot process.
+typedef struct
+{
+    char *key; ///< cwd, argv and compile-relevant environment the snapshot was made for.
+    size_t size;
+    int control; ///< Socket to the snapshot process; -1 when the slot is free.
+    unsigned long last_used;
+} ServeSlot;
+
+static int listen_fd = -1;
+static ServeSlot slots[SERVE_MAX_SNAPSHOTS];
+static unsigned long serve_tick;
+
+// State of a worker process: one request, compiled either from scratch or from a snapshot.
+static struct
+{
+    int active;     ///< This process compiles a request for a client.
+    int control;    ///< Socket the server will send follow-up requests on, once snapshotted.
+    int client_out; ///< Client stdout/stderr while fd 1/2 still point at the capture files.
+    int client_err;
+    int cap_out; ///< Capture of everything printed before the snapshot point.
+    int cap_err;
+
+    // Set at the snapshot point.
+    char *path;      ///< Resolved main file.
+    char *prefix;    ///< Main file text when the snapshot was taken.
+    int prefix_len;  ///< Lexer position at the snapshot; this much of the text must match.
+    char *out;       ///< Output printed before the snapshot, replayed to each client.
+    size_t out_len;
+    char *err;
+    size_t err_len;
+    long hoist_len;  ///< Bytes already written to the hoisting temp file.
+    double hook_time;
+    ServeDep *deps;
+    size_t dep_count;
+    char **env_names; ///< Variables the build directives of the main file and imports expand.
+    size_t env_count;
+} worker = {0, -1, -1, -1, -1, -1, NULL, NULL, 0, NULL, 0, NULL, 0, 0, 0, NULL, 0, NULL, 0};
+
+static int sigchld_pipe[2] = {-1, -1};
+
+// ----------------------------------------------------------------------------
+// Socket helpers
+// ----------------------------------------------------------------------------
+
+int serve_private_dir(char *buf, size_t size, int create)
+{
+    const char *xdg = getenv("XDG_RUNTIME_DIR");
+    if (xdg && xdg[0])
+    {
+        snprintf(buf, size, "%s", xdg);
+    }
+    else
+    {
+        snprintf(buf, size, "%s/zc-%u", z_get_temp_dir(), (unsigned)getuid());
+        if (create && mkdir(buf, 0700) != 0 && errno != EEXIST)
+        {
+            return 0;
+        }
+    }
+    // Anyone who can write here could put a socket of their own in place of the server's.
+    struct stat st;
+    return lstat(buf, &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == getuid() &&
+           (st.st_mode & 077) == 0;
+}
+
+// NULL if the default directory is missing (@p create unset) or not private.
+static const char *default_socket_path(char *buf, size_t size, int create)
+{
+    const char *env = getenv("ZC_SERVER");
+    if (env && env[0] && strcmp(env, "1") != 0 && strcmp(env, "0") != 0)
+    {
+        return env;
+    }
+    char dir[MAX_PATH_SIZE];
+    if (!serve_private_dir(dir, sizeof(dir), create))
+    {
+        return NULL;
+    }
+    snprintf(buf, size, "%s/zc-serve.sock", dir);
+    return buf;
+}
+
+// A request hands over the client's stdio and environment, and the server runs whatever the
+// request builds, so both ends only deal with a process of their own user.
+static int peer_is_self(int sock)
+{
+#if defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    return getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(sock, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+static int write_full(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void *buf, size_t len)
+{
+    char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Send @p len bytes with @p nfds descriptors attached to the first byte.
+static int send_with_fds(int sock, const void *buf, size_t len, const int *fds, int nfds)
+{
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(int) * (SERVE_REQUEST_FDS + 1))];
+        struct cmsghdr align;
+    } ctrl;
+    struct iovec iov = {(void *)buf, len};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (nfds > 0)
+    {
+        memset(&ctrl, 0, sizeof(ctrl));
+        msg.msg_control = ctrl.buf;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)nfds);
+        struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)nfds);
+        memcpy(CMSG_DATA(c), fds, sizeof(int) * (size_t)nfds);
+    }
+
+    ssize_t n;
+    do
+    {
+        n = sendmsg(sock, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+    {
+        return -1;
+    }
+    return write_full(sock, (const char *)buf + n, len - (size_t)n);
+}
+
+// Receive exactly @p len bytes; descriptors attached to them are stored in @p fds.
+static int recv_with_fds(int sock, void *buf, size_t len, int *fds, int max_fds, int *nfds)
+{
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(int) * (SERVE_REQUEST_FDS + 1))];
+        struct cmsghdr align;
+    } ctrl;
+    struct iovec iov = {buf, len};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+
+    ssize_t n;
+    do
+    {
+        n = recvmsg(sock, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    *nfds = 0;
+    if (n <= 0)
+    {
+        return -1;
+    }
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+    {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+        {
+            continue;
+        }
+        int count = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        int *data = (int *)(void *)CMSG_DATA(c);
+        for (int i = 0; i < count; i++)
+        {
+            if (*nfds < max_fds)
+            {
+                fds[(*nfds)++] = data[i];
+            }
+            else
+            {
+                close(data[i]);
+            }
+        }
+    }
+    return read_full(sock, (char *)buf + n, len - (size_t)n);
+}
+
+static void close_fds(int *fds, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+}
+
+// Children of the server must not keep the listening socket or other snapshots alive.
+static void close_server_fds(int keep)
+{
+    if (listen_fd >= 0)
+    {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+    for (int i = 0; i < SERVE_MAX_SNAPSHOTS; i++)
+    {
+        if (slots[i].control >= 0 && slots[i].control != keep)
+        {
+            close(slots[i].control);
+            slots[i].control = -1;
+        }
+    }
+}
+
+// Everything here outlives many requests, so it lives on the libc heap, not the arena.
+static char *read_file_libc(const char *path, size_t *len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    char *buf = libc_malloc((size_t)st.st_size + 1);
+    if (!buf || read_full(fd, buf, (size_t)st.st_size) != 0)
+    {
+        libc_free(buf);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    buf[st.st_size] = 0;
+    *len = (size_t)st.st_size;
+    return buf;
+}
+
+static void replay(int from, int to, char **keep, size_t *keep_len)
+{
+    struct stat st;
+    if (fstat(from, &st) != 0 || st.st_size == 0)
+    {
+        return;
+    }
+    char *buf = libc_malloc((size_t)st.st_size);
+    if (!buf)
+    {
+        return;
+    }
+    if (pread(from, buf, (size_t)st.st_size, 0) == st.st_size)
+    {
+        write_full(to, buf, (size_t)st.st_size);
+        if (keep)
+        {
+            *keep = buf;
+            *keep_len = (size_t)st.st_size;
+            buf = NULL;
+        }
+    }
+    libc_free(buf);
+    if (ftruncate(from, 0) != 0)
+    {
+        return;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Supervision: one process per request waits for the worker and reports its status
+// ----------------------------------------------------------------------------
+
+static void on_sigchld(int sig)
+{
+    (void)sig;
+    int saved = errno;
+    if (write(sigchld_pipe[1], "c", 1) < 0)
+    {
+        // Pipe full: a wakeup is already pending.
+    }
+    errno = saved;
+}
+
+// Runs in the supervisor, a session leader whose process group holds the worker and whatever
+// the worker starts (cc, the program of `zc run`). If the client goes away, the whole group is
+// terminated. Captured output is replayed before the status is sent.
+static void supervise(int client, pid_t pid, int cap_out, int cap_err, int out, int err)
+{
+    int status = 0;
+    for (;;)
+    {
+        pid_t r = waitpid(pid, &status, WNOHANG);
+        if (r == pid || (r < 0 && errno != EINTR))
+        {
+            break;
+        }
+        struct pollfd p[2] = {{client, POLLIN, 0}, {sigchld_pipe[0], POLLIN, 0}};
+        if (poll(p, 2, -1) < 0)
+        {
+            continue;
+        }
+        if (p[1].revents)
+        {
+            char drain[16];
+            if (read(sigchld_pipe[0], drain, sizeof(drain)) < 0)
+            {
+                continue;
+            }
+        }
+        if (p[0].revents)
+        {
+            // The client never writes after its request, so readable means gone.
+            signal(SIGTERM, SIG_IGN);
+            kill(0, SIGTERM);
+            waitpid(pid, &status, 0);
+            _exit(0);
+        }
+    }
+
+    if (cap_out >= 0)
+    {
+        replay(cap_out, out, NULL, NULL);
+    }
+    if (cap_err >= 0)
+    {
+        replay(cap_err, err, NULL, NULL);
+    }
+
+    int32_t code = 1;
+    if (WIFEXITED(status))
+    {
+        code = WEXITSTATUS(status);
+    }
+    else if (WIFSIGNALED(status))
+    {
+        code = 128 + WTERMSIG(status);
+    }
+    write_full(client, &code, sizeof(code));
+    _exit(0);
+}
+
+// Become a supervisor: new session, SIGCHLD wakeups, then fork the worker.
+// Returns 0 in the worker; never returns in the supervisor.
+static pid_t fork_supervised(int client, int cap_out, int cap_err, int out, int err)
+{
+    setsid();
+    if (pipe(sigchld_pipe) != 0)
+    {
+        _exit(1);
+    }
+    signal(SIGCHLD, on_sigchld);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        int32_t code = 1;
+        write_full(client, &code, sizeof(code));
+        _exit(0);
+    }
+    if (pid == 0)
+    {
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        close(sigchld_pipe[0]);
+        close(sigchld_pipe[1]);
+        return 0;
+    }
+    supervise(client, pid, cap_out, cap_err, out, err);
+    return pid;
+}
+
+// ----------------------------------------------------------------------------
+// Snapshot: taken by the worker once the main file's imports are parsed
+// ----------------------------------------------------------------------------
+
+static void release_output(void)
+{
+    if (worker.cap_out < 0)
+    {
+        return;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    replay(worker.cap_out, worker.client_out, NULL, NULL);
+    replay(worker.cap_err, worker.client_err, NULL, NULL);
+    dup2(worker.client_out, 1);
+    dup2(worker.client_err, 2);
+    zcolors_assume_tty(1, -1);
+    zcolors_assume_tty(2, -1);
+    close(worker.client_out);
+    close(worker.client_err);
+    close(worker.cap_out);
+    close(worker.cap_err);
+    worker.client_out = worker.client_err = worker.cap_out = worker.cap_err = -1;
+}
+
+// Give this worker a private copy of the hoisting temp file; the inherited one is shared
+// with the snapshot and every other worker forked from it.
+static void reopen_hoist(ParserContext *ctx)
+{
+    FILE *shared = ctx->cg.hoist_out;
+    FILE *own = z_tmpfile();
+    if (!own)
+    {
+        return;
+    }
+    char buf[8192];
+    long off = 0;
+    while (off < worker.hoist_len)
+    {
+        size_t want = sizeof(buf);
+        if ((long)want > worker.hoist_len - off)
+        {
+            want = (size_t)(worker.hoist_len - off);
+        }
+        ssize_t n = pread(fileno(shared), buf, want, off);
+        if (n <= 0)
+        {
+            break;
+        }
+        fwrite(buf, 1, (size_t)n, own);
+        off += n;
+    }
+    ctx->cg.hoist_out = own;
+}
+
+// Next `//>` build directive at or after @p p, or NULL.
+static const char *next_directive(const char *p, size_t *len)
+{
+    const char *d = strstr(p, "//>");
+    if (d)
+    {
+        const char *eol = strchr(d, '\n');
+        *len = eol ? (size_t)(eol - d) : strlen(d);
+    }
+    return d;
+}
+
+// Directives anywhere in the main file were applied before parsing started, so a snapshot is
+// only reusable if those after the snapshot point are unchanged too.
+static int same_directives(const char *a, const char *b)
+{
+    size_t alen = 0;
+    size_t blen = 0;
+    for (;;)
+    {
+        a = next_directive(a, &alen);
+        b = next_directive(b, &blen);
+        if (!a || !b)
+        {
+            return !a && !b;
+        }
+        if (alen != blen || memcmp(a, b, alen) != 0)
+        {
+            return 0;
+        }
+        a += alen;
+        b += blen;
+    }
+}
+
+// Value of @p name in a NUL-terminated environment array, or NULL.
+static const char *env_lookup(char **envp, const char *name)
+{
+    size_t n = strlen(name);
+    for (char **e = envp; *e; e++)
+    {
+        if (strncmp(*e, name, n) == 0 && (*e)[n] == '=')
+        {
+            return *e + n + 1;
+        }
+    }
+    return NULL;
+}
+
+static void add_env_name(const char *name, size_t n)
+{
+    for (size_t i = 0; i < worker.env_count; i++)
+    {
+        if (strlen(worker.env_names[i]) == n && memcmp(worker.env_names[i], name, n) == 0)
+        {
+            return;
+        }
+    }
+    char **grown = libc_realloc(worker.env_names, (worker.env_count + 1) * sizeof(char *));
+    if (!grown)
+    {
+        return;
+    }
+    worker.env_names = grown;
+    char *copy = libc_malloc(n + 1);
+    if (copy)
+    {
+        memcpy(copy, name, n);
+        copy[n] = 0;
+        worker.env_names[worker.env_count++] = copy;
+    }
+}
+
+// Remember each ${VAR} the `//>` directives of @p text expand.
+static void collect_directive_env(const char *text)
+{
+    size_t len = 0;
+    for (const char *d = next_directive(text, &len); d; d = next_directive(d + len, &len))
+    {
+        const char *end = d + len;
+        for (const char *q = d + 3; q + 1 < end; q++)
+        {
+            if (q[0] != '$' || q[1] != '{')
+            {
+                continue;
+            }
+            const char *close = memchr(q + 2, '}', (size_t)(end - q - 2));
+            if (!close)
+            {
+                break;
+            }
+            add_env_name(q + 2, (size_t)(close - (q + 2)));
+            q = close;
+        }
+    }
+}
+
+// The snapshot already applied the directives with its own environment, which is that of the
+// request it was taken for.
+static int same_directive_env(char **envp)
+{
+    for (size_t i = 0; i < worker.env_count; i++)
+    {
+        const char *was = getenv(worker.env_names[i]);
+        const char *now = env_lookup(envp, worker.env_names[i]);
+        if ((was == NULL) != (now == NULL) || (was && strcmp(was, now) != 0))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int snapshot_current(char **src, char **envp)
+{
+    size_t len = 0;
+    char *text = read_file_libc(worker.path, &len);
+    if (!text || len < (size_t)worker.prefix_len ||
+        memcmp(text, worker.prefix, (size_t)worker.prefix_len) != 0 ||
+        !same_directives(text + worker.prefix_len, worker.prefix + worker.prefix_len) ||
+        !same_directive_env(envp))
+    {
+        libc_free(text);
+        return 0;
+    }
+    for (size_t i = 0; i < worker.dep_count; i++)
+    {
+        struct stat st;
+        if (stat(worker.deps[i].path, &st) != 0 || stat_mtime_ns(&st) != worker.deps[i].mtime_ns ||
+            st.st_size != worker.deps[i].size)
+        {
+            libc_free(text);
+            return 0;
+        }
+    }
+    *src = text;
+    return 1;
+}
+
+static char **unpack_strings(char **cursor, char *end, uint32_t count)
+{
+    char **out = libc_malloc(((size_t)count + 1) * sizeof(char *));
+    if (!out)
+    {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        char *nul = memchr(*cursor, 0, (size_t)(end - *cursor));
+        if (!nul)
+        {
+            libc_free(out);
+            return NULL;
+        }
+        out[i] = *cursor;
+        *cursor = nul + 1;
+    }
+    out[count] = NULL;
+    return out;
+}
+
+// Continue a request forked from the snapshot: client stdio, fresh main file text, own files.
+static void resume_worker(ParserContext *ctx, Lexer *l, char *src, int *fds)
+{
+    close(worker.control);
+    worker.control = -1;
+    close(fds[0]);
+    dup2(fds[1], 0);
+    dup2(fds[2], 1);
+    dup2(fds[3], 2);
+    close_fds(fds + 1, SERVE_REQUEST_FDS);
+    write_full(1, worker.out, worker.out_len);
+    write_full(2, worker.err, worker.err_len);
+
+    l->src = src;
+    lexer_buffer_tokens(l);
+    reopen_hoist(ctx);
+    ctx->compiler->start_time += z_get_monotonic_time() - worker.hook_time;
+}
+
+// The snapshot process: wait for requests from the server and fork a worker for each.
+// Returns only in a worker.
+static void snapshot_loop(ParserContext *ctx, Lexer *l)
+{
+    setsid();
+    signal(SIGCHLD, SIG_IGN);
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0)
+    {
+        dup2(null_fd, 0);
+        dup2(null_fd, 1);
+        dup2(null_fd, 2);
+        close(null_fd);
+    }
+
+    for (;;)
+    {
+        char tag;
+        int fds[SERVE_REQUEST_FDS + 1];
+        int nfds = 0;
+        if (recv_with_fds(worker.control, &tag, 1, fds, SERVE_REQUEST_FDS + 1, &nfds) != 0)
+        {
+            _exit(0);
+        }
+        // The request follows; only its environment can differ from the one snapshotted.
+        ServeHeader hdr;
+        char *request = NULL;
+        char **envp = NULL;
+        if (read_full(worker.control, &hdr, sizeof(hdr)) == 0 && hdr.size <= SERVE_MAX_REQUEST &&
+            (request = libc_malloc((size_t)hdr.size + 1)) != NULL &&
+            read_full(worker.control, request, hdr.size) == 0)
+        {
+            request[hdr.size] = 0;
+            char *cursor = request + strlen(request) + 1;
+            char **argv = unpack_strings(&cursor, request + hdr.size, hdr.argc);
+            envp = argv ? unpack_strings(&cursor, request + hdr.size, hdr.envc) : NULL;
+            libc_free(argv);
+        }
+        char *src = NULL;
+        int ok = nfds == SERVE_REQUEST_FDS + 1 && envp && snapshot_current(&src, envp);
+        if (write_full(worker.control, ok ? "A" : "S", 1) != 0 || !ok)
+        {
+            _exit(0);
+        }
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            signal(SIGCHLD, SIG_DFL);
+            fork_supervised(fds[0], -1, -1, -1, -1);
+            environ = envp;
+            resume_worker(ctx, l, src, fds);
+            return;
+        }
+        libc_free(envp);
+        libc_free(request);
+        libc_free(src);
+        close_fds(fds, nfds);
+    }
+}
+
+static void take_snapshot(ParserContext *ctx, Lexer *l)
+{
+    fflush(stdout);
+    fflush(stderr);
+    fflush(ctx->cg.hoist_out);
+
+    char *resolved = z_resolve_path(ctx->config->input_file, ctx->config->input_file,
+                                    ctx->config);
+    size_t len = 0;
+    worker.path = resolved;
+    worker.prefix = resolved ? read_file_libc(resolved, &len) : NULL;
+    if (!worker.prefix || len < (size_t)l->pos || memcmp(worker.prefix, l->src, (size_t)l->pos))
+    {
+        // The file changed while it was being parsed; serve this request without a snapshot.
+        release_output();
+        close(worker.control);
+        worker.control = -1;
+        return;
+    }
+    worker.prefix_len = l->pos;
+    worker.hoist_len = ftell(ctx->cg.hoist_out);
+    worker.hook_time = z_get_monotonic_time();
+
+    size_t cap = zmap_size(&ctx->imports.imported_files);
+    worker.deps = libc_malloc((cap ? cap : 1) * sizeof(ServeDep));
+    zmap_iter_FileSet it = zmap_iter_init(FileSet, &ctx->imports.imported_files);
+    const char *key;
+    const char *val;
+    while (worker.deps && zmap_iter_next(&it, &key, &val))
+    {
+        struct stat st;
+        if (key && worker.dep_count < cap && stat(key, &st) == 0)
+        {
+            worker.deps[worker.dep_count].path = xstrdup(key);
+            worker.deps[worker.dep_count].mtime_ns = stat_mtime_ns(&st);
+            worker.deps[worker.dep_count].size = st.st_size;
+            worker.dep_count++;
+        }
+    }
+    collect_directive_env(worker.prefix);
+    for (size_t i = 0; i < worker.dep_count; i++)
+    {
+        size_t dep_len = 0;
+        char *text = read_file_libc(worker.deps[i].path, &dep_len);
+        if (text)
+        {
+            collect_directive_env(text);
+            libc_free(text);
+        }
+    }
+
+    // Keep what was printed so far for the workers forked later, then hand this process
+    // over to the client that started it.
+    fflush(stdout);
+    fflush(stderr);
+    replay(worker.cap_out, worker.client_out, &worker.out, &worker.out_len);
+    replay(worker.cap_err, worker.client_err, &worker.err, &worker.err_len);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close_fds(&worker.client_out, 1);
+        close_fds(&worker.client_err, 1);
+        close_fds(&worker.cap_out, 1);
+        close_fds(&worker.cap_err, 1);
+        snapshot_loop(ctx, l);
+        return;
+    }
+
+    close(worker.control);
+    worker.control = -1;
+    release_output();
+    reopen_hoist(ctx);
+}
+
+int serve_arm_snapshot(ParserContext *ctx, Lexer *l)
+{
+    if (!worker.active || worker.control < 0)
+    {
+        return 0;
+    }
+    // A cached build can finish (and run) before parsing; it gets its output live instead.
+    if (ctx->config->use_build_cache || !ctx->cg.hoist_out)
+    {
+        release_output();
+        close(worker.control);
+        worker.control = -1;
+        return 0;
+    }
+    ctx->hook_imports_parsed = take_snapshot;
+    ctx->hook_imports_lexer = l;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+// Server
+// ----------------------------------------------------------------------------
+
+// Compile a request in a new worker. The worker prints into capture files until it either
+// reaches the snapshot point or decides not to take one.
+static void spawn_worker(const ServeHeader *hdr, char *request, int client, int *fds,
+                         ServeCompileFn compile, ServeSlot *slot)
+{
+    int ctl[2] = {-1, -1};
+    if (slot && socketpair(AF_UNIX, SOCK_STREAM, 0, ctl) != 0)
+    {
+        slot = NULL;
+    }
+
+    pid_t pid = fork();
+    if (pid != 0)
+    {
+        if (ctl[1] >= 0)
+        {
+            close(ctl[1]);
+        }
+        if (pid < 0 || !slot)
+        {
+            if (ctl[0] >= 0)
+            {
+                close(ctl[0]);
+            }
+            if (pid < 0)
+            {
+                int32_t code = 1;
+                write_full(client, &code, sizeof(code));
+            }
+            return;
+        }
+        slot->control = ctl[0];
+        return;
+    }
+
+    // Supervisor for this request.
+    close_server_fds(-1);
+    if (ctl[0] >= 0)
+    {
+        close(ctl[0]);
+    }
+    signal(SIGCHLD, SIG_DFL);
+    FILE *cap_out = tmpfile();
+    FILE *cap_err = tmpfile();
+    int cap_out_fd = cap_out ? fileno(cap_out) : -1;
+    int cap_err_fd = cap_err ? fileno(cap_err) : -1;
+    if (cap_out_fd < 0 || cap_err_fd < 0)
+    {
+        cap_out_fd = cap_err_fd = -1;
+    }
+    if (fork_supervised(client, cap_out_fd, cap_err_fd, fds[1], fds[2]) != 0)
+    {
+        _exit(0);
+    }
+
+    // Worker.
+    close(client);
+    char *cursor = request;
+    char *end = request + hdr->size;
+    char *cwd = cursor;
+    cursor += strlen(cwd) + 1;
+    char **argv = unpack_strings(&cursor, end, hdr->argc);
+    char **envp = unpack_strings(&cursor, end, hdr->envc);
+    if (!argv || !envp || chdir(cwd) != 0)
+    {
+        _exit(1);
+    }
+    environ = envp;
+
+    dup2(fds[0], 0);
+    if (cap_out_fd >= 0)
+    {
+        zcolors_assume_tty(1, isatty(fds[1]));
+        zcolors_assume_tty(2, isatty(fds[2]));
+        worker.client_out = dup(fds[1]);
+        worker.client_err = dup(fds[2]);
+        worker.cap_out = dup(cap_out_fd);
+        worker.cap_err = dup(cap_err_fd);
+        dup2(cap_out_fd, 1);
+        dup2(cap_err_fd, 2);
+    }
+    else
+    {
+        dup2(fds[1], 1);
+        dup2(fds[2], 2);
+    }
+    close_fds(fds, SERVE_REQUEST_FDS);
+    worker.active = 1;
+    worker.control = ctl[1];
+    if (worker.cap_out < 0 && worker.control >= 0)
+    {
+        close(worker.control);
+        worker.control = -1;
+    }
+
+    exit(compile((int)hdr->argc, argv));
+}
+
+// Environment entries that change what a compile does: zc's own settings, where cc and the
+// caches are found, and colors. The rest (what a `zc run` program reads) goes to the worker.
+static int env_affects_compile(const char *entry)
+{
+    static const char *const names[] = {"PATH=", "HOME=", "XDG_CACHE_HOME=", "TMPDIR=",
+                                        "NO_COLOR="};
+    if (strncmp(entry, "ZC_", 3) == 0)
+    {
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (strncmp(entry, names[i], strlen(names[i])) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The part of a request a snapshot is made for: cwd, argv and env_affects_compile() entries.
+// Whether the files it parsed are still current is for the snapshot to decide.
+static char *snapshot_key(const ServeHeader *hdr, const char *request, size_t *size)
+{
+    char *key = libc_malloc(hdr->size);
+    if (!key)
+    {
+        return NULL;
+    }
+    const char *p = request;
+    const char *end = request + hdr->size;
+    size_t len = 0;
+    for (uint32_t i = 0; i < 1 + hdr->argc + hdr->envc && p < end; i++)
+    {
+        size_t n = strlen(p) + 1;
+        if (i <= hdr->argc || env_affects_compile(p))
+        {
+            memcpy(key + len, p, n);
+            len += n;
+        }
+        p += n;
+    }
+    *size = len;
+    return key;
+}
+
+static ServeSlot *find_slot(const char *key, size_t size)
+{
+    for (int i = 0; i < SERVE_MAX_SNAPSHOTS; i++)
+    {
+        ServeSlot *s = &slots[i];
+        if (s->control >= 0 && s->size == size && memcmp(s->key, key, size) == 0)
+        {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+static void free_slot(ServeSlot *s)
+{
+    if (s->control >= 0)
+    {
+        close(s->control);
+    }
+    libc_free(s->key);
+    s->key = NULL;
+    s->size = 0;
+    s->control = -1;
+}
+
+static ServeSlot *claim_slot(char *key, size_t size)
+{
+    ServeSlot *victim = &slots[0];
+    for (int i = 0; i < SERVE_MAX_SNAPSHOTS; i++)
+    {
+        if (slots[i].control < 0)
+        {
+            victim = &slots[i];
+            break;
+        }
+        if (slots[i].last_used < victim->last_used)
+        {
+            victim = &slots[i];
+        }
+    }
+    free_slot(victim);
+    victim->key = key;
+    victim->size = size;
+    victim->last_used = ++serve_tick;
+    return victim;
+}
+
+// Hand a request to a live snapshot. Returns 0 if the snapshot accepted it.
+static int forward_to_slot(ServeSlot *s, int client, int *fds, const ServeHeader *hdr,
+                           const char *request)
+{
+    // A snapshot never talks first; anything readable means it is gone.
+    struct pollfd p = {s->control, POLLIN, 0};
+    if (poll(&p, 1, 0) != 0)
+    {
+        return -1;
+    }
+    int all[SERVE_REQUEST_FDS + 1] = {client, fds[0], fds[1], fds[2]};
+    if (send_with_fds(s->control, "R", 1, all, SERVE_REQUEST_FDS + 1) != 0 ||
+        write_full(s->control, hdr, sizeof(*hdr)) != 0 ||
+        write_full(s->control, request, hdr->size) != 0)
+    {
+        return -1;
+    }
+    p.revents = 0;
+    if (poll(&p, 1, SERVE_REPLY_TIMEOUT_MS) <= 0)
+    {
+        return -1;
+    }
+    char reply = 0;
+    if (read_full(s->control, &reply, 1) != 0 || reply != 'A')
+    {
+        return -1;
+    }
+    s->last_used = ++serve_tick;
+    return 0;
+}
+
+static void set_recv_timeout(int sock, int ms)
+{
+    struct timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0)
+    {
+        // Without the timeout a stalled client only delays the requests queued behind it.
+    }
+}
+
+static void handle_client(int client, ServeCompileFn compile, int verbose)
+{
+    ServeHeader hdr;
+    int fds[SERVE_REQUEST_FDS] = {-1, -1, -1};
+    int nfds = 0;
+    // The server reads requests one at a time; a client that connects and then sends nothing
+    // must not hold up the others.
+    set_recv_timeout(client, SERVE_REQUEST_TIMEOUT_MS);
+    if (recv_with_fds(client, &hdr, sizeof(hdr), fds, SERVE_REQUEST_FDS, &nfds) != 0 ||
+        hdr.magic != SERVE_MAGIC || hdr.size == 0 || hdr.size > SERVE_MAX_REQUEST ||
+        nfds != SERVE_REQUEST_FDS || hdr.argc == 0)
+    {
+        close_fds(fds, nfds);
+        return;
+    }
+    char *request = libc_malloc(hdr.size);
+    if (!request || read_full(client, request, hdr.size) != 0 || request[hdr.size - 1] != 0)
+    {
+        libc_free(request);
+        close_fds(fds, nfds);
+        return;
+    }
+    set_recv_timeout(client, 0);
+
+    size_t key_size = 0;
+    char *key = snapshot_key(&hdr, request, &key_size);
+    ServeSlot *slot = key ? find_slot(key, key_size) : NULL;
+    if (slot && forward_to_slot(slot, client, fds, &hdr, request) == 0)
+    {
+        if (verbose)
+        {
+            printf(COLOR_BOLD COLOR_CYAN "    Snapshot" COLOR_RESET " hit\n");
+            fflush(stdout);
+        }
+        libc_free(key);
+    }
+    else
+    {
+        if (slot)
+        {
+            free_slot(slot);
+        }
+        if (verbose)
+        {
+            printf(COLOR_BOLD COLOR_CYAN "    Snapshot" COLOR_RESET " miss\n");
+            fflush(stdout);
+        }
+        // The slot owns the key; the worker reads the request from its copy of memory.
+        slot = key ? claim_slot(key, key_size) : NULL;
+        spawn_worker(&hdr, request, client, fds, compile, slot);
+        if (slot && slot->control < 0)
+        {
+            free_slot(slot);
+        }
+    }
+    libc_free(request);
+    close_fds(fds, SERVE_REQUEST_FDS);
+}
+
+int serve_main(int argc, char **argv, ServeCompileFn compile)
+{
+    char path_buf[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    const char *path = NULL;
+    int verbose = 0;
+    int quiet = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+        {
+            path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0)
+        {
+            verbose = 1;
+        }
+        else if (strcmp(argv[i], "--quiet") == 0 || strcmp(argv[i], "-q") == 0)
+        {
+            quiet = 1;
+        }
+        else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+        {
+            print_command_help("serve");
+            return 0;
+        }
+        else
+        {
+            fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET ": unknown option '%s'\n",
+                    argv[i]);
+            return 1;
+        }
+    }
+
+    if (!path)
+    {
+        path = default_socket_path(path_buf, sizeof(path_buf), 1);
+    }
+    if (!path)
+    {
+        char dir[MAX_PATH_SIZE];
+        serve_private_dir(dir, sizeof(dir), 0);
+        fprintf(stderr,
+                COLOR_BOLD COLOR_RED "error" COLOR_RESET
+                ": %s must be a directory that only you can access (mode 0700); use --socket\n",
+                dir);
+        return 1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET ": socket path too long: %s\n",
+                path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Snapshots outlive edits to the files they parsed, which may be truncated meanwhile.
+    source_copy_files(1);
+
+    for (int i = 0; i < SERVE_MAX_SNAPSHOTS; i++)
+    {
+        slots[i].control = -1;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+    unlink(path);
+    mode_t old_mask = umask(077);
+    int bound = bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (bound != 0 || listen(listen_fd, 64) != 0)
+    {
+        fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET ": cannot listen on %s: %s\n",
+                path, strerror(errno));
+        return 1;
+    }
+
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    if (!quiet)
+    {
+        printf(COLOR_BOLD COLOR_GREEN "     Serving" COLOR_RESET " on %s (set ZC_SERVER=%s)\n",
+               path, path);
+        fflush(stdout);
+    }
+
+    for (;;)
+    {
+        int client = accept(listen_fd, NULL, NULL);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            perror("accept");
+            return 1;
+        }
+        if (!peer_is_self(client))
+        {
+            close(client);
+            continue;
+        }
+        handle_client(client, compile, verbose);
+        close(client);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Client
+// ----------------------------------------------------------------------------
+
+static int append_string(char **buf, size_t *len, size_t *cap, const char *s)
+{
+    size_t n = strlen(s) + 1;
+    if (*len + n > *cap)
+    {
+        size_t grown = (*cap ? *cap * 2 : 4096);
+        while (grown < *len + n)
+        {
+            grown *= 2;
+        }
+        char *p = libc_realloc(*buf, grown);
+        if (!p)
+        {
+            return -1;
+        }
+        *buf = p;
+        *cap = grown;
+    }
+    memcpy(*buf + *len, s, n);
+    *len += n;
+    return 0;
+}
+
+int serve_client(int argc, char **argv, int *status)
+{
+    const char *env = getenv("ZC_SERVER");
+    if (!env || !env[0] || strcmp(env, "0") == 0 || argc < 2)
+    {
+        return 0;
+    }
+    // Interactive and long-running commands stay local.
+    if (strcmp(argv[1], "serve") == 0 || strcmp(argv[1], "watch") == 0 ||
+        strcmp(argv[1], "lsp") == 0 || strcmp(argv[1], "repl") == 0)
+    {
+        return 0;
+    }
+
+    char path_buf[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    const char *path = default_socket_path(path_buf, sizeof(path_buf), 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (!path || strlen(path) >= sizeof(addr.sun_path))
+    {
+        return 0;
+    }
+    strcpy(addr.sun_path, path);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        return 0;
+    }
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(sock);
+        return 0;
+    }
+    if (!peer_is_self(sock))
+    {
+        zwarn("%s is served by another user; compiling locally", path);
+        close(sock);
+        return 0;
+    }
+
+    char cwd[MAX_PATH_SIZE];
+    if (!getcwd(cwd, sizeof(cwd)))
+    {
+        close(sock);
+        return 0;
+    }
+
+    char *buf = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    uint32_t envc = 0;
+    int failed = append_string(&buf, &len, &cap, cwd);
+    for (int i = 0; i < argc && !failed; i++)
+    {
+        failed = append_string(&buf, &len, &cap, argv[i]);
+    }
+    for (char **e = environ; e && *e && !failed; e++, envc++)
+    {
+        failed = append_string(&buf, &len, &cap, *e);
+    }
+    if (failed || len > SERVE_MAX_REQUEST)
+    {
+        libc_free(buf);
+        close(sock);
+        return 0;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    ServeHeader hdr = {SERVE_MAGIC, (uint32_t)len, (uint32_t)argc, envc};
+    int fds[SERVE_REQUEST_FDS] = {0, 1, 2};
+    int sent = send_with_fds(sock, &hdr, sizeof(hdr), fds, SERVE_REQUEST_FDS) == 0 &&
+               write_full(sock, buf, len) == 0;
+    libc_free(buf);
+    if (!sent)
+    {
+        close(sock);
+        return 0;
+    }
+
+    int32_t code;
+    if (read_full(sock, &code, sizeof(code)) != 0)
+    {
+        fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET
+                                             ": lost connection to zc serve at %s\n",
+                path);
+        code = 1;
+    }
+    close(sock);
+    *status = code;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef ZC_ALLOW_INTERNAL
+#error "driver/serve.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#ifndef SERVE_H
+#define SERVE_H
+
+#include "../compiler.h"
+#include "../token.h"
+
+struct ParserContext;
+
+/**
+ * @brief Compile server (`zc serve`).
+ *
+ * The server listens on a Unix socket. A client (any `zc` invocation with ZC_SERVER set) sends
+ * its argv, working directory and environment together with its stdin/stdout/stderr, and gets
+ * the exit status back; diagnostics and program output go straight to the client's descriptors.
+ *
+ * The first request for a given argv, cwd and compile-relevant environment (ZC_*, PATH, the
+ * cache locations) is compiled by a forked process that stops once the main file's leading
+ * imports are parsed and forks a snapshot of itself. Later requests with the same invocation
+ * are forked from that snapshot, with their own full environment, and only parse what follows
+ * the imports, as long as the text up to that point, every imported file and the variables
+ * their build directives expand are unchanged.
+ */
+
+/** @brief Signature of the regular command-line entry point run for each request. */
+typedef int (*ServeCompileFn)(int argc, char **argv);
+
+/**
+ * @brief Entry point for `zc serve [--socket <path>]`. Runs until killed.
+ * @return Process exit code on startup failure.
+ */
+int serve_main(int argc, char **argv, ServeCompileFn compile);
+
+/**
+ * @brief Forward this invocation to a running server when ZC_SERVER is set.
+ *
+ * ZC_SERVER is either a socket path or "1" for the default path.
+ * @return 1 with the exit status in @p status if a server handled the request, 0 if the
+ *         caller should compile locally (ZC_SERVER unset, no server listening).
+ */
+int serve_client(int argc, char **argv, int *status);
+
+/**
+ * @brief Directory for the default server sockets: $XDG_RUNTIME_DIR, else `<tmp>/zc-<uid>`.
+ *
+ * With @p create set, the latter is created with mode 0700 if missing.
+ * @return 1 with the path in @p buf if the directory is owned by this user and closed to everyone
+ *         else, 0 otherwise.
+ */
+int serve_private_dir(char *buf, size_t size, int create);
+
+/**
+ * @brief Arm the snapshot hook for driver_compile() when running inside a server worker.
+ * @return 1 if ctx->hook_imports_parsed was installed.
+ */
+int serve_arm_snapshot(struct ParserContext *ctx, Lexer *l);
+
+#endif // SERVE_H
@@ -0,0 +1,704 @@
+// SPDX-License-Identifier: MIT
+#include "watch.h"
+#include "../utils/utils.h"
+#include "../constants.h"
+#include "../utils/colors.h"
+#include "../utils/cmd.h"
+#include "../utils/source_manager.h"
+#include "../platform/os.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ZC_OS_WINDOWS
+
+int watch_main(int argc, char **argv, ServeCompileFn compile)
+{
+    (void)argc;
+    (void)argv;
+    (void)compile;
+    fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET
+                                         ": zc watch needs Unix domain sockets and fork()\n");
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/prctl.h>
+#endif
+
+enum
+{
+    WATCH_QUIET_MS = 100,       ///< A burst of changes ends after this long without events.
+    WATCH_POLL_MS = 300,        ///< Stat interval when inotify is not available.
+    WATCH_STOP_MS = 1000,       ///< Grace period between SIGTERM and SIGKILL for --run.
+    WATCH_SERVER_WAIT_MS = 2000 ///< How long to wait for the private server's socket.
+};
+
+/// A file the last build read.
+typedef struct
+{
+    char *path;         ///< Absolute path, as written by --emit-deps.
+    const char *name;   ///< Basename within path.
+    long long mtime_ns; ///< When the watch was set up; -1 if the file was missing.
+    int wd;             ///< inotify watch of the parent directory, -1 if none.
+} WatchFile;
+
+static struct
+{
+    char **build_argv; ///< zc build <user args> --emit-deps <deps_path>
+    int build_argc;
+    char **run_argv; ///< Program, then the arguments after "--".
+    int run;
+    int quiet;
+    const char *main_file; ///< Watched when a build fails before any deps are known.
+    char deps_path[MAX_PATH_LEN];
+    char sock_path[MAX_PATH_LEN];
+    pid_t server;
+    pid_t program;
+    char *target; ///< Output of the last build.
+    WatchFile *files;
+    size_t file_count;
+} watch;
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static long long stat_mtime_ns(const struct stat *st)
+{
+#if defined(__APPLE__)
+    return (long long)st->st_mtimespec.tv_sec * 1000000000LL + st->st_mtimespec.tv_nsec;
+#else
+    return (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+#endif
+}
+
+static long long file_mtime_ns(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? stat_mtime_ns(&st) : -1;
+}
+
+// Wall clock, comparable with file modification times.
+static long long wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static char *dup_string(const char *s)
+{
+    size_t n = strlen(s) + 1;
+    char *copy = libc_malloc(n);
+    if (copy)
+    {
+        memcpy(copy, s, n);
+    }
+    return copy;
+}
+
+// ----------------------------------------------------------------------------
+// File set
+// ----------------------------------------------------------------------------
+
+static void clear_files(WatchFile *files, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        libc_free(files[i].path);
+    }
+    libc_free(files);
+}
+
+static void add_file(WatchFile **files, size_t *count, const char *path)
+{
+    for (size_t i = 0; i < *count; i++)
+    {
+        if (strcmp((*files)[i].path, path) == 0)
+        {
+            return;
+        }
+    }
+    WatchFile *grown = libc_realloc(*files, (*count + 1) * sizeof(WatchFile));
+    if (!grown)
+    {
+        return;
+    }
+    *files = grown;
+    WatchFile *f = &grown[*count];
+    f->path = dup_string(path);
+    if (!f->path)
+    {
+        return;
+    }
+    const char *slash = strrchr(f->path, '/');
+    f->name = slash ? slash + 1 : f->path;
+    f->mtime_ns = -1;
+    f->wd = -1;
+    (*count)++;
+}
+
+// Next word of a make rule: skips line continuations and undoes `\ ` escaping in place.
+static char *next_word(char **cursor)
+{
+    char *p = *cursor;
+    for (;;)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+        {
+            p++;
+        }
+        if (p[0] == '\\' && (p[1] == '\n' || p[1] == '\r'))
+        {
+            p++;
+            continue;
+        }
+        break;
+    }
+    if (!*p)
+    {
+        *cursor = p;
+        return NULL;
+    }
+    char *word = p;
+    char *out = p;
+    while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+    {
+        if (*p == '\\' && p[1] && p[1] != '\n' && p[1] != '\r')
+        {
+            p++;
+        }
+        *out++ = *p++;
+    }
+    if (*p)
+    {
+        p++;
+    }
+    *out = '\0';
+    *cursor = p;
+    return word;
+}
+
+// Replace the file set with the one recorded by the last build's --emit-deps.
+static int read_deps(void)
+{
+    FILE *f = fopen(watch.deps_path, "rb");
+    if (!f)
+    {
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = size >= 0 ? libc_malloc((size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, f) != (size_t)size)
+    {
+        libc_free(text);
+        fclose(f);
+        return 0;
+    }
+    text[size] = '\0';
+    fclose(f);
+
+    char *cursor = text;
+    char *target = next_word(&cursor);
+    size_t target_len = target ? strlen(target) : 0;
+    if (target_len < 2 || target[target_len - 1] != ':')
+    {
+        libc_free(text);
+        return 0;
+    }
+    target[target_len - 1] = '\0';
+
+    WatchFile *files = NULL;
+    size_t count = 0;
+    for (char *w = next_word(&cursor); w; w = next_word(&cursor))
+    {
+        add_file(&files, &count, w);
+    }
+    if (count == 0)
+    {
+        libc_free(text);
+        return 0;
+    }
+
+    libc_free(watch.target);
+    watch.target = dup_string(target);
+    clear_files(watch.files, watch.file_count);
+    watch.files = files;
+    watch.file_count = count;
+    libc_free(text);
+    return 1;
+}
+
+// Record the current modification times. A file written while the build ran (so after
+// @p started) counts as changed right away, since no watch was set up to see it.
+static const char *snapshot_files(long long started)
+{
+    const char *changed = NULL;
+    for (size_t i = 0; i < watch.file_count; i++)
+    {
+        watch.files[i].mtime_ns = file_mtime_ns(watch.files[i].path);
+        if (!changed && watch.files[i].mtime_ns > started)
+        {
+            changed = watch.files[i].path;
+        }
+    }
+    return changed;
+}
+
+// ----------------------------------------------------------------------------
+// Processes
+// ----------------------------------------------------------------------------
+
+static void start_server(ServeCompileFn compile)
+{
+    char dir[MAX_PATH_LEN - 32];
+    if (!serve_private_dir(dir, sizeof(dir), 1))
+    {
+        // Builds compile locally.
+        return;
+    }
+    snprintf(watch.sock_path, sizeof(watch.sock_path), "%s/zc-watch-%d.sock", dir, z_get_pid());
+    unlink(watch.sock_path);
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return;
+    }
+    if (pid == 0)
+    {
+#if defined(__linux__)
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+        char *args[] = {"zc", "serve", "--socket", watch.sock_path, "--quiet", NULL};
+        exit(serve_main(5, args, compile));
+    }
+    watch.server = pid;
+
+    for (int waited = 0; waited < WATCH_SERVER_WAIT_MS; waited += 10)
+    {
+        struct stat st;
+        if (stat(watch.sock_path, &st) == 0 && S_ISSOCK(st.st_mode))
+        {
+            setenv("ZC_SERVER", watch.sock_path, 1);
+            return;
+        }
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            break;
+        }
+        poll(NULL, 0, 10);
+    }
+    // Builds fall back to a local compile per change.
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    watch.server = 0;
+}
+
+static void stop_server(void)
+{
+    if (watch.server > 0)
+    {
+        kill(watch.server, SIGTERM);
+        waitpid(watch.server, NULL, 0);
+        watch.server = 0;
+    }
+    unlink(watch.sock_path);
+}
+
+static int build(ServeCompileFn compile)
+{
+    remove(watch.deps_path);
+    int status = 0;
+    if (serve_client(watch.build_argc, watch.build_argv, &status))
+    {
+        return status;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0)
+    {
+        exit(compile(watch.build_argc, watch.build_argv));
+    }
+    int wstatus = 0;
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR)
+    {
+    }
+    return WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 1;
+}
+
+static void report_exit(int wstatus)
+{
+    if (watch.quiet)
+    {
+        return;
+    }
+    if (WIFSIGNALED(wstatus))
+    {
+        printf(COLOR_BOLD COLOR_YELLOW "      Exited" COLOR_RESET " on signal %d\n",
+               WTERMSIG(wstatus));
+    }
+    else
+    {
+        printf(COLOR_BOLD COLOR_YELLOW "      Exited" COLOR_RESET " with status %d\n",
+               WEXITSTATUS(wstatus));
+    }
+    fflush(stdout);
+}
+
+// Reap the program if it finished on its own.
+static void reap_program(void)
+{
+    int wstatus = 0;
+    if (watch.program > 0 && waitpid(watch.program, &wstatus, WNOHANG) == watch.program)
+    {
+        watch.program = 0;
+        report_exit(wstatus);
+    }
+}
+
+static void stop_program(void)
+{
+    if (watch.program <= 0)
+    {
+        return;
+    }
+    kill(watch.program, SIGTERM);
+    for (int waited = 0; waited < WATCH_STOP_MS; waited += 10)
+    {
+        if (waitpid(watch.program, NULL, WNOHANG) == watch.program)
+        {
+            watch.program = 0;
+            return;
+        }
+        poll(NULL, 0, 10);
+    }
+    kill(watch.program, SIGKILL);
+    waitpid(watch.program, NULL, 0);
+    watch.program = 0;
+}
+
+static void start_program(void)
+{
+    char exe[MAX_PATH_LEN];
+    snprintf(exe, sizeof(exe), "%s%s", strchr(watch.target, '/') ? "" : "./", watch.target);
+    if (!watch.quiet)
+    {
+        printf(COLOR_BOLD COLOR_GREEN "     Running" COLOR_RESET " %s\n", exe);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return;
+    }
+    if (pid == 0)
+    {
+        // The program is not a client of our server, and any zc it runs should not be either.
+        unsetenv("ZC_SERVER");
+        watch.run_argv[0] = exe;
+        execv(exe, watch.run_argv);
+        perror(exe);
+        _exit(127);
+    }
+    watch.program = pid;
+}
+
+// ----------------------------------------------------------------------------
+// Waiting for changes
+// ----------------------------------------------------------------------------
+
+static const char *wait_polling(void)
+{
+    const char *changed = NULL;
+    for (;;)
+    {
+        poll(NULL, 0, changed ? WATCH_QUIET_MS : WATCH_POLL_MS);
+        if (stop_requested)
+        {
+            return NULL;
+        }
+        reap_program();
+        int any = 0;
+        for (size_t i = 0; i < watch.file_count; i++)
+        {
+            long long now = file_mtime_ns(watch.files[i].path);
+            if (now != watch.files[i].mtime_ns)
+            {
+                watch.files[i].mtime_ns = now;
+                any = 1;
+                if (!changed)
+                {
+                    changed = watch.files[i].path;
+                }
+            }
+        }
+        if (changed && !any)
+        {
+            return changed;
+        }
+    }
+}
+
+#if defined(__linux__)
+
+// Watch the parent directories rather than the files: editors that save by writing a new file
+// and renaming it over the old one would otherwise leave a watch on a deleted inode.
+static const char *wait_inotify(int fd)
+{
+    for (size_t i = 0; i < watch.file_count; i++)
+    {
+        WatchFile *f = &watch.files[i];
+        char dir[MAX_PATH_LEN];
+        size_t dir_len = (size_t)(f->name - f->path);
+        if (dir_len == 0 || dir_len >= sizeof(dir))
+        {
+            continue;
+        }
+        memcpy(dir, f->path, dir_len);
+        dir[dir_len > 1 ? dir_len - 1 : dir_len] = '\0';
+        f->wd = inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    }
+
+    const char *changed = NULL;
+    for (;;)
+    {
+        int timeout = changed ? WATCH_QUIET_MS : (watch.program > 0 ? WATCH_POLL_MS : -1);
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int n = poll(&pfd, 1, timeout);
+        if (stop_requested)
+        {
+            return NULL;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("poll");
+            return NULL;
+        }
+        if (n == 0)
+        {
+            if (changed)
+            {
+                return changed;
+            }
+            reap_program();
+            continue;
+        }
+
+        union
+        {
+            struct inotify_event event;
+            char bytes[4096];
+        } buf;
+        ssize_t len;
+        while ((len = read(fd, buf.bytes, sizeof(buf.bytes))) > 0)
+        {
+            const struct inotify_event *ev;
+            for (char *p = buf.bytes; p < buf.bytes + len; p += sizeof(*ev) + ev->len)
+            {
+                ev = (const struct inotify_event *)p;
+                for (size_t i = 0; !changed && ev->len > 0 && i < watch.file_count; i++)
+                {
+                    if (watch.files[i].wd == ev->wd && strcmp(watch.files[i].name, ev->name) == 0)
+                    {
+                        changed = watch.files[i].path;
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+static const char *wait_for_change(long long started)
+{
+    const char *changed = snapshot_files(started);
+    if (changed)
+    {
+        return changed;
+    }
+#if defined(__linux__)
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0)
+    {
+        changed = wait_inotify(fd);
+        close(fd);
+        return changed;
+    }
+#endif
+    return wait_polling();
+}
+
+// ----------------------------------------------------------------------------
+// Entry point
+// ----------------------------------------------------------------------------
+
+static int parse_args(int argc, char **argv)
+{
+    watch.build_argv = libc_malloc((size_t)(argc + 4) * sizeof(char *));
+    watch.run_argv = libc_malloc((size_t)(argc + 1) * sizeof(char *));
+    if (!watch.build_argv || !watch.run_argv)
+    {
+        return 0;
+    }
+    int b = 0;
+    int r = 0;
+    watch.build_argv[b++] = argv[0];
+    watch.build_argv[b++] = "build";
+    watch.run_argv[r++] = NULL; // The executable, filled in by start_program().
+    int rest = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (rest)
+        {
+            watch.run_argv[r++] = argv[i];
+        }
+        else if (strcmp(argv[i], "--") == 0)
+        {
+            rest = 1;
+        }
+        else if (strcmp(argv[i], "--run") == 0)
+        {
+            watch.run = 1;
+        }
+        else
+        {
+            if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0)
+            {
+                watch.quiet = 1;
+            }
+            else if (z_path_has_extension(argv[i], ".zc"))
+            {
+                watch.main_file = argv[i];
+            }
+            watch.build_argv[b++] = argv[i];
+        }
+    }
+    watch.build_argv[b++] = "--emit-deps";
+    watch.build_argv[b++] = watch.deps_path;
+    watch.build_argv[b] = NULL;
+    watch.build_argc = b;
+    watch.run_argv[r] = NULL;
+    return 1;
+}
+
+int watch_main(int argc, char **argv, ServeCompileFn compile)
+{
+    for (int i = 2; i < argc && strcmp(argv[i], "--") != 0; i++)
+    {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+        {
+            print_command_help("watch");
+            return 0;
+        }
+    }
+    if (argc < 3 || !parse_args(argc, argv))
+    {
+        print_command_help("watch");
+        return 1;
+    }
+    // Saving a file may truncate it while a build still reads it.
+    source_copy_files(1);
+    snprintf(watch.deps_path, sizeof(watch.deps_path), "%s/zc-watch-%d.d", z_get_temp_dir(),
+             z_get_pid());
+
+    start_server(compile);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+
+    int status = 0;
+    while (!stop_requested)
+    {
+        stop_program();
+        long long started = wall_ns();
+        status = build(compile);
+        if (stop_requested)
+        {
+            break;
+        }
+
+        if (!read_deps() && watch.file_count == 0 && watch.main_file)
+        {
+            char abs_path[MAX_PATH_LEN];
+            z_get_absolute_path(watch.main_file, abs_path, sizeof(abs_path));
+            add_file(&watch.files, &watch.file_count, abs_path);
+        }
+        if (watch.file_count == 0)
+        {
+            fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET
+                                                 ": the build read no files to watch\n");
+            status = status ? status : 1;
+            break;
+        }
+        if (status == 0 && watch.run && watch.target)
+        {
+            start_program();
+        }
+
+        if (!watch.quiet)
+        {
+            printf(COLOR_BOLD COLOR_CYAN "    Watching" COLOR_RESET " %zu file%s\n",
+                   watch.file_count, watch.file_count == 1 ? "" : "s");
+            fflush(stdout);
+        }
+        const char *changed = wait_for_change(started);
+        if (!changed)
+        {
+            break;
+        }
+        if (!watch.quiet)
+        {
+            printf(COLOR_BOLD COLOR_CYAN "     Changed" COLOR_RESET " %s\n", changed);
+            fflush(stdout);
+        }
+    }
+
+    stop_program();
+    stop_server();
+    remove(watch.deps_path);
+    clear_files(watch.files, watch.file_count);
+    libc_free(watch.target);
+    libc_free(watch.build_argv);
+    libc_free(watch.run_argv);
+    return stop_requested ? 0 : status;
+}
+
+#endif
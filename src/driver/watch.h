@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef ZC_ALLOW_INTERNAL
+#error "driver/watch.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "serve.h"
+
+/**
+ * @brief Incremental rebuild mode (`zc watch`).
+ *
+ * Each build is a `zc build ... --emit-deps` request to a private compile server, so the file
+ * set to watch is exactly what the last build read and an edit that leaves the imports alone
+ * is compiled from the server's post-import snapshot. Changes are picked up with inotify on
+ * Linux and by polling modification times elsewhere, and coalesced until the tree is quiet.
+ */
+
+/**
+ * @brief Entry point for `zc watch [--run] [build options] <file> [-- <program args>]`.
+ *
+ * Runs until interrupted. @p compile builds locally if the private server cannot be started.
+ * @return Process exit code.
+ */
+int watch_main(int argc, char **argv, ServeCompileFn compile);
+
+#endif // WATCH_H
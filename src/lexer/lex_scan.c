@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: MIT
+#include "lex_scan.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__) &&       \
+    !defined(__TINYC__)
+#define LEX_SCAN_X86 1
+#include <immintrin.h>
+#else
+#define LEX_SCAN_X86 0
+#endif
+
+#if LEX_SCAN_X86
+
+// The aligned loads read the start of the first block and the tail of the last one, which lie
+// outside the string but inside its pages; the sanitizers would report them.
+#if defined(__clang__)
+#define LEX_SCAN_RAW_READ __attribute__((no_sanitize("address", "memory")))
+#else
+#define LEX_SCAN_RAW_READ __attribute__((no_sanitize_address))
+#endif
+
+static int avx2_state = -1;
+
+static int have_avx2(void)
+{
+    if (avx2_state < 0)
+    {
+        __builtin_cpu_init();
+        avx2_state = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return avx2_state;
+}
+
+static inline unsigned match16(const char *block, __m128i a, __m128i b)
+{
+    __m128i v = _mm_load_si128((const __m128i *)(const void *)block);
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, b));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return (unsigned)_mm_movemask_epi8(hit);
+}
+
+LEX_SCAN_RAW_READ static const char *scan_until_sse2(const char *p, char a, char b)
+{
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    unsigned skip = (unsigned)((uintptr_t)p & 15);
+    const char *block = p - skip;
+    unsigned mask = match16(block, va, vb) & (0xffffu << skip);
+    while (!mask)
+    {
+        block += 16;
+        mask = match16(block, va, vb);
+    }
+    return block + __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2"))) static inline uint32_t match32(const char *block, __m256i a,
+                                                               __m256i b)
+{
+    __m256i v = _mm256_load_si256((const __m256i *)(const void *)block);
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, a), _mm256_cmpeq_epi8(v, b));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+    return (uint32_t)_mm256_movemask_epi8(hit);
+}
+
+__attribute__((target("avx2"))) LEX_SCAN_RAW_READ static const char *
+scan_until_avx2(const char *p, char a, char b)
+{
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    unsigned skip = (unsigned)((uintptr_t)p & 31);
+    const char *block = p - skip;
+    uint32_t mask = match32(block, va, vb) & (0xffffffffu << skip);
+    while (!mask)
+    {
+        block += 32;
+        mask = match32(block, va, vb);
+    }
+    return block + __builtin_ctz(mask);
+}
+
+// Bytes of @p block that are not ' ' or '\t'..'\r'; NUL is one of them.
+static inline unsigned non_space16(const char *block)
+{
+    __m128i v = _mm_load_si128((const __m128i *)(const void *)block);
+    __m128i sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8('\r' - '\t')), t);
+    return ~(unsigned)_mm_movemask_epi8(_mm_or_si128(sp, ctl)) & 0xffffu;
+}
+
+// Whitespace runs are mostly a newline and an indent, too short to pay for AVX2.
+LEX_SCAN_RAW_READ static const char *skip_space_sse2(const char *p)
+{
+    unsigned skip = (unsigned)((uintptr_t)p & 15);
+    const char *block = p - skip;
+    unsigned mask = non_space16(block) & (0xffffu << skip);
+    while (!mask)
+    {
+        block += 16;
+        mask = non_space16(block);
+    }
+    return block + __builtin_ctz(mask);
+}
+
+// Only whole 16-byte windows inside the range are loaded; the tail is counted bytewise.
+static int count_lines_sse2(const char *from, const char *to, const char **last_nl)
+{
+    const __m128i nl = _mm_set1_epi8('\n');
+    int n = 0;
+    const char *q = from;
+    for (; to - q >= 16; q += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)q);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        if (mask)
+        {
+            n += __builtin_popcount(mask);
+            *last_nl = q + 31 - __builtin_clz(mask);
+        }
+    }
+    for (; q < to; q++)
+    {
+        if (*q == '\n')
+        {
+            n++;
+            *last_nl = q;
+        }
+    }
+    return n;
+}
+
+__attribute__((target("avx2"))) static int count_lines_avx2(const char *from, const char *to,
+                                                            const char **last_nl)
+{
+    const __m256i nl = _mm256_set1_epi8('\n');
+    int n = 0;
+    const char *q = from;
+    for (; to - q >= 32; q += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)q);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+        if (mask)
+        {
+            n += __builtin_popcount(mask);
+            *last_nl = q + 31 - __builtin_clz(mask);
+        }
+    }
+    int tail = count_lines_sse2(q, to, last_nl);
+    return n + tail;
+}
+
+#else
+
+static inline int is_space(char c)
+{
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+#endif // LEX_SCAN_X86
+
+const char *lex_scan_until(const char *p, char a, char b)
+{
+#if LEX_SCAN_X86
+    return have_avx2() ? scan_until_avx2(p, a, b) : scan_until_sse2(p, a, b);
+#else
+    while (*p && *p != a && *p != b)
+    {
+        p++;
+    }
+    return p;
+#endif
+}
+
+const char *lex_skip_space(const char *p)
+{
+#if LEX_SCAN_X86
+    return skip_space_sse2(p);
+#else
+    while (is_space(*p))
+    {
+        p++;
+    }
+    return p;
+#endif
+}
+
+int lex_count_lines(const char *from, const char *to, const char **last_nl)
+{
+#if LEX_SCAN_X86
+    return have_avx2() ? count_lines_avx2(from, to, last_nl)
+                       : count_lines_sse2(from, to, last_nl);
+#else
+    int n = 0;
+    for (; from < to; from++)
+    {
+        if (*from == '\n')
+        {
+            n++;
+            *last_nl = from;
+        }
+    }
+    return n;
+#endif
+}
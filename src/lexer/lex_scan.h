@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: MIT
+#ifndef ZC_ALLOW_INTERNAL
+#error "lexer/lex_scan.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#ifndef LEX_SCAN_H
+#define LEX_SCAN_H
+
+/**
+ * @brief Vectorised byte scans for the lexer's long runs: whitespace, comment and string bodies.
+ *
+ * x86 builds use SSE2, and AVX2 when the CPU has it; other targets and compilers fall back to
+ * plain loops. Every scan stops at the NUL terminator. Vector loads are aligned, so they may
+ * read bytes before @p p or after the terminator, but never outside the pages holding them.
+ */
+
+/** @brief First byte at or after @p p that is @p a, @p b or NUL. */
+const char *lex_scan_until(const char *p, char a, char b);
+
+/** @brief First byte at or after @p p that is not whitespace (NUL included). */
+const char *lex_skip_space(const char *p);
+
+/**
+ * @brief Newlines in [@p from, @p to).
+ * @param last_nl Receives the last of them; untouched if there are none.
+ */
+int lex_count_lines(const char *from, const char *to, const char **last_nl);
+
+#endif // LEX_SCAN_H
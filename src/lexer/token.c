@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: MIT
 
 #include "zprep.h"
+#include "lex_scan.h"
+#include "../utils/pass_timer.h"
+#include "../utils/source_manager.h"
 
 void lexer_init(Lexer *l, const char *src, CompilerConfig *cfg, const char *filename)
 {
@@ -11,16 +14,217 @@ void lexer_init(Lexer *l, const char *src, CompilerConfig *cfg, const char *file
     l->emit_comments = 0;
     l->config = cfg;
     l->filename = filename;
+    l->file = source_intern(filename);
+    l->table = NULL;
+    l->table_hint = 0;
 }
 
-static __attribute__((unused)) int is_ident_start(char c)
+// Character classes, replacing the locale-dependent <ctype.h> calls (the lexer only ever
+// accepted ASCII letters in identifiers).
+enum
 {
-    return isalpha(c) || c == '_';
+    CHAR_SPACE = 1 << 0,
+    CHAR_DIGIT = 1 << 1,
+    CHAR_XDIGIT = 1 << 2,
+    CHAR_IDENT_START = 1 << 3,
+    CHAR_IDENT = 1 << 4,
+};
+
+#define CHAR_CLASS_OF(c)                                                                           \
+    ((((c) == ' ' || ((c) >= '\t' && (c) <= '\r')) ? CHAR_SPACE : 0) |                             \
+     (((c) >= '0' && (c) <= '9') ? CHAR_DIGIT | CHAR_XDIGIT | CHAR_IDENT : 0) |                     \
+     ((((c) >= 'a' && (c) <= 'f') || ((c) >= 'A' && (c) <= 'F')) ? CHAR_XDIGIT : 0) |              \
+     ((((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || (c) == '_')                     \
+          ? CHAR_IDENT_START | CHAR_IDENT                                                          \
+          : 0))
+#define CHAR_CLASS_ROW(b)                                                                          \
+    CHAR_CLASS_OF((b) + 0), CHAR_CLASS_OF((b) + 1), CHAR_CLASS_OF((b) + 2),                        \
+        CHAR_CLASS_OF((b) + 3), CHAR_CLASS_OF((b) + 4), CHAR_CLASS_OF((b) + 5),                    \
+        CHAR_CLASS_OF((b) + 6), CHAR_CLASS_OF((b) + 7), CHAR_CLASS_OF((b) + 8),                    \
+        CHAR_CLASS_OF((b) + 9), CHAR_CLASS_OF((b) + 10), CHAR_CLASS_OF((b) + 11),                  \
+        CHAR_CLASS_OF((b) + 12), CHAR_CLASS_OF((b) + 13), CHAR_CLASS_OF((b) + 14),                 \
+        CHAR_CLASS_OF((b) + 15)
+
+static const unsigned char char_class[256] = {
+    CHAR_CLASS_ROW(0x00), CHAR_CLASS_ROW(0x10), CHAR_CLASS_ROW(0x20), CHAR_CLASS_ROW(0x30),
+    CHAR_CLASS_ROW(0x40), CHAR_CLASS_ROW(0x50), CHAR_CLASS_ROW(0x60), CHAR_CLASS_ROW(0x70),
+    CHAR_CLASS_ROW(0x80), CHAR_CLASS_ROW(0x90), CHAR_CLASS_ROW(0xa0), CHAR_CLASS_ROW(0xb0),
+    CHAR_CLASS_ROW(0xc0), CHAR_CLASS_ROW(0xd0), CHAR_CLASS_ROW(0xe0), CHAR_CLASS_ROW(0xf0),
+};
+
+#define CHAR_IS(c, cls) (char_class[(unsigned char)(c)] & (cls))
+
+static inline int is_ident_start(char c)
+{
+    return CHAR_IS(c, CHAR_IDENT_START);
+}
+
+static inline int is_ident_char(char c)
+{
+    return CHAR_IS(c, CHAR_IDENT);
+}
+
+// Keywords the lexer gives their own token type; every other word is TOK_IDENT. Dispatches on
+// length and first character, so an identifier costs at most one or two memcmp()s.
+static ZenTokenType keyword_type(const char *s, int len)
+{
+#define KW(word, type)                                                                             \
+    if (memcmp(s, word, sizeof(word) - 1) == 0)                                                    \
+    {                                                                                              \
+        return type;                                                                               \
+    }
+    switch (len)
+    {
+    case 2:
+        switch (s[0])
+        {
+        case 'o':
+            KW("or", TOK_OR);
+            break;
+        case 'd':
+            KW("do", TOK_DO);
+            break;
+        default:
+            break;
+        }
+        break;
+    case 3:
+        switch (s[0])
+        {
+        case 'd':
+            KW("def", TOK_DEF);
+            break;
+        case 'u':
+            KW("use", TOK_USE);
+            break;
+        case 'a':
+            KW("asm", TOK_ASM);
+            KW("and", TOK_AND);
+            break;
+        case 'n':
+            KW("not", TOK_NOT);
+            break;
+        default:
+            break;
+        }
+        break;
+    case 4:
+        switch (s[0])
+        {
+        case 't':
+            KW("test", TOK_TEST);
+            break;
+        case 'i':
+            KW("impl", TOK_IMPL);
+            break;
+        default:
+            break;
+        }
+        break;
+    case 5:
+        switch (s[0])
+        {
+        case 'd':
+            KW("defer", TOK_DEFER);
+            break;
+        case 't':
+            KW("trait", TOK_TRAIT);
+            break;
+        case 'a':
+            KW("alias", TOK_ALIAS);
+            KW("async", TOK_ASYNC);
+            KW("await", TOK_AWAIT);
+            break;
+        case 'u':
+            KW("union", TOK_UNION);
+            break;
+        default:
+            break;
+        }
+        break;
+    case 6:
+        switch (s[0])
+        {
+        case 'a':
+            KW("assert", TOK_ASSERT);
+            break;
+        case 'e':
+            KW("expect", TOK_EXPECT);
+            break;
+        case 's':
+            KW("sizeof", TOK_SIZEOF);
+            break;
+        case 'o':
+            KW("opaque", TOK_OPAQUE);
+            break;
+        default:
+            break;
+        }
+        break;
+    case 8:
+        switch (s[0])
+        {
+        case 'a':
+            KW("autofree", TOK_AUTOFREE);
+            break;
+        case 'c':
+            KW("comptime", TOK_COMPTIME);
+            break;
+        case 'v':
+            KW("volatile", TOK_VOLATILE);
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+#undef KW
+    return TOK_IDENT;
+}
+
+// Below this many bytes a plain loop beats a call into lex_scan.c.
+#define SCAN_SHORT 32
+
+// Line and column after the bytes [from, to), which start at the current position.
+static inline void advance_over(Lexer *l, const char *from, const char *to)
+{
+    const char *last_nl = NULL;
+    int lines = 0;
+    if (to - from < SCAN_SHORT)
+    {
+        for (const char *p = from; p < to; p++)
+        {
+            if (*p == '\n')
+            {
+                lines++;
+                last_nl = p;
+            }
+        }
+    }
+    else
+    {
+        lines = lex_count_lines(from, to, &last_nl);
+    }
+    if (lines)
+    {
+        l->line += lines;
+        l->col = (int)(to - last_nl);
+    }
+    else
+    {
+        l->col += (int)(to - from);
+    }
 }
 
-static __attribute__((unused)) int is_ident_char(char c)
+// Rest of a whitespace run at @p s, which is at the current position.
+static __attribute__((noinline)) const char *skip_long_space(Lexer *l, const char *s)
 {
-    return isalnum(c) || c == '_';
+    const char *end = lex_skip_space(s);
+    advance_over(l, s, end);
+    l->pos += (int)(end - s);
+    return end;
 }
 
 static __attribute__((unused)) int lexer_scan_string_internal(Lexer *l, const char *s, char quote,
@@ -32,9 +236,16 @@ static __attribute__((unused)) int lexer_scan_string_internal(Lexer *l, const ch
         is_multi = 1;
     }
 
+    // Only the closing quote and, outside triple quotes, a backslash need a closer look.
+    char stop = is_multi ? quote : '\\';
     int len = prefix_len + (is_multi ? 3 : 1);
-    while (s[len])
+    for (;;)
     {
+        len = (int)(lex_scan_until(s + len, quote, stop) - s);
+        if (!s[len])
+        {
+            break;
+        }
         if (is_multi && s[len] == quote && s[len + 1] == quote && s[len + 2] == quote)
         {
             len += 3;
@@ -63,30 +274,24 @@ static __attribute__((unused)) int lexer_scan_string_internal(Lexer *l, const ch
         len++;
     }
 
-    // Update lexer line/col
-    for (int i = 0; i < len; i++)
-    {
-        if (s[i] == '\n')
-        {
-            l->line++;
-            l->col = 1;
-        }
-        else
-        {
-            l->col++;
-        }
-    }
+    advance_over(l, s, s + len);
     return len;
 }
 
-Token lexer_next(Lexer *l)
+static Token lex_token(Lexer *l)
 {
     const char *s = l->src + l->pos;
     int start_line = l->line;
     int start_col = l->col;
 
-    while (isspace(*s))
+    // Runs are usually a newline and an indent; hand longer ones to the vector scan.
+    for (int n = 0; CHAR_IS(*s, CHAR_SPACE); n++)
     {
+        if (n == SCAN_SHORT)
+        {
+            s = skip_long_space(l, s);
+            break;
+        }
         if (*s == '\n')
         {
             l->line++;
@@ -98,14 +303,14 @@ Token lexer_next(Lexer *l)
         }
         l->pos++;
         s++;
-        start_line = l->line;
-        start_col = l->col;
     }
+    start_line = l->line;
+    start_col = l->col;
 
     // Check for EOF.
     if (!*s)
     {
-        return (Token){TOK_EOF, s, 0, start_line, start_col, l->filename};
+        return (Token){TOK_EOF, s, 0, start_line, start_col, l->file};
     }
 
     // C preprocessor directives.
@@ -131,21 +336,25 @@ Token lexer_next(Lexer *l)
         }
         l->pos += len;
 
-        return (Token){TOK_PREPROC, s, (size_t)len, start_line, start_col, l->filename};
+        return (Token){TOK_PREPROC, s, (uint32_t)len, start_line, start_col, l->file};
     }
 
     // Comments.
     if (s[0] == '/' && s[1] == '/')
     {
         int len = 2;
+        if (!l->config->misra_mode)
+        {
+            len = (int)(lex_scan_until(s + len, '\n', '\n') - s);
+        }
         while (s[len] && s[len] != '\n')
         {
             if (l->config->misra_mode)
             {
                 if ((s[len] == '/' && s[len + 1] == '/') || (s[len] == '/' && s[len + 1] == '*'))
                 {
-                    zerror_at((Token){TOK_COMMENT, s, (size_t)(len + 2), start_line, start_col,
-                                      l->filename},
+                    zerror_at((Token){TOK_COMMENT, s, (uint32_t)(len + 2), start_line, start_col,
+                                      l->file},
                               "MISRA Rule 3.1: '//' or '/*' within a comment");
                 }
             }
@@ -156,12 +365,12 @@ Token lexer_next(Lexer *l)
         {
             l->pos += len;
             l->col += len;
-            return (Token){TOK_COMMENT, s, (size_t)len, start_line, start_col, l->filename};
+            return (Token){TOK_COMMENT, s, (uint32_t)len, start_line, start_col, l->file};
         }
 
         l->pos += len;
         l->col += len;
-        return lexer_next(l);
+        return lex_token(l);
     }
 
     // Block Comments.
@@ -172,6 +381,25 @@ Token lexer_next(Lexer *l)
         l->pos += 2;
         s += 2;
 
+        // Outside MISRA mode only a '*' can end the comment, so jump to the closing "*/" and
+        // leave the loop below to step over it. Neither delimiter counts towards the column.
+        if (!l->config->misra_mode)
+        {
+            const char *end = s;
+            for (;;)
+            {
+                end = lex_scan_until(end, '*', '*');
+                if (!*end || end[1] == '/')
+                {
+                    break;
+                }
+                end++;
+            }
+            advance_over(l, s, end);
+            l->pos += (int)(end - s);
+            s = end;
+        }
+
         while (s[0])
         {
             if (l->config->misra_mode)
@@ -179,8 +407,8 @@ Token lexer_next(Lexer *l)
                 // Check for nested /* or //
                 if ((s[0] == '/' && s[1] == '*') || (s[0] == '/' && s[1] == '/'))
                 {
-                    zerror_at((Token){TOK_COMMENT, comment_start, (size_t)(s - comment_start) + 2,
-                                      start_line, start_col, l->filename},
+                    zerror_at((Token){TOK_COMMENT, comment_start, (uint32_t)(s - comment_start) + 2,
+                                      start_line, start_col, l->file},
                               "MISRA Rule 3.1: '/*' or '//' within a comment");
                 }
             }
@@ -211,11 +439,11 @@ Token lexer_next(Lexer *l)
         if (l->emit_comments)
         {
             size_t len = (size_t)(s - comment_start);
-            return (Token){TOK_COMMENT, comment_start, (size_t)len,
-                           start_line,  start_col,     l->filename};
+            return (Token){TOK_COMMENT, comment_start, (uint32_t)len,
+                           start_line,  start_col,     l->file};
         }
 
-        return lexer_next(l);
+        return lex_token(l);
     }
 
     // Identifiers.
@@ -230,93 +458,10 @@ Token lexer_next(Lexer *l)
         l->pos += len;
         l->col += len;
 
-        if (len == 4 && strncmp(s, "test", 4) == 0)
-        {
-            return (Token){TOK_TEST, s, 4, start_line, start_col, l->filename};
-        }
-        if (len == 6 && strncmp(s, "assert", 6) == 0)
+        ZenTokenType kw = keyword_type(s, len);
+        if (kw != TOK_IDENT)
         {
-            return (Token){TOK_ASSERT, s, 6, start_line, start_col, l->filename};
-        }
-        if (len == 6 && strncmp(s, "expect", 6) == 0)
-        {
-            return (Token){TOK_EXPECT, s, 6, start_line, start_col, l->filename};
-        }
-        if (len == 6 && strncmp(s, "sizeof", 6) == 0)
-        {
-            return (Token){TOK_SIZEOF, s, 6, start_line, start_col, l->filename};
-        }
-        if (len == 5 && strncmp(s, "defer", 5) == 0)
-        {
-            return (Token){TOK_DEFER, s, 5, start_line, start_col, l->filename};
-        }
-        if (len == 3 && strncmp(s, "def", 3) == 0)
-        {
-            return (Token){TOK_DEF, s, 3, start_line, start_col, l->filename};
-        }
-        if (len == 5 && strncmp(s, "trait", 5) == 0)
-        {
-            return (Token){TOK_TRAIT, s, 5, start_line, start_col, l->filename};
-        }
-        if (len == 4 && strncmp(s, "impl", 4) == 0)
-        {
-            return (Token){TOK_IMPL, s, 4, start_line, start_col, l->filename};
-        }
-        if (len == 8 && strncmp(s, "autofree", 8) == 0)
-        {
-            return (Token){TOK_AUTOFREE, s, 8, start_line, start_col, l->filename};
-        }
-        if (len == 5 && strncmp(s, "alias", 5) == 0)
-        {
-            return (Token){TOK_ALIAS, s, 5, start_line, start_col, l->filename};
-        }
-        if (len == 3 && strncmp(s, "use", 3) == 0)
-        {
-            return (Token){TOK_USE, s, 3, start_line, start_col, l->filename};
-        }
-        if (len == 8 && strncmp(s, "comptime", 8) == 0)
-        {
-            return (Token){TOK_COMPTIME, s, 8, start_line, start_col, l->filename};
-        }
-        if (len == 5 && strncmp(s, "union", 5) == 0)
-        {
-            return (Token){TOK_UNION, s, 5, start_line, start_col, l->filename};
-        }
-        if (len == 3 && strncmp(s, "asm", 3) == 0)
-        {
-            return (Token){TOK_ASM, s, 3, start_line, start_col, l->filename};
-        }
-        if (len == 8 && strncmp(s, "volatile", 8) == 0)
-        {
-            return (Token){TOK_VOLATILE, s, 8, start_line, start_col, l->filename};
-        }
-        if (len == 5 && strncmp(s, "async", 5) == 0)
-        {
-            return (Token){TOK_ASYNC, s, 5, start_line, start_col, l->filename};
-        }
-        if (len == 5 && strncmp(s, "await", 5) == 0)
-        {
-            return (Token){TOK_AWAIT, s, 5, start_line, start_col, l->filename};
-        }
-        if (len == 3 && strncmp(s, "and", 3) == 0)
-        {
-            return (Token){TOK_AND, s, 3, start_line, start_col, l->filename};
-        }
-        if (len == 2 && strncmp(s, "or", 2) == 0)
-        {
-            return (Token){TOK_OR, s, 2, start_line, start_col, l->filename};
-        }
-        if (len == 3 && strncmp(s, "not", 3) == 0)
-        {
-            return (Token){TOK_NOT, s, 3, start_line, start_col, l->filename};
-        }
-        if (len == 6 && strncmp(s, "opaque", 6) == 0)
-        {
-            return (Token){TOK_OPAQUE, s, 6, start_line, start_col, l->filename};
-        }
-        if (len == 2 && strncmp(s, "do", 2) == 0)
-        {
-            return (Token){TOK_DO, s, 2, start_line, start_col, l->filename};
+            return (Token){kw, s, (uint32_t)len, start_line, start_col, l->file};
         }
 
         // F-Strings
@@ -335,7 +480,7 @@ Token lexer_next(Lexer *l)
         }
         else
         {
-            return (Token){TOK_IDENT, s, (size_t)len, start_line, start_col, l->filename};
+            return (Token){TOK_IDENT, s, (uint32_t)len, start_line, start_col, l->file};
         }
     }
 
@@ -343,7 +488,7 @@ Token lexer_next(Lexer *l)
     {
         int len = lexer_scan_string_internal(l, s, '"', 0, 1);
         l->pos += len;
-        return (Token){TOK_FSTRING, s, (size_t)len, start_line, start_col, l->filename};
+        return (Token){TOK_FSTRING, s, (uint32_t)len, start_line, start_col, l->file};
     }
 
     // Raw Strings (r"..." or r'...' or r"""...""")
@@ -352,11 +497,11 @@ Token lexer_next(Lexer *l)
         char quote = s[1];
         int len = lexer_scan_string_internal(l, s, quote, 1, 1);
         l->pos += len;
-        return (Token){TOK_RAW_STRING, s, (size_t)len, start_line, start_col, l->filename};
+        return (Token){TOK_RAW_STRING, s, (uint32_t)len, start_line, start_col, l->file};
     }
 
     // Numbers
-    if (isdigit(*s))
+    if (CHAR_IS(*s, CHAR_DIGIT))
     {
         int len = 0;
         int is_hex = 0;
@@ -367,7 +512,7 @@ Token lexer_next(Lexer *l)
         {
             is_hex = 1;
             len = 2;
-            while (isxdigit(s[len]) || s[len] == '_')
+            while (CHAR_IS(s[len], CHAR_XDIGIT) || s[len] == '_')
             {
                 len++;
             }
@@ -392,13 +537,13 @@ Token lexer_next(Lexer *l)
         }
         else
         {
-            if (s[0] == '0' && isdigit(s[1]) && l->config->misra_mode)
+            if (s[0] == '0' && CHAR_IS(s[1], CHAR_DIGIT) && l->config->misra_mode)
             {
                 // Rule 7.1: Octal constants shall not be used (and leading zeros are disallowed).
-                zerror_at((Token){TOK_INT, s, 2, start_line, start_col, l->filename},
+                zerror_at((Token){TOK_INT, s, 2, start_line, start_col, l->file},
                           "MISRA Rule 7.1");
             }
-            while (isdigit(s[len]) || s[len] == '_')
+            while (CHAR_IS(s[len], CHAR_DIGIT) || s[len] == '_')
             {
                 len++;
             }
@@ -407,13 +552,13 @@ Token lexer_next(Lexer *l)
         if (!is_hex && !is_bin && !is_oct)
         {
             int is_float = 0;
-            if (s[len] == '.' && isdigit(s[len + 1]))
+            if (s[len] == '.' && CHAR_IS(s[len + 1], CHAR_DIGIT))
             {
                 if (s[len + 1] != '.')
                 {
                     is_float = 1;
                     len++;
-                    while (isdigit(s[len]) || s[len] == '_')
+                    while (CHAR_IS(s[len], CHAR_DIGIT) || s[len] == '_')
                     {
                         len++;
                     }
@@ -428,7 +573,7 @@ Token lexer_next(Lexer *l)
                 {
                     len++;
                 }
-                while (isdigit(s[len]) || s[len] == '_')
+                while (CHAR_IS(s[len], CHAR_DIGIT) || s[len] == '_')
                 {
                     len++;
                 }
@@ -445,7 +590,7 @@ Token lexer_next(Lexer *l)
                 }
                 l->pos += len;
                 l->col += len;
-                return (Token){TOK_FLOAT, s, (size_t)len, start_line, start_col, l->filename};
+                return (Token){TOK_FLOAT, s, (uint32_t)len, start_line, start_col, l->file};
             }
         }
 
@@ -459,7 +604,7 @@ Token lexer_next(Lexer *l)
 
         l->pos += len;
         l->col += len;
-        return (Token){TOK_INT, s, (size_t)len, start_line, start_col, l->filename};
+        return (Token){TOK_INT, s, (uint32_t)len, start_line, start_col, l->file};
     }
 
     // Strings
@@ -467,7 +612,7 @@ Token lexer_next(Lexer *l)
     {
         int len = lexer_scan_string_internal(l, s, '"', 0, 0);
         l->pos += len;
-        return (Token){TOK_STRING, s, (size_t)len, start_line, start_col, l->filename};
+        return (Token){TOK_STRING, s, (uint32_t)len, start_line, start_col, l->file};
     }
 
     if (*s == '\'')
@@ -525,147 +670,339 @@ Token lexer_next(Lexer *l)
 
         l->pos += len;
         l->col += len;
-        return (Token){TOK_CHAR, s, (size_t)len, start_line, start_col, l->filename};
+        return (Token){TOK_CHAR, s, (uint32_t)len, start_line, start_col, l->file};
     }
 
     // Operators.
     int len = 1;
     ZenTokenType type = TOK_OP;
 
-    if (s[0] == '?' && s[1] == '.')
-    {
-        len = 2;
-        type = TOK_Q_DOT;
-    }
-    else if (s[0] == '?' && s[1] == '?')
+    switch (s[0])
     {
-        if (s[2] == '=')
+    case '?':
+        if (s[1] == '.')
         {
-            len = 3;
-            type = TOK_QQ_EQ;
+            len = 2;
+            type = TOK_Q_DOT;
+        }
+        else if (s[1] == '?')
+        {
+            len = s[2] == '=' ? 3 : 2;
+            type = s[2] == '=' ? TOK_QQ_EQ : TOK_QQ;
         }
         else
+        {
+            type = TOK_QUESTION;
+        }
+        break;
+    case '|':
+        if (s[1] == '>')
         {
             len = 2;
-            type = TOK_QQ;
+            type = TOK_PIPE;
         }
-    }
-    else if (*s == '?')
-    {
-        type = TOK_QUESTION;
-    }
-    else if (s[0] == '|' && s[1] == '>')
-    {
-        len = 2;
-        type = TOK_PIPE;
-    }
-    else if (s[0] == ':' && s[1] == ':')
-    {
-        len = 2;
-        type = TOK_DCOLON;
-    }
-    else if (s[0] == '.' && s[1] == '.' && s[2] == '.')
-    {
-        len = 3;
-        type = TOK_ELLIPSIS;
-    }
-    else if (s[0] == '.' && s[1] == '.')
-    {
-        if (s[2] == '=')
+        else if (s[1] == '|' || s[1] == '=')
         {
-            len = 3;
-            type = TOK_DOTDOT_EQ;
+            len = 2;
+        }
+        break;
+    case ':':
+        if (s[1] == ':')
+        {
+            len = 2;
+            type = TOK_DCOLON;
+        }
+        else
+        {
+            type = TOK_COLON;
         }
-        else if (s[2] == '<')
+        break;
+    case '.':
+        if (s[1] == '.')
         {
             len = 3;
-            type = TOK_DOTDOT_LT;
+            if (s[2] == '.')
+            {
+                type = TOK_ELLIPSIS;
+            }
+            else if (s[2] == '=')
+            {
+                type = TOK_DOTDOT_EQ;
+            }
+            else if (s[2] == '<')
+            {
+                type = TOK_DOTDOT_LT;
+            }
+            else
+            {
+                len = 2;
+                type = TOK_DOTDOT;
+            }
+        }
+        break;
+    case '-':
+    case '=':
+        if (s[1] == '>')
+        {
+            len = 2;
+            type = TOK_ARROW;
+        }
+        else if (s[1] == '=' || (s[0] == '-' && s[1] == '-'))
+        {
+            len = 2;
+        }
+        break;
+    case '<':
+    case '>':
+        if (s[1] == s[0])
+        {
+            len = s[2] == '=' ? 3 : 2; // <<, >>, <<=, >>=
+        }
+        else if (s[1] == '=')
+        {
+            len = 2;
         }
         else
+        {
+            type = s[0] == '<' ? TOK_LANGLE : TOK_RANGLE;
+        }
+        break;
+    case '*':
+        if (s[1] == '*')
+        {
+            len = s[2] == '=' ? 3 : 2;
+        }
+        else if (s[1] == '=')
         {
             len = 2;
-            type = TOK_DOTDOT;
         }
+        break;
+    case '&':
+    case '+':
+        if (s[1] == s[0] || s[1] == '=')
+        {
+            len = 2;
+        }
+        break;
+    case '!':
+    case '/':
+    case '%':
+    case '^':
+        if (s[1] == '=')
+        {
+            len = 2;
+        }
+        break;
+    case '(':
+        type = TOK_LPAREN;
+        break;
+    case ')':
+        type = TOK_RPAREN;
+        break;
+    case '{':
+        type = TOK_LBRACE;
+        break;
+    case '}':
+        type = TOK_RBRACE;
+        break;
+    case '[':
+        type = TOK_LBRACKET;
+        break;
+    case ']':
+        type = TOK_RBRACKET;
+        break;
+    case ',':
+        type = TOK_COMMA;
+        break;
+    case ';':
+        type = TOK_SEMICOLON;
+        break;
+    case '@':
+        type = TOK_AT;
+        break;
+    default:
+        break;
     }
-    else if ((s[0] == '-' && s[1] == '>') || (s[0] == '=' && s[1] == '>'))
+
+    l->pos += len;
+    l->col += len;
+    return (Token){type, s, (uint32_t)len, start_line, start_col, l->file};
+}
+
+// Columns at or above this are relative: the table is built with the lexer's col starting here.
+#define TABLE_COL_BASE (1 << 28)
+
+#define TOKEN_TABLE_TYPE_MASK 0xffffu
+#define TOKEN_TABLE_COL_REL (1u << 16)     ///< Token col is relative to the lexer's col.
+#define TOKEN_TABLE_END_COL_REL (1u << 17) ///< Lexer col after the token is relative too.
+
+// A token lexed from a fixed position. Lines are stored as deltas and columns as either absolute
+// values or deltas, so the entry replays exactly whatever line/col the lexer arrives with.
+typedef struct
+{
+    uint32_t pos;        ///< Lexer position the token is lexed from (before whitespace).
+    uint32_t start;      ///< Offset of the token text in the source.
+    uint32_t len;        ///< Length of the token text.
+    uint32_t end;        ///< Lexer position after the token.
+    int32_t line;        ///< Lines between pos and the token.
+    int32_t col;         ///< Token column (see TOKEN_TABLE_COL_REL).
+    int32_t end_line;    ///< Lines between pos and end.
+    int32_t end_col;     ///< Lexer column at end (see TOKEN_TABLE_END_COL_REL).
+    uint32_t type_flags; ///< ZenTokenType in TOKEN_TABLE_TYPE_MASK, TOKEN_TABLE_* flags above.
+} TokenTableEntry;
+
+struct TokenTable
+{
+    const TokenTableEntry *entries; ///< Sorted by position.
+    uint32_t count;
+};
+
+static TokenTableEntry *build_table(const char *src, CompilerConfig *cfg, uint32_t *count)
+{
+    size_t src_len = strlen(src);
+    if (src_len >= UINT32_MAX)
     {
-        len = 2;
-        type = TOK_ARROW;
+        return NULL;
     }
+    size_t cap = src_len / 4 + 16;
+    TokenTableEntry *entries = xmalloc(cap * sizeof(TokenTableEntry));
 
-    else if ((s[0] == '<' && s[1] == '<') || (s[0] == '>' && s[1] == '>'))
+    Lexer l;
+    lexer_init(&l, src, cfg, NULL);
+    uint32_t n = 0;
+    for (;;)
     {
-        len = 2;
-        if (s[2] == '=')
+        if (n == cap)
         {
-            len = 3; // Handle <<= and >>=
+            cap *= 2;
+            entries = xrealloc(entries, cap * sizeof(TokenTableEntry));
         }
-    }
-    else if ((s[0] == '&' && s[1] == '&') || (s[0] == '|' && s[1] == '|') ||
-             (s[0] == '+' && s[1] == '+') || (s[0] == '-' && s[1] == '-') ||
-             (s[0] == '*' && s[1] == '*'))
-    {
-        len = 2;
-        if (s[0] == '*' && s[1] == '*' && s[2] == '=')
+        uint32_t pos = (uint32_t)l.pos;
+        l.line = 0;
+        l.col = TABLE_COL_BASE;
+        Token t = lex_token(&l);
+
+        TokenTableEntry *e = &entries[n++];
+        e->pos = pos;
+        e->start = (uint32_t)(t.start - src);
+        e->len = (uint32_t)t.len;
+        e->end = (uint32_t)l.pos;
+        e->line = t.line;
+        e->end_line = l.line;
+        e->type_flags = (uint32_t)t.type;
+        e->col = t.col;
+        if (t.col >= TABLE_COL_BASE / 2)
         {
-            len = 3;
+            e->col = t.col - TABLE_COL_BASE;
+            e->type_flags |= TOKEN_TABLE_COL_REL;
         }
+        e->end_col = l.col;
+        if (l.col >= TABLE_COL_BASE / 2)
+        {
+            e->end_col = l.col - TABLE_COL_BASE;
+            e->type_flags |= TOKEN_TABLE_END_COL_REL;
+        }
+        if (t.type == TOK_EOF)
+        {
+            break;
+        }
+    }
+    *count = n;
+    return entries;
+}
+
+void lexer_buffer_tokens(Lexer *l)
+{
+    l->table = NULL;
+    l->table_hint = 0;
+    if (l->config && l->config->misra_mode)
+    {
+        return;
     }
-    else if (s[1] == '=' && strchr("=!<>+-*/%|&^", s[0]))
+    PASS_BEGIN(PASS_LEX, NULL);
+    uint32_t count = 0;
+    TokenTableEntry *entries = build_table(l->src, l->config, &count);
+    if (entries)
     {
-        len = 2;
+        TokenTable *table = xmalloc(sizeof(TokenTable));
+        table->entries = entries;
+        table->count = count;
+        l->table = table;
     }
+    PASS_END();
+}
 
-    else
+// Replay the table entry lexed from l->pos. Returns 0 if the parser moved the lexer somewhere
+// the table has no entry for (it only rewinds to token boundaries, so this is rare).
+static int table_token(Lexer *l, Token *out)
+{
+    const TokenTable *table = l->table;
+    uint32_t pos = (uint32_t)l->pos;
+    uint32_t i = l->table_hint;
+    if (i >= table->count || table->entries[i].pos != pos)
     {
-        switch (*s)
+        uint32_t lo = 0;
+        uint32_t hi = table->count;
+        while (lo < hi)
         {
-
-        case '(':
-            type = TOK_LPAREN;
-            break;
-        case ')':
-            type = TOK_RPAREN;
-            break;
-        case '{':
-            type = TOK_LBRACE;
-            break;
-        case '}':
-            type = TOK_RBRACE;
-            break;
-        case '[':
-            type = TOK_LBRACKET;
-            break;
-        case ']':
-            type = TOK_RBRACKET;
-            break;
-        case '<':
-            type = TOK_LANGLE;
-            break;
-        case '>':
-            type = TOK_RANGLE;
-            break;
-        case ',':
-            type = TOK_COMMA;
-            break;
-        case ':':
-            type = TOK_COLON;
-            break;
-        case ';':
-            type = TOK_SEMICOLON;
-            break;
-        case '@':
-            type = TOK_AT;
-            break;
-        default:
-            type = TOK_OP;
-            break;
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (table->entries[mid].pos < pos)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        if (lo >= table->count || table->entries[lo].pos != pos)
+        {
+            return 0;
         }
+        i = lo;
     }
 
-    l->pos += len;
-    l->col += len;
-    return (Token){type, s, (size_t)len, start_line, start_col, l->filename};
+    const TokenTableEntry *e = &table->entries[i];
+    int line = l->line;
+    int col = l->col;
+    out->type = (ZenTokenType)(e->type_flags & TOKEN_TABLE_TYPE_MASK);
+    out->start = l->src + e->start;
+    out->len = e->len;
+    out->line = line + e->line;
+    out->col = (e->type_flags & TOKEN_TABLE_COL_REL) ? col + e->col : e->col;
+    out->file = l->file;
+    l->pos = (int)e->end;
+    l->line = line + e->end_line;
+    l->col = (e->type_flags & TOKEN_TABLE_END_COL_REL) ? col + e->end_col : e->end_col;
+    l->table_hint = i + 1;
+    return 1;
+}
+
+static Token next_token(Lexer *l)
+{
+    Token t;
+    if (l->table && !l->emit_comments && table_token(l, &t))
+    {
+        return t;
+    }
+    return lex_token(l);
+}
+
+Token lexer_next(Lexer *l)
+{
+    if (!g_pass_timing)
+    {
+        return next_token(l);
+    }
+    pass_begin(PASS_LEX, NULL);
+    Token t = next_token(l);
+    pass_end();
+    return t;
+}
+
+const char *token_file(Token t)
+{
+    return source_name(t.file);
 }
 
 Token lexer_peek(Lexer *l)
@@ -16,6 +16,9 @@
 #include "analysis/typecheck.h"
 #include "codegen/compat.h"
 #include "driver/driver.h"
+#include "driver/build_cache.h"
+#include "driver/serve.h"
+#include "driver/watch.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,12 +45,8 @@ static void handle_crash(int sig)
 #if ZC_HAS_LSP
 int lsp_main(int argc, char **argv);
 #endif
-int main(int argc, char **argv)
+static int compiler_main(int argc, char **argv)
 {
-    signal(SIGSEGV, handle_crash);
-    signal(SIGABRT, handle_crash);
-    signal(SIGFPE, handle_crash);
-
     int i;
     const char *optimization_level = NULL;
     char *env_root;
@@ -140,6 +139,30 @@ int main(int argc, char **argv)
         zvec_push_Str(&g_config.cfg_defines, xstrdup("macos"));
     }
 
+    const char *env_cache = getenv("ZC_CACHE");
+    if (env_cache && strcmp(env_cache, "1") == 0)
+    {
+        g_config.use_build_cache = 1;
+    }
+
+    const char *env_pch = getenv("ZC_PCH");
+    g_config.use_runtime_pch = !(env_pch && strcmp(env_pch, "0") == 0);
+
+    const char *env_comptime_cache = getenv("ZC_COMPTIME_CACHE");
+    g_config.comptime_cache = !(env_comptime_cache && strcmp(env_comptime_cache, "0") == 0);
+
+    const char *env_lazy_methods = getenv("ZC_LAZY_METHODS");
+    g_config.use_lazy_methods = !(env_lazy_methods && strcmp(env_lazy_methods, "0") == 0);
+
+    const char *env_fold = getenv("ZC_FOLD");
+    g_config.use_fold = !(env_fold && strcmp(env_fold, "0") == 0);
+
+    const char *env_share = getenv("ZC_SHARE_GENERICS");
+    if (env_share && strcmp(env_share, "1") == 0)
+    {
+        g_config.share_generics = 1;
+    }
+
     if (argc < 2)
     {
         print_usage();
@@ -170,6 +193,10 @@ int main(int argc, char **argv)
 #endif
     }
 
+    else if (strcmp(command, "cache") == 0)
+    {
+        return build_cache_command(argc - 2, argv + 2);
+    }
     else if (strcmp(command, "transpile") == 0 || strcmp(command, "-c") == 0)
     {
         g_config.mode_transpile = 1;
@@ -279,6 +306,95 @@ int main(int argc, char **argv)
         {
             g_config.quiet = 1;
         }
+        else if (strcmp(arg, "--cache") == 0)
+        {
+            g_config.use_build_cache = 1;
+        }
+        else if (strcmp(arg, "--no-cache") == 0)
+        {
+            g_config.use_build_cache = 0;
+        }
+        else if (strcmp(arg, "--no-pch") == 0)
+        {
+            g_config.use_runtime_pch = 0;
+        }
+        else if (strcmp(arg, "--no-comptime-cache") == 0)
+        {
+            g_config.comptime_cache = 0;
+        }
+        else if (strcmp(arg, "--no-lazy-methods") == 0)
+        {
+            g_config.use_lazy_methods = 0;
+        }
+        else if (strcmp(arg, "--no-fold") == 0)
+        {
+            g_config.use_fold = 0;
+        }
+        else if (strcmp(arg, "--share-generics") == 0)
+        {
+            g_config.share_generics = 1;
+        }
+        else if (strcmp(arg, "--jit") == 0)
+        {
+            g_config.use_jit = 1;
+        }
+        else if (strcmp(arg, "--time-passes") == 0)
+        {
+            g_config.time_passes = 1;
+        }
+        else if (strcmp(arg, "--mem-report") == 0)
+        {
+            g_config.mem_report = 1;
+        }
+        else if (strcmp(arg, "--trace-out") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET
+                                                     ": missing file name after '--trace-out'\n");
+                return 1;
+            }
+            g_config.trace_out = argv[++i];
+        }
+        else if (strcmp(arg, "--emit-deps") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET
+                                                     ": missing file name after '--emit-deps'\n");
+                return 1;
+            }
+            g_config.deps_out = argv[++i];
+        }
+        else if (strncmp(arg, "-j", 2) == 0 || strcmp(arg, "--jobs") == 0)
+        {
+            const char *n = NULL;
+            if (arg[1] == 'j' && arg[2])
+            {
+                n = arg + 2;
+            }
+            else if (i + 1 < argc)
+            {
+                n = argv[++i];
+            }
+            if (!n || atoi(n) < 1)
+            {
+                fprintf(stderr,
+                        COLOR_BOLD COLOR_RED "error" COLOR_RESET ": '%s' expects a job count\n", arg);
+                return 1;
+            }
+            g_config.jobs = atoi(n);
+        }
+        else if (strcmp(arg, "--check-jobs") == 0)
+        {
+            if (i + 1 >= argc || atoi(argv[i + 1]) < 1)
+            {
+                fprintf(stderr,
+                        COLOR_BOLD COLOR_RED "error" COLOR_RESET ": '%s' expects a job count\n", arg);
+                return 1;
+            }
+            g_config.check_jobs = atoi(argv[++i]);
+        }
         else if (strcmp(arg, "--zen") == 0)
         {
             g_config.zen_mode = 1;
@@ -568,6 +684,8 @@ int main(int argc, char **argv)
             if (strcmp(arg, "-shared") == 0 || strcmp(arg, "--shared") == 0)
             {
                 append_flag(g_config.gcc_flags, sizeof(g_config.gcc_flags), "-fPIC", NULL);
+                // A library's callers are not in the program, so every method is kept.
+                g_config.use_lazy_methods = 0;
             }
         }
         else if (arg[0] == '-')
@@ -597,6 +715,18 @@ int main(int argc, char **argv)
         }
     }
 
+    if (g_config.check_jobs > 1 && !g_config.mode_check)
+    {
+        // Builds type-check in one process; only zc check hands bodies to workers.
+        zwarn("'--check-jobs' only applies to 'zc check' and is ignored here");
+    }
+
+    if (g_config.share_generics)
+    {
+        // A shared body reads every instantiation of its group through one struct type.
+        append_flag(g_config.gcc_flags, sizeof(g_config.gcc_flags), "-fno-strict-aliasing", NULL);
+    }
+
     for (i = arg_start; i < argc; i++)
     {
         char *arg = argv[i];
@@ -634,3 +764,26 @@ int main(int argc, char **argv)
 
     return driver_run(&g_compiler);
 }
+
+int main(int argc, char **argv)
+{
+    signal(SIGSEGV, handle_crash);
+    signal(SIGABRT, handle_crash);
+    signal(SIGFPE, handle_crash);
+
+    if (argc >= 2 && strcmp(argv[1], "serve") == 0)
+    {
+        return serve_main(argc, argv, compiler_main);
+    }
+    if (argc >= 2 && strcmp(argv[1], "watch") == 0)
+    {
+        return watch_main(argc, argv, compiler_main);
+    }
+
+    int status = 0;
+    if (serve_client(argc, argv, &status))
+    {
+        return status;
+    }
+    return compiler_main(argc, argv);
+}
@@ -55,6 +55,14 @@ ASTNode *parse_program_nodes(ParserContext *ctx, Lexer *l)
 
         skip_comments(l);
         Token t = lexer_peek(l);
+        if (ctx->hook_imports_parsed && l == ctx->hook_imports_lexer &&
+            !(t.type == TOK_IDENT && t.len == 6 && strncmp(t.start, "import", 6) == 0))
+        {
+            void (*hook)(ParserContext *, Lexer *) = ctx->hook_imports_parsed;
+            ctx->hook_imports_parsed = NULL;
+            hook(ctx, l);
+            t = lexer_peek(l);
+        }
         if (t.type == TOK_EOF)
         {
             break;
@@ -878,8 +878,7 @@ ASTNode *parse_size_or_typeof(ParserContext *ctx, Lexer *l, Token tk, int is_typ
     else
     {
         ctx->pending_type_validations = old_pending;
-        ctx->used_slices = old_slices;
-        ctx->used_tuples = old_tuples;
+        rewind_type_registries(ctx, old_slices, old_tuples);
 
         l->pos = pos;
         l->col = col;
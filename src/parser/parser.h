@@ -11,6 +11,7 @@
 #include "compiler.h"
 #include "../diagnostics/diagnostics.h"
 #include "../utils/emitter.h"
+#include "../utils/intern.h"
 
 // Operator precedence for expression parsing
 
@@ -99,7 +100,7 @@ extern ParserContext *token_parser_ctx;
  */
 typedef struct FuncSig
 {
-    char *name;           ///< Function name.
+    char *name;           ///< Function name; interned for entries of func_registry.
     Token decl_token;     ///< declaration token.
     int total_args;       ///< Total argument count.
     char **defaults;      ///< Default values for arguments (or NULL).
@@ -178,6 +179,15 @@ static inline int zmap_cmp_cstr(const char *a, const char *b)
 {
     return strcmp(a, b);
 }
+// For maps keyed by interned names (intern.h): the hash is stored, equality is identity.
+static inline uint32_t zmap_hash_name(const char *k, uint32_t seed)
+{
+    return intern_hash(k) ^ seed;
+}
+static inline int zmap_cmp_name(const char *a, const char *b)
+{
+    return a != b;
+}
 // ---------------------------------------------------------------------------
 
 /**
@@ -185,7 +195,7 @@ static inline int zmap_cmp_cstr(const char *a, const char *b)
  */
 typedef struct Instantiation
 {
-    char *name;           ///< Mangled name of the instantiation (e.g. "Vec_int").
+    char *name;           ///< Mangled name of the instantiation (e.g. "Vec_int"), interned.
     char *template_name;  ///< Original template name (e.g. "Vec").
     char *concrete_arg;   ///< Concrete type argument string.
     char *unmangled_arg;  ///< Unmangled argument for substitution code.
@@ -207,28 +217,17 @@ typedef struct StructRef
  */
 typedef struct StructDef
 {
-    char *name;
+    char *name; ///< Interned.
     ASTNode *node;
     struct StructDef *next;
 } StructDef;
 
-// Hash table entry for fast struct/enum lookup (used by find_struct_def).
-enum
-{
-    STRUCT_HASH_SIZE = 2048
-};
-typedef struct
-{
-    char name[256]; // empty string = empty slot (avoids dangling stack pointer issues with ASAN)
-    ASTNode *node;
-} StructHashEntry;
-
 /**
  * @brief Track used slice types for generation.
  */
 typedef struct SliceType
 {
-    char *name;
+    char *name; ///< Interned.
     struct SliceType *next;
 } SliceType;
 
@@ -237,7 +236,7 @@ typedef struct SliceType
  */
 typedef struct TupleType
 {
-    char *sig;    ///< Signature string for dedup (e.g. "int__string").
+    char *sig;    ///< Signature string for dedup (e.g. "int__string"), interned.
     char **types; ///< Individual field type names for codegen.
     int count;    ///< Number of fields.
     struct TupleType *next;
@@ -253,6 +252,7 @@ typedef struct EnumVariantReg
     char *mangled_name; ///< Mangled name (Enum__Variant).
     int tag_id;         ///< Integration tag value.
     struct EnumVariantReg *next;
+    struct EnumVariantReg *same_name; ///< Older registration of the same variant name.
 } EnumVariantReg;
 
 /**
@@ -295,6 +295,7 @@ typedef struct ImplReg
     char *trait; ///< Trait name.
     char *strct; ///< Implementing struct name.
     struct ImplReg *next;
+    struct ImplReg *next_generic; ///< Next entry whose strct is a template ("Vec<T>").
 } ImplReg;
 
 /**
@@ -319,12 +320,23 @@ typedef struct TypeAlias
     char *defined_in_file;
 } TypeAlias;
 
+/** @brief Generic impl method whose emission waits until it is referenced (codegen_lazy.c). */
+typedef struct LazyMethod LazyMethod;
+
 // zmap type registration (generates type-safe hash maps)
 #define REGISTER_ZMAP_TYPES(X)                                                                     \
     X(const char *, Module *, ModMap)                                                              \
     X(const char *, SelectiveImport *, SelMap)                                                     \
     X(const char *, const char *, FileSet)                                                         \
-    X(const char *, ImportedPlugin *, PluginMap)
+    X(const char *, ImportedPlugin *, PluginMap)                                                   \
+    X(const char *, Instantiation *, InstMap)                                                      \
+    X(const char *, SliceType *, SliceMap)                                                         \
+    X(const char *, TupleType *, TupleMap)                                                         \
+    X(const char *, ImplReg *, ImplMap)                                                            \
+    X(const char *, EnumVariantReg *, VariantMap)                                                  \
+    X(const char *, ASTNode *, NodeMap)                                                            \
+    X(const char *, char *, StrMap)                                                                \
+    X(const char *, LazyMethod *, LazyMap)
 
 #include "../utils/zmap.h"
 
@@ -333,8 +345,8 @@ typedef struct TypeAlias
  */
 typedef struct ModuleState
 {
-    zmap_ModMap modules;           ///< Map: alias → Module*.
-    zmap_SelMap selective_imports; ///< Map: symbol → SelectiveImport*.
+    zmap_ModMap modules;           ///< Map: interned alias → Module*.
+    zmap_SelMap selective_imports; ///< Map: interned symbol → SelectiveImport*.
     char *current_module_prefix;   ///< Prefix for current module (namespacing).
     zmap_FileSet imported_files;   ///< Set: imported file paths (key=value).
     zmap_FileSet
@@ -343,11 +355,32 @@ typedef struct ModuleState
     zmap_FileSet wildcard_imports;   ///< Set: module base names imported via `as *`.
 } ModuleState;
 
+/**
+ * @brief Hash indexes over the parser's type registries, keyed by interned names.
+ *
+ * The lists in ParserContext stay authoritative (codegen and the LSP walk them); these only
+ * answer "is X registered" without a scan. Contexts are often zero-initialised, so the maps
+ * are set up on first use by registry_index().
+ */
+typedef struct RegistryIndex
+{
+    int ready;
+    zmap_InstMap instantiations; ///< Instantiation::name → entry.
+    zmap_SliceMap slices;        ///< SliceType::name → entry.
+    zmap_TupleMap tuples;        ///< TupleType::sig → entry.
+    zmap_ImplMap impls;          ///< "<trait>\x1f<struct>" → entry.
+    zmap_VariantMap variants;    ///< Variant name → newest entry; older ones via same_name.
+    zmap_NodeMap structs;        ///< Struct/enum name → definition, for find_struct_def().
+    zmap_NodeMap methods;        ///< "<struct>\x1f<impl template>" → its instantiation.
+    zmap_InstMap functions;      ///< Generic function instantiation ("dealloc__APtr") → entry.
+    ImplReg *generic_impls;      ///< Entries whose struct is a template, via next_generic.
+} RegistryIndex;
+
 /* * Initialize all maps in a ModuleState. Call once after zeroing the struct. */
 static inline void module_state_init(ModuleState *ms)
 {
-    ms->modules = zmap_init(ModMap, zmap_hash_cstr, zmap_cmp_cstr);
-    ms->selective_imports = zmap_init(SelMap, zmap_hash_cstr, zmap_cmp_cstr);
+    ms->modules = zmap_init(ModMap, zmap_hash_name, zmap_cmp_name);
+    ms->selective_imports = zmap_init(SelMap, zmap_hash_name, zmap_cmp_name);
     ms->imported_files = zmap_init(FileSet, zmap_hash_cstr, zmap_cmp_cstr);
     ms->imported_plugins = zmap_init(PluginMap, zmap_hash_cstr, zmap_cmp_cstr);
     ms->currently_parsing = zmap_init(FileSet, zmap_hash_cstr, zmap_cmp_cstr);
@@ -390,15 +423,15 @@ struct ParserContext
     ASTNode *instantiated_funcs;   ///< List of AST nodes for instantiated functions.
 
     // Structs/Enums
-    StructRef *parsed_structs_list;                ///< List of all parsed struct nodes.
-    StructHashEntry struct_hash[STRUCT_HASH_SIZE]; ///< Hash table for fast struct/enum lookup.
-    StructRef *parsed_enums_list;                  ///< List of all parsed enum nodes.
-    StructRef *parsed_funcs_list;                  ///< List of all parsed function nodes.
-    StructRef *parsed_impls_list;                  ///< List of all parsed impl blocks.
-    StructRef *parsed_globals_list;                ///< List of all parsed global variables.
-    StructDef *struct_defs;        ///< Registry of struct definitions (map name -> node).
-    EnumVariantReg *enum_variants; ///< Registry of enum variants for global lookup.
-    ImplReg *registered_impls;     ///< Cache of type/trait implementations.
+    StructRef *parsed_structs_list; ///< List of all parsed struct nodes.
+    StructRef *parsed_enums_list;   ///< List of all parsed enum nodes.
+    StructRef *parsed_funcs_list;   ///< List of all parsed function nodes.
+    StructRef *parsed_impls_list;   ///< List of all parsed impl blocks.
+    StructRef *parsed_globals_list; ///< List of all parsed global variables.
+    StructDef *struct_defs;         ///< Registry of struct definitions (map name -> node).
+    EnumVariantReg *enum_variants;  ///< Registry of enum variants for global lookup.
+    ImplReg *registered_impls;      ///< Cache of type/trait implementations.
+    RegistryIndex index;            ///< Lookup side of the registries above and below.
 
     // Types
     SliceType *used_slices;  ///< Cache of generated slice types.
@@ -459,6 +492,12 @@ struct ParserContext
         int func_defer_boundary;       ///< Defer stack index at function entry.
         int pending_closure_frees[64]; ///< Lambda IDs whose ctx needs freeing (max 64).
         int pending_closure_free_count;
+        int split_role;           ///< CodegenUnitRole of the unit being emitted.
+        int split_unit;           ///< Unit whose function bodies are emitted (0 = primary).
+        int split_units;          ///< Number of units in a split build; 0 when not split.
+        const char *split_header; ///< Header file name included by body-only units.
+        const char *runtime_header; ///< Runtime header included instead of the hosted preamble.
+        struct LazyMethods *lazy;   ///< Deferred generic impl methods (lazy_methods_begin()).
     } cg;
 
     // Type Validation
@@ -497,6 +536,12 @@ struct ParserContext
 
     /// Hook: zen fact trigger
     int (*hook_zen_trigger)(int t, Token location, struct CompilerConfig *cfg);
+
+    /// Hook: the leading imports of the main file are parsed (zc serve snapshots here).
+    /// Called once, before the first other top-level item of hook_imports_lexer; it may
+    /// replace that lexer's source buffer with one sharing the text parsed so far.
+    void (*hook_imports_parsed)(struct ParserContext *ctx, Lexer *l);
+    Lexer *hook_imports_lexer; ///< Lexer of the main file.
 };
 
 // Intrusive linked-list iteration utilities
@@ -846,6 +891,11 @@ void re_export_wildcard_symbols(ParserContext *ctx, const char *module_base);
 void re_export_propagated(ParserContext *ctx, const char *alias, const char *parent_prefix,
                           const char *base_name);
 ASTNode *find_concrete_struct_def(ParserContext *ctx, const char *name);
+RegistryIndex *registry_index(ParserContext *ctx);
+Instantiation *find_instantiation(ParserContext *ctx, const char *name);
+void register_instantiation(ParserContext *ctx, Instantiation *inst);
+Instantiation *find_function_instantiation(ParserContext *ctx, const char *name);
+void rewind_type_registries(ParserContext *ctx, SliceType *slices, TupleType *tuples);
 const char *find_type_alias(ParserContext *ctx, const char *alias);
 Type *parse_type_base(ParserContext *ctx, Lexer *l);
 char *parse_type(ParserContext *ctx, Lexer *l);
@@ -14,6 +14,7 @@
 #include "zen/zen_facts.h"
 #include "zprep_plugin.h"
 #include "analysis/move_check.h"
+#include "utils/pass_timer.h"
 
 static void try_parse_c_function_decl(ParserContext *ctx, const char *line)
 {
@@ -229,7 +230,8 @@ static void scan_c_header_contents(ParserContext *ctx, const char *path, int dep
     {
         return;
     }
-    mark_file_imported(ctx, path);
+    // Nested headers arrive in a stack buffer; the set keeps the key.
+    mark_file_imported(ctx, xstrdup(path));
 
     char *src = load_file(path, ctx->current_filename);
     if (!src)
@@ -660,7 +662,8 @@ ASTNode *parse_import(ParserContext *ctx, Lexer *l, int is_re_export)
                     is_header = 1;
                 }
 
-                if (!zmap_get(&ctx->imports.modules, alias))
+                const char *key = intern(alias);
+                if (!zmap_get(&ctx->imports.modules, key))
                 {
                     char *mod_base = extract_module_name(fn);
                     Module *m = xmalloc(sizeof(Module));
@@ -669,7 +672,7 @@ ASTNode *parse_import(ParserContext *ctx, Lexer *l, int is_re_export)
                     m->base_name = mod_base;
                     m->is_c_header = is_header;
                     m->is_re_export = is_re_export;
-                    zmap_put(&ctx->imports.modules, alias, m);
+                    zmap_put(&ctx->imports.modules, key, m);
                 }
             }
         }
@@ -720,8 +723,10 @@ ASTNode *parse_import(ParserContext *ctx, Lexer *l, int is_re_export)
         }
     }
 
+    PASS_BEGIN(PASS_IMPORT, fn);
     Lexer i;
     lexer_init(&i, src, ctx->config, ctx->current_filename);
+    lexer_buffer_tokens(&i);
 
     char *prev_module_prefix = ctx->imports.current_module_prefix;
     char *temp_module_prefix = NULL;
@@ -757,6 +762,7 @@ ASTNode *parse_import(ParserContext *ctx, Lexer *l, int is_re_export)
     ATTACH_DOC_COMMENT(ctx, import_node);
 
     ASTNode *r = parse_program_nodes(ctx, &i);
+    PASS_END();
 
     zmap_remove(&ctx->imports.currently_parsing, fn);
     mark_file_imported(ctx, fn);
@@ -305,9 +305,8 @@ ASTNode *parse_struct(ParserContext *ctx, Lexer *l, int is_union, int is_opaque,
     ASTNode *node = ast_create(NODE_STRUCT);
     node->token = name_token;
     node->link_name = link_name ? xstrdup(link_name) : NULL;
-    add_to_struct_list(ctx, node);
-
     node->strct.name = name;
+    add_to_struct_list(ctx, node);
 
     // Initialize Type Info so we can track traits (like Drop)
     node->type_info = type_new(TYPE_STRUCT);
@@ -9,63 +9,25 @@
 #include <ctype.h>
 #include "analysis/const_fold.h"
 
-static unsigned int struct_name_hash(const char *name)
-{
-    unsigned int h = 2166136261u;
-    while (*name)
-    {
-        h ^= (unsigned char)*name++;
-        h *= 16777619u;
-    }
-    return h;
-}
-
 void struct_hash_insert(ParserContext *ctx, const char *name, ASTNode *node)
 {
-    unsigned int idx = struct_name_hash(name) & (STRUCT_HASH_SIZE - 1);
-    for (int i = 0; i < STRUCT_HASH_SIZE; i++)
+    if (name && node)
     {
-        unsigned int slot =
-            ((unsigned)(idx) + (unsigned)(i) + STRUCT_HASH_SIZE) & (STRUCT_HASH_SIZE - 1U);
-        if (!ctx->struct_hash[slot].name[0] || strcmp(ctx->struct_hash[slot].name, name) == 0)
-        {
-            strncpy(ctx->struct_hash[slot].name, name, sizeof(ctx->struct_hash[slot].name) - 1);
-            ctx->struct_hash[slot].name[sizeof(ctx->struct_hash[slot].name) - 1] = '\0';
-            ctx->struct_hash[slot].node = node;
-            return;
-        }
+        zmap_put(&registry_index(ctx)->structs, intern(name), node);
     }
 }
 
 static ASTNode *struct_hash_lookup(ParserContext *ctx, const char *name)
 {
-    unsigned int idx = struct_name_hash(name) & (STRUCT_HASH_SIZE - 1);
-    for (int i = 0; i < STRUCT_HASH_SIZE; i++)
+    const char *key = intern_find(name);
+    if (!key)
     {
-        unsigned int slot =
-            ((unsigned)(idx) + (unsigned)(i) + STRUCT_HASH_SIZE) & (STRUCT_HASH_SIZE - 1U);
-        if (!ctx->struct_hash[slot].name[0])
-        {
-            return NULL;
-        }
-        if (strcmp(ctx->struct_hash[slot].name, name) == 0)
-        {
-            return ctx->struct_hash[slot].node;
-        }
+        return NULL;
     }
-    return NULL;
+    ASTNode **found = zmap_get(&registry_index(ctx)->structs, key);
+    return found ? *found : NULL;
 }
 
-#define CACHE_RESULT(node)                                                                         \
-    do                                                                                             \
-    {                                                                                              \
-        if (node)                                                                                  \
-        {                                                                                          \
-            struct_hash_insert(ctx, name, node);                                                   \
-            return node;                                                                           \
-        }                                                                                          \
-    } while (0)
-
 void add_to_struct_list(ParserContext *ctx, ASTNode *node)
 {
     StructRef *r = xmalloc(sizeof(StructRef));
@@ -73,13 +35,19 @@ void add_to_struct_list(ParserContext *ctx, ASTNode *node)
     r->next = ctx->parsed_structs_list;
     ctx->parsed_structs_list = r;
 
-    if (node->type == NODE_STRUCT && node->strct.name)
+    // Templates share their base name with concrete structs; a registered definition wins.
+    const char *name = NULL;
+    if (node->type == NODE_STRUCT)
+    {
+        name = node->strct.name;
+    }
+    else if (node->type == NODE_ENUM)
     {
-        struct_hash_insert(ctx, node->strct.name, node);
+        name = node->enm.name;
     }
-    else if (node->type == NODE_ENUM && node->enm.name)
+    if (name && !struct_hash_lookup(ctx, name))
     {
-        struct_hash_insert(ctx, node->enm.name, node);
+        struct_hash_insert(ctx, name, node);
     }
 }
 
@@ -220,6 +188,70 @@ void add_to_global_list(ParserContext *ctx, ASTNode *node)
     ctx->parsed_globals_list = r;
 }
 
+RegistryIndex *registry_index(ParserContext *ctx)
+{
+    RegistryIndex *ix = &ctx->index;
+    if (!ix->ready)
+    {
+        ix->instantiations = zmap_init(InstMap, zmap_hash_name, zmap_cmp_name);
+        ix->slices = zmap_init(SliceMap, zmap_hash_name, zmap_cmp_name);
+        ix->tuples = zmap_init(TupleMap, zmap_hash_name, zmap_cmp_name);
+        ix->impls = zmap_init(ImplMap, zmap_hash_name, zmap_cmp_name);
+        ix->variants = zmap_init(VariantMap, zmap_hash_name, zmap_cmp_name);
+        ix->structs = zmap_init(NodeMap, zmap_hash_name, zmap_cmp_name);
+        ix->methods = zmap_init(NodeMap, zmap_hash_name, zmap_cmp_name);
+        ix->functions = zmap_init(InstMap, zmap_hash_name, zmap_cmp_name);
+        ix->ready = 1;
+    }
+    return ix;
+}
+
+Instantiation *find_instantiation(ParserContext *ctx, const char *name)
+{
+    const char *key = intern_find(name);
+    if (!key)
+    {
+        return NULL;
+    }
+    Instantiation **found = zmap_get(&registry_index(ctx)->instantiations, key);
+    return found ? *found : NULL;
+}
+
+Instantiation *find_function_instantiation(ParserContext *ctx, const char *name)
+{
+    const char *key = intern_find(name);
+    if (!key)
+    {
+        return NULL;
+    }
+    Instantiation **found = zmap_get(&registry_index(ctx)->functions, key);
+    return found ? *found : NULL;
+}
+
+void register_instantiation(ParserContext *ctx, Instantiation *inst)
+{
+    inst->next = ctx->instantiations;
+    ctx->instantiations = inst;
+    zmap_put(&registry_index(ctx)->instantiations, inst->name, inst);
+}
+
+// Drop slice and tuple types registered after @p slices / @p tuples were the list heads
+// (a speculative parse is being undone).
+void rewind_type_registries(ParserContext *ctx, SliceType *slices, TupleType *tuples)
+{
+    RegistryIndex *ix = registry_index(ctx);
+    for (SliceType *s = ctx->used_slices; s && s != slices; s = s->next)
+    {
+        zmap_remove(&ix->slices, s->name);
+    }
+    for (TupleType *tp = ctx->used_tuples; tp && tp != tuples; tp = tp->next)
+    {
+        zmap_remove(&ix->tuples, tp->sig);
+    }
+    ctx->used_slices = slices;
+    ctx->used_tuples = tuples;
+}
+
 void register_slice(ParserContext *ctx, const char *type)
 {
     if (is_known_generic(ctx, (char *)type))
@@ -227,19 +259,17 @@ void register_slice(ParserContext *ctx, const char *type)
         return;
     }
 
-    SliceType *c = ctx->used_slices;
-    while (c)
+    RegistryIndex *ix = registry_index(ctx);
+    const char *key = intern(type);
+    if (zmap_get(&ix->slices, key))
     {
-        if (strcmp(c->name, type) == 0)
-        {
-            return;
-        }
-        c = c->next;
+        return;
     }
     SliceType *n = xmalloc(sizeof(SliceType));
-    n->name = xstrdup(type);
+    n->name = (char *)key;
     n->next = ctx->used_slices;
     ctx->used_slices = n;
+    zmap_put(&ix->slices, key, n);
 
     char slice_name[MAX_TYPE_NAME_LEN];
     snprintf(slice_name, sizeof(slice_name), "Slice__%s", type);
@@ -275,17 +305,14 @@ void register_slice(ParserContext *ctx, const char *type)
 
 void register_tuple_with_types(ParserContext *ctx, const char *sig, const char **types, int count)
 {
-    TupleType *c = ctx->used_tuples;
-    while (c)
+    RegistryIndex *ix = registry_index(ctx);
+    const char *key = intern(sig);
+    if (zmap_get(&ix->tuples, key))
     {
-        if (strcmp(c->sig, sig) == 0)
-        {
-            return;
-        }
-        c = c->next;
+        return;
     }
     TupleType *n = xmalloc(sizeof(TupleType));
-    n->sig = xstrdup(sig);
+    n->sig = (char *)key;
     n->types = xmalloc(sizeof(char *) * (size_t)count);
     for (int i = 0; i < count; i++)
     {
@@ -294,6 +321,7 @@ void register_tuple_with_types(ParserContext *ctx, const char *sig, const char *
     n->count = count;
     n->next = ctx->used_tuples;
     ctx->used_tuples = n;
+    zmap_put(&ix->tuples, key, n);
 
     char struct_name[MAX_ERROR_MSG_LEN];
     char *clean_sig = sanitize_mangled_name(sig);
@@ -326,13 +354,14 @@ void register_tuple_with_types(ParserContext *ctx, const char *sig, const char *
 
 void register_struct_def(ParserContext *ctx, const char *name, ASTNode *node)
 {
+    const char *key = intern(name);
     if (ctx->config->mode_lsp)
     {
         StructDef *existing = NULL;
         StructDef *curr = ctx->struct_defs;
         while (curr)
         {
-            if (strcmp(curr->name, name) == 0)
+            if (curr->name == key)
             {
                 existing = curr;
                 break;
@@ -351,7 +380,7 @@ void register_struct_def(ParserContext *ctx, const char *name, ASTNode *node)
         StructDef *curr = ctx->struct_defs;
         while (curr)
         {
-            if (strcmp(curr->name, name) == 0)
+            if (curr->name == key)
             {
                 d = curr;
                 break;
@@ -363,7 +392,7 @@ void register_struct_def(ParserContext *ctx, const char *name, ASTNode *node)
     if (!d)
     {
         d = xmalloc(sizeof(StructDef));
-        d->name = xstrdup(name);
+        d->name = (char *)key;
         d->next = ctx->struct_defs;
         ctx->struct_defs = d;
     }
@@ -376,7 +405,7 @@ void register_struct_def(ParserContext *ctx, const char *name, ASTNode *node)
         ZenSymbol *all = ctx->all_symbols;
         while (all)
         {
-            if ((all->kind == SYM_STRUCT || all->kind == SYM_ENUM) && strcmp(all->name, name) == 0)
+            if ((all->kind == SYM_STRUCT || all->kind == SYM_ENUM) && all->name == key)
             {
                 zerror_at(node ? node->token : TOKEN_UNKNOWN, "MISRA Rule 5.7");
                 break;
@@ -421,118 +450,10 @@ void register_struct_def(ParserContext *ctx, const char *name, ASTNode *node)
 
 ASTNode *find_struct_def(ParserContext *ctx, const char *name)
 {
-    if (ctx)
-    {
-        ASTNode *cached = struct_hash_lookup(ctx, name);
-        if (cached)
-        {
-            return cached;
-        }
-    }
-
-    if (!ctx)
-    {
-        return NULL;
-    }
-
-    ZenSymbol *sym = symbol_lookup_kind(ctx->current_scope, name, SYM_STRUCT);
-    if (!sym)
-    {
-        sym = symbol_lookup_kind(ctx->current_scope, name, SYM_ENUM);
-    }
-    if (sym && sym->data.node)
-    {
-        CACHE_RESULT(sym->data.node);
-    }
-
-    if (ctx->cg.global_user_structs)
-    {
-        ASTNode *s = ctx->cg.global_user_structs;
-        while (s)
-        {
-            if ((s->type == NODE_STRUCT || s->type == NODE_ENUM) &&
-                strcmp((s->type == NODE_STRUCT ? s->strct.name : s->enm.name), name) == 0)
-            {
-                if (!(s->type == NODE_STRUCT && s->strct.is_incomplete))
-                {
-                    CACHE_RESULT(s);
-                }
-            }
-            s = s->next;
-        }
-    }
-
-    Instantiation *i = ctx->instantiations;
-    while (i)
-    {
-        if (strcmp(i->name, name) == 0)
-        {
-            CACHE_RESULT(i->struct_node);
-        }
-        i = i->next;
-    }
-
-    ASTNode *s = ctx->instantiated_structs;
-    while (s)
-    {
-        if ((s->type == NODE_STRUCT || s->type == NODE_ENUM) &&
-            strcmp((s->type == NODE_STRUCT ? s->strct.name : s->enm.name), name) == 0)
-        {
-            CACHE_RESULT(s);
-        }
-        s = s->next;
-    }
-
-    StructRef *r = ctx->parsed_structs_list;
-    while (r)
-    {
-        if (r->node->type == NODE_STRUCT && strcmp(r->node->strct.name, name) == 0)
-        {
-            CACHE_RESULT(r->node);
-        }
-        if (r->node->type == NODE_ENUM && strcmp(r->node->enm.name, name) == 0)
-        {
-            CACHE_RESULT(r->node);
-        }
-        r = r->next;
-    }
-
-    ZenSymbol *all = ctx->all_symbols;
-    while (all)
-    {
-        if ((all->kind == SYM_STRUCT || all->kind == SYM_ENUM) && strcmp(all->name, name) == 0 &&
-            all->data.node)
-        {
-            CACHE_RESULT(all->data.node);
-        }
-        all = all->next;
-    }
-
-    StructDef *d = ctx->struct_defs;
-    while (d)
-    {
-        if (strcmp(d->name, name) == 0)
-        {
-            CACHE_RESULT(d->node);
-        }
-        d = d->next;
-    }
-
-    StructRef *e = ctx->parsed_enums_list;
-    while (e)
-    {
-        if (e->node->type == NODE_ENUM && strcmp(e->node->enm.name, name) == 0)
-        {
-            CACHE_RESULT(e->node);
-        }
-        e = e->next;
-    }
-
-    return NULL;
+    // Every struct and enum is indexed when it is registered, so a miss is final.
+    return ctx && name ? struct_hash_lookup(ctx, name) : NULL;
 }
 
-#undef CACHE_RESULT
-
 ASTNode *find_trait_def(ParserContext *ctx, const char *name)
 {
     if (!ctx || !name)
@@ -554,15 +475,12 @@ ASTNode *find_trait_def(ParserContext *ctx, const char *name)
 
 ASTNode *find_concrete_struct_def(ParserContext *ctx, const char *name)
 {
-    Instantiation *i = ctx->instantiations;
-    while (i)
+    const char *key = intern_find(name);
+    Instantiation *i = key ? find_instantiation(ctx, key) : NULL;
+    if (i && i->struct_node && i->struct_node->type == NODE_STRUCT &&
+        !i->struct_node->strct.is_template)
     {
-        if (strcmp(i->name, name) == 0 && i->struct_node && i->struct_node->type == NODE_STRUCT &&
-            !i->struct_node->strct.is_template)
-        {
-            return i->struct_node;
-        }
-        i = i->next;
+        return i->struct_node;
     }
 
     ASTNode *s = ctx->instantiated_structs;
@@ -586,11 +504,11 @@ ASTNode *find_concrete_struct_def(ParserContext *ctx, const char *name)
         r = r->next;
     }
 
-    StructDef *d = ctx->struct_defs;
+    StructDef *d = key ? ctx->struct_defs : NULL;
     while (d)
     {
         if (d->node && d->node->type == NODE_STRUCT && !d->node->strct.is_template &&
-            strcmp(d->name, name) == 0)
+            d->name == key)
         {
             return d->node;
         }
@@ -602,7 +520,12 @@ ASTNode *find_concrete_struct_def(ParserContext *ctx, const char *name)
 
 Module *find_module(ParserContext *ctx, const char *alias)
 {
-    Module **mod_ptr = zmap_get(&ctx->imports.modules, alias);
+    const char *key = intern_find(alias);
+    if (!key)
+    {
+        return NULL;
+    }
+    Module **mod_ptr = zmap_get(&ctx->imports.modules, key);
     return mod_ptr ? *mod_ptr : NULL;
 }
 
@@ -613,13 +536,17 @@ void register_selective_import(ParserContext *ctx, const char *symbol, const cha
     si->symbol = xstrdup(symbol);
     si->alias = alias ? xstrdup(alias) : NULL;
     si->source_module = xstrdup(source_module);
-    const char *key = alias ? alias : symbol;
-    zmap_put(&ctx->imports.selective_imports, key, si);
+    zmap_put(&ctx->imports.selective_imports, intern(alias ? alias : symbol), si);
 }
 
 SelectiveImport *find_selective_import(ParserContext *ctx, const char *name)
 {
-    SelectiveImport **si_ptr = zmap_get(&ctx->imports.selective_imports, name);
+    const char *key = intern_find(name);
+    if (!key)
+    {
+        return NULL;
+    }
+    SelectiveImport **si_ptr = zmap_get(&ctx->imports.selective_imports, key);
     return si_ptr ? *si_ptr : NULL;
 }
 
@@ -633,7 +560,8 @@ void re_export_propagated(ParserContext *ctx, const char *alias, const char *par
     char combined[MAX_PATH_LEN];
     snprintf(combined, sizeof(combined), "%s__%s", parent_prefix, alias);
 
-    if (!zmap_get(&ctx->imports.modules, combined))
+    const char *key = intern(combined);
+    if (!zmap_get(&ctx->imports.modules, key))
     {
         Module *new_mod = xmalloc(sizeof(Module));
         new_mod->alias = xstrdup(combined);
@@ -641,7 +569,7 @@ void re_export_propagated(ParserContext *ctx, const char *alias, const char *par
         new_mod->base_name = xstrdup(base_name ? base_name : alias);
         new_mod->is_c_header = 0;
         new_mod->is_re_export = 1;
-        zmap_put(&ctx->imports.modules, xstrdup(combined), new_mod);
+        zmap_put(&ctx->imports.modules, key, new_mod);
     }
 }
 
@@ -667,7 +595,7 @@ void re_export_wildcard_symbols(ParserContext *ctx, const char *module_base)
                 continue;
             }
 
-            if (zmap_get(&ctx->imports.selective_imports, bare_name))
+            if (find_selective_import(ctx, bare_name))
             {
                 sym = sym->next;
                 continue;
@@ -722,29 +650,52 @@ void mark_file_imported(ParserContext *ctx, const char *path)
     zmap_put(&ctx->imports.imported_files, path, path);
 }
 
+// Interned "<trait>\x1f<struct>"; with @p add unset, NULL if no such pair was ever registered.
+static const char *impl_key(const char *trait, const char *strct, int add)
+{
+    size_t tlen = strlen(trait);
+    size_t slen = strlen(strct);
+    char stack_buf[256];
+    char *buf = tlen + slen + 2 <= sizeof(stack_buf) ? stack_buf : xmalloc(tlen + slen + 2);
+    memcpy(buf, trait, tlen);
+    buf[tlen] = '\x1f';
+    memcpy(buf + tlen + 1, strct, slen + 1);
+    const char *key = add ? intern(buf) : intern_find(buf);
+    if (buf != stack_buf)
+    {
+        zfree(buf);
+    }
+    return key;
+}
+
 void register_impl(ParserContext *ctx, const char *trait, const char *strct)
 {
-    ImplReg *r = xmalloc(sizeof(ImplReg));
+    ImplReg *r = xcalloc(1, sizeof(ImplReg));
     r->trait = xstrdup(trait);
     r->strct = xstrdup(strct);
     r->next = ctx->registered_impls;
     ctx->registered_impls = r;
+
+    RegistryIndex *ix = registry_index(ctx);
+    zmap_put(&ix->impls, impl_key(trait, strct, 1), r);
+    if (strchr(strct, '<'))
+    {
+        r->next_generic = ix->generic_impls;
+        ix->generic_impls = r;
+    }
 }
 
 int check_impl(ParserContext *ctx, const char *trait, const char *strct)
 {
-    ImplReg *r = ctx->registered_impls;
-    while (r)
+    RegistryIndex *ix = registry_index(ctx);
+    const char *key = impl_key(trait, strct, 0);
+    if (key && zmap_get(&ix->impls, key))
     {
-        if (strcmp(r->trait, trait) == 0 && strcmp(r->strct, strct) == 0)
-        {
-            return 1;
-        }
-        r = r->next;
+        return 1;
     }
 
-    r = ctx->registered_impls;
-    while (r)
+    // A template impl ("Vec<T>") covers its instantiations ("Vec__int").
+    for (ImplReg *r = ix->generic_impls; r; r = r->next_generic)
     {
         char *base_reg = xstrdup(r->strct);
         char *ptr2 = (char *)strchr(base_reg, '<');
@@ -762,7 +713,6 @@ int check_impl(ParserContext *ctx, const char *trait, const char *strct)
             }
         }
         zfree(base_reg);
-        r = r->next;
     }
 
     return 0;
@@ -776,10 +726,11 @@ FuncSig *find_func(ParserContext *ctx, const char *name)
         return sym->data.sig;
     }
 
-    FuncSig *c = ctx->func_registry;
+    const char *key = intern_find(name);
+    FuncSig *c = key ? ctx->func_registry : NULL;
     while (c)
     {
-        if (strcmp(c->name, name) == 0)
+        if (c->name == key)
         {
             return c;
         }
@@ -4,6 +4,7 @@
 #include "utils/format_expr.h"
 #include "utils/colors.h"
 #include "utils/utils.h"
+#include "utils/mem_report.h"
 #include "constants.h"
 #include "ast/primitives.h"
 #include <ctype.h>
@@ -45,27 +46,24 @@ void register_symbol_to_lsp(ParserContext *ctx, ZenSymbol *s)
     while (curr)
     {
         if (curr->kind == s->kind && curr->decl_token.line == s->decl_token.line &&
-            curr->decl_token.col == s->decl_token.col && curr->name && s->name &&
-            strcmp(curr->name, s->name) == 0)
+            curr->decl_token.col == s->decl_token.col && curr->name == s->name)
         {
             return;
         }
         curr = curr->next;
     }
 
+    ZcMemCategory prev = mem_enter(ZC_MEM_SYMBOLS);
     ZenSymbol *lsp_copy = xmalloc(sizeof(ZenSymbol));
     memcpy(lsp_copy, s, sizeof(ZenSymbol));
     lsp_copy->original = s;
     lsp_copy->next = ctx->all_symbols;
     ctx->all_symbols = lsp_copy;
-    if (s->name)
-    {
-        lsp_copy->name = xstrdup(s->name);
-    }
     if (s->cfg_condition)
     {
         lsp_copy->cfg_condition = xstrdup(s->cfg_condition);
     }
+    mem_leave(prev);
 
     lsp_copy->is_local = s->is_local;
 }
@@ -96,10 +96,11 @@ ZenSymbol *find_symbol_entry(ParserContext *ctx, const char *n)
 
 ZenSymbol *find_symbol_in_all(ParserContext *ctx, const char *n)
 {
-    ZenSymbol *sym = ctx->all_symbols;
+    const char *key = intern_find(n);
+    ZenSymbol *sym = key ? ctx->all_symbols : NULL;
     while (sym)
     {
-        if (strcmp(sym->name, n) == 0)
+        if (sym->name == key)
         {
             return sym;
         }
@@ -147,7 +148,7 @@ void register_func(ParserContext *ctx, Scope *scope, const char *name, int count
     if (!f)
     {
         f = xmalloc(sizeof(FuncSig));
-        f->name = xstrdup(name);
+        f->name = (char *)intern(name);
         f->next = ctx->func_registry;
         ctx->func_registry = f;
     }
@@ -336,6 +337,15 @@ void register_enum_variant(ParserContext *ctx, const char *vname, const char *en
     r->tag_id = tag;
     r->next = ctx->enum_variants;
     ctx->enum_variants = r;
+
+    if (vname)
+    {
+        RegistryIndex *ix = registry_index(ctx);
+        const char *key = intern(vname);
+        EnumVariantReg **older = zmap_get(&ix->variants, key);
+        r->same_name = older ? *older : NULL;
+        zmap_put(&ix->variants, key, r);
+    }
 }
 
 EnumVariantReg *find_enum_variant(ParserContext *ctx, const char *name)
@@ -357,21 +367,18 @@ EnumVariantReg *find_enum_variant(ParserContext *ctx, const char *name)
         vname = sep + 2;
     }
 
-    EnumVariantReg *r = ctx->enum_variants;
-    while (r)
+    const char *key = intern_find(vname);
+    EnumVariantReg **newest = key ? zmap_get(&registry_index(ctx)->variants, key) : NULL;
+    for (EnumVariantReg *r = newest ? *newest : NULL; r; r = r->same_name)
     {
-        if (strcmp(r->variant_name, vname) == 0)
+        if (!ename || strcmp(r->enum_name, ename) == 0)
         {
-            if (!ename || strcmp(r->enum_name, ename) == 0)
+            if (ename)
             {
-                if (ename)
-                {
-                    zfree(ename);
-                }
-                return r;
+                zfree(ename);
             }
+            return r;
         }
-        r = r->next;
     }
     if (ename)
     {
@@ -8,6 +8,7 @@
 #include "ast/primitives.h"
 #include <ctype.h>
 #include "analysis/const_fold.h"
+#include "utils/pass_timer.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -365,8 +366,9 @@ static void trigger_instantiations(ParserContext *ctx, ASTNode *node)
     trigger_instantiations(ctx, node->next);
 }
 
-char *instantiate_function_template(ParserContext *ctx, const char *name, const char *concrete_type,
-                                    const char *unmangled_type)
+static char *instantiate_function_template_impl(ParserContext *ctx, const char *name,
+                                                const char *concrete_type,
+                                                const char *unmangled_type)
 {
     GenericFuncTemplate *tpl = find_func_template(ctx, name);
     if (!tpl)
@@ -543,6 +545,14 @@ char *instantiate_function_template(ParserContext *ctx, const char *name, const
 
     add_instantiated_func(ctx, new_fn);
 
+    // Codegen matches instantiations of the same template (codegen_lazy.c).
+    Instantiation *fi = xcalloc(1, sizeof(Instantiation));
+    fi->name = (char *)intern(mangled);
+    fi->template_name = xstrdup(name);
+    fi->concrete_arg = xstrdup(concrete_type);
+    fi->unmangled_arg = xstrdup(subst_arg);
+    zmap_put(&registry_index(ctx)->functions, fi->name, fi);
+
     register_func(ctx, ctx->global_scope, mangled, new_fn->func.arg_count, new_fn->func.defaults,
                   new_fn->func.arg_types, new_fn->func.ret_type_info, new_fn->func.is_varargs, 0,
                   new_fn->func.pure, new_fn->link_name, new_fn->token, new_fn->func.is_export);
@@ -566,6 +576,22 @@ char *instantiate_function_template(ParserContext *ctx, const char *name, const
     return mangled;
 }
 
+char *instantiate_function_template(ParserContext *ctx, const char *name, const char *concrete_type,
+                                    const char *unmangled_type)
+{
+    if (!g_pass_timing)
+    {
+        return instantiate_function_template_impl(ctx, name, concrete_type, unmangled_type);
+    }
+    char label[256];
+    snprintf(label, sizeof(label), "%s<%s>", name,
+             unmangled_type ? unmangled_type : concrete_type);
+    pass_begin(PASS_INSTANTIATE, label);
+    char *result = instantiate_function_template_impl(ctx, name, concrete_type, unmangled_type);
+    pass_end();
+    return result;
+}
+
 void register_template(ParserContext *ctx, const char *name, ASTNode *node)
 {
     GenericTemplate *t = xcalloc(1, sizeof(GenericTemplate));
@@ -705,10 +731,15 @@ void instantiate_methods(ParserContext *ctx, GenericImplTemplate *it,
                          const char *mangled_struct_name, const char *arg,
                          const char *unmangled_arg)
 {
-    if (check_impl(ctx, "Methods", mangled_struct_name))
+    // Each (impl template, concrete struct) pair is copied once.
+    char key_buf[MAX_TYPE_NAME_LEN];
+    snprintf(key_buf, sizeof(key_buf), "%s\x1f%p", mangled_struct_name, (void *)it->impl_node);
+    const char *key = intern(key_buf);
+    if (zmap_get(&registry_index(ctx)->methods, key))
     {
-        return; // Simple dedupe check
+        return;
     }
+    zmap_put(&registry_index(ctx)->methods, key, NULL);
 
     ASTNode *backup_next = it->impl_node->next;
     it->impl_node->next = NULL; // Break link to isolate node
@@ -862,6 +893,7 @@ void instantiate_methods(ParserContext *ctx, GenericImplTemplate *it,
 
         meth = meth->next;
     }
+    zmap_put(&registry_index(ctx)->methods, key, new_impl);
     add_instantiated_func(ctx, new_impl);
 }
 
@@ -891,8 +923,8 @@ static void register_enum_constructor(ParserContext *ctx, const char *m, const c
     zfree(mangled_var);
 }
 
-void instantiate_generic(ParserContext *ctx, const char *tpl, const char *arg,
-                         const char *unmangled_arg, Token token)
+static void instantiate_generic_impl(ParserContext *ctx, const char *tpl, const char *arg,
+                                     const char *unmangled_arg, Token token)
 {
     // Ignore generic placeholders
     if (strlen(arg) == 1 && isupper(arg[0]))
@@ -916,15 +948,11 @@ void instantiate_generic(ParserContext *ctx, const char *tpl, const char *arg,
     strcat(m, clean_arg);
     zfree(clean_arg);
 
-    Instantiation *c = ctx->instantiations;
-    while (c)
+    const char *key = intern(m);
+    if (find_instantiation(ctx, key))
     {
-        if (strcmp(c->name, m) == 0)
-        {
-            zfree(m);
-            return; // Already instantiated, DO NOTHING.
-        }
-        c = c->next;
+        zfree(m);
+        return; // Already instantiated, DO NOTHING.
     }
 
     GenericTemplate *t = ctx->templates;
@@ -943,14 +971,13 @@ void instantiate_generic(ParserContext *ctx, const char *tpl, const char *arg,
     }
 
     Instantiation *ni = xcalloc(1, sizeof(Instantiation));
-    ni->name = xstrdup(m);
+    ni->name = (char *)key;
     ni->template_name = xstrdup(tpl);
     ni->concrete_arg = xstrdup(arg);
     ni->unmangled_arg = unmangled_arg ? xstrdup(unmangled_arg)
                                       : xstrdup(arg); // Fallback to arg if unmangled is generic
     ni->struct_node = NULL;                           // Placeholder to break cycles
-    ni->next = ctx->instantiations;
-    ctx->instantiations = ni;
+    register_instantiation(ctx, ni);
 
     ASTNode *struct_node_copy = NULL;
 
@@ -1069,6 +1096,21 @@ void instantiate_generic(ParserContext *ctx, const char *tpl, const char *arg,
     zfree(m);
 }
 
+void instantiate_generic(ParserContext *ctx, const char *tpl, const char *arg,
+                         const char *unmangled_arg, Token token)
+{
+    if (!g_pass_timing)
+    {
+        instantiate_generic_impl(ctx, tpl, arg, unmangled_arg, token);
+        return;
+    }
+    char label[256];
+    snprintf(label, sizeof(label), "%s<%s>", tpl, unmangled_arg ? unmangled_arg : arg);
+    pass_begin(PASS_INSTANTIATE, label);
+    instantiate_generic_impl(ctx, tpl, arg, unmangled_arg, token);
+    pass_end();
+}
+
 static void free_field_list(ASTNode *fields)
 {
     while (fields)
@@ -1087,8 +1129,8 @@ static void free_field_list(ASTNode *fields)
     }
 }
 
-void instantiate_generic_multi(ParserContext *ctx, const char *tpl, char **args, int arg_count,
-                               Token token)
+static void instantiate_generic_multi_impl(ParserContext *ctx, const char *tpl, char **args,
+                                           int arg_count, Token token)
 {
     // Build mangled name from all args
     size_t m_len = strlen(tpl) + 1;
@@ -1114,15 +1156,11 @@ void instantiate_generic_multi(ParserContext *ctx, const char *tpl, char **args,
     }
 
     // Check if already instantiated
-    Instantiation *c = ctx->instantiations;
-    while (c)
+    const char *key = intern(m);
+    if (find_instantiation(ctx, key))
     {
-        if (strcmp(c->name, m) == 0)
-        {
-            zfree(m);
-            return; // Already done
-        }
-        c = c->next;
+        zfree(m);
+        return; // Already done
     }
 
     // Find the template
@@ -1143,7 +1181,7 @@ void instantiate_generic_multi(ParserContext *ctx, const char *tpl, char **args,
 
     // Register instantiation first (to break cycles)
     Instantiation *ni = xcalloc(1, sizeof(Instantiation));
-    ni->name = xstrdup(m);
+    ni->name = (char *)key;
     ni->template_name = xstrdup(tpl);
     ni->concrete_arg = (arg_count > 0) ? xstrdup(args[0]) : xstrdup("T");
 
@@ -1166,8 +1204,7 @@ void instantiate_generic_multi(ParserContext *ctx, const char *tpl, char **args,
     ni->unmangled_arg = u_buf;
 
     ni->struct_node = NULL;
-    ni->next = ctx->instantiations;
-    ctx->instantiations = ni;
+    register_instantiation(ctx, ni);
 
     if (t->struct_node->type == NODE_STRUCT)
     {
@@ -1290,3 +1327,26 @@ void instantiate_generic_multi(ParserContext *ctx, const char *tpl, char **args,
     }
     zfree(m);
 }
+
+void instantiate_generic_multi(ParserContext *ctx, const char *tpl, char **args, int arg_count,
+                               Token token)
+{
+    if (!g_pass_timing)
+    {
+        instantiate_generic_multi_impl(ctx, tpl, args, arg_count, token);
+        return;
+    }
+    char label[256];
+    int len = snprintf(label, sizeof(label), "%s<", tpl);
+    for (int i = 0; i < arg_count && len > 0 && (size_t)len < sizeof(label); i++)
+    {
+        len += snprintf(label + len, sizeof(label) - (size_t)len, "%s%s", i ? ", " : "", args[i]);
+    }
+    if (len > 0 && (size_t)len < sizeof(label) - 1)
+    {
+        strcat(label, ">");
+    }
+    pass_begin(PASS_INSTANTIATE, label);
+    instantiate_generic_multi_impl(ctx, tpl, args, arg_count, token);
+    pass_end();
+}
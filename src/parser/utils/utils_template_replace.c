@@ -4,6 +4,7 @@
 #include "utils/format_expr.h"
 #include "utils/colors.h"
 #include "utils/utils.h"
+#include "utils/mem_report.h"
 #include "constants.h"
 #include "ast/primitives.h"
 #include <ctype.h>
@@ -13,6 +14,128 @@
 
 int is_unmangle_primitive(const char *base);
 
+/**
+ * One substitution as copy_ast_replacing() applies it to a whole template: the parameter lists
+ * split and sanitized once, each concrete type parsed once, and each distinct string rewritten
+ * once, rather than again at every node, type and name of the body.
+ */
+typedef struct Subst
+{
+    const char *p, *c, *os, *ns; ///< Arguments it was built for, compared by pointer.
+    int count;                   ///< Parameter/concrete pairs.
+    char **params;
+    char **concretes;
+    Type **parsed;     ///< type_from_string_helper() of each concrete, built on first use.
+    char *p_suffix;    ///< "__T__U", how the parameters appear in mangled names.
+    char *c_suffix;    ///< "__int__float", what replaces them.
+    zmap_StrMap types; ///< replace_type_str() results by source string.
+    zmap_StrMap words; ///< replace_params() results by source string.
+    struct Subst *outer;
+} Subst;
+
+static Subst *subst; // Innermost copy_ast_replacing() in progress.
+
+static Subst *subst_for(const char *p, const char *c, const char *os, const char *ns)
+{
+    if (subst && subst->p == p && subst->c == c && subst->os == os && subst->ns == ns)
+    {
+        return subst;
+    }
+    return NULL;
+}
+
+static char **split_list(const char *s, int *count)
+{
+    int cap = 1;
+    for (const char *q = s; *q; q++)
+    {
+        cap += *q == ',';
+    }
+    char **out = xmalloc(sizeof(char *) * (size_t)cap);
+    int n = 0;
+    while (*s)
+    {
+        const char *end = strchr(s, ',');
+        size_t len = end ? (size_t)(end - s) : strlen(s);
+        out[n] = xmalloc(len + 1);
+        memcpy(out[n], s, len);
+        out[n++][len] = 0;
+        if (!end)
+        {
+            break;
+        }
+        s = end + 1;
+    }
+    *count = n;
+    return out;
+}
+
+// "__" followed by each element of the list, sanitized for mangling.
+static char *mangled_suffix(const char *list)
+{
+    int n = 0;
+    char **parts = split_list(list, &n);
+    size_t cap = 1;
+    char **clean = xmalloc(sizeof(char *) * (size_t)(n ? n : 1));
+    for (int i = 0; i < n; i++)
+    {
+        clean[i] = sanitize_mangled_name(parts[i]);
+        cap += strlen(clean[i]) + 2;
+    }
+    char *res = xmalloc(cap);
+    res[0] = 0;
+    for (int i = 0; i < n; i++)
+    {
+        strcat(res, "__");
+        strcat(res, clean[i]);
+    }
+    return res;
+}
+
+static void subst_push(const char *p, const char *c, const char *os, const char *ns)
+{
+    Subst *s = xcalloc(1, sizeof(Subst));
+    s->p = p;
+    s->c = c;
+    s->os = os;
+    s->ns = ns;
+    s->types = zmap_init(StrMap, zmap_hash_cstr, zmap_cmp_cstr);
+    s->words = zmap_init(StrMap, zmap_hash_cstr, zmap_cmp_cstr);
+    if (p && c)
+    {
+        if (strchr(p, ','))
+        {
+            int np = 0;
+            int nc = 0;
+            s->params = split_list(p, &np);
+            s->concretes = split_list(c, &nc);
+            s->count = np < nc ? np : nc;
+        }
+        else
+        {
+            // A single parameter takes the whole argument, commas and all.
+            s->params = xmalloc(sizeof(char *));
+            s->concretes = xmalloc(sizeof(char *));
+            s->params[0] = (char *)p;
+            s->concretes[0] = (char *)c;
+            s->count = 1;
+        }
+        s->parsed = xcalloc((size_t)(s->count ? s->count : 1), sizeof(Type *));
+        s->p_suffix = mangled_suffix(p);
+        s->c_suffix = mangled_suffix(c);
+    }
+    s->outer = subst;
+    subst = s;
+}
+
+static void subst_pop(void)
+{
+    Subst *s = subst;
+    subst = s->outer;
+    zmap_free(&s->types);
+    zmap_free(&s->words);
+}
+
 static char *replace_in_string(const char *src, const char *old_w, const char *new_w)
 {
     if (!src || !old_w || !new_w)
@@ -265,8 +388,8 @@ static char *replace_mangled_part(const char *src, const char *param, const char
     return result;
 }
 
-char *replace_type_str(const char *src, const char *param, const char *concrete,
-                       const char *old_struct, const char *new_struct)
+static char *replace_type_str_impl(const char *src, const char *param, const char *concrete,
+                                   const char *old_struct, const char *new_struct)
 {
     if (!src)
     {
@@ -397,6 +520,29 @@ char *replace_type_str(const char *src, const char *param, const char *concrete,
     return final_res;
 }
 
+char *replace_type_str(const char *src, const char *param, const char *concrete,
+                       const char *old_struct, const char *new_struct)
+{
+    ZcMemCategory prev = mem_enter(ZC_MEM_TEMPLATES);
+    Subst *s = src ? subst_for(param, concrete, old_struct, new_struct) : NULL;
+    char **hit = s ? zmap_get(&s->types, src) : NULL;
+    char *res;
+    if (hit)
+    {
+        res = *hit ? xstrdup(*hit) : NULL;
+    }
+    else
+    {
+        res = replace_type_str_impl(src, param, concrete, old_struct, new_struct);
+        if (s)
+        {
+            zmap_put(&s->types, xstrdup(src), res ? xstrdup(res) : NULL);
+        }
+    }
+    mem_leave(prev);
+    return res;
+}
+
 ASTNode *copy_ast_replacing(ASTNode *n, const char *p, const char *c, const char *os,
                             const char *ns);
 
@@ -540,6 +686,39 @@ Type *type_from_string_helper(const char *c)
     return n;
 }
 
+// Deep copy, so that substituted types never share nodes with each other.
+static Type *type_copy(const Type *t)
+{
+    if (!t)
+    {
+        return NULL;
+    }
+    ZcMemCategory prev = mem_enter(ZC_MEM_TYPES);
+    Type *n = xmalloc(sizeof(Type));
+    mem_leave(prev);
+    *n = *t;
+    n->name = t->name ? xstrdup(t->name) : NULL;
+    n->inner = type_copy(t->inner);
+    if (t->arg_count > 0 && t->args)
+    {
+        n->args = xmalloc(sizeof(Type *) * (size_t)t->arg_count);
+        for (int i = 0; i < t->arg_count; i++)
+        {
+            n->args[i] = type_copy(t->args[i]);
+        }
+    }
+    return n;
+}
+
+static Type *subst_type(Subst *s, int i)
+{
+    if (!s->parsed[i])
+    {
+        s->parsed[i] = type_from_string_helper(s->concretes[i]);
+    }
+    return type_copy(s->parsed[i]);
+}
+
 Type *replace_type_formal(Type *t, const char *p, const char *c, const char *os, const char *ns)
 {
     if (!t || (uintptr_t)t < 0x10000)
@@ -553,11 +732,22 @@ Type *replace_type_formal(Type *t, const char *p, const char *c, const char *os,
         return NULL;
     }
 
+    Subst *s = subst_for(p, c, os, ns);
+
     // Exact Match Logic (with multi-param splitting)
     if ((t->kind == TYPE_STRUCT || t->kind == TYPE_GENERIC) && t->name)
     {
-
-        if (p && c && strchr(p, ','))
+        if (s && s->count)
+        {
+            for (int i = 0; i < s->count; i++)
+            {
+                if (strcmp(t->name, s->params[i]) == 0)
+                {
+                    return subst_type(s, i);
+                }
+            }
+        }
+        else if (p && c && strchr(p, ','))
         {
             char *p_ptr = (char *)p;
             char *c_ptr = (char *)c;
@@ -617,10 +807,11 @@ Type *replace_type_formal(Type *t, const char *p, const char *c, const char *os,
         else if (p && c)
         {
             // Suffix Match Logic (with multi-param splitting)
-            char p_suffix[4096];
-            p_suffix[0] = 0;
+            char p_suffix_buf[4096];
+            const char *p_suffix = s ? s->p_suffix : p_suffix_buf;
+            p_suffix_buf[0] = 0;
 
-            const char *p_ptr = p;
+            const char *p_ptr = s ? NULL : p;
             while (p_ptr && *p_ptr)
             {
                 const char *p_next = (char *)strchr(p_ptr, ',');
@@ -630,8 +821,8 @@ Type *replace_type_formal(Type *t, const char *p, const char *c, const char *os,
                 sub[sub_len] = 0;
 
                 char *clean_sub = sanitize_mangled_name(sub);
-                strcat(p_suffix, "__");
-                strcat(p_suffix, clean_sub);
+                strcat(p_suffix_buf, "__");
+                strcat(p_suffix_buf, clean_sub);
                 zfree(clean_sub);
                 zfree(sub);
 
@@ -694,9 +885,10 @@ Type *replace_type_formal(Type *t, const char *p, const char *c, const char *os,
             if (match)
             {
                 slen = found_slen;
-                char c_suffix[MAX_ERROR_MSG_LEN];
-                c_suffix[0] = 0;
-                const char *c_ptr = c;
+                char c_suffix_buf[MAX_ERROR_MSG_LEN];
+                const char *c_suffix = s ? s->c_suffix : c_suffix_buf;
+                c_suffix_buf[0] = 0;
+                const char *c_ptr = s ? NULL : c;
                 while (c_ptr && *c_ptr)
                 {
                     const char *c_next = (char *)strchr(c_ptr, ',');
@@ -708,8 +900,8 @@ Type *replace_type_formal(Type *t, const char *p, const char *c, const char *os,
 
                     char *clean = sanitize_mangled_name(sub);
                     // Standardize: always use __ for mangled part
-                    strcat(c_suffix, "__");
-                    strcat(c_suffix, clean);
+                    strcat(c_suffix_buf, "__");
+                    strcat(c_suffix_buf, clean);
                     zfree(clean);
                     zfree(sub);
 
@@ -785,8 +977,95 @@ Type *replace_type_formal(Type *t, const char *p, const char *c, const char *os,
     return n;
 }
 
-ASTNode *copy_ast_replacing(ASTNode *n, const char *p, const char *c, const char *os,
+// Generic parameters in @p src replaced by their concrete types, as written and mangled.
+static char *replace_params_impl(const char *src, const char *p, const char *c)
+{
+    char *res = src ? xstrdup(src) : NULL;
+    if (p && c && strchr(p, ','))
+    {
+        char *p_ptr = (char *)p;
+        char *c_ptr = (char *)c;
+        while (*p_ptr && *c_ptr)
+        {
+            char *p_end = (char *)strchr(p_ptr, ',');
+            int p_len = p_end ? (int)(p_end - p_ptr) : (int)strlen(p_ptr);
+            char *c_end = (char *)strchr(c_ptr, ',');
+            int c_len = c_end ? (int)(c_end - c_ptr) : (int)strlen(c_ptr);
+
+            char *p_part = xmalloc((size_t)(p_len + 1));
+            strncpy(p_part, p_ptr, (size_t)(p_len));
+            p_part[p_len] = 0;
+
+            char *c_part = xmalloc((size_t)(c_len + 1));
+            strncpy(c_part, c_ptr, (size_t)(c_len));
+            c_part[c_len] = 0;
+
+            char *t1 = replace_in_string(res, p_part, c_part);
+            zfree(res);
+            res = t1;
+
+            char *clean_c = sanitize_mangled_name(c_part);
+            char *t2 = replace_mangled_part(res, p_part, clean_c);
+            zfree(res);
+            res = t2;
+
+            zfree(p_part);
+            zfree(c_part);
+            zfree(clean_c);
+
+            if (p_end)
+            {
+                p_ptr = p_end + 1;
+            }
+            else
+            {
+                break;
+            }
+            if (c_end)
+            {
+                c_ptr = c_end + 1;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+    else if (p && c)
+    {
+        char *t1 = replace_in_string(res, p, c);
+        zfree(res);
+        res = t1;
+
+        char *clean_c = sanitize_mangled_name(c);
+        char *t2 = replace_mangled_part(res, p, clean_c);
+        zfree(res);
+        res = t2;
+        zfree(clean_c);
+    }
+    return res;
+}
+
+static char *replace_params(const char *src, const char *p, const char *c, const char *os,
                             const char *ns)
+{
+    Subst *s = src ? subst_for(p, c, os, ns) : NULL;
+    if (!s)
+    {
+        return replace_params_impl(src, p, c);
+    }
+    char **hit = zmap_get(&s->words, src);
+    if (hit)
+    {
+        return xstrdup(*hit);
+    }
+    char *res = replace_params_impl(src, p, c);
+    zmap_put(&s->words, xstrdup(src), xstrdup(res));
+    return res;
+}
+
+static ASTNode *copy_ast_replacing_impl(ASTNode *n, const char *p, const char *c, const char *os,
+                                        const char *ns)
 {
     if (!n)
     {
@@ -813,72 +1092,7 @@ ASTNode *copy_ast_replacing(ASTNode *n, const char *p, const char *c, const char
         new_node->func.name = n->func.name ? xstrdup(n->func.name) : NULL;
         new_node->func.ret_type = replace_type_str(n->func.ret_type, p, c, os, ns);
 
-        char *tmp_args = n->func.args ? xstrdup(n->func.args) : NULL;
-        if (p && c && strchr(p, ','))
-        {
-            char *p_ptr = (char *)p;
-            char *c_ptr = (char *)c;
-            while (*p_ptr && *c_ptr)
-            {
-                char *p_end = (char *)strchr(p_ptr, ',');
-                int p_len = p_end ? (int)(p_end - p_ptr) : (int)strlen(p_ptr);
-                char *c_end = (char *)strchr(c_ptr, ',');
-                int c_len = c_end ? (int)(c_end - c_ptr) : (int)strlen(c_ptr);
-
-                char *p_part = xmalloc((size_t)(p_len + 1));
-                strncpy(p_part, p_ptr, (size_t)(p_len));
-                p_part[p_len] = 0;
-
-                char *c_part = xmalloc((size_t)(c_len + 1));
-                strncpy(c_part, c_ptr, (size_t)(c_len));
-                c_part[c_len] = 0;
-
-                char *t1 = replace_in_string(tmp_args, p_part, c_part);
-                zfree(tmp_args);
-                tmp_args = t1;
-
-                char *clean_c = sanitize_mangled_name(c_part);
-                char *t2 = replace_mangled_part(tmp_args, p_part, clean_c);
-                zfree(tmp_args);
-                tmp_args = t2;
-
-                zfree(p_part);
-                zfree(c_part);
-                zfree(clean_c);
-
-                if (p_end)
-                {
-                    p_ptr = p_end + 1;
-                }
-                else
-                {
-                    break;
-                }
-                if (c_end)
-                {
-                    c_ptr = c_end + 1;
-                }
-                else
-                {
-                    break;
-                }
-            }
-        }
-        else
-        {
-            char *t1 = replace_in_string(tmp_args, p, c);
-            zfree(tmp_args);
-            tmp_args = t1;
-
-            if (p && c)
-            {
-                char *clean_c = sanitize_mangled_name(c);
-                char *t2 = replace_mangled_part(tmp_args, p, clean_c);
-                zfree(tmp_args);
-                tmp_args = t2;
-                zfree(clean_c);
-            }
-        }
+        char *tmp_args = replace_params(n->func.args, p, c, os, ns);
 
         if (os && ns)
         {
@@ -944,72 +1158,7 @@ ASTNode *copy_ast_replacing(ASTNode *n, const char *p, const char *c, const char
         break;
     case NODE_RAW_STMT:
     {
-        char *s1 = xstrdup(n->raw_stmt.content);
-        if (p && c && strchr(p, ','))
-        {
-            char *p_ptr = (char *)p;
-            char *c_ptr = (char *)c;
-            while (*p_ptr && *c_ptr)
-            {
-                char *p_end = (char *)strchr(p_ptr, ',');
-                int p_len = p_end ? (int)(p_end - p_ptr) : (int)strlen(p_ptr);
-                char *c_end = (char *)strchr(c_ptr, ',');
-                int c_len = c_end ? (int)(c_end - c_ptr) : (int)strlen(c_ptr);
-
-                char *p_part = xmalloc((size_t)(p_len + 1));
-                strncpy(p_part, p_ptr, (size_t)(p_len));
-                p_part[p_len] = 0;
-
-                char *c_part = xmalloc((size_t)(c_len + 1));
-                strncpy(c_part, c_ptr, (size_t)(c_len));
-                c_part[c_len] = 0;
-
-                char *t1 = replace_in_string(s1, p_part, c_part);
-                zfree(s1);
-                s1 = t1;
-
-                char *clean_c = sanitize_mangled_name(c_part);
-                char *t2 = replace_mangled_part(s1, p_part, clean_c);
-                zfree(s1);
-                s1 = t2;
-
-                zfree(p_part);
-                zfree(c_part);
-                zfree(clean_c);
-
-                if (p_end)
-                {
-                    p_ptr = p_end + 1;
-                }
-                else
-                {
-                    break;
-                }
-                if (c_end)
-                {
-                    c_ptr = c_end + 1;
-                }
-                else
-                {
-                    break;
-                }
-            }
-        }
-        else
-        {
-            char *t1 = replace_in_string(s1, p, c);
-            zfree(s1);
-            s1 = t1;
-
-            if (p && c)
-            {
-                char *clean_c = sanitize_mangled_name(c);
-                char *t2 = replace_mangled_part(s1, p, clean_c);
-                zfree(s1);
-                s1 = t2;
-                zfree(clean_c);
-            }
-        }
+        char *s1 = replace_params(n->raw_stmt.content, p, c, os, ns);
 
         if (os && ns)
         {
@@ -1047,72 +1196,7 @@ ASTNode *copy_ast_replacing(ASTNode *n, const char *p, const char *c, const char
         break;
     case NODE_EXPR_VAR:
     {
-        char *n1 = n->var_ref.name ? xstrdup(n->var_ref.name) : NULL;
-        if (p && c && strchr(p, ','))
-        {
-            char *p_ptr = (char *)p;
-            char *c_ptr = (char *)c;
-            while (*p_ptr && *c_ptr)
-            {
-                char *p_end = (char *)strchr(p_ptr, ',');
-                int p_len = p_end ? (int)(p_end - p_ptr) : (int)strlen(p_ptr);
-                char *c_end = (char *)strchr(c_ptr, ',');
-                int c_len = c_end ? (int)(c_end - c_ptr) : (int)strlen(c_ptr);
-
-                char *p_part = xmalloc((size_t)(p_len + 1));
-                strncpy(p_part, p_ptr, (size_t)(p_len));
-                p_part[p_len] = 0;
-
-                char *c_part = xmalloc((size_t)(c_len + 1));
-                strncpy(c_part, c_ptr, (size_t)(c_len));
-                c_part[c_len] = 0;
-
-                char *t1 = replace_in_string(n1, p_part, c_part);
-                zfree(n1);
-                n1 = t1;
-
-                char *clean_c = sanitize_mangled_name(c_part);
-                char *t2 = replace_mangled_part(n1, p_part, clean_c);
-                zfree(n1);
-                n1 = t2;
-
-                zfree(p_part);
-                zfree(c_part);
-                zfree(clean_c);
-
-                if (p_end)
-                {
-                    p_ptr = p_end + 1;
-                }
-                else
-                {
-                    break;
-                }
-                if (c_end)
-                {
-                    c_ptr = c_end + 1;
-                }
-                else
-                {
-                    break;
-                }
-            }
-        }
-        else
-        {
-            if (p && c)
-            {
-                char *t1 = replace_in_string(n1, p, c);
-                zfree(n1);
-                n1 = t1;
-
-                char *clean_c = sanitize_mangled_name(c);
-                char *n2 = replace_mangled_part(n1, p, clean_c);
-                zfree(clean_c);
-                zfree(n1);
-                n1 = n2;
-            }
-        }
+        char *n1 = replace_params(n->var_ref.name, p, c, os, ns);
 
         if (os && ns)
         {
@@ -1544,6 +1628,25 @@ ASTNode *copy_ast_replacing(ASTNode *n, const char *p, const char *c, const char
     return new_node;
 }
 
+// Nodes and types keep their own categories; what is left here are the substituted strings.
+ASTNode *copy_ast_replacing(ASTNode *n, const char *p, const char *c, const char *os,
+                            const char *ns)
+{
+    ZcMemCategory prev = mem_enter(ZC_MEM_TEMPLATES);
+    int outermost = !subst_for(p, c, os, ns);
+    if (outermost)
+    {
+        subst_push(p, c, os, ns);
+    }
+    ASTNode *res = copy_ast_replacing_impl(n, p, c, os, ns);
+    if (outermost)
+    {
+        subst_pop();
+    }
+    mem_leave(prev);
+    return res;
+}
+
 // Helper to sanitize type names for mangling (e.g. "int*" -> "intPtr")
 char *sanitize_mangled_name(const char *s)
 {
@@ -466,7 +466,7 @@ static char *quote_arg(const char *arg)
 }
 #endif
 
-int z_run_command(char *const argv[])
+int z_spawn_command(char *const argv[], ZProcess *out)
 {
 #if ZC_OS_WINDOWS
     size_t cmd_len = 0;
@@ -515,14 +515,10 @@ int z_run_command(char *const argv[])
         return -1;
     }
 
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    DWORD exit_code;
-    GetExitCodeProcess(pi.hProcess, &exit_code);
-
-    CloseHandle(pi.hProcess);
     CloseHandle(pi.hThread);
     zfree(cmd_line);
-    return (int)exit_code;
+    *out = (ZProcess)pi.hProcess;
+    return 0;
 #else
     pid_t pid = fork();
     if (pid == 0)
@@ -534,18 +530,42 @@ int z_run_command(char *const argv[])
     {
         return -1;
     }
-    else
+    *out = (ZProcess)pid;
+    return 0;
+#endif
+}
+
+int z_wait_command(ZProcess proc)
+{
+#if ZC_OS_WINDOWS
+    HANDLE h = (HANDLE)proc;
+    WaitForSingleObject(h, INFINITE);
+    DWORD exit_code;
+    GetExitCodeProcess(h, &exit_code);
+    CloseHandle(h);
+    return (int)exit_code;
+#else
+    int status;
+    if (waitpid((pid_t)proc, &status, 0) < 0)
     {
-        int status;
-        waitpid(pid, &status, 0);
-        if (WIFEXITED(status))
-        {
-            return WEXITSTATUS(status);
-        }
         return -1;
     }
-#endif
+    if (WIFEXITED(status))
+    {
+        return WEXITSTATUS(status);
+    }
     return -1;
+#endif
+}
+
+int z_run_command(char *const argv[])
+{
+    ZProcess proc;
+    if (z_spawn_command(argv, &proc) != 0)
+    {
+        return -1;
+    }
+    return z_wait_command(proc);
 }
 
 #if !ZC_OS_WINDOWS
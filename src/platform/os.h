@@ -9,6 +9,7 @@
 #include "lang.h"
 #include "arch.h"
 #include "../compat/c23_compat.h"
+#include <stdint.h>
 
 // OS Detection
 #ifdef __COSMOPOLITAN__
@@ -188,6 +189,25 @@ int z_path_match_compiler(const char *path, const char *compiler_name);
  */
 int z_path_has_extension(const char *path, const char *ext);
 
+/**
+ * @brief Handle of a spawned child process (pid on POSIX, process HANDLE on Windows).
+ */
+typedef intptr_t ZProcess;
+
+/**
+ * @brief Start a command without waiting for it.
+ * @param argv NULL-terminated array of arguments.
+ * @param out Receives the process handle, to be passed to z_wait_command() exactly once.
+ * @return 0 on success, -1 if the process could not be created.
+ */
+int z_spawn_command(char *const argv[], ZProcess *out);
+
+/**
+ * @brief Wait for a process started with z_spawn_command() and release its handle.
+ * @return Exit code of the process, or -1 if it did not exit normally.
+ */
+int z_wait_command(ZProcess proc);
+
 /**
  * @brief Run a command securely without shell interpretation.
  * @param argv NULL-terminated array of arguments.
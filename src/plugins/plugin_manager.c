@@ -6,6 +6,7 @@
 #include "../utils/colors.h"
 #include "../constants.h"
 #include "../diagnostics/diagnostics.h"
+#include "../utils/source_manager.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,7 +39,7 @@ static ZEN_FORMAT_PRINTF(2, 3) void plugin_error(const ZApi *api, const char *fm
     va_end(args);
 
     Token t = {0};
-    t.file = api->filename;
+    t.file = source_intern(api->filename);
     t.line = api->current_line;
     t.col = 1;
     t.col = 1;
@@ -54,7 +55,7 @@ static ZEN_FORMAT_PRINTF(2, 3) void plugin_warn(const ZApi *api, const char *fmt
     va_end(args);
 
     Token t = {0};
-    t.file = api->filename;
+    t.file = source_intern(api->filename);
     t.line = api->current_line;
     t.col = 1;
     t.col = 1;
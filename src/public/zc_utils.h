@@ -11,15 +11,16 @@
 #include <stddef.h>
 
 // Memory allocation (from zalloc.h arena system)
+// The names are parenthesized so these declarations survive arena.h's call-site macros.
 
 /** @brief Allocate memory from the arena. Never returns NULL (aborts on OOM). */
-void *xmalloc(size_t size);
+void *(xmalloc)(size_t size);
 /** @brief Reallocate memory within the arena. Never returns NULL. */
-void *xrealloc(void *ptr, size_t new_size);
+void *(xrealloc)(void *ptr, size_t new_size);
 /** @brief Allocate zero-initialized memory. Never returns NULL. */
-void *xcalloc(size_t n, size_t size);
+void *(xcalloc)(size_t n, size_t size);
 /** @brief Duplicate a string using arena allocation. Never returns NULL. */
-char *xstrdup(const char *s);
+char *(xstrdup)(const char *s);
 
 /**
  * @brief No-op free for arena-allocated memory.
@@ -34,6 +35,10 @@ char *xstrdup(const char *s);
 #define realloc(p, s) xrealloc(p, s)
 #define calloc(n, s) xcalloc(n, s)
 
+// Memory accounting: per-subsystem arena counters (ZcMemStats, zc_mem_stats())
+
+#include "mem_stats.h"
+
 // Emitter (output buffer)
 
 #include "emitter.h"
@@ -60,6 +60,173 @@ int repl_jit_execute(const char *c_code, CompilerConfig *cfg)
     tcc_delete(s);
     return 0;
 }
+
+struct ZJitProgram
+{
+    TCCState *s;
+};
+
+typedef struct
+{
+    char *buf;
+    size_t size;
+    int set;
+} JitReason;
+
+// Warnings do not matter once cc takes over; the first hard error becomes the fallback reason.
+static void jit_reason_handler(void *opaque, const char *msg)
+{
+    JitReason *reason = (JitReason *)opaque;
+    if (reason->set || strstr(msg, "warning:"))
+    {
+        return;
+    }
+    snprintf(reason->buf, reason->size, "tcc: %s", msg);
+    reason->set = 1;
+}
+
+// Value of a flag given either joined ("-Ifoo") or as the next argument ("-I foo").
+static const char *jit_flag_value(const ArgList *flags, size_t *i, size_t prefix_len)
+{
+    const char *arg = flags->args[*i];
+    if (arg[prefix_len])
+    {
+        return arg + prefix_len;
+    }
+    if (*i + 1 < flags->count)
+    {
+        return flags->args[++*i];
+    }
+    return NULL;
+}
+
+static int jit_apply_flags(TCCState *s, const ArgList *flags, JitReason *reason)
+{
+    for (size_t i = 0; i < flags->count; i++)
+    {
+        const char *arg = flags->args[i];
+        const char *value = NULL;
+        if (strcmp(arg, "-iquote") == 0 || strncmp(arg, "-I", 2) == 0)
+        {
+            value = jit_flag_value(flags, &i, arg[1] == 'I' ? 2 : strlen(arg));
+            if (value)
+            {
+                tcc_add_include_path(s, value);
+            }
+        }
+        else if (strncmp(arg, "-D", 2) == 0)
+        {
+            value = jit_flag_value(flags, &i, 2);
+            if (value)
+            {
+                char name[256];
+                const char *eq = strchr(value, '=');
+                size_t len = eq ? (size_t)(eq - value) : strlen(value);
+                snprintf(name, sizeof(name), "%.*s", (int)len, value);
+                tcc_define_symbol(s, name, eq ? eq + 1 : NULL);
+            }
+        }
+        else if (strncmp(arg, "-U", 2) == 0)
+        {
+            value = jit_flag_value(flags, &i, 2);
+            if (value)
+            {
+                tcc_undefine_symbol(s, value);
+            }
+        }
+        else if (strncmp(arg, "-L", 2) == 0)
+        {
+            value = jit_flag_value(flags, &i, 2);
+            if (value)
+            {
+                tcc_add_library_path(s, value);
+            }
+        }
+        else if (strncmp(arg, "-l", 2) == 0)
+        {
+            value = jit_flag_value(flags, &i, 2);
+            if (value && tcc_add_library(s, value) < 0)
+            {
+                if (!reason->set)
+                {
+                    snprintf(reason->buf, reason->size, "tcc cannot find library '%s'", value);
+                }
+                return 0;
+            }
+        }
+        else if (strncmp(arg, "-O", 2) == 0 || strncmp(arg, "-g", 2) == 0 ||
+                 strncmp(arg, "-W", 2) == 0 || strcmp(arg, "-w") == 0 ||
+                 strncmp(arg, "-std=", 5) == 0 || strcmp(arg, "-pipe") == 0)
+        {
+            // Code generation and diagnostics tuning; meaningless for an in-memory TCC run.
+        }
+        else
+        {
+            snprintf(reason->buf, reason->size, "flag '%s' is not supported in-process", arg);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+ZJitProgram *repl_jit_compile_program(const char *c_code, const ArgList *flags,
+                                      CompilerConfig *cfg, char *reason, size_t reason_size)
+{
+    JitReason why = {reason, reason_size, 0};
+    snprintf(reason, reason_size, "tcc rejected the program");
+
+    TCCState *s = tcc_new();
+    if (!s)
+    {
+        snprintf(reason, reason_size, "could not create a TCC state");
+        return NULL;
+    }
+    tcc_set_error_func(s, &why, jit_reason_handler);
+    tcc_set_output_type(s, TCC_OUTPUT_MEMORY);
+
+    int ok = jit_apply_flags(s, flags, &why) && tcc_compile_string(s, c_code) != -1;
+    for (size_t i = 0; ok && i < cfg->c_files.length; i++)
+    {
+        ok = tcc_add_file(s, cfg->c_files.data[i]) != -1;
+    }
+    // Relocate here rather than in tcc_run() so unresolved symbols still reach the fallback.
+#ifdef TCC_RELOCATE_AUTO
+    ok = ok && tcc_relocate(s, TCC_RELOCATE_AUTO) >= 0;
+#else
+    ok = ok && tcc_relocate(s) >= 0;
+#endif
+    if (ok && !tcc_get_symbol(s, "main"))
+    {
+        snprintf(reason, reason_size, "the program has no main()");
+        ok = 0;
+    }
+    if (!ok)
+    {
+        tcc_delete(s);
+        return NULL;
+    }
+
+    ZJitProgram *prog = malloc(sizeof(ZJitProgram));
+    if (!prog)
+    {
+        tcc_delete(s);
+        snprintf(reason, reason_size, "out of memory");
+        return NULL;
+    }
+    prog->s = s;
+    return prog;
+}
+
+int repl_jit_run_program(ZJitProgram *prog, int argc, char **argv)
+{
+    int (*entry)(int, char **) = (int (*)(int, char **))tcc_get_symbol(prog->s, "main");
+    fflush(stdout);
+    int ret = entry(argc, argv);
+    fflush(stdout);
+    // The TCC state is deliberately not deleted: atexit handlers and destructors registered by
+    // the program still point into its code, and the process exits right after this.
+    return ret;
+}
 #else
 int repl_jit_execute(const char *c_code, CompilerConfig *cfg)
 {
@@ -91,4 +258,22 @@ int repl_jit_execute(const char *c_code, CompilerConfig *cfg)
 
     return res;
 }
+
+ZJitProgram *repl_jit_compile_program(const char *c_code, const ArgList *flags,
+                                      CompilerConfig *cfg, char *reason, size_t reason_size)
+{
+    (void)c_code;
+    (void)flags;
+    (void)cfg;
+    snprintf(reason, reason_size, "zc was built without libtcc");
+    return NULL;
+}
+
+int repl_jit_run_program(ZJitProgram *prog, int argc, char **argv)
+{
+    (void)prog;
+    (void)argc;
+    (void)argv;
+    return 1;
+}
 #endif
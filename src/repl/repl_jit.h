@@ -15,6 +15,9 @@
 #include <libtcc.h>
 #endif
 
+#include <stddef.h>
+#include "../utils/cmd.h"
+
 typedef struct CompilerConfig CompilerConfig;
 
 /**
@@ -25,4 +28,33 @@ typedef struct CompilerConfig CompilerConfig;
  */
 int repl_jit_execute(const char *c_code, CompilerConfig *cfg);
 
+/**
+ * @brief A whole program compiled into memory by repl_jit_compile_program().
+ */
+typedef struct ZJitProgram ZJitProgram;
+
+/**
+ * @brief Compiles a generated program in memory for `zc run --jit`.
+ *
+ * Also adds `cfg->c_files` and resolves every symbol, so a NULL return always means the
+ * program can still be built with cc instead.
+ *
+ * @param c_code The generated C translation unit.
+ * @param flags cc-style flags; -I, -iquote, -D, -U, -L and -l are applied, -O, -g, -W and
+ *              -std are ignored, anything else makes the program fall back.
+ * @param cfg Compiler configuration.
+ * @param reason Receives why TCC did not take the program when NULL is returned.
+ * @param reason_size Size of @p reason.
+ * @return The relocated program, or NULL.
+ */
+ZJitProgram *repl_jit_compile_program(const char *c_code, const ArgList *flags,
+                                      CompilerConfig *cfg, char *reason, size_t reason_size);
+
+/**
+ * @brief Calls main() of a program returned by repl_jit_compile_program().
+ *
+ * @return The value main() returned.
+ */
+int repl_jit_run_program(ZJitProgram *prog, int argc, char **argv);
+
 #endif /* REPL_JIT_H */
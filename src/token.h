@@ -1,4 +1,5 @@
 #include <stddef.h>
+#include <stdint.h>
 // SPDX-License-Identifier: MIT
 
 /**
@@ -83,27 +84,33 @@ typedef struct
 {
     ZenTokenType type; ///< Type of the token.
     const char *start; ///< Pointer to start of token in source buffer.
-    size_t len;        ///< Length of the token text.
+    uint32_t len;      ///< Length of the token text.
     int line;          ///< Line number (1-based).
     int col;           ///< Column number (1-based).
-    const char *file;  ///< Name of file with source code.
+    uint32_t file;     ///< File name ID (source_name() resolves it), 0 if unknown.
 } Token;
 
 /** Sentinel for diagnostics with no source location. */
 #define TOKEN_UNKNOWN ((Token){0})
 
+/** @brief Every token of a source buffer, built by lexer_buffer_tokens(). */
+typedef struct TokenTable TokenTable;
+
 /**
  * @brief Lexer state.
  */
 typedef struct
 {
-    const char *src;        ///< Source code buffer.
-    int pos;                ///< Current position index.
-    int line;               ///< Current line number.
-    int col;                ///< Current column number.
-    int emit_comments;      ///< 1 if comments should be emitted as tokens.
-    CompilerConfig *config; ///< Compiler config (for MISRA mode checks).
-    const char *filename;   ///< Name of file being lexed (for token attribution).
+    const char *src;          ///< Source code buffer.
+    int pos;                  ///< Current position index.
+    int line;                 ///< Current line number.
+    int col;                  ///< Current column number.
+    int emit_comments;        ///< 1 if comments should be emitted as tokens.
+    CompilerConfig *config;   ///< Compiler config (for MISRA mode checks).
+    const char *filename;     ///< Name of file being lexed.
+    uint32_t file;            ///< ID of filename, stored in every token.
+    const TokenTable *table;  ///< Pre-lexed tokens of src, or NULL to lex on demand.
+    uint32_t table_hint;      ///< Entry expected at pos (the one after the last token).
 } Lexer;
 
 #ifdef __cplusplus
@@ -116,11 +123,24 @@ extern "C"
      */
     void lexer_init(Lexer *l, const char *src, CompilerConfig *cfg, const char *filename);
 
+    /**
+     * @brief Lex all of l->src into an arena token buffer that lexer_next() replays.
+     *
+     * Peeks and speculative rewinds (copying and restoring the Lexer) then index the buffer
+     * instead of lexing again. Does nothing in MISRA mode, whose checks report from the lexer.
+     */
+    void lexer_buffer_tokens(Lexer *l);
+
     /**
      * @brief Get the next token.
      */
     Token lexer_next(Lexer *l);
 
+    /**
+     * @brief Name of the file @p t was lexed from, or NULL.
+     */
+    const char *token_file(Token t);
+
     /**
      * @brief Get the next token without advancing.
      */
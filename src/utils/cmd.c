@@ -94,6 +94,9 @@ void print_usage(void)
                     "Type check only / generate C code");
     print_help_item(COLOR_GREEN "repl, lsp, doc" COLOR_RESET,
                     "REPL / Language Server / Documentation");
+    print_help_item(COLOR_GREEN "cache" COLOR_RESET, "Inspect or clean the build cache");
+    print_help_item(COLOR_GREEN "serve" COLOR_RESET, "Compile server for ZC_SERVER clients");
+    print_help_item(COLOR_GREEN "watch" COLOR_RESET, "Rebuild (and rerun) on every change");
 
     printf("\ncommon options:\n");
     print_help_item(COLOR_CYAN "-o <f>, --cc <c>" COLOR_RESET,
@@ -131,6 +134,18 @@ void print_command_help(const char *command)
         print_help_item("-g, -g0", "Enable/disable debug information");
         print_help_item("--release", "Release mode (equivalent to -O3 -g0)");
         print_help_item("-shared", "Build a shared library (.so, .dll)");
+        print_help_item("--cache", "Reuse unchanged builds from the cache (or ZC_CACHE=1)");
+        print_help_item("--no-cache", "Ignore the build cache for this invocation");
+        print_help_item("--no-pch", "Inline the runtime preamble instead of a precompiled header");
+        print_help_item("--no-comptime-cache", "Rerun comptime blocks instead of reusing output");
+        print_help_item("--no-lazy-methods", "Also emit generic impl methods nothing references");
+        print_help_item("--share-generics", "Let pointer instantiations share generic method bodies");
+        print_help_item("--no-fold", "Keep constant expressions and dead branches in the C output");
+        print_help_item("-j <n>", "Split C output into units compiled by n parallel cc jobs");
+        print_help_item("--time-passes", "Print wall time, arena bytes and AST nodes per phase");
+        print_help_item("--trace-out <file>", "Write a Chrome trace of phases and imports");
+        print_help_item("--mem-report", "Print arena bytes per subsystem and top allocation sites");
+        print_help_item("--emit-deps <file>", "Write a make rule listing every file the build read");
         print_help_item("-v, --verbose", "Show all granular compilation phases");
         print_help_item("-q, --quiet", "Suppress non-essential status messages");
     }
@@ -141,6 +156,10 @@ void print_command_help(const char *command)
         printf("options:\n");
         print_help_item("-o <file>", "Temp binary name (default: a.out)");
         print_help_item("-O<level>", "Backend optimization level");
+        print_help_item("--cache", "Reuse unchanged builds from the cache (or ZC_CACHE=1)");
+        print_help_item("--no-pch", "Inline the runtime preamble instead of a precompiled header");
+        print_help_item("--jit", "Run in memory through libtcc, falling back to cc if needed");
+        print_help_item("-j <n>", "Split C output into units compiled by n parallel cc jobs");
         print_help_item("-q, --quiet", "Run without compiler status markers");
     }
     else if (strcmp(command, "check") == 0)
@@ -150,6 +169,8 @@ void print_command_help(const char *command)
         printf("options:\n");
         print_help_item("--json", "Output diagnostics in structured JSON");
         print_help_item("--check", "Enable advanced borrow/move checking");
+        print_help_item("--check-jobs <n>", "Type-check function bodies in n processes (with check only)");
+        print_help_item("--no-comptime-cache", "Rerun comptime blocks instead of reusing output");
     }
     else if (strcmp(command, "transpile") == 0)
     {
@@ -159,6 +180,37 @@ void print_command_help(const char *command)
         print_help_item("-o <file>", "Output C file name");
         print_help_item("--emit-c", "Keep the generated C file (implied)");
     }
+    else if (strcmp(command, "cache") == 0)
+    {
+        printf("usage: zc cache [dir | clean]\n\n");
+        printf("Manage the content-addressed build cache used by --cache.\n");
+        printf("Location: $ZC_CACHE_DIR, else $XDG_CACHE_HOME/zenc, else ~/.cache/zenc.\n\n");
+        printf("commands:\n");
+        print_help_item("dir", "Print the cache directory (default)");
+        print_help_item("clean", "Remove cached binaries, runtime headers and comptime output");
+    }
+    else if (strcmp(command, "serve") == 0)
+    {
+        printf("usage: zc serve [--socket <path>] [-v] [-q]\n\n");
+        printf("Serve compile requests from zc invocations run with ZC_SERVER set.\n");
+        printf("A repeated invocation is forked from a snapshot taken after the main file's\n");
+        printf("imports, as long as those imports and the text before them are unchanged.\n\n");
+        printf("options:\n");
+        print_help_item("--socket <path>",
+                        "Listen here (default $XDG_RUNTIME_DIR/zc-serve.sock)");
+        print_help_item("-v, --verbose", "Log snapshot hits and misses");
+        print_help_item("-q, --quiet", "Do not print the socket path on startup");
+    }
+    else if (strcmp(command, "watch") == 0)
+    {
+        printf("usage: zc watch [--run] [build options] <file> [-- <program args>]\n\n");
+        printf("Build, then rebuild whenever the file, one of its imports or a linked C file\n");
+        printf("changes. Builds go through a private compile server, so an edit below the\n");
+        printf("imports reuses their parsed state.\n\n");
+        printf("options:\n");
+        print_help_item("--run", "Run the program after each successful build, stopping the "
+                                 "previous one first");
+    }
     else if (strcmp(command, "debug") == 0)
     {
         printf("usage: zc debug <file> [<args>]\n\n");
@@ -191,8 +243,7 @@ void print_command_help(const char *command)
     }
 }
 
-void build_compile_arg_list(ArgList *list, const char *outfile, const char *temp_source_file,
-                            CompilerConfig *cfg)
+static void add_cc_flags(ArgList *list, CompilerConfig *cfg)
 {
     // Compiler
     arg_list_add_from_string(list, cfg->cc);
@@ -243,13 +294,11 @@ void build_compile_arg_list(ArgList *list, const char *outfile, const char *temp
         arg_list_add(list, "objective-c");
         arg_list_add(list, "-std=gnu11");
     }
+}
 
-    // Output file
-    arg_list_add(list, "-o");
-    arg_list_add(list, outfile);
-
-    // Input files
-    arg_list_add(list, temp_source_file);
+// Extra C sources pulled in by @link directives or passed on the command line.
+static void add_extra_inputs(ArgList *list, CompilerConfig *cfg)
+{
     for (size_t i = 0; i < cfg->c_files.length; i++)
     {
         const char *file = cfg->c_files.data[i];
@@ -262,7 +311,10 @@ void build_compile_arg_list(ArgList *list, const char *outfile, const char *temp
         }
         arg_list_add(list, file);
     }
+}
 
+static void add_link_flags(ArgList *list, CompilerConfig *cfg)
+{
     // Platform flags
     if (z_is_windows() && !cfg->is_freestanding)
     {
@@ -279,7 +331,10 @@ void build_compile_arg_list(ArgList *list, const char *outfile, const char *temp
     {
         arg_list_add(list, "-lws2_32");
     }
+}
 
+static void add_include_flags(ArgList *list, CompilerConfig *cfg)
+{
     // Include paths
     if (cfg->root_path && cfg->root_path[0])
     {
@@ -375,6 +430,108 @@ void build_compile_arg_list(ArgList *list, const char *outfile, const char *temp
     }
 }
 
+// clang only uses a PCH named on the command line. -include-pch applies to every input of the
+// command, so it is left out when user C files are compiled alongside the generated source.
+static void add_pch_flags(ArgList *list, CompilerConfig *cfg)
+{
+    if (cfg->runtime_pch)
+    {
+        arg_list_add(list, "-include-pch");
+        arg_list_add(list, cfg->runtime_pch);
+    }
+}
+
+void build_compile_arg_list(ArgList *list, const char *outfile, const char *temp_source_file,
+                            CompilerConfig *cfg)
+{
+    add_cc_flags(list, cfg);
+    if (cfg->c_files.length == 0)
+    {
+        add_pch_flags(list, cfg);
+    }
+
+    arg_list_add(list, "-o");
+    arg_list_add(list, outfile);
+
+    arg_list_add(list, temp_source_file);
+    add_extra_inputs(list, cfg);
+
+    add_link_flags(list, cfg);
+    add_include_flags(list, cfg);
+}
+
+void build_object_arg_list(ArgList *list, const char *objfile, const char *source_file,
+                           CompilerConfig *cfg)
+{
+    add_cc_flags(list, cfg);
+    add_pch_flags(list, cfg);
+
+    arg_list_add(list, "-c");
+    arg_list_add(list, "-o");
+    arg_list_add(list, objfile);
+    arg_list_add(list, source_file);
+
+    add_include_flags(list, cfg);
+}
+
+void build_link_arg_list(ArgList *list, const char *outfile, char *const objfiles[],
+                         size_t objcount, CompilerConfig *cfg)
+{
+    add_cc_flags(list, cfg);
+
+    arg_list_add(list, "-o");
+    arg_list_add(list, outfile);
+
+    for (size_t i = 0; i < objcount; i++)
+    {
+        arg_list_add(list, objfiles[i]);
+    }
+    add_extra_inputs(list, cfg);
+
+    add_link_flags(list, cfg);
+    add_include_flags(list, cfg);
+}
+
+void build_pch_arg_list(ArgList *list, const char *pchfile, const char *header,
+                        CompilerConfig *cfg)
+{
+    add_cc_flags(list, cfg);
+
+    arg_list_add(list, "-x");
+    arg_list_add(list, "c-header");
+    arg_list_add(list, "-o");
+    arg_list_add(list, pchfile);
+    arg_list_add(list, header);
+}
+
+void build_deps_arg_list(ArgList *list, const char *depfile, const char *source_file,
+                         CompilerConfig *cfg)
+{
+    add_cc_flags(list, cfg);
+
+    arg_list_add(list, "-M");
+    arg_list_add(list, "-MF");
+    arg_list_add(list, depfile);
+    size_t len = strlen(source_file);
+    if (cfg->use_cpp && len > 2 && source_file[len - 2] == '.' && source_file[len - 1] == 'c')
+    {
+        // As add_extra_inputs() compiles it.
+        arg_list_add(list, "-x");
+        arg_list_add(list, "c");
+    }
+    arg_list_add(list, source_file);
+
+    add_include_flags(list, cfg);
+}
+
+void build_jit_arg_list(ArgList *list, CompilerConfig *cfg)
+{
+    arg_list_add_from_string(list, cfg->gcc_flags);
+    arg_list_add_from_string(list, g_cflags);
+    add_include_flags(list, cfg);
+    add_link_flags(list, cfg);
+}
+
 void cmd_init(CmdBuilder *cmd)
 {
     cmd->cap = 1024;
@@ -530,6 +687,49 @@ int arg_run(ArgList *list)
     return z_run_command(list->args);
 }
 
+int arg_run_parallel(ArgList *lists, size_t count, int jobs)
+{
+    if (jobs < 1)
+    {
+        jobs = 1;
+    }
+
+    // Jobs are reaped in spawn order. cc jobs of one build are similar in size, so waiting on
+    // the oldest rather than whichever finishes first costs little and keeps this portable.
+    ZProcess *running = xmalloc(sizeof(ZProcess) * (size_t)jobs);
+    size_t head = 0;
+    size_t tail = 0;
+    size_t next = 0;
+    int result = 0;
+
+    while (head < tail || (next < count && result == 0))
+    {
+        if (next < count && result == 0 && tail - head < (size_t)jobs)
+        {
+            ZProcess proc;
+            if (z_spawn_command(lists[next].args, &proc) != 0)
+            {
+                result = -1;
+                continue;
+            }
+            running[tail % (size_t)jobs] = proc;
+            tail++;
+            next++;
+            continue;
+        }
+
+        int ret = z_wait_command(running[head % (size_t)jobs]);
+        head++;
+        if (ret != 0 && result == 0)
+        {
+            result = ret;
+        }
+    }
+
+    zfree(running);
+    return result;
+}
+
 void arg_list_add_from_string(ArgList *list, const char *str)
 {
     if (!str || !str[0])
@@ -109,6 +109,17 @@ void arg_list_free(ArgList *list);
  */
 int arg_run(ArgList *list);
 
+/**
+ * @brief Run several argument lists with at most @p jobs of them alive at once
+ *
+ * Once a job fails no new jobs are started, but the ones already running are waited for.
+ * @param lists Array of argument lists
+ * @param count Number of lists
+ * @param jobs Maximum number of concurrent processes
+ * @return 0 if every job succeeded, otherwise the exit code of the first failure
+ */
+int arg_run_parallel(ArgList *lists, size_t count, int jobs);
+
 /**
  * @brief Add arguments from a space-separated string to the list
  * @param list The list to add to
@@ -119,4 +130,53 @@ void arg_list_add_from_string(ArgList *list, const char *str);
 void build_compile_arg_list(ArgList *list, const char *outfile, const char *temp_source_file,
                             CompilerConfig *cfg);
 
+/**
+ * @brief Build a `cc -c` command for one translation unit of a split build
+ * @param list The list to fill
+ * @param objfile Object file to write
+ * @param source_file Generated C source to compile
+ * @param cfg Compiler configuration
+ */
+void build_object_arg_list(ArgList *list, const char *objfile, const char *source_file,
+                           CompilerConfig *cfg);
+
+/**
+ * @brief Build the command that links the objects of a split build into @p outfile
+ * @param list The list to fill
+ * @param outfile Final executable
+ * @param objfiles Object files produced by build_object_arg_list()
+ * @param objcount Number of object files
+ * @param cfg Compiler configuration
+ */
+void build_link_arg_list(ArgList *list, const char *outfile, char *const objfiles[],
+                         size_t objcount, CompilerConfig *cfg);
+
+/**
+ * @brief Build the command that precompiles the runtime header with the same cc flags
+ * @param list The list to fill
+ * @param pchfile Precompiled header to write (.gch for gcc, .pch for clang)
+ * @param header Runtime header source
+ * @param cfg Compiler configuration
+ */
+void build_pch_arg_list(ArgList *list, const char *pchfile, const char *header,
+                        CompilerConfig *cfg);
+
+/**
+ * @brief Build a `cc -M` command that lists the headers @p source_file includes, without
+ * compiling it
+ * @param list The list to fill
+ * @param depfile Make-style rule to write
+ * @param source_file Source compiled by the build
+ * @param cfg Compiler configuration
+ */
+void build_deps_arg_list(ArgList *list, const char *depfile, const char *source_file,
+                         CompilerConfig *cfg);
+
+/**
+ * @brief Collect the flags of a cc build (without the cc itself) for an in-process JIT run
+ * @param list The list to fill
+ * @param cfg Compiler configuration
+ */
+void build_jit_arg_list(ArgList *list, CompilerConfig *cfg);
+
 #endif
@@ -45,9 +45,30 @@ static void strip_ansi_codes(char *str)
     *write_ptr = '\0';
 }
 
+// Overrides for fd 1 and 2, used while zc serve captures output meant for a client terminal.
+static int assumed_tty[3] = {-1, -1, -1};
+
+void zcolors_assume_tty(int fd, int is_tty)
+{
+    if (fd >= 1 && fd <= 2)
+    {
+        assumed_tty[fd] = is_tty;
+    }
+}
+
+int zcolors_is_tty(int fd)
+{
+    if (fd >= 1 && fd <= 2 && assumed_tty[fd] >= 0)
+    {
+        return assumed_tty[fd];
+    }
+    return isatty(fd);
+}
+
 int zvfprintf(FILE *stream, const char *format, va_list args)
 {
-    int should_strip = !isatty(fileno(stream));
+    int fd = fileno(stream);
+    int should_strip = !zcolors_is_tty(fd);
 
     if (!should_strip)
     {
@@ -24,6 +24,17 @@ int zvprintf(const char *format, va_list args);
 int zfprintf(FILE *stream, const char *format, ...);
 ZEN_FORMAT_PRINTF(2, 0) int zvfprintf(FILE *stream, const char *format, va_list args);
 
+/**
+ * @brief Decide color stripping for stdout/stderr (fd 1/2) as if it were (not) a terminal.
+ * @param is_tty 1 or 0 to override isatty(), -1 to go back to asking isatty().
+ */
+void zcolors_assume_tty(int fd, int is_tty);
+
+/**
+ * @brief Whether output to fd 1 or 2 keeps its colors: the override, else isatty().
+ */
+int zcolors_is_tty(int fd);
+
 #ifndef ZEN_DISABLE_COLORS_WRAPPER
 #define printf zprintf
 #define fprintf zfprintf
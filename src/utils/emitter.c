@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "emitter.h"
+#include "mem_report.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -16,6 +17,7 @@ static int emitter_grow(Emitter *e, size_t needed)
     {
         return 0;
     }
+    mem_charge(ZC_MEM_EMITTER, new_cap - e->buffer.cap);
     e->buffer.buf = new_buf;
     e->buffer.cap = new_cap;
     return 1;
@@ -298,6 +300,30 @@ int emitter_pop(Emitter *e)
     return 1;
 }
 
+// Save the current target and send output to a fresh buffer until emitter_pop_buffer().
+// Unlike emitter_init_buffer() this keeps the saved stack and the indentation.
+int emitter_push_buffer(Emitter *e)
+{
+    if (!emitter_push(e))
+    {
+        return 0;
+    }
+    e->mode = EMITTER_BUFFER;
+    e->buffer.buf = NULL;
+    e->buffer.len = 0;
+    e->buffer.cap = 0;
+    return 1;
+}
+
+// Restore the target saved by emitter_push_buffer() and return what was written since
+// (heap string owned by the caller, NULL if nothing was).
+char *emitter_pop_buffer(Emitter *e)
+{
+    char *result = emitter_take_string(e);
+    emitter_pop(e);
+    return result;
+}
+
 void emitter_release(Emitter *e)
 {
     if (!e)
@@ -69,6 +69,8 @@ void emitter_indent(Emitter *e);
 void emitter_dedent(Emitter *e);
 int emitter_push(Emitter *e);
 int emitter_pop(Emitter *e);
+int emitter_push_buffer(Emitter *e);
+char *emitter_pop_buffer(Emitter *e);
 void emitter_release(Emitter *e);
 
 #endif
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT
+#include "intern.h"
+#include "../compiler.h"
+#include "../diagnostics/diagnostics.h"
+#include "mem_report.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Names are packed into blocks: a uint32_t hash, a uint32_t length, the text and its NUL.
+#define INTERN_BLOCK_SIZE (64 * 1024)
+#define INTERN_HEADER (2 * sizeof(uint32_t))
+
+static struct
+{
+    const char **slots; ///< Open-addressed table of names, NULL = empty.
+    uint32_t cap;       ///< Power of two.
+    uint32_t count;
+    char *block; ///< Block being filled.
+    size_t used; ///< Bytes of it handed out.
+} names;
+
+static uint32_t name_hash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void *intern_alloc(size_t size)
+{
+    void *p = libc_malloc(size);
+    if (!p)
+    {
+        zfatal("intern: out of memory");
+        exit(1); // whitelisted
+    }
+    return p;
+}
+
+static void names_grow(void)
+{
+    uint32_t cap = names.cap ? names.cap * 2 : 1024;
+    const char **slots = intern_alloc(cap * sizeof(const char *));
+    mem_charge(ZC_MEM_NAMES, cap * sizeof(const char *));
+    memset(slots, 0, cap * sizeof(const char *));
+    for (uint32_t i = 0; i < names.cap; i++)
+    {
+        const char *name = names.slots[i];
+        if (name)
+        {
+            uint32_t j = intern_hash(name) & (cap - 1);
+            while (slots[j])
+            {
+                j = (j + 1) & (cap - 1);
+            }
+            slots[j] = name;
+        }
+    }
+    libc_free((void *)names.slots);
+    names.slots = slots;
+    names.cap = cap;
+}
+
+// Slot holding the name, or the empty slot where it belongs.
+static const char **names_slot(const char *s, size_t len, uint32_t hash)
+{
+    uint32_t i = hash & (names.cap - 1);
+    for (;;)
+    {
+        const char *name = names.slots[i];
+        if (!name || (intern_hash(name) == hash && intern_len(name) == len &&
+                      memcmp(name, s, len) == 0))
+        {
+            return &names.slots[i];
+        }
+        i = (i + 1) & (names.cap - 1);
+    }
+}
+
+static const char *store(const char *s, size_t len, uint32_t hash)
+{
+    // Keep the headers of the next name 4-byte aligned.
+    size_t size = (INTERN_HEADER + len + 1 + 3) & ~(size_t)3;
+    char *p;
+    if (size > INTERN_BLOCK_SIZE / 4)
+    {
+        p = intern_alloc(size);
+    }
+    else
+    {
+        if (!names.block || names.used + size > INTERN_BLOCK_SIZE)
+        {
+            names.block = intern_alloc(INTERN_BLOCK_SIZE);
+            names.used = 0;
+        }
+        p = names.block + names.used;
+        names.used += size;
+    }
+    mem_charge(ZC_MEM_NAMES, size);
+    uint32_t *header = (uint32_t *)(void *)p;
+    header[0] = hash;
+    header[1] = (uint32_t)len;
+    char *text = p + INTERN_HEADER;
+    memcpy(text, s, len);
+    text[len] = '\0';
+    return text;
+}
+
+const char *intern_n(const char *s, size_t len)
+{
+    if (!s)
+    {
+        return NULL;
+    }
+    if ((names.count + 1) * 2 > names.cap)
+    {
+        names_grow();
+    }
+    uint32_t hash = name_hash(s, len);
+    const char **slot = names_slot(s, len, hash);
+    if (!*slot)
+    {
+        *slot = store(s, len, hash);
+        names.count++;
+    }
+    return *slot;
+}
+
+const char *intern(const char *s)
+{
+    return s ? intern_n(s, strlen(s)) : NULL;
+}
+
+const char *intern_find(const char *s)
+{
+    return s ? intern_find_n(s, strlen(s)) : NULL;
+}
+
+const char *intern_find_n(const char *s, size_t len)
+{
+    if (!s || !names.cap)
+    {
+        return NULL;
+    }
+    return *names_slot(s, len, name_hash(s, len));
+}
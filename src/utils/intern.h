@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+#ifndef ZC_ALLOW_INTERNAL
+#error "utils/intern.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Identifier interning.
+ *
+ * Each distinct name is stored once, with its hash and length in front of the text, so two
+ * interned names are equal exactly when the pointers are. Names live on the libc heap for the
+ * life of the process: they outlive arena resets and the LSP's arena rewinds, and must never
+ * be written to or freed.
+ */
+
+/** @brief Interned copy of @p s (NULL for NULL). */
+const char *intern(const char *s);
+
+/** @brief Interned copy of the @p len bytes at @p s, which need not be NUL-terminated. */
+const char *intern_n(const char *s, size_t len);
+
+/**
+ * @brief Interned copy of @p s if it was ever interned, otherwise NULL.
+ *
+ * Lookups use this: a name nobody interned cannot be in any table keyed by interned names.
+ */
+const char *intern_find(const char *s);
+
+/** @brief intern_find() for the @p len bytes at @p s, which need not be NUL-terminated. */
+const char *intern_find_n(const char *s, size_t len);
+
+/** @brief Hash of an interned name, computed once when it was interned. */
+static inline uint32_t intern_hash(const char *name)
+{
+    return ((const uint32_t *)(const void *)name)[-2];
+}
+
+/** @brief Length of an interned name. */
+static inline uint32_t intern_len(const char *name)
+{
+    return ((const uint32_t *)(const void *)name)[-1];
+}
+
+#endif // INTERN_H
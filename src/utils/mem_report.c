@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: MIT
+#include "mem_report.h"
+#include "../compiler.h"
+#include "colors.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+enum
+{
+    MEM_TOP_SITES = 15
+};
+
+ZcMemCategory g_mem_category = ZC_MEM_OTHER;
+ZcMemCounter g_mem_counters[ZC_MEM_CATEGORY_COUNT];
+int g_mem_sites = 0;
+
+static const char *category_names[ZC_MEM_CATEGORY_COUNT] = {
+    "other", "ast", "types", "templates", "symbols", "emitter", "names",
+};
+
+typedef struct
+{
+    const char *file; ///< __FILE__ of the call; NULL for calls without a site.
+    int line;
+    size_t bytes;
+    size_t allocations;
+} MemSite;
+
+// Open-addressed table keyed by (file pointer, line). It lives on the libc heap so recording
+// a site never allocates from the arena being measured.
+static struct
+{
+    MemSite *slots;
+    size_t cap;
+    size_t count;
+    int reported;
+} sites;
+
+const char *zc_mem_category_name(ZcMemCategory cat)
+{
+    if ((int)cat < 0 || cat >= ZC_MEM_CATEGORY_COUNT)
+    {
+        return "unknown";
+    }
+    return category_names[cat];
+}
+
+ZcMemCategory zc_mem_set_category(ZcMemCategory cat)
+{
+    return mem_enter(cat);
+}
+
+void zc_mem_stats(ZcMemStats *out)
+{
+    memcpy(out->category, g_mem_counters, sizeof(out->category));
+    out->arena_used = g_compiler.arena.total_alloc;
+    out->arena_reserved = 0;
+    for (zarena_block *b = g_compiler.arena.first; b; b = b->next)
+    {
+        out->arena_reserved += b->capacity;
+    }
+}
+
+static size_t site_hash(const char *file, int line)
+{
+    size_t h = ((size_t)(uintptr_t)file >> 3) * 31 + (size_t)line;
+    return h ^ (h >> 15);
+}
+
+static int site_grow(void)
+{
+    size_t cap = sites.cap ? sites.cap * 2 : 1024;
+    MemSite *slots = libc_malloc(cap * sizeof(MemSite));
+    if (!slots)
+    {
+        return 0;
+    }
+    memset(slots, 0, cap * sizeof(MemSite));
+    for (size_t i = 0; i < sites.cap; i++)
+    {
+        MemSite *s = &sites.slots[i];
+        if (s->allocations == 0)
+        {
+            continue;
+        }
+        size_t j = site_hash(s->file, s->line) & (cap - 1);
+        while (slots[j].allocations)
+        {
+            j = (j + 1) & (cap - 1);
+        }
+        slots[j] = *s;
+    }
+    libc_free(sites.slots);
+    sites.slots = slots;
+    sites.cap = cap;
+    return 1;
+}
+
+void mem_record_site(const char *file, int line, size_t size)
+{
+    if (sites.count * 2 >= sites.cap && !site_grow())
+    {
+        return;
+    }
+    size_t i = site_hash(file, line) & (sites.cap - 1);
+    while (sites.slots[i].allocations &&
+           (sites.slots[i].file != file || sites.slots[i].line != line))
+    {
+        i = (i + 1) & (sites.cap - 1);
+    }
+    MemSite *s = &sites.slots[i];
+    if (s->allocations == 0)
+    {
+        s->file = file;
+        s->line = line;
+        sites.count++;
+    }
+    s->bytes += size;
+    s->allocations++;
+}
+
+void mem_report_init(void)
+{
+    g_mem_sites = 1;
+}
+
+void mem_report_reset(void)
+{
+    memset(g_mem_counters, 0, sizeof(g_mem_counters));
+    if (sites.slots)
+    {
+        memset(sites.slots, 0, sites.cap * sizeof(MemSite));
+    }
+    sites.count = 0;
+}
+
+static void print_bytes(size_t n)
+{
+    if (n >= 1024 * 1024)
+    {
+        printf("%9.2fMiB", (double)n / (1024.0 * 1024.0));
+    }
+    else
+    {
+        printf("%9.2fKiB", (double)n / 1024.0);
+    }
+}
+
+static int site_cmp(const void *a, const void *b)
+{
+    const MemSite *x = a;
+    const MemSite *y = b;
+    if (x->bytes != y->bytes)
+    {
+        return x->bytes < y->bytes ? 1 : -1;
+    }
+    return 0;
+}
+
+// __FILE__ carries whatever path the build passed to cc; show it from the source root.
+static const char *site_path(const char *file)
+{
+    if (!file)
+    {
+        return "(no call site)";
+    }
+    const char *p = strstr(file, "src/");
+    return p ? p : file;
+}
+
+void mem_report_print(void)
+{
+    if (!g_mem_sites || sites.reported)
+    {
+        return;
+    }
+    sites.reported = 1;
+
+    ZcMemStats st;
+    zc_mem_stats(&st);
+    size_t bytes = 0;
+    size_t allocs = 0;
+    for (int c = 0; c < ZC_MEM_CATEGORY_COUNT; c++)
+    {
+        bytes += st.category[c].bytes;
+        allocs += st.category[c].allocations;
+    }
+
+    printf(COLOR_BOLD "%12s %12s %7s %12s" COLOR_RESET "\n", "Category", "Arena", "%", "Allocs");
+    for (int c = 0; c < ZC_MEM_CATEGORY_COUNT; c++)
+    {
+        printf("%12s ", category_names[c]);
+        print_bytes(st.category[c].bytes);
+        printf(" %6.1f%% %12zu\n",
+               bytes > 0 ? (double)st.category[c].bytes * 100.0 / (double)bytes : 0.0,
+               st.category[c].allocations);
+    }
+    printf(COLOR_BOLD "%12s" COLOR_RESET " ", "total");
+    print_bytes(bytes);
+    printf(" %6.1f%% %12zu\n", 100.0, allocs);
+
+    // Headers are the 32 bytes xmalloc and the arena wrapper put in front of each block; the
+    // emitter's buffers and the interned names are on the heap, not part of arena_used.
+    size_t in_arena =
+        bytes - st.category[ZC_MEM_EMITTER].bytes - st.category[ZC_MEM_NAMES].bytes;
+    printf("%12s ", "headers");
+    print_bytes(st.arena_used > in_arena ? st.arena_used - in_arena : 0);
+    printf("\n%12s ", "reserved");
+    print_bytes(st.arena_reserved);
+    printf("\n");
+#ifndef _WIN32
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+    {
+        // ru_maxrss is KiB on Linux and bytes on macOS.
+#ifdef __APPLE__
+        size_t rss = (size_t)ru.ru_maxrss;
+#else
+        size_t rss = (size_t)ru.ru_maxrss * 1024;
+#endif
+        printf("%12s ", "peak rss");
+        print_bytes(rss);
+        printf("\n");
+    }
+#endif
+
+    if (sites.count == 0)
+    {
+        fflush(stdout);
+        return;
+    }
+
+    MemSite *top = libc_malloc(sites.count * sizeof(MemSite));
+    if (!top)
+    {
+        fflush(stdout);
+        return;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < sites.cap; i++)
+    {
+        if (sites.slots[i].allocations)
+        {
+            top[n++] = sites.slots[i];
+        }
+    }
+    qsort(top, n, sizeof(MemSite), site_cmp);
+
+    printf(COLOR_BOLD "\n%12s %12s %7s %12s  %s" COLOR_RESET "\n", "Top sites", "Arena", "%",
+           "Allocs", "Location");
+    for (size_t i = 0; i < n && i < MEM_TOP_SITES; i++)
+    {
+        printf("%12zu ", i + 1);
+        print_bytes(top[i].bytes);
+        printf(" %6.1f%% %12zu  %s:%d\n",
+               bytes > 0 ? (double)top[i].bytes * 100.0 / (double)bytes : 0.0,
+               top[i].allocations, site_path(top[i].file), top[i].line);
+    }
+    libc_free(top);
+    fflush(stdout);
+}
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: MIT
+#ifndef ZC_ALLOW_INTERNAL
+#error "utils/mem_report.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#ifndef MEM_REPORT_H
+#define MEM_REPORT_H
+
+#include "mem_stats.h"
+
+extern ZcMemCategory g_mem_category;                     ///< Category charged by xmalloc.
+extern ZcMemCounter g_mem_counters[ZC_MEM_CATEGORY_COUNT]; ///< Running totals per category.
+extern int g_mem_sites;                                    ///< Non-zero while sites are recorded.
+
+void mem_record_site(const char *file, int line, size_t size);
+
+/** @brief Charge one allocation of @p size bytes; called by the xmalloc family. */
+static inline void mem_account(size_t size, const char *file, int line)
+{
+    g_mem_counters[g_mem_category].bytes += size;
+    g_mem_counters[g_mem_category].allocations++;
+    if (g_mem_sites)
+    {
+        mem_record_site(file, line, size);
+    }
+}
+
+/** @brief Charge memory held outside the arena (emitter buffers live on the libc heap). */
+static inline void mem_charge(ZcMemCategory cat, size_t size)
+{
+    g_mem_counters[cat].bytes += size;
+    g_mem_counters[cat].allocations++;
+}
+
+/** @brief Switch the charged category; pair with mem_leave() on the returned value. */
+static inline ZcMemCategory mem_enter(ZcMemCategory cat)
+{
+    ZcMemCategory prev = g_mem_category;
+    g_mem_category = cat;
+    return prev;
+}
+
+static inline void mem_leave(ZcMemCategory prev)
+{
+    g_mem_category = prev;
+}
+
+/** @brief Start recording allocation sites for mem_report_print() (--mem-report). */
+void mem_report_init(void);
+
+/** @brief Zero all counters and forget recorded sites (the arena was reset). */
+void mem_report_reset(void);
+
+/**
+ * @brief Print arena bytes per category and the top allocation sites. Does nothing unless
+ * mem_report_init() was called; only the first call has an effect.
+ */
+void mem_report_print(void);
+
+#endif // MEM_REPORT_H
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file mem_stats.h
+ * @brief Arena accounting: bytes and allocation counts per compiler subsystem.
+ *
+ * Every xmalloc/xcalloc/xrealloc/xstrdup is charged to the category active at the time of the
+ * call. Subsystems switch the category around their allocations; everything else lands in
+ * ZC_MEM_OTHER. Counting is always on, so embedders can poll it between compilations.
+ */
+
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <stddef.h>
+
+/** @brief Subsystems arena bytes are attributed to. */
+typedef enum
+{
+    ZC_MEM_OTHER = 0, ///< Anything not claimed by a subsystem below.
+    ZC_MEM_AST,       ///< AST nodes (ast_create).
+    ZC_MEM_TYPES,     ///< Type objects (type_new and friends).
+    ZC_MEM_TEMPLATES, ///< Strings from generic substitution (replace_type_str and friends).
+    ZC_MEM_SYMBOLS,   ///< Scopes and symbol table entries.
+    ZC_MEM_EMITTER,   ///< Codegen output buffers; these grow on the libc heap, not the arena.
+    ZC_MEM_NAMES,     ///< Interned identifiers (intern()); also on the libc heap.
+    ZC_MEM_CATEGORY_COUNT
+} ZcMemCategory;
+
+/** @brief Running totals for one category. */
+typedef struct
+{
+    size_t bytes;       ///< Bytes requested, excluding allocator headers.
+    size_t allocations; ///< Number of allocation calls.
+} ZcMemCounter;
+
+/** @brief Snapshot of the compiler arena. */
+typedef struct
+{
+    ZcMemCounter category[ZC_MEM_CATEGORY_COUNT];
+    size_t arena_used;     ///< Bytes handed out by the arena, headers included.
+    size_t arena_reserved; ///< Bytes held in arena blocks (used plus slack).
+} ZcMemStats;
+
+/** @brief Fill @p out with the current counters of the global compiler arena. */
+void zc_mem_stats(ZcMemStats *out);
+
+/** @brief Human-readable name of a category ("ast", "types", ...). */
+const char *zc_mem_category_name(ZcMemCategory cat);
+
+/**
+ * @brief Charge subsequent allocations to @p cat.
+ * @return The previous category, to be restored with another call.
+ */
+ZcMemCategory zc_mem_set_category(ZcMemCategory cat);
+
+#endif // MEM_STATS_H
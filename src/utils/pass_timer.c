@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: MIT
+#include "pass_timer.h"
+#include "../compiler.h"
+#include "../platform/os.h"
+#include "colors.h"
+#include <stdio.h>
+#include <string.h>
+
+enum
+{
+    PASS_MAX_DEPTH = 1024
+};
+
+int g_pass_timing = 0;
+size_t g_ast_node_count = 0;
+
+static const char *pass_names[PASS_COUNT] = {
+    "lex",  "parse", "import", "instantiate", "semantic", "typecheck", "move check",
+    "fold", "codegen", "cc",
+};
+
+typedef struct
+{
+    CompilerPass pass;
+    double start;
+    double child_time;
+    size_t start_bytes;
+    size_t child_bytes;
+    size_t start_nodes;
+    size_t child_nodes;
+    long event; ///< Index into the trace events, or -1.
+} PassFrame;
+
+typedef struct
+{
+    char *name;
+    CompilerPass pass;
+    double start;
+    double dur;
+    size_t bytes;
+    size_t nodes;
+} TraceEvent;
+
+static struct
+{
+    int print_table;
+    char *trace_path;
+    int reported;
+    double origin;
+
+    PassFrame stack[PASS_MAX_DEPTH];
+    int depth;
+    int overflow; ///< Spans opened past PASS_MAX_DEPTH; closed without being measured.
+
+    double time[PASS_COUNT];
+    size_t bytes[PASS_COUNT];
+    size_t nodes[PASS_COUNT];
+    size_t spans[PASS_COUNT];
+
+    TraceEvent *events;
+    size_t event_count;
+    size_t event_cap;
+} timer;
+
+// Bookkeeping lives on the libc heap so it does not show up in the arena figures it reports.
+static char *dup_label(const char *s)
+{
+    size_t len = strlen(s);
+    char *d = libc_malloc(len + 1);
+    if (d)
+    {
+        memcpy(d, s, len + 1);
+    }
+    return d;
+}
+
+static size_t arena_bytes(void)
+{
+    return g_compiler.arena.total_alloc;
+}
+
+void pass_timer_init(int print_table, const char *trace_path)
+{
+    memset(&timer, 0, sizeof(timer));
+    timer.print_table = print_table;
+    timer.trace_path = trace_path ? dup_label(trace_path) : NULL;
+    timer.origin = z_get_monotonic_time();
+    g_pass_timing = print_table || trace_path;
+}
+
+void pass_begin(CompilerPass pass, const char *label)
+{
+    if (timer.depth == PASS_MAX_DEPTH)
+    {
+        timer.overflow++;
+        return;
+    }
+
+    PassFrame *f = &timer.stack[timer.depth++];
+    f->pass = pass;
+    f->child_time = 0;
+    f->child_bytes = 0;
+    f->child_nodes = 0;
+    f->event = -1;
+
+    if (timer.trace_path && pass != PASS_LEX)
+    {
+        if (timer.event_count == timer.event_cap)
+        {
+            size_t cap = timer.event_cap ? timer.event_cap * 2 : 256;
+            TraceEvent *grown = libc_realloc(timer.events, cap * sizeof(TraceEvent));
+            if (grown)
+            {
+                timer.events = grown;
+                timer.event_cap = cap;
+            }
+        }
+        if (timer.event_count < timer.event_cap)
+        {
+            f->event = (long)timer.event_count++;
+            timer.events[f->event].name = dup_label(label ? label : pass_names[pass]);
+            timer.events[f->event].pass = pass;
+            timer.events[f->event].dur = -1;
+        }
+    }
+
+    // Sample last so the bookkeeping above is not charged to the span.
+    f->start_nodes = g_ast_node_count;
+    f->start_bytes = arena_bytes();
+    f->start = z_get_monotonic_time();
+}
+
+void pass_end(void)
+{
+    double now = z_get_monotonic_time();
+    if (timer.overflow > 0)
+    {
+        timer.overflow--;
+        return;
+    }
+    if (timer.depth == 0)
+    {
+        return;
+    }
+
+    PassFrame *f = &timer.stack[--timer.depth];
+    double total = now - f->start;
+    size_t bytes = arena_bytes() - f->start_bytes;
+    size_t nodes = g_ast_node_count - f->start_nodes;
+
+    timer.time[f->pass] += total - f->child_time;
+    timer.bytes[f->pass] += bytes - f->child_bytes;
+    timer.nodes[f->pass] += nodes - f->child_nodes;
+    timer.spans[f->pass]++;
+
+    if (timer.depth > 0)
+    {
+        PassFrame *parent = &timer.stack[timer.depth - 1];
+        parent->child_time += total;
+        parent->child_bytes += bytes;
+        parent->child_nodes += nodes;
+    }
+
+    if (f->event >= 0)
+    {
+        TraceEvent *e = &timer.events[f->event];
+        e->start = f->start - timer.origin;
+        e->dur = total;
+        e->bytes = bytes;
+        e->nodes = nodes;
+    }
+}
+
+static void print_bytes(size_t n)
+{
+    if (n >= 1024 * 1024)
+    {
+        printf("%9.2fMiB", (double)n / (1024.0 * 1024.0));
+    }
+    else
+    {
+        printf("%9.2fKiB", (double)n / 1024.0);
+    }
+}
+
+static void print_table(void)
+{
+    double total_time = 0;
+    size_t total_bytes = 0;
+    size_t total_nodes = 0;
+    for (int p = 0; p < PASS_COUNT; p++)
+    {
+        total_time += timer.time[p];
+        total_bytes += timer.bytes[p];
+        total_nodes += timer.nodes[p];
+    }
+
+    printf(COLOR_BOLD "%12s %11s %7s %12s %10s %9s" COLOR_RESET "\n", "Phase", "Wall", "%", "Arena",
+           "Nodes", "Spans");
+    for (int p = 0; p < PASS_COUNT; p++)
+    {
+        if (timer.spans[p] == 0)
+        {
+            continue;
+        }
+        printf("%12s %9.2fms %6.1f%% ", pass_names[p], timer.time[p] * 1000.0,
+               total_time > 0 ? timer.time[p] * 100.0 / total_time : 0.0);
+        print_bytes(timer.bytes[p]);
+        printf(" %10zu %9zu\n", timer.nodes[p], timer.spans[p]);
+    }
+    printf(COLOR_BOLD "%12s" COLOR_RESET " %9.2fms %6.1f%% ", "total", total_time * 1000.0, 100.0);
+    print_bytes(total_bytes);
+    printf(" %10zu\n", total_nodes);
+    fflush(stdout);
+}
+
+static void write_json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', f);
+            fputc(c, f);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(f, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static void write_trace(void)
+{
+    FILE *f = fopen(timer.trace_path, "w");
+    if (!f)
+    {
+        fprintf(stderr, COLOR_BOLD COLOR_RED "error" COLOR_RESET ": cannot write trace '%s'\n",
+                timer.trace_path);
+        return;
+    }
+
+    // Complete ("X") events nest by their time ranges; spans still open here (an aborted
+    // build) have no duration yet and are skipped.
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int first = 1;
+    for (size_t i = 0; i < timer.event_count; i++)
+    {
+        TraceEvent *e = &timer.events[i];
+        if (!e->name || e->dur < 0)
+        {
+            continue;
+        }
+        fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+        write_json_string(f, e->name);
+        fprintf(f,
+                ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"arena_bytes\":%zu,\"ast_nodes\":%zu}}",
+                pass_names[e->pass], e->start * 1e6, e->dur * 1e6, e->bytes, e->nodes);
+        first = 0;
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+}
+
+void pass_timer_report(void)
+{
+    if (!g_pass_timing || timer.reported)
+    {
+        return;
+    }
+    timer.reported = 1;
+    if (timer.print_table)
+    {
+        print_table();
+    }
+    if (timer.trace_path)
+    {
+        write_trace();
+    }
+}
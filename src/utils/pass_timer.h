@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MIT
+#ifndef ZC_ALLOW_INTERNAL
+#error "utils/pass_timer.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#ifndef PASS_TIMER_H
+#define PASS_TIMER_H
+
+#include <stddef.h>
+
+/**
+ * @brief Compiler phases reported by --time-passes.
+ *
+ * Time, arena bytes and AST nodes are attributed exclusively: a span nested in another (an
+ * import parsed from its importer, lexing inside any parse) is subtracted from its parent.
+ */
+typedef enum
+{
+    PASS_LEX,
+    PASS_PARSE,
+    PASS_IMPORT,
+    PASS_INSTANTIATE,
+    PASS_SEMA,
+    PASS_TYPECHECK,
+    PASS_MOVE_CHECK,
+    PASS_FOLD,
+    PASS_CODEGEN,
+    PASS_CC,
+    PASS_COUNT
+} CompilerPass;
+
+extern int g_pass_timing;       ///< Non-zero once pass_timer_init() enabled timing.
+extern size_t g_ast_node_count; ///< AST nodes created so far, maintained by ast_create().
+
+/**
+ * @brief Enable pass timing.
+ * @param print_table Print the per-phase table from pass_timer_report() (--time-passes).
+ * @param trace_path Write Chrome trace-event JSON there (--trace-out), or NULL.
+ */
+void pass_timer_init(int print_table, const char *trace_path);
+
+/**
+ * @brief Open a span. Spans nest and must be closed in reverse order with pass_end().
+ * @param label Trace event name (copied); NULL uses the phase name. Lexing spans are only
+ *              counted, never written to the trace.
+ */
+void pass_begin(CompilerPass pass, const char *label);
+
+/** @brief Close the innermost span opened by pass_begin(). */
+void pass_end(void);
+
+/**
+ * @brief Print the table and write the trace file. Only the first call has an effect.
+ */
+void pass_timer_report(void);
+
+#define PASS_BEGIN(pass, label)                                                                    \
+    do                                                                                             \
+    {                                                                                              \
+        if (g_pass_timing)                                                                         \
+        {                                                                                          \
+            pass_begin((pass), (label));                                                           \
+        }                                                                                          \
+    } while (0)
+
+#define PASS_END()                                                                                 \
+    do                                                                                             \
+    {                                                                                              \
+        if (g_pass_timing)                                                                         \
+        {                                                                                          \
+            pass_end();                                                                            \
+        }                                                                                          \
+    } while (0)
+
+#endif // PASS_TIMER_H
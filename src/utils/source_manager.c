@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: MIT
+#include "source_manager.h"
+#include "../compiler.h"
+#include "../platform/os.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#if !ZC_OS_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Everything here is bookkeeping for the arena's contents, so it lives on the libc heap.
+static struct
+{
+    SourceFile **files; ///< Sorted by data address for source_find().
+    size_t count;
+    size_t cap;
+} sources;
+
+static struct
+{
+    char **names; ///< names[id - 1]
+    uint32_t count;
+    uint32_t *slots; ///< Open-addressed hash of IDs, 0 = empty.
+    uint32_t cap;
+} names;
+
+static int copy_files;
+
+static uint32_t name_hash(const char *s)
+{
+    uint32_t h = 2166136261u;
+    for (; *s; s++)
+    {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int names_grow(void)
+{
+    uint32_t cap = names.cap ? names.cap * 2 : 64;
+    uint32_t *slots = libc_malloc(cap * sizeof(uint32_t));
+    char **list = libc_realloc(names.names, cap * sizeof(char *));
+    if (!slots || !list)
+    {
+        libc_free(slots);
+        if (list)
+        {
+            names.names = list;
+        }
+        return 0;
+    }
+    names.names = list;
+    memset(slots, 0, cap * sizeof(uint32_t));
+    for (uint32_t id = 1; id <= names.count; id++)
+    {
+        uint32_t i = name_hash(names.names[id - 1]) & (cap - 1);
+        while (slots[i])
+        {
+            i = (i + 1) & (cap - 1);
+        }
+        slots[i] = id;
+    }
+    libc_free(names.slots);
+    names.slots = slots;
+    names.cap = cap;
+    return 1;
+}
+
+uint32_t source_intern(const char *name)
+{
+    if (!name)
+    {
+        return 0;
+    }
+    if (names.cap)
+    {
+        uint32_t i = name_hash(name) & (names.cap - 1);
+        while (names.slots[i])
+        {
+            if (strcmp(names.names[names.slots[i] - 1], name) == 0)
+            {
+                return names.slots[i];
+            }
+            i = (i + 1) & (names.cap - 1);
+        }
+    }
+    if ((names.count + 1) * 2 > names.cap && !names_grow())
+    {
+        return 0;
+    }
+
+    size_t len = strlen(name);
+    char *copy = libc_malloc(len + 1);
+    if (!copy)
+    {
+        return 0;
+    }
+    memcpy(copy, name, len + 1);
+    names.names[names.count++] = copy;
+    uint32_t id = names.count;
+    uint32_t i = name_hash(name) & (names.cap - 1);
+    while (names.slots[i])
+    {
+        i = (i + 1) & (names.cap - 1);
+    }
+    names.slots[i] = id;
+    return id;
+}
+
+const char *source_name(uint32_t id)
+{
+    if (id == 0 || id > names.count)
+    {
+        return NULL;
+    }
+    return names.names[id - 1];
+}
+
+static void register_file(SourceFile *sf)
+{
+    if (sources.count == sources.cap)
+    {
+        size_t cap = sources.cap ? sources.cap * 2 : 32;
+        SourceFile **files = libc_realloc(sources.files, cap * sizeof(SourceFile *));
+        if (!files)
+        {
+            return;
+        }
+        sources.files = files;
+        sources.cap = cap;
+    }
+    size_t i = sources.count;
+    while (i > 0 && sources.files[i - 1]->data > sf->data)
+    {
+        sources.files[i] = sources.files[i - 1];
+        i--;
+    }
+    sources.files[i] = sf;
+    sources.count++;
+}
+
+static char *read_into_arena(FILE *f, size_t size)
+{
+    char *b = xmalloc(size + 1);
+    if (fread(b, 1, size, f) != size)
+    {
+        zfree(b);
+        return NULL;
+    }
+    b[size] = 0;
+    return b;
+}
+
+char *source_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || st.st_size < 0 || (uint64_t)st.st_size >= UINT32_MAX)
+    {
+        fclose(f);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+
+    SourceFile *sf = libc_malloc(sizeof(SourceFile));
+    if (!sf)
+    {
+        fclose(f);
+        return NULL;
+    }
+    memset(sf, 0, sizeof(*sf));
+    sf->size = (uint32_t)size;
+
+    char *data = NULL;
+#if !ZC_OS_WINDOWS
+    // The bytes after the end of the file up to the page boundary read as zero, which is the
+    // terminator the lexer relies on. A file ending exactly on a page boundary has none.
+    long page = sysconf(_SC_PAGESIZE);
+    if (!copy_files && size > 0 && page > 0 && size % (size_t)page != 0)
+    {
+        void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0);
+        if (map != MAP_FAILED)
+        {
+            data = map;
+            sf->mapped = 1;
+        }
+    }
+#endif
+    if (!data)
+    {
+        data = read_into_arena(f, size);
+    }
+    fclose(f);
+    if (!data)
+    {
+        libc_free(sf);
+        return NULL;
+    }
+    sf->data = data;
+    register_file(sf);
+    return data;
+}
+
+void source_copy_files(int enable)
+{
+    copy_files = enable;
+}
+
+const SourceFile *source_find(const char *ptr)
+{
+    size_t lo = 0;
+    size_t hi = sources.count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sources.files[mid]->data <= ptr)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (lo == 0)
+    {
+        return NULL;
+    }
+    const SourceFile *sf = sources.files[lo - 1];
+    return ptr <= sf->data + sf->size ? sf : NULL;
+}
+
+static void build_line_table(SourceFile *sf)
+{
+    uint32_t count = 1;
+    for (uint32_t i = 0; i < sf->size; i++)
+    {
+        count += sf->data[i] == '\n';
+    }
+    uint32_t *starts = libc_malloc(count * sizeof(uint32_t));
+    if (!starts)
+    {
+        return;
+    }
+    uint32_t n = 0;
+    starts[n++] = 0;
+    for (uint32_t i = 0; i < sf->size; i++)
+    {
+        if (sf->data[i] == '\n')
+        {
+            starts[n++] = i + 1;
+        }
+    }
+    sf->line_starts = starts;
+    sf->line_count = count;
+}
+
+int source_line_of(const SourceFile *file, const char *ptr, const char **line_start)
+{
+    SourceFile *sf = (SourceFile *)file;
+    if (!sf->line_starts)
+    {
+        build_line_table(sf);
+    }
+    uint32_t offset = (uint32_t)(ptr - sf->data);
+    if (!sf->line_starts)
+    {
+        const char *p = ptr;
+        while (p > sf->data && p[-1] != '\n')
+        {
+            p--;
+        }
+        *line_start = p;
+        int line = 1;
+        for (const char *q = sf->data; q < p; q++)
+        {
+            line += *q == '\n';
+        }
+        return line;
+    }
+
+    uint32_t lo = 0;
+    uint32_t hi = sf->line_count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (sf->line_starts[mid] <= offset)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    *line_start = sf->data + sf->line_starts[lo - 1];
+    return (int)lo;
+}
+
+void source_reset(void)
+{
+    for (size_t i = 0; i < sources.count; i++)
+    {
+        SourceFile *sf = sources.files[i];
+#if !ZC_OS_WINDOWS
+        if (sf->mapped)
+        {
+            munmap((void *)sf->data, sf->size);
+        }
+#endif
+        libc_free(sf->line_starts);
+        libc_free(sf);
+    }
+    sources.count = 0;
+}
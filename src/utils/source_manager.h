@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: MIT
+#ifndef ZC_ALLOW_INTERNAL
+#error "utils/source_manager.h is internal to Zen C. Include the appropriate public header instead."
+#endif
+
+#ifndef SOURCE_MANAGER_H
+#define SOURCE_MANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Source files and file names of a compilation.
+ *
+ * Files are mapped privately instead of being copied into the arena, and share its lifetime.
+ * Token::file is a 32-bit ID from source_intern() rather than a pointer. Line tables are built
+ * on first use, so diagnostics find the line containing any pointer into a loaded file by
+ * binary search.
+ */
+typedef struct SourceFile
+{
+    const char *data;      ///< NUL-terminated contents.
+    uint32_t size;         ///< Bytes, excluding the terminator.
+    int mapped;            ///< 1 if data is an mmap that source_reset() unmaps.
+    uint32_t *line_starts; ///< Offset of each line, built by source_line_of(); NULL until then.
+    uint32_t line_count;
+} SourceFile;
+
+/** @brief ID of @p name (interned on first use); 0 for NULL. IDs survive source_reset(). */
+uint32_t source_intern(const char *name);
+
+/** @brief Name interned as @p id, or NULL for 0 and unknown IDs. */
+const char *source_name(uint32_t id);
+
+/**
+ * @brief Map @p path and return its contents, NUL-terminated.
+ *
+ * Sizes that leave no room for the terminator in the last page are read into the arena
+ * instead. The buffer is private to this process; writes never reach the file.
+ * @return NULL if the file cannot be read.
+ */
+char *source_load(const char *path);
+
+/**
+ * @brief Read files into the arena instead of mapping them.
+ *
+ * A mapped file that is truncated while in use raises SIGBUS on the next access to the lost
+ * pages. zc watch and zc serve compile files the user is still editing, so they copy.
+ */
+void source_copy_files(int enable);
+
+/** @brief The loaded file whose contents contain @p ptr, or NULL. */
+const SourceFile *source_find(const char *ptr);
+
+/**
+ * @brief Line of @p ptr within @p file.
+ * @param line_start Receives the first character of that line.
+ * @return 1-based line number.
+ */
+int source_line_of(const SourceFile *file, const char *ptr, const char **line_start);
+
+/** @brief Unmap every loaded file (the arena holding tokens into them was reset). */
+void source_reset(void);
+
+#endif // SOURCE_MANAGER_H
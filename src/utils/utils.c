@@ -5,6 +5,8 @@
 #include "zprep.h"
 #include "cmd.h"
 #include "platform/os.h"
+#include "mem_report.h"
+#include "source_manager.h"
 #include <sys/stat.h>
 
 // ** Arena Implementation **
@@ -13,6 +15,11 @@
 void arena_reset(zarena *a)
 {
     zarena_reset(a);
+    if (a == &g_compiler.arena)
+    {
+        mem_report_reset();
+        source_reset();
+    }
 }
 
 static void *arena_alloc(zarena *a, size_t size)
@@ -43,7 +50,7 @@ static void *arena_alloc_raw(size_t size)
 #include "platform/arch.h"
 #include "platform/os.h"
 
-void *xmalloc(size_t size)
+void *xmalloc_at(size_t size, const char *file, int line)
 {
     void *ptr = arena_alloc_raw(size + XMALLOC_HDR_SIZE);
     if (!ptr)
@@ -51,12 +58,13 @@ void *xmalloc(size_t size)
         zfatal("xmalloc: out of memory");
         exit(1); // whitelisted
     }
+    mem_account(size, file, line);
     ((size_t *)ptr)[0] = size;
     ((size_t *)ptr)[1] = 0;
     return (char *)ptr + XMALLOC_HDR_SIZE;
 }
 
-void *xcalloc(size_t n, size_t size)
+void *xcalloc_at(size_t n, size_t size, const char *file, int line)
 {
     size_t total = n * size;
     void *ptr = arena_alloc_raw(total + XMALLOC_HDR_SIZE);
@@ -65,17 +73,18 @@ void *xcalloc(size_t n, size_t size)
         zfatal("xcalloc: out of memory");
         exit(1); // whitelisted
     }
+    mem_account(total, file, line);
     memset(ptr, 0, total + XMALLOC_HDR_SIZE);
     ((size_t *)ptr)[0] = total;
     ((size_t *)ptr)[1] = 0;
     return (char *)ptr + XMALLOC_HDR_SIZE;
 }
 
-void *xrealloc(void *ptr, size_t new_size)
+void *xrealloc_at(void *ptr, size_t new_size, const char *file, int line)
 {
     if (!ptr)
     {
-        return xmalloc((size_t)(new_size));
+        return xmalloc_at((size_t)(new_size), file, line);
     }
 
     // Header is XMALLOC_HDR_SIZE bytes before the returned pointer
@@ -87,24 +96,45 @@ void *xrealloc(void *ptr, size_t new_size)
         return ptr;
     }
 
-    void *new_ptr = xmalloc((size_t)(new_size));
+    void *new_ptr = xmalloc_at((size_t)(new_size), file, line);
     memcpy(new_ptr, ptr, (size_t)(old_size));
     return new_ptr;
 }
 
-char *xstrdup(const char *s)
+char *xstrdup_at(const char *s, const char *file, int line)
 {
     if (!s)
     {
         zfatal("xstrdup(NULL)");
     }
     size_t len = strlen(s);
-    char *d = xmalloc((size_t)(len + 1));
+    char *d = xmalloc_at((size_t)(len + 1), file, line);
     memcpy(d, s, (size_t)(len));
     d[len] = 0;
     return d;
 }
 
+// Out-of-line entry points for code that does not see the call-site macros (plugins, embedders).
+void *(xmalloc)(size_t size)
+{
+    return xmalloc_at(size, NULL, 0);
+}
+
+void *(xcalloc)(size_t n, size_t size)
+{
+    return xcalloc_at(n, size, NULL, 0);
+}
+
+void *(xrealloc)(void *ptr, size_t new_size)
+{
+    return xrealloc_at(ptr, new_size, NULL, 0);
+}
+
+char *(xstrdup)(const char *s)
+{
+    return xstrdup_at(s, NULL, 0);
+}
+
 char *merge_underscores(const char *name)
 {
     if (!name)
@@ -374,35 +404,7 @@ char *load_file(const char *fn, const char *relative_to)
     {
         return NULL;
     }
-
-    FILE *f = fopen(resolved, "rb");
-    if (!f)
-    {
-        return NULL;
-    }
-    fseek(f, 0, SEEK_END);
-    long l = ftell(f);
-    if (l < 0)
-    {
-        fclose(f);
-        return NULL;
-    }
-    if (l < 0)
-    {
-        fclose(f);
-        return NULL;
-    }
-    rewind(f);
-    char *b = xmalloc((size_t)(l + 1));
-    if (fread(b, 1, (size_t)(l), f) != (size_t)(l))
-    {
-        zfree(b);
-        fclose(f);
-        return NULL;
-    }
-    b[l] = 0;
-    fclose(f);
-    return b;
+    return source_load(resolved);
 }
 
 // ** Global Compiler State **
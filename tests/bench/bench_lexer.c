@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: MIT
+//
+// Lexer throughput: tokens per second delivered to a caller that peeks like the parser does.
+// The parser calls lexer_peek() about four times per lexer_next() (measured over std/), so
+// without the token buffer every token is lexed about five times.
+//
+// Usage: zc-bench-lexer <file.zc>...
+// Prints one line per mode and "RESULT: <tokens/s>" for the buffered parser pattern.
+
+#include "zprep.h"
+#include "platform/os.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern ZenCompiler g_compiler;
+
+enum
+{
+    PEEKS_PER_NEXT = 4,
+    MIN_ITERATIONS = 5,
+};
+
+#define MIN_SECONDS 0.25
+
+typedef enum
+{
+    MODE_SCAN,     ///< lexer_next() only.
+    MODE_PEEK,     ///< Parser pattern, lexing on demand.
+    MODE_BUFFERED, ///< Parser pattern over lexer_buffer_tokens().
+} BenchMode;
+
+static const char *mode_names[] = {"scan", "peek, re-lex", "peek, buffered"};
+
+static char *read_source(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = size >= 0 ? libc_malloc((size_t)size + 1) : NULL;
+    if (buf && fread(buf, 1, (size_t)size, f) != (size_t)size)
+    {
+        libc_free(buf);
+        buf = NULL;
+    }
+    if (buf)
+    {
+        buf[size] = '\0';
+    }
+    fclose(f);
+    return buf;
+}
+
+// Tokens returned by lexer_next() for one pass over @p src.
+static size_t lex_once(const char *src, BenchMode mode)
+{
+    Lexer l;
+    lexer_init(&l, src, &g_compiler.config, "bench");
+    if (mode == MODE_BUFFERED)
+    {
+        lexer_buffer_tokens(&l);
+    }
+    size_t n = 0;
+    for (;;)
+    {
+        if (mode != MODE_SCAN)
+        {
+            for (int i = 0; i < PEEKS_PER_NEXT; i++)
+            {
+                lexer_peek(&l);
+            }
+        }
+        Token t = lexer_next(&l);
+        n++;
+        if (t.type == TOK_EOF)
+        {
+            return n;
+        }
+    }
+}
+
+static double run_mode(char **sources, int count, BenchMode mode, size_t *tokens)
+{
+    double best = 0.0;
+    double spent = 0.0;
+    for (int iter = 0; iter < MIN_ITERATIONS || spent < MIN_SECONDS; iter++)
+    {
+        size_t n = 0;
+        double start = z_get_monotonic_time();
+        for (int i = 0; i < count; i++)
+        {
+            n += lex_once(sources[i], mode);
+        }
+        double elapsed = z_get_monotonic_time() - start;
+        spent += elapsed;
+        // The buffers live in the arena; drop them between iterations.
+        arena_reset(&g_compiler.arena);
+        if (elapsed > 0.0 && (double)n / elapsed > best)
+        {
+            best = (double)n / elapsed;
+        }
+        *tokens = n;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <file.zc>...\n", argv[0]);
+        return 1;
+    }
+    memset(&g_compiler, 0, sizeof(g_compiler));
+    g_compiler.config.quiet = 1;
+    zarena_init(&g_compiler.arena);
+
+    char **sources = libc_malloc((size_t)argc * sizeof(char *));
+    int count = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        char *src = read_source(argv[i]);
+        if (!src)
+        {
+            fprintf(stderr, "cannot read %s\n", argv[i]);
+            return 1;
+        }
+        sources[count++] = src;
+    }
+
+    double buffered = 0.0;
+    for (int mode = MODE_SCAN; mode <= MODE_BUFFERED; mode++)
+    {
+        size_t tokens = 0;
+        double rate = run_mode(sources, count, (BenchMode)mode, &tokens);
+        printf("%-16s %10zu tokens %14.0f tokens/s\n", mode_names[mode], tokens, rate);
+        if (mode == MODE_BUFFERED)
+        {
+            buffered = rate;
+        }
+    }
+    printf("RESULT: %.0f\n", buffered);
+
+    for (int i = 0; i < count; i++)
+    {
+        libc_free(sources[i]);
+    }
+    libc_free(sources);
+    return 0;
+}
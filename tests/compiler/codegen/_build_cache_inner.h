@@ -0,0 +1,6 @@
+#ifndef BUILD_CACHE_INNER_H
+#define BUILD_CACHE_INNER_H
+
+#define INNER_VALUE 40
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef BUILD_CACHE_OUTER_H
+#define BUILD_CACHE_OUTER_H
+
+#include "_build_cache_inner.h"
+
+#define OUTER_VALUE (INNER_VALUE + 1)
+
+#endif
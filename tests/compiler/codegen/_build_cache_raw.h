@@ -0,0 +1,6 @@
+#ifndef BUILD_CACHE_RAW_H
+#define BUILD_CACHE_RAW_H
+
+#define RAW_VALUE 7
+
+#endif
@@ -75,6 +75,23 @@ COMP_AVG=$((COMP_MED / FILE_COUNT))
 echo "Compiler: median=$COMP_MED ms, MAD=$COMP_MAD ms ($FILE_COUNT files, avg $COMP_AVG ms/file)"
 add_result "Compiler (Full Suite Transpilation)" "$COMP_MED" "ms"
 
+echo ""
+echo "=== Lexer Benchmark: Tokens per Second ==="
+BENCH_LEXER="./zc-bench-lexer"
+if [ ! -x "$BENCH_LEXER" ]; then
+    BENCH_LEXER="./build/zc-bench-lexer"
+fi
+if [ -x "$BENCH_LEXER" ]; then
+    LEX_OUT=$($BENCH_LEXER std/*.zc)
+    echo "$LEX_OUT" | grep -v "RESULT:"
+    LEX_RATE=$(echo "$LEX_OUT" | grep "RESULT:" | cut -d' ' -f2)
+    if [ -n "$LEX_RATE" ]; then
+        add_result "Lexer (tokens/s, parser peek pattern)" "$LEX_RATE" "tokens/s"
+    fi
+else
+    echo "zc-bench-lexer not built (make zc-bench-lexer), skipping"
+fi
+
 echo ""
 echo "=== Runtime Benchmarks ==="
 echo "(Warmup + $ITERATIONS iterations, reporting median)"
@@ -30,6 +30,11 @@ if [ -n "$TEST_LIST" ]; then
     exit 0
 fi
 
+# Tests that need a cache of their own set ZC_CACHE_DIR; the rest must not fill the
+# user's cache directory with runtime headers
+export ZC_CACHE_DIR=$(mktemp -d)
+trap 'rm -rf "$ZC_CACHE_DIR"' EXIT
+
 echo "** Running Codegen Verification Tests **"
 
 #
@@ -108,6 +113,567 @@ fi
 # Cleanup
 rm -f "${TEST_NAME%.zc}.c" "${TEST_NAME%.zc}" a.out
 
+#
+# Test 4: Split translation units
+#         The -j build emits a header plus several units; its output must match
+#         the single-unit build of the same program. The program has a global, a trait
+#         vtable, an enum, a closure and generic instantiations, which every unit must
+#         agree on, and enough functions for three units.
+#
+
+TEST_NAME="test_split_units.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Split Units)... "
+
+SINGLE_OUT=$($ZC run "$TEST_DIR/$TEST_NAME" -q 2>&1)
+SPLIT_OUT=$($ZC run "$TEST_DIR/$TEST_NAME" -q -j 3 2>&1)
+SPLIT_RC=$?
+SPLIT_UNITS=$($ZC build "$TEST_DIR/$TEST_NAME" -v -j 3 -o split_units 2>&1 | grep -c " -c -o split_units\.[0-9]*\.o ")
+if [ $SPLIT_RC -ne 0 ]; then
+    echo "FAIL (Compilation error)"
+    ((FAILED++))
+elif [ "$SPLIT_UNITS" != "3" ]; then
+    echo "FAIL (Expected 3 units, compiled $SPLIT_UNITS)"
+    ((FAILED++))
+elif [ "$SINGLE_OUT" != "$SPLIT_OUT" ]; then
+    echo "FAIL (Output differs: '$SPLIT_OUT' vs '$SINGLE_OUT')"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -f "${TEST_NAME%.zc}" split_units a.out
+
+#
+# Test 5: Precompiled runtime header
+#         Builds include a cached zc_runtime header instead of the inline preamble. The
+#         header does not depend on the program: a second, different program built with
+#         the same flags reuses the one the first precompiled. The output of each must
+#         match --no-pch, and --emit-c must stay self-contained.
+#
+
+TEST_NAME="test_runtime_header.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Runtime Header)... "
+
+PCH_DIR=$(mktemp -d)
+FIRST_LOG=$(ZC_CACHE_DIR="$PCH_DIR" $ZC build "$TEST_DIR/test_split_units.zc" -v -o runtime_header_first 2>&1)
+PCH_LOG=$(ZC_CACHE_DIR="$PCH_DIR" $ZC build "$TEST_DIR/$TEST_NAME" -v -o runtime_header 2>&1)
+PCH_RET=$?
+PCH_OUT=$(./runtime_header 2>&1)
+INLINE_OUT=$($ZC run "$TEST_DIR/$TEST_NAME" -q --no-pch 2>&1)
+FIRST_OUT=$(./runtime_header_first 2>&1)
+FIRST_INLINE_OUT=$($ZC run "$TEST_DIR/test_split_units.zc" -q --no-pch 2>&1)
+ZC_CACHE_DIR="$PCH_DIR" $ZC "$TEST_DIR/$TEST_NAME" --emit-c > /dev/null 2>&1
+if [ $PCH_RET -ne 0 ]; then
+    echo "FAIL (Compilation error)"
+    ((FAILED++))
+elif ! echo "$FIRST_LOG" | grep -q "runtime header .* (precompiled)" ||
+    ! echo "$PCH_LOG" | grep -q "runtime header .* (reused)"; then
+    echo "FAIL (Runtime header not shared between programs)"
+    ((FAILED++))
+elif [ "$(ls "$PCH_DIR/runtime" | grep -c '\.gch$')" != "1" ]; then
+    echo "FAIL (Expected one precompiled header in the cache)"
+    ((FAILED++))
+elif [ "$PCH_OUT" != "$INLINE_OUT" ] || [ "$FIRST_OUT" != "$FIRST_INLINE_OUT" ]; then
+    echo "FAIL (Output differs: '$PCH_OUT' vs '$INLINE_OUT')"
+    ((FAILED++))
+elif grep -q "zc_runtime" "${TEST_NAME%.zc}.c"; then
+    echo "FAIL (--emit-c output includes the runtime header)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -rf "$PCH_DIR"
+rm -f "${TEST_NAME%.zc}.c" "${TEST_NAME%.zc}" runtime_header runtime_header_first a.out
+
+#
+# Test 6: In-process JIT run
+#         zc run --jit executes through libtcc when available and falls back to cc
+#         otherwise, saying which. Either way the program's stdout, stderr, global state
+#         and the status main() returns (3 in a copy of the program) must not change.
+#
+
+TEST_NAME="test_jit_run.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (JIT Run)... "
+
+JIT_SRC=$(mktemp -d)
+sed 's/return 0;/return 3;/' "$TEST_DIR/$TEST_NAME" > "$JIT_SRC/$TEST_NAME"
+CC_OUT=$($ZC run "$JIT_SRC/$TEST_NAME" -q 2>/dev/null)
+CC_RC=$?
+CC_ERR=$($ZC run "$JIT_SRC/$TEST_NAME" -q 2>&1 >/dev/null)
+JIT_OUT=$($ZC run "$JIT_SRC/$TEST_NAME" -q --jit 2>/dev/null)
+JIT_RC=$?
+JIT_ERR=$($ZC run "$JIT_SRC/$TEST_NAME" -q --jit 2>&1 >/dev/null)
+JIT_LOG=$($ZC run "$JIT_SRC/$TEST_NAME" --jit 2>&1)
+if [ $CC_RC -ne 3 ] || [ $JIT_RC -ne 3 ]; then
+    echo "FAIL (Expected exit status 3, got $CC_RC with cc and $JIT_RC with --jit)"
+    ((FAILED++))
+elif [ "$JIT_OUT" != "$CC_OUT" ] || [ "$JIT_ERR" != "$CC_ERR" ]; then
+    echo "FAIL (Output differs: '$JIT_OUT' vs '$CC_OUT')"
+    ((FAILED++))
+elif [ "$CC_OUT" != "$(printf 'ids 10 20\ncalls 2')" ] || [ "$CC_ERR" != "to stderr" ]; then
+    echo "FAIL (Unexpected program output '$CC_OUT')"
+    ((FAILED++))
+elif ! echo "$JIT_LOG" | grep -qE "\(jit\)|Fallback"; then
+    echo "FAIL (Neither a JIT run nor a fallback reported)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -rf "$JIT_SRC"
+rm -f "${TEST_NAME%.zc}" a.out
+
+#
+# Test 7: Pass timing and trace output
+#         --time-passes prints a per-phase table and --trace-out writes a Chrome
+#         trace with one span for every imported module, including the one imported
+#         by another module, and a span for the generic instantiation.
+#
+
+TEST_NAME="test_time_passes.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Time Passes)... "
+
+TRACE_FILE="${TEST_NAME%.zc}.trace.json"
+TABLE=$($ZC build "$TEST_DIR/$TEST_NAME" -q --time-passes --trace-out "$TRACE_FILE" 2>&1)
+TRACE_RC=$?
+MODULE_SPANS=0
+for MODULE in _time_passes_shapes _time_passes_units _time_passes_pair; do
+    MODULE_SPANS=$((MODULE_SPANS + $(grep -o "/$MODULE.zc\",\"cat\":\"import\"" "$TRACE_FILE" 2>/dev/null | wc -l)))
+done
+if [ $TRACE_RC -ne 0 ]; then
+    echo "FAIL (Compilation error)"
+    ((FAILED++))
+elif ! echo "$TABLE" | grep -q "codegen" || ! echo "$TABLE" | grep -qE "^ +import .* 3$"; then
+    echo "FAIL (Missing phase table, or not 3 import spans in it)"
+    ((FAILED++))
+elif ! grep -q '"traceEvents"' "$TRACE_FILE" || [ "$MODULE_SPANS" != "3" ]; then
+    echo "FAIL (Expected one trace span per imported module, got $MODULE_SPANS)"
+    ((FAILED++))
+elif ! grep -q '"name":"Pair<int32_t>","cat":"instantiate"' "$TRACE_FILE"; then
+    echo "FAIL (Missing instantiation span)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -f "$TRACE_FILE" "${TEST_NAME%.zc}" a.out
+
+#
+# Test 8: Memory report
+#         --mem-report splits arena bytes by subsystem and lists allocation sites. The
+#         program instantiates a generic impl for five types and uses a trait, so every
+#         subsystem allocates, and the allocation counts of the rows add up to the total.
+#
+
+TEST_NAME="test_mem_report.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Memory Report)... "
+
+REPORT=$($ZC build "$TEST_DIR/$TEST_NAME" -q --mem-report 2>&1)
+REPORT_RC=$?
+# Rows with no allocations, and the row allocations minus the total.
+EMPTY_ROWS=$(echo "$REPORT" | awk '/^ +(other|ast|types|templates|symbols|emitter|names) / && $NF == 0' | wc -l)
+ROW_DIFF=$(echo "$REPORT" | awk '/^ +(other|ast|types|templates|symbols|emitter|names) / { n += $NF }
+    /^ +total / { n -= $NF } END { print n + 0 }')
+if [ $REPORT_RC -ne 0 ]; then
+    echo "FAIL (Compilation error)"
+    ((FAILED++))
+elif ! echo "$REPORT" | grep -qE "^ +templates +[0-9.]+[KM]iB" || ! echo "$REPORT" | grep -q "Top sites"; then
+    echo "FAIL (Missing memory report)"
+    ((FAILED++))
+elif [ "$EMPTY_ROWS" != "0" ]; then
+    echo "FAIL (A subsystem reported no allocations)"
+    ((FAILED++))
+elif [ "$ROW_DIFF" != "0" ]; then
+    echo "FAIL (Subsystem allocations do not add up to the total)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -f "${TEST_NAME%.zc}" a.out
+
+#
+# Test 9: Compile server
+#         The program imports many modules. A repeated request is forked from the
+#         post-import snapshot and behaves like a local run, also when an unrelated
+#         environment variable changed. An edit below the imports still reuses the
+#         snapshot; an edit to an imported file does not.
+#
+
+TEST_NAME="test_compile_server.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Compile Server)... "
+
+SERVE_SRC=$(mktemp -d)
+cp "$TEST_DIR/$TEST_NAME" "$TEST_DIR/_compile_server_import.zc" "$SERVE_SRC/"
+SERVE_SOCK=$(mktemp -u /tmp/zc_serve_XXXXXX.sock)
+SERVE_LOG=$(mktemp)
+$ZC serve --socket "$SERVE_SOCK" -v > "$SERVE_LOG" 2>&1 &
+SERVE_PID=$!
+for _ in $(seq 1 50); do
+    [ -S "$SERVE_SOCK" ] && break
+    sleep 0.1
+done
+
+LOCAL_OUT=$($ZC run "$SERVE_SRC/$TEST_NAME" -q 2>&1)
+FIRST_OUT=$(ZC_SERVER="$SERVE_SOCK" $ZC run "$SERVE_SRC/$TEST_NAME" -q 2>&1)
+FIRST_RC=$?
+SECOND_OUT=$(SERVE_NOTE=second ZC_SERVER="$SERVE_SOCK" $ZC run "$SERVE_SRC/$TEST_NAME" -q 2>&1)
+SECOND_RC=$?
+sed -i 's/"served"/"edited"/' "$SERVE_SRC/$TEST_NAME"
+BODY_OUT=$(ZC_SERVER="$SERVE_SOCK" $ZC run "$SERVE_SRC/$TEST_NAME" -q 2>&1)
+sed -i 's/return 41;/return 141;/' "$SERVE_SRC/_compile_server_import.zc"
+IMPORT_OUT=$(ZC_SERVER="$SERVE_SOCK" $ZC run "$SERVE_SRC/$TEST_NAME" -q 2>&1)
+kill $SERVE_PID 2>/dev/null
+wait $SERVE_PID 2>/dev/null
+SNAPSHOTS=$(grep -o "Snapshot [a-z]*" "$SERVE_LOG" | cut -d' ' -f2 | tr '\n' ' ')
+
+if [ $FIRST_RC -ne 0 ] || [ $SECOND_RC -ne 0 ]; then
+    echo "FAIL (Served compilation error)"
+    ((FAILED++))
+elif [ "$FIRST_OUT" != "$LOCAL_OUT" ] || [ "$SECOND_OUT" != "$LOCAL_OUT" ]; then
+    echo "FAIL (Served output differs from local run)"
+    ((FAILED++))
+elif [ "$BODY_OUT" != "edited 42" ] || [ "$IMPORT_OUT" != "edited 142" ]; then
+    echo "FAIL (Edits not picked up: '$BODY_OUT', '$IMPORT_OUT')"
+    ((FAILED++))
+elif [ "$SNAPSHOTS" != "miss hit hit miss " ]; then
+    echo "FAIL (Expected snapshot 'miss hit hit miss', got '$SNAPSHOTS')"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -rf "$SERVE_SRC"
+rm -f "$SERVE_SOCK" "$SERVE_LOG" a.out
+
+#
+# Test 10: Dependency file
+#          --emit-deps names the output, the main file and every transitively imported file,
+#          escaping the space in their directory. A cache hit writes the same rule from
+#          the stored manifest.
+#
+
+TEST_NAME="test_emit_deps.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Dependency File)... "
+
+DEPS_SRC="$(mktemp -d)/dep dir"
+mkdir -p "$DEPS_SRC"
+cp "$TEST_DIR/$TEST_NAME" "$TEST_DIR/_emit_deps_outer.zc" "$TEST_DIR/_emit_deps_inner.zc" "$DEPS_SRC/"
+$ZC build "$DEPS_SRC/$TEST_NAME" -o emit_deps -q --cache --emit-deps emit_deps.d
+HIT_LOG=$($ZC build "$DEPS_SRC/$TEST_NAME" -o emit_deps -v --cache --emit-deps emit_deps_hit.d 2>&1)
+
+if ! head -n 1 emit_deps.d | grep -q "^emit_deps:"; then
+    echo "FAIL (Missing target)"
+    ((FAILED++))
+elif [ "$(grep -c 'dep\\ dir/' emit_deps.d)" != "3" ] || ! grep -q "/$TEST_NAME" emit_deps.d ||
+    ! grep -q "/_emit_deps_outer.zc" emit_deps.d || ! grep -q "/_emit_deps_inner.zc" emit_deps.d; then
+    echo "FAIL (Missing or unescaped dependencies)"
+    ((FAILED++))
+elif ! echo "$HIT_LOG" | grep -q "Cache hit" || ! cmp -s emit_deps.d emit_deps_hit.d; then
+    echo "FAIL (Dependency file differs after a cache hit)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -rf "$(dirname "$DEPS_SRC")"
+rm -f emit_deps emit_deps.d emit_deps_hit.d
+
+#
+# Test 11: Lazy generic methods
+#          Methods of generic impls are emitted only when referenced, directly or from
+#          another emitted method; --no-lazy-methods keeps all of them.
+#
+
+TEST_NAME="test_lazy_methods.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Lazy Methods)... "
+
+$ZC transpile "$TEST_DIR/$TEST_NAME" -o lazy_methods.c -q
+$ZC transpile "$TEST_DIR/$TEST_NAME" -o lazy_methods_off.c -q --no-lazy-methods
+LAZY_OUT=$($ZC run "$TEST_DIR/$TEST_NAME" -q 2>&1)
+EAGER_OUT=$($ZC run "$TEST_DIR/$TEST_NAME" -q --no-lazy-methods 2>&1)
+
+if [ "$LAZY_OUT" != "42" ] || [ "$EAGER_OUT" != "42" ]; then
+    echo "FAIL (Output differs: '$LAZY_OUT' / '$EAGER_OUT')"
+    ((FAILED++))
+elif grep -q "Holder__int32_t__unused_helper" lazy_methods.c ||
+    grep -q "Vec__int32_t__reverse" lazy_methods.c; then
+    echo "FAIL (Unreferenced method emitted)"
+    ((FAILED++))
+elif ! grep -q "Holder__int32_t__get(" lazy_methods.c; then
+    echo "FAIL (Method called from another method dropped)"
+    ((FAILED++))
+elif ! grep -q "Holder__int32_t__unused_helper" lazy_methods_off.c; then
+    echo "FAIL (--no-lazy-methods dropped a method)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -f lazy_methods.c lazy_methods_off.c "${TEST_NAME%.zc}" a.out
+
+#
+# Test 12: Shared generic instantiations
+#          With --share-generics, Vec<Label*> and Vec<Point*> share method bodies: one
+#          instantiation forwards to the other through pointer casts.
+#
+
+TEST_NAME="test_share_generics.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Shared Generics)... "
+
+$ZC transpile "$TEST_DIR/$TEST_NAME" -o share_generics.c -q --share-generics
+$ZC transpile "$TEST_DIR/$TEST_NAME" -o share_generics_off.c -q
+SHARED_OUT=$($ZC run "$TEST_DIR/$TEST_NAME" -q --share-generics 2>&1)
+PLAIN_OUT=$($ZC run "$TEST_DIR/$TEST_NAME" -q 2>&1)
+
+if [ "$SHARED_OUT" != "3 7 1 2" ] || [ "$PLAIN_OUT" != "3 7 1 2" ]; then
+    echo "FAIL (Output differs: '$SHARED_OUT' / '$PLAIN_OUT')"
+    ((FAILED++))
+elif ! grep -q "(Vec__[A-Za-z]*Ptr\*)self" share_generics.c; then
+    echo "FAIL (No method body shared)"
+    ((FAILED++))
+elif grep -q "(Vec__[A-Za-z]*Ptr\*)self" share_generics_off.c; then
+    echo "FAIL (Bodies shared without --share-generics)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -f share_generics.c share_generics_off.c "${TEST_NAME%.zc}" a.out
+
+#
+# Test 13: Parallel type checking
+#          zc check --check-jobs prints the diagnostics of every function body in the same
+#          order as a single-process check. Outside zc check the flag is ignored with a
+#          warning.
+#
+
+TEST_NAME="test_check_jobs.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Check Jobs)... "
+
+SERIAL_OUT=$($ZC check "$TEST_DIR/$TEST_NAME" 2>&1)
+JOBS_OUT=$($ZC check --check-jobs 3 "$TEST_DIR/$TEST_NAME" 2>&1)
+BUILD_OUT=$($ZC transpile --check-jobs 3 "$TEST_DIR/$TEST_NAME" -o check_jobs.c 2>&1)
+
+if [ "$(echo "$SERIAL_OUT" | grep -c "Unused parameter")" != "6" ]; then
+    echo "FAIL (Expected 6 warnings from a serial check)"
+    ((FAILED++))
+elif [ "$SERIAL_OUT" != "$JOBS_OUT" ]; then
+    echo "FAIL (Diagnostics differ with --check-jobs)"
+    ((FAILED++))
+elif ! echo "$BUILD_OUT" | grep -q "'--check-jobs' only applies to 'zc check'"; then
+    echo "FAIL (No warning for --check-jobs outside zc check)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -f check_jobs.c
+
+#
+# Test 14: Comptime cache
+#          The output of a comptime block is stored on the first compile and reused on the
+#          next one, and the program built from the reused output behaves the same.
+#
+
+TEST_NAME="test_comptime_cache.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Comptime Cache)... "
+
+COMPTIME_CACHE_DIR=$(mktemp -d)
+COLD_LOG=$(ZC_CACHE_DIR="$COMPTIME_CACHE_DIR" $ZC check "$TEST_DIR/$TEST_NAME" -v 2>&1)
+WARM_LOG=$(ZC_CACHE_DIR="$COMPTIME_CACHE_DIR" $ZC check "$TEST_DIR/$TEST_NAME" -v 2>&1)
+WARM_OUT=$(ZC_CACHE_DIR="$COMPTIME_CACHE_DIR" $ZC run "$TEST_DIR/$TEST_NAME" -q 2>&1)
+OFF_LOG=$(ZC_CACHE_DIR="$COMPTIME_CACHE_DIR" $ZC check "$TEST_DIR/$TEST_NAME" -v \
+    --no-comptime-cache 2>&1)
+
+if ! echo "$COLD_LOG" | grep -q "Cache comptime 0 hits, 1 miss"; then
+    echo "FAIL (First compile did not run the block)"
+    ((FAILED++))
+elif ! echo "$WARM_LOG" | grep -q "Cache comptime 1 hit, 0 misses"; then
+    echo "FAIL (Comptime output not reused)"
+    ((FAILED++))
+elif [ "$WARM_OUT" != "55" ]; then
+    echo "FAIL (Expected 55 from the cached output, got '$WARM_OUT')"
+    ((FAILED++))
+elif echo "$OFF_LOG" | grep -q "Cache comptime"; then
+    echo "FAIL (--no-comptime-cache still used the cache)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -rf "$COMPTIME_CACHE_DIR" "${TEST_NAME%.zc}"
+
+#
+# Test 15: Constant folding
+#          Branches and match arms whose conditions fold never reach the generated C,
+#          string literals joined with + become one literal, and a function whose @cfg is
+#          false is dropped when zc runs the C compiler itself. --no-fold keeps the
+#          branches but still joins the strings.
+#
+
+TEST_NAME="test_const_fold.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Constant Folding)... "
+
+$ZC "$TEST_DIR/$TEST_NAME" --emit-c > /dev/null 2>&1
+FOLD_RC=$?
+# Read the C before the build below replaces it.
+DEAD_COUNT=$(grep -c "marker" "${TEST_NAME%.zc}.c" 2>/dev/null)
+JOINED_COUNT=$(grep -c '"folded"' "${TEST_NAME%.zc}.c" 2>/dev/null)
+FOLD_LOG=$($ZC build "$TEST_DIR/$TEST_NAME" -v -o "${TEST_NAME%.zc}" 2>&1)
+FOLD_OUT=$(./"${TEST_NAME%.zc}" 2>&1)
+NO_FOLD_LOG=$($ZC "$TEST_DIR/$TEST_NAME" --emit-c --no-fold -v -o const_fold_off 2>&1)
+NO_FOLD_DEAD=$(grep -c "marker" const_fold_off.c 2>/dev/null)
+NO_FOLD_OUT=$(./const_fold_off 2>&1)
+
+if [ $FOLD_RC -ne 0 ]; then
+    echo "FAIL (Compilation error)"
+    ((FAILED++))
+elif [ "$DEAD_COUNT" != "0" ]; then
+    echo "FAIL (Dead branch emitted)"
+    ((FAILED++))
+elif [ "$JOINED_COUNT" = "0" ]; then
+    echo "FAIL (String concatenation not folded)"
+    ((FAILED++))
+elif ! echo "$FOLD_LOG" | grep -q "Fold .* 1 @cfg item dropped"; then
+    echo "FAIL (@cfg function not dropped)"
+    ((FAILED++))
+elif [ "$FOLD_OUT" != "folded 33 10.000000" ]; then
+    echo "FAIL (Expected 'folded 33 10.000000', got '$FOLD_OUT')"
+    ((FAILED++))
+elif [ "$NO_FOLD_DEAD" != "3" ] || ! echo "$NO_FOLD_LOG" | grep -q "Fold off, 1 string sum"; then
+    echo "FAIL (--no-fold still folded, or did not join the strings)"
+    ((FAILED++))
+elif [ "$NO_FOLD_OUT" != "$FOLD_OUT" ]; then
+    echo "FAIL (Output differs with --no-fold: '$NO_FOLD_OUT')"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -f "${TEST_NAME%.zc}.c" "${TEST_NAME%.zc}" const_fold_off.c const_fold_off
+
+#
+# Test 16: Build cache
+#          A repeated --cache build is served from the cache, editing an imported file
+#          makes the next build rebuild, and `zc cache clean` empties the cache directory.
+#
+
+TEST_NAME="test_build_cache.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Build Cache)... "
+
+BUILD_CACHE_DIR=$(mktemp -d)
+BUILD_SRC_DIR=$(mktemp -d)
+cp "$TEST_DIR/$TEST_NAME" "$TEST_DIR/_build_cache_import.zc" "$BUILD_SRC_DIR/"
+BUILD_BIN="$BUILD_SRC_DIR/${TEST_NAME%.zc}"
+
+ZC_CACHE_DIR="$BUILD_CACHE_DIR" $ZC build "$BUILD_SRC_DIR/$TEST_NAME" --cache -q -o "$BUILD_BIN"
+HIT_LOG=$(ZC_CACHE_DIR="$BUILD_CACHE_DIR" $ZC build "$BUILD_SRC_DIR/$TEST_NAME" --cache -v \
+    -o "$BUILD_BIN" 2>&1)
+sed -i 's/return 41;/return 42;/' "$BUILD_SRC_DIR/_build_cache_import.zc"
+MISS_LOG=$(ZC_CACHE_DIR="$BUILD_CACHE_DIR" $ZC build "$BUILD_SRC_DIR/$TEST_NAME" --cache -v \
+    -o "$BUILD_BIN" 2>&1)
+MISS_OUT=$("$BUILD_BIN" 2>&1)
+ZC_CACHE_DIR="$BUILD_CACHE_DIR" $ZC cache clean > /dev/null 2>&1
+LEFT=$(find "$BUILD_CACHE_DIR" -type f | wc -l)
+
+if ! echo "$HIT_LOG" | grep -q "Cache hit"; then
+    echo "FAIL (Second build not served from the cache)"
+    ((FAILED++))
+elif ! echo "$MISS_LOG" | grep -q "Cache miss" ||
+    ! echo "$MISS_LOG" | grep -q "_build_cache_import.zc"; then
+    echo "FAIL (Edited import did not invalidate the entry)"
+    ((FAILED++))
+elif [ "$MISS_OUT" != "42" ]; then
+    echo "FAIL (Expected 42 from the rebuilt binary, got '$MISS_OUT')"
+    ((FAILED++))
+elif [ "$LEFT" -ne 0 ]; then
+    echo "FAIL ($LEFT files left after zc cache clean)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -rf "$BUILD_CACHE_DIR" "$BUILD_SRC_DIR"
+
+#
+# Test 17: Build cache and C headers
+#          Editing a header reached only through another header, or one included from a
+#          raw block, makes the next --cache build rebuild.
+#
+
+TEST_NAME="test_build_cache_headers.zc"
+echo -n "Testing $TEST_DIR/$TEST_NAME (Build Cache Headers)... "
+
+BUILD_CACHE_DIR=$(mktemp -d)
+BUILD_SRC_DIR=$(mktemp -d)
+cp "$TEST_DIR/$TEST_NAME" "$TEST_DIR/_build_cache_outer.h" "$TEST_DIR/_build_cache_inner.h" \
+    "$TEST_DIR/_build_cache_raw.h" "$BUILD_SRC_DIR/"
+BUILD_BIN="$BUILD_SRC_DIR/${TEST_NAME%.zc}"
+
+ZC_CACHE_DIR="$BUILD_CACHE_DIR" $ZC build "$BUILD_SRC_DIR/$TEST_NAME" --cache -q -o "$BUILD_BIN"
+sed -i 's/INNER_VALUE 40/INNER_VALUE 41/' "$BUILD_SRC_DIR/_build_cache_inner.h"
+INNER_LOG=$(ZC_CACHE_DIR="$BUILD_CACHE_DIR" $ZC build "$BUILD_SRC_DIR/$TEST_NAME" --cache -v \
+    -o "$BUILD_BIN" 2>&1)
+INNER_OUT=$("$BUILD_BIN" 2>&1)
+sed -i 's/RAW_VALUE 7/RAW_VALUE 8/' "$BUILD_SRC_DIR/_build_cache_raw.h"
+RAW_LOG=$(ZC_CACHE_DIR="$BUILD_CACHE_DIR" $ZC build "$BUILD_SRC_DIR/$TEST_NAME" --cache -v \
+    -o "$BUILD_BIN" 2>&1)
+RAW_OUT=$("$BUILD_BIN" 2>&1)
+LEFT=$(find "$BUILD_CACHE_DIR" -name "*.d" | wc -l)
+
+if ! echo "$INNER_LOG" | grep -q "Cache miss" ||
+    ! echo "$INNER_LOG" | grep -q "_build_cache_inner.h"; then
+    echo "FAIL (Edited nested header did not invalidate the entry)"
+    ((FAILED++))
+elif [ "$INNER_OUT" != "42 7" ]; then
+    echo "FAIL (Expected '42 7' after the nested header edit, got '$INNER_OUT')"
+    ((FAILED++))
+elif ! echo "$RAW_LOG" | grep -q "Cache miss" ||
+    ! echo "$RAW_LOG" | grep -q "_build_cache_raw.h"; then
+    echo "FAIL (Edited raw-block header did not invalidate the entry)"
+    ((FAILED++))
+elif [ "$RAW_OUT" != "42 8" ]; then
+    echo "FAIL (Expected '42 8' after the raw-block header edit, got '$RAW_OUT')"
+    ((FAILED++))
+elif [ "$LEFT" -ne 0 ]; then
+    echo "FAIL ($LEFT dependency files left in the cache directory)"
+    ((FAILED++))
+else
+    echo "PASS"
+    ((PASSED++))
+fi
+
+# Cleanup
+rm -rf "$BUILD_CACHE_DIR" "$BUILD_SRC_DIR"
+
 echo "----------------------------------------"
 echo "Summary:"
 echo "-> Passed: $PASSED"
@@ -25,6 +25,10 @@ if [ -z "$TEST_LIST" ]; then
     exit 0
 fi
 
+# Token tables of the imported modules go to a throwaway cache, not the user's
+export ZC_CACHE_DIR=$(mktemp -d)
+trap 'rm -rf "$ZC_CACHE_DIR"' EXIT
+
 echo "Running Example Transpilation Tests..."
 
 while IFS= read -r file; do
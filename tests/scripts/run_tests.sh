@@ -148,7 +148,11 @@ echo "** Running Zen C test suite (mode: $MODE, compiler: $CC_NAME, jobs: $JOBS)
 
 # Create temp dir for parallel results
 RESULTS_DIR=$(mktemp -d)
-trap 'rm -rf "$RESULTS_DIR"' EXIT
+
+# Keep the precompiled runtime headers and comptime output the tests
+# produce out of the user's cache directory
+export ZC_CACHE_DIR=$(mktemp -d)
+trap 'rm -rf "$RESULTS_DIR" "$ZC_CACHE_DIR"' EXIT
 
 run_test() {
     local test_file="$1"